@@ -0,0 +1,125 @@
+/**
+ * @file AllocationCounter.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "AllocationCounter.h"
+
+#ifdef GO_CAM_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <new>
+#include <errno.h>
+#include <stdlib.h>
+
+// Constant initialisation, usable before main
+static std::atomic<long long int> NbAllocations( 0 );
+
+#ifdef __GLIBC__
+
+// Wrap the malloc family using glibc internal entry points
+extern "C"
+{
+	void * __libc_malloc( size_t Size );
+	void * __libc_calloc( size_t NbElements, size_t Size );
+	void * __libc_realloc( void * Ptr, size_t Size );
+	void * __libc_memalign( size_t Alignment, size_t Size );
+
+	void * malloc( size_t Size )
+	{
+		NbAllocations++;
+		return __libc_malloc( Size );
+	}
+
+	void * calloc( size_t NbElements, size_t Size )
+	{
+		NbAllocations++;
+		return __libc_calloc( NbElements, Size );
+	}
+
+	void * realloc( void * Ptr, size_t Size )
+	{
+		NbAllocations++;
+		return __libc_realloc( Ptr, Size );
+	}
+
+	void * memalign( size_t Alignment, size_t Size )
+	{
+		NbAllocations++;
+		return __libc_memalign( Alignment, Size );
+	}
+
+	void * aligned_alloc( size_t Alignment, size_t Size )
+	{
+		NbAllocations++;
+		return __libc_memalign( Alignment, Size );
+	}
+
+	int posix_memalign( void ** Ptr, size_t Alignment, size_t Size )
+	{
+		NbAllocations++;
+		*Ptr = __libc_memalign( Alignment, Size );
+		return ( *Ptr == nullptr ) ? ENOMEM : 0;
+	}
+}
+
+#else
+
+// Only C++ allocations
+void * operator new( size_t Size )
+{
+	NbAllocations++;
+	void * Ptr = malloc( Size > 0 ? Size : 1 );
+	if ( Ptr == nullptr )
+	{
+		throw std::bad_alloc();
+	}
+	return Ptr;
+}
+
+void * operator new[]( size_t Size )
+{
+	return operator new( Size );
+}
+
+void operator delete( void * Ptr ) noexcept
+{
+	free( Ptr );
+}
+
+void operator delete[]( void * Ptr ) noexcept
+{
+	free( Ptr );
+}
+
+#endif // __GLIBC__
+
+#endif // GO_CAM_COUNT_ALLOCATIONS
+
+/**
+* @brief Is allocation counting compiled in?
+* @return true if GetNbAllocations counts allocations
+*/
+bool AllocationCounter::IsEnabled()
+{
+#ifdef GO_CAM_COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+* @brief Get number of heap allocations since the beginning of the process
+* @return Number of allocations (always 0 if not enabled)
+*/
+long long int AllocationCounter::GetNbAllocations()
+{
+#ifdef GO_CAM_COUNT_ALLOCATIONS
+	return NbAllocations.load();
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,36 @@
+/**
+ * @file AllocationCounter.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __ALLOCATION_COUNTER_H__
+#define __ALLOCATION_COUNTER_H__
+
+#define AllocationWarmupFrames 50		// Frames before checking that the steady state loop does not allocate
+
+/**
+ * @class AllocationCounter
+ * @brief Debug counter of heap allocations of the process, active only when compiled with GO_CAM_COUNT_ALLOCATIONS
+ *		  (cmake -DCOUNT_ALLOCATIONS=1). With glibc, the malloc family is wrapped, thus OpenCV buffers are counted.
+ *		  Elsewhere, only C++ allocations (operator new) are counted.
+ */
+class AllocationCounter
+{
+public:
+	/**
+    * @brief Is allocation counting compiled in?
+    * @return true if GetNbAllocations counts allocations
+	*/
+	static bool IsEnabled();
+
+	/**
+    * @brief Get number of heap allocations since the beginning of the process
+    * @return Number of allocations (always 0 if not enabled)
+	*/
+	static long long int GetNbAllocations();
+};
+
+#endif // __ALLOCATION_COUNTER_H__
@@ -77,7 +77,7 @@ void CalibrationContainer::Draw( cv::Mat& WhereToDraw, double scale /*= 1.0*/, i
 
 /**
 * @brief Compute calibration using 17 points.
-* 17 points calibration : good one, generate it from NumCells
+* 17 points calibration : good one, generate it from NumColumns and NumLines
 * 
 * On a theorical 7x7 goban, point to calibrate must plus place in this order:
 * 			  1   2  .   3  .   4  5 
@@ -88,15 +88,22 @@ void CalibrationContainer::Draw( cv::Mat& WhereToDraw, double scale /*= 1.0*/, i
 * 			 14   .  .   .  .   .  8 
 * 			 13  12  .  11  .  10  9
 * 
-* Same pattern apply to bigger goban. Point 1 is aa, point 2 is ab, and so one
+* Same pattern apply to bigger or rectangular goban. Point 1 is aa, point 2 is ab, and so one.
+* On even sizes, middle points (3, 7, 11, 15 and 17) are on the line just after the center.
 * @param ImageSize [in] Size of the image
 * @return True if calibration process worked.
 */
 bool CalibrationContainer::ComputeCalibrationParameters( cv::Size& ImageSize )
 {
+	// Goban is centered on (0,0), y axis goes up. Middle positions are the ones of the middle lines.
+	float HalfX = GobanHalfExtent( NumColumns, 1.0f );
+	float HalfY = GobanHalfExtent( NumLines, 1.0f );
+	float MidX = (float)(NumColumns/2) - HalfX;
+	float MidY = HalfY - (float)(NumLines/2);
+
 	// Let the compiler optimize it as the implicite constructor initialisation is tricky
-	float PosX[NumOfPointsToCalibrate] ={-((float)(NumCells/2)), -((float)(NumCells/2-1)), 0.0f, ((float)(NumCells/2-1)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2-1)), 0.0f, -((float)(NumCells/2-1)), -((float)(NumCells/2)), -((float)(NumCells/2)), -((float)(NumCells/2)), -((float)(NumCells/2)), 0.0f};
-	float PosY[NumOfPointsToCalibrate] ={((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2)), ((float)(NumCells/2-1)), 0.0f, -((float)(NumCells/2-1)), -((float)(NumCells/2)), -((float)(NumCells/2)), -((float)(NumCells/2)), -((float)(NumCells/2)), -((float)(NumCells/2)), -((float)(NumCells/2-1)), 0.0f, ((float)(NumCells/2-1)), 0.0f};
+	float PosX[NumOfPointsToCalibrate] ={-HalfX, -(HalfX-1.0f), MidX, (HalfX-1.0f), HalfX, HalfX, HalfX, HalfX, HalfX, (HalfX-1.0f), MidX, -(HalfX-1.0f), -HalfX, -HalfX, -HalfX, -HalfX, MidX};
+	float PosY[NumOfPointsToCalibrate] ={HalfY, HalfY, HalfY, HalfY, HalfY, (HalfY-1.0f), MidY, -(HalfY-1.0f), -HalfY, -HalfY, -HalfY, -HalfY, -HalfY, -(HalfY-1.0f), MidY, (HalfY-1.0f), MidY};
 
 	if ( size() != NumOfPointsToCalibrate )
 	{
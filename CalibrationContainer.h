@@ -19,6 +19,17 @@
 // 17 points 
 #define NumOfPointsToCalibrate 17		// 17 points are used to calibrate the goban within the camera view
 
+/**
+* @brief Distance between the center of the goban and its first/last line, the goban is centered on (0,0)
+* @param NbLines [in] Number of lines (or columns) of the goban
+* @param SizeOfCells [in] Size of cells
+* @return Half extent of the grid
+*/
+inline float GobanHalfExtent( int NbLines, float SizeOfCells )
+{
+	return (float)(NbLines-1)*SizeOfCells/2.0f;
+}
+
 /**
  * @class CalibrationContainer 
  * @brief Class to compute and hold calibration
@@ -34,14 +45,16 @@ public:
 
 	// Save parameters to recompute calibration at other scale (i.e. another SizeOfCells) if mandatory
 	float SizeOfCells = 1.0f;	// Fake size of cells
-	int NumCells;				// Number of cells, i.e. goban size
+	int NumColumns;				// Number of columns of the goban
+	int NumLines;				// Number of lines of the goban
 
 	/**
     * @brief Constructor
-    * @param _NumCells [in] Size of the goban
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
 	* @param _SizeOfCells [in] Size of cells, considered as square even if it not actually the case
 	*/
-	CalibrationContainer(int _NumCells, float _SizeOfCells) : NumCells(_NumCells), SizeOfCells(_SizeOfCells)
+	CalibrationContainer(int _NumColumns, int _NumLines, float _SizeOfCells) : SizeOfCells(_SizeOfCells), NumColumns(_NumColumns), NumLines(_NumLines)
 	{
 	}
 
@@ -79,7 +92,7 @@ public:
 
 	/**
     * @brief Compute calibration using 17 points.
- 	* 17 points calibration : good one, generate it from NumCells
+ 	* 17 points calibration : good one, generate it from NumColumns and NumLines
 	* 
 	* On a theorical 7x7 goban, point to calibrate must plus place in this order:
 	* 			  1   2  .   3  .   4  5 
@@ -90,7 +103,8 @@ public:
 	* 			 14   .  .   .  .   .  8 
 	* 			 13  12  .  11  .  10  9
 	* 
-	* Same pattern apply to bigger goban. Point 1 is aa, point 2 is ab, and so one
+	* Same pattern apply to bigger or rectangular goban. Point 1 is aa, point 2 is ab, and so one.
+	* On even sizes, middle points (3, 7, 11, 15 and 17) are on the line just after the center.
 	* @param ImageSize [in] Size of the image
 	* @return True if calibration process worked.
 	*/
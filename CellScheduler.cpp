@@ -0,0 +1,173 @@
+/**
+ * @file CellScheduler.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "CellScheduler.h"
+
+/**
+* @brief Constructor
+* @param _NumColumns [in] Number of columns of the goban
+* @param _NumLines [in] Number of lines of the goban
+*/
+CellScheduler::CellScheduler( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines), ActiveNeighbourhood(_NumColumns*_NumLines, false),
+	LastCheckFrame(_NumColumns*_NumLines, 0), CheckedThisFrame(_NumColumns*_NumLines, false)
+{
+	// No allocation while scheduling
+	ActiveCells.reserve( _NumColumns*_NumLines );
+	StableCells.reserve( _NumColumns*_NumLines );
+}
+
+/**
+* @brief Select and order cells to process for the current frame. Must be called after motion detection.
+* @param AllDetectors [in] All stone detectors
+* @param GameState [in] Current game state (committed stones)
+* @param CellsToProcess [out] Ordered cells on which stone detection should run
+* @param NbMandatory [out] Number of cells (at the beginning of CellsToProcess) to process whatever the budget
+*/
+void CellScheduler::Schedule( StoneDetectorStorage& AllDetectors, GobanState& GameState, std::vector<int>& CellsToProcess, int& NbMandatory )
+{
+	const int NbCells = NumColumns*NumLines;
+
+	FrameNumber++;
+	CellsToProcess.clear();
+
+	// Mark cells with motion on them or on one of their 8 neighbours
+	std::fill( ActiveNeighbourhood.begin(), ActiveNeighbourhood.end(), false );
+	for ( int a = 0; a < NumColumns; a++ )
+	{
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			if ( AllDetectors.InMotionExtended[AllDetectors.Index( a, b )] == false )
+			{
+				continue;
+			}
+
+			for ( int na = Max( a-1, 0 ); na <= Min( a+1, NumColumns-1 ); na++ )
+			{
+				for ( int nb = Max( b-1, 0 ); nb <= Min( b+1, NumLines-1 ); nb++ )
+				{
+					ActiveNeighbourhood[AllDetectors.Index( na, nb )] = true;
+				}
+			}
+		}
+	}
+
+	// Heartbeat: each frame, one slice of the goban is rechecked
+	int HeartbeatSlice = (int)(FrameNumber % (unsigned int)HeartbeatPeriod);
+
+	// Overdue cells first, then cells in or near motion, then stable cells in round-robin order
+	ActiveCells.clear();
+	StableCells.clear();
+	for ( int Offset = 0; Offset < NbCells; Offset++ )
+	{
+		int Cell = (RoundRobinStart + Offset) % NbCells;
+		int a = Cell/NumLines;
+		int b = Cell%NumLines;
+
+		if ( FrameNumber - LastCheckFrame[Cell] >= (unsigned int)MaxFramesWithoutCheck )
+		{
+			CellsToProcess.push_back( Cell );
+			continue;
+		}
+
+		// Committed stone, still detected, not a captured stone waiting for removal
+		bool Committed = ( GameState.Goban[a][b].State != StoneState::Empty &&
+						   AllDetectors.State[Cell] == GameState.Goban[a][b].State &&
+						   AllDetectors.AwaitingRemoval[Cell] == false );
+
+		if ( Enabled == true && Committed == true && ActiveNeighbourhood[Cell] == false && (Cell % HeartbeatPeriod) != HeartbeatSlice )
+		{
+			// Quiet committed stone, skip it
+			continue;
+		}
+
+		if ( ActiveNeighbourhood[Cell] == true )
+		{
+			ActiveCells.push_back( Cell );
+		}
+		else
+		{
+			StableCells.push_back( Cell );
+		}
+	}
+
+	NbMandatory = (int)CellsToProcess.size();
+	CellsToProcess.insert( CellsToProcess.end(), ActiveCells.begin(), ActiveCells.end() );
+	NbStableStart = (int)CellsToProcess.size();
+	CellsToProcess.insert( CellsToProcess.end(), StableCells.begin(), StableCells.end() );
+
+	if ( FrameBudget <= 0.0 )
+	{
+		// No budget, everything must be done
+		NbMandatory = (int)CellsToProcess.size();
+	}
+}
+
+/**
+* @brief Record processed cells and prepare next round-robin
+* @param CellsToProcess [in] Ordered cells given by Schedule
+* @param NbProcessed [in] Number of cells actually processed (from the beginning of CellsToProcess)
+* @param NotProcessedCells [out] All cells of the goban not processed for this frame
+*/
+void CellScheduler::SetProcessed( const std::vector<int>& CellsToProcess, int NbProcessed, std::vector<int>& NotProcessedCells )
+{
+	std::fill( CheckedThisFrame.begin(), CheckedThisFrame.end(), false );
+	for ( int Pos = 0; Pos < NbProcessed; Pos++ )
+	{
+		int Cell = CellsToProcess[Pos];
+		CheckedThisFrame[Cell] = true;
+
+		MaxObservedFramesWithoutCheck = std::max( MaxObservedFramesWithoutCheck, FrameNumber - LastCheckFrame[Cell] );
+		LastCheckFrame[Cell] = FrameNumber;
+	}
+
+	// Next frame, start stable cells where we stopped
+	if ( NbProcessed >= NbStableStart && NbProcessed < (int)CellsToProcess.size() )
+	{
+		RoundRobinStart = CellsToProcess[NbProcessed];
+	}
+
+	NotProcessedCells.clear();
+	for ( int Cell = 0; Cell < NumColumns*NumLines; Cell++ )
+	{
+		if ( CheckedThisFrame[Cell] == false )
+		{
+			NotProcessedCells.push_back( Cell );
+		}
+	}
+}
+
+/**
+* @brief Record processing time of a frame to check budget overruns
+* @param FrameTime [in] Processing time of the frame
+*/
+void CellScheduler::RecordFrameTime( double FrameTime )
+{
+	NbFrames++;
+
+	if ( FrameBudget > 0.0 && FrameTime > FrameBudget )
+	{
+		NbOverruns++;
+		SumOverrun += FrameTime-FrameBudget;
+		MaxOverrun = std::max( MaxOverrun, FrameTime-FrameBudget );
+	}
+}
+
+/**
+* @brief Print budget statistics
+* @param fout [in] Output file (default=stderr)
+*/
+void CellScheduler::ReportBudget( FILE * fout /* = stderr */ )
+{
+	if ( FrameBudget <= 0.0 )
+	{
+		return;
+	}
+
+	fprintf( fout, "Frame budget %.1lf ms: %lld overruns over %lld frames (%.2lf%%), mean overrun=%.2lf ms, max overrun=%.2lf ms, max frames between 2 checks of a cell=%u\n",
+		FrameBudget*1000.0, NbOverruns, NbFrames, NbFrames > 0 ? 100.0*(double)NbOverruns/(double)NbFrames : 0.0,
+		NbOverruns > 0 ? 1000.0*SumOverrun/(double)NbOverruns : 0.0, MaxOverrun*1000.0, MaxObservedFramesWithoutCheck );
+}
@@ -0,0 +1,124 @@
+/**
+ * @file CellScheduler.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __CELL_SCHEDULER_H__
+#define __CELL_SCHEDULER_H__
+
+#include "Go-CamRecorder.h"
+
+#include <vector>
+
+#include "StoneDetectorStorage.h"
+#include "GobanState.h"
+
+#define DefaultHeartbeatPeriod 25			// Committed stones are rechecked at least every 25 frames (1s at 25 fps)
+#define DefaultMaxFramesWithoutCheck 50		// Whatever the budget, a cell is rechecked at least every 50 frames
+
+/**
+ * @class CellScheduler
+ * @brief Select and order cells on which stone detection must run for the current frame. Committed stones
+ *		  with a quiet neighbourhood are skipped, they are re-verified only on motion around them,
+ *		  on captures (cell is not committed anymore) or by a slow round-robin heartbeat.
+ *		  With a frame budget, cells not checked for MaxFramesWithoutCheck frames come first (mandatory),
+ *		  then cells in or near motion, then stable cells in round-robin order while time remains.
+ */
+class CellScheduler
+{
+public:
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+	*/
+	CellScheduler( int _NumColumns, int _NumLines );
+
+	/**
+    * @brief Virtual destructor
+	*/
+	virtual ~CellScheduler() {}
+
+	bool Enabled = true;										// If false, committed quiet stones are not skipped
+	int HeartbeatPeriod = DefaultHeartbeatPeriod;				// Frames between 2 heartbeat checks of a committed stone
+	double FrameBudget = 0.0;									// Max processing time of a frame in seconds, 0 for no limit
+	int MaxFramesWithoutCheck = DefaultMaxFramesWithoutCheck;	// Bound on the number of frames between 2 checks of a cell
+
+	/**
+    * @brief Select and order cells to process for the current frame. Must be called after motion detection.
+    * @param AllDetectors [in] All stone detectors
+    * @param GameState [in] Current game state (committed stones)
+    * @param CellsToProcess [out] Ordered cells on which stone detection should run
+    * @param NbMandatory [out] Number of cells (at the beginning of CellsToProcess) to process whatever the budget
+	*/
+	void Schedule( StoneDetectorStorage& AllDetectors, GobanState& GameState, std::vector<int>& CellsToProcess, int& NbMandatory );
+
+	/**
+    * @brief Is there enough time left in the frame budget to process some cells?
+    * @param NbCells [in] Number of cells to process
+    * @param Elapsed [in] Processing time of the frame so far
+    * @return true if the cells can be processed within the budget
+	*/
+	inline bool HasTimeFor( int NbCells, double Elapsed )
+	{
+		return ( FrameBudget <= 0.0 || Elapsed + (double)NbCells*TimePerCell < FrameBudget );
+	}
+
+	/**
+    * @brief Update estimation of processing time of a cell
+    * @param NbCells [in] Number of processed cells
+    * @param Duration [in] Processing time of these cells
+	*/
+	inline void UpdateCellCost( int NbCells, double Duration )
+	{
+		if ( NbCells > 0 )
+		{
+			TimePerCell = 0.9*TimePerCell + 0.1*Duration/(double)NbCells;
+		}
+	}
+
+	/**
+    * @brief Record processed cells and prepare next round-robin
+    * @param CellsToProcess [in] Ordered cells given by Schedule
+    * @param NbProcessed [in] Number of cells actually processed (from the beginning of CellsToProcess)
+    * @param NotProcessedCells [out] All cells of the goban not processed for this frame
+	*/
+	void SetProcessed( const std::vector<int>& CellsToProcess, int NbProcessed, std::vector<int>& NotProcessedCells );
+
+	/**
+    * @brief Record processing time of a frame to check budget overruns
+    * @param FrameTime [in] Processing time of the frame
+	*/
+	void RecordFrameTime( double FrameTime );
+
+	/**
+    * @brief Print budget statistics
+    * @param fout [in] Output file (default=stderr)
+	*/
+	void ReportBudget( FILE * fout = stderr );
+
+protected:
+	int NumColumns;										// Number of columns of the goban
+	int NumLines;										// Number of lines of the goban
+	unsigned int FrameNumber = 0;						// Number of scheduled frames, used for heartbeat
+	std::vector<unsigned char> ActiveNeighbourhood;		// Cells with motion on them or around them
+	std::vector<unsigned int> LastCheckFrame;			// Frame of the last check of each cell
+	std::vector<unsigned char> CheckedThisFrame;		// Cells processed for the current frame
+	std::vector<int> ActiveCells;						// Cells in or near motion for the current frame
+	std::vector<int> StableCells;						// Stable cells for the current frame
+	int RoundRobinStart = 0;							// First stable cell for the next frame
+	int NbStableStart = 0;								// Position of the first stable cell in the current schedule
+
+	// Estimation and statistics
+	double TimePerCell = 0.0;							// Mean processing time of a cell
+	long long int NbFrames = 0;							// Number of frames
+	long long int NbOverruns = 0;						// Number of frames over budget
+	double SumOverrun = 0.0;							// Sum of overrun times
+	double MaxOverrun = 0.0;							// Max overrun time
+	unsigned int MaxObservedFramesWithoutCheck = 0;		// Max number of frames between 2 checks of a cell
+};
+
+#endif // __CELL_SCHEDULER_H__
@@ -0,0 +1,424 @@
+/**
+ * @file Checkpoint.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "Checkpoint.h"
+
+#include <string.h>
+
+// System calls only, new checkpoints are written without memory allocation
+#ifdef OMISCID_ON_WINDOWS
+	#include <windows.h>
+	#include <io.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#define OpenNewFile( Name ) _open( Name, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE )
+	#define FileWrite( Fd, Data, Size ) _write( Fd, Data, (unsigned int)(Size) )
+	#define FileSync( Fd ) _commit( Fd )
+	#define FileClose( Fd ) _close( Fd )
+	// rename does not replace an existing file on Windows, MoveFileEx does it atomically
+	#define ReplaceFileWith( Name, NewName ) ( MoveFileExA( NewName, Name, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0 )
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#define OpenNewFile( Name ) open( Name, O_WRONLY | O_CREAT | O_TRUNC, 0644 )
+	#define FileWrite( Fd, Data, Size ) write( Fd, Data, Size )
+	#define FileSync( Fd ) fsync( Fd )
+	#define FileClose( Fd ) close( Fd )
+	#define ReplaceFileWith( Name, NewName ) ( rename( NewName, Name ) == 0 )
+#endif
+
+/**
+* @brief Write a new checkpoint in a temporary file, sync it to the disk and replace the previous one
+* @param FileName [in] Checkpoint file name
+* @param TmpFileName [in] Temporary file name
+* @param Data [in] Serialised checkpoint
+* @return true if everything was written
+*/
+static bool WriteCheckpointFile( const char * FileName, const char * TmpFileName, const std::vector<char>& Data )
+{
+	int Fd = OpenNewFile( TmpFileName );
+	if ( Fd < 0 )
+	{
+		return false;
+	}
+
+	bool Failed = false;
+	size_t Written = 0;
+	while ( Written < Data.size() )
+	{
+		long Size = (long)FileWrite( Fd, &Data[Written], Data.size()-Written );
+		if ( Size <= 0 )
+		{
+			Failed = true;
+			break;
+		}
+		Written += (size_t)Size;
+	}
+
+	// Data must be on the disk before replacing the previous checkpoint
+	if ( Failed == false && FileSync( Fd ) != 0 )
+	{
+		Failed = true;
+	}
+	if ( FileClose( Fd ) != 0 )
+	{
+		Failed = true;
+	}
+
+	// Atomic replacement: a crash leaves either the previous checkpoint or the new one
+	if ( Failed == true || ReplaceFileWith( FileName, TmpFileName ) == false )
+	{
+		remove( TmpFileName );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+* @brief Constructor
+*/
+BinaryCheckpoint::BinaryCheckpoint() : File(nullptr), Writing(false), Failed(false)
+{
+}
+
+/**
+* @brief Virtual destructor, an uncommitted checkpoint is dropped
+*/
+BinaryCheckpoint::~BinaryCheckpoint()
+{
+	Close();
+}
+
+/**
+* @brief Start serialising a new checkpoint in memory
+* @param _FileName [in] Checkpoint file name
+* @return true if the checkpoint could be started
+*/
+bool BinaryCheckpoint::Create( const Omiscid::SimpleString& _FileName )
+{
+	Close();
+
+	FileName = _FileName;
+	Buffer.clear();
+	Writing = true;
+	Failed = false;
+
+	WriteRaw( CheckpointMagic, sizeof(CheckpointMagic) );
+	WriteValue( (int32_t)CheckpointVersion );
+
+	return IsValid();
+}
+
+/**
+* @brief Write a new checkpoint (in FileName.tmp) and replace the previous one
+* @return true if everything was written
+*/
+bool BinaryCheckpoint::Commit()
+{
+	if ( Writing == false )
+	{
+		return false;
+	}
+	Writing = false;
+
+	if ( Failed == true )
+	{
+		return false;
+	}
+
+	Omiscid::SimpleString TmpFileName = FileName + ".tmp";
+	if ( WriteCheckpointFile( FileName.GetStr(), TmpFileName.GetStr(), Buffer ) == false )
+	{
+		fprintf( stderr, "Unable to write checkpoint '%s'\n", FileName.GetStr() );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+* @brief Hand a new checkpoint to a writer thread, it writes it and replaces the previous one
+* @param Writer [in] Writer thread of this checkpoint file
+* @return true if everything was serialised
+*/
+bool BinaryCheckpoint::Commit( CheckpointWriter& Writer )
+{
+	if ( Writing == false )
+	{
+		return false;
+	}
+	Writing = false;
+
+	if ( Failed == true )
+	{
+		return false;
+	}
+
+	Writer.Submit( Buffer );
+	return true;
+}
+
+/**
+* @brief Open a checkpoint to read it, magic and version are checked
+* @param _FileName [in] Checkpoint file name
+* @return true if the file is a checkpoint of the current version
+*/
+bool BinaryCheckpoint::Open( const Omiscid::SimpleString& _FileName )
+{
+	Close();
+
+	FileName = _FileName;
+	File = fopen( FileName.GetStr(), "rb" );
+	if ( File == nullptr )
+	{
+		return false;
+	}
+
+	Writing = false;
+	Failed = false;
+
+	char Magic[sizeof(CheckpointMagic)];
+	int32_t Version = 0;
+	ReadRaw( Magic, sizeof(Magic) );
+	ReadValue( Version );
+	if ( Failed == true || memcmp( Magic, CheckpointMagic, sizeof(Magic) ) != 0 || Version != CheckpointVersion )
+	{
+		fprintf( stderr, "'%s' is not a valid checkpoint\n", FileName.GetStr() );
+		Failed = true;
+	}
+
+	return IsValid();
+}
+
+/**
+* @brief Close the file (a new checkpoint not committed is dropped)
+*/
+void BinaryCheckpoint::Close()
+{
+	Writing = false;
+
+	if ( File == nullptr )
+	{
+		return;
+	}
+
+	fclose( File );
+	File = nullptr;
+}
+
+/**
+* @brief Write raw bytes
+* @param Data [in] Data to write
+* @param Size [in] Number of bytes
+*/
+void BinaryCheckpoint::WriteRaw( const void * Data, size_t Size )
+{
+	if ( Writing == false || Failed == true || Size == 0 )
+	{
+		return;
+	}
+
+	Buffer.insert( Buffer.end(), (const char *)Data, (const char *)Data+Size );
+}
+
+/**
+* @brief Read raw bytes, Data is zeroed on error
+* @param Data [out] Data to read
+* @param Size [in] Number of bytes
+*/
+void BinaryCheckpoint::ReadRaw( void * Data, size_t Size )
+{
+	if ( File == nullptr || Failed == true || fread( Data, 1, Size, File ) != Size )
+	{
+		Failed = true;
+		memset( Data, 0, Size );
+	}
+}
+
+/**
+* @brief Write a string, preceded by its length
+* @param Value [in] String to write
+*/
+void BinaryCheckpoint::WriteString( const Omiscid::SimpleString& Value )
+{
+	uint32_t Length = (uint32_t)Value.GetLength();
+	WriteValue( Length );
+	WriteRaw( Value.GetStr(), Length );
+}
+
+/**
+* @brief Read a string
+* @param Value [out] String to read
+*/
+void BinaryCheckpoint::ReadString( Omiscid::SimpleString& Value )
+{
+	std::vector<char> Buffer;
+	ReadVector( Buffer );
+	Buffer.push_back( '\0' );
+	Value = &Buffer[0];
+}
+
+/**
+* @brief Write an OpenCV matrix (size, type and data)
+* @param Value [in] Matrix to write
+*/
+void BinaryCheckpoint::WriteMat( const cv::Mat& Value )
+{
+	// Data are written in one block
+	cv::Mat Continuous = Value.isContinuous() ? Value : Value.clone();
+
+	WriteValue( (int32_t)Continuous.rows );
+	WriteValue( (int32_t)Continuous.cols );
+	WriteValue( (int32_t)Continuous.type() );
+	WriteRaw( Continuous.data, Continuous.total()*Continuous.elemSize() );
+}
+
+/**
+* @brief Read an OpenCV matrix
+* @param Value [out] Matrix to read
+*/
+void BinaryCheckpoint::ReadMat( cv::Mat& Value )
+{
+	int32_t Rows = 0, Cols = 0, Type = 0;
+	ReadValue( Rows );
+	ReadValue( Cols );
+	ReadValue( Type );
+	if ( Failed == true || Rows < 0 || Cols < 0 || (int64_t)Rows*(int64_t)Cols > MaxCheckpointVectorSize )
+	{
+		Failed = true;
+		Value.release();
+		return;
+	}
+
+	Value.create( Rows, Cols, Type );
+	ReadRaw( Value.data, Value.total()*Value.elemSize() );
+}
+
+/**
+* @brief Operator<< to store calibration in a checkpoint
+* @param Checkpoint [in] Checkpoint
+* @param CalibValue [in] Calibration to store
+*/
+BinaryCheckpoint& operator<<( BinaryCheckpoint& Checkpoint, CalibrationContainer& CalibValue )
+{
+	Checkpoint.WriteMat( CalibValue.intrinsic );
+	Checkpoint.WriteMat( CalibValue.distCoeffs );
+	Checkpoint.WriteMat( CalibValue.rvec );
+	Checkpoint.WriteMat( CalibValue.tvec );
+	Checkpoint.WriteVector( (std::vector<cv::Point>&)(CalibValue) );
+	Checkpoint.WriteValue( CalibValue.SizeOfCells );
+
+	return Checkpoint;
+}
+
+/**
+* @brief Operator>> to read calibration from a checkpoint
+* @param Checkpoint [in] Checkpoint
+* @param CalibValue [out] Calibration to read
+*/
+void operator>>( BinaryCheckpoint& Checkpoint, CalibrationContainer& CalibValue )
+{
+	Checkpoint.ReadMat( CalibValue.intrinsic );
+	Checkpoint.ReadMat( CalibValue.distCoeffs );
+	Checkpoint.ReadMat( CalibValue.rvec );
+	Checkpoint.ReadMat( CalibValue.tvec );
+	Checkpoint.ReadVector( (std::vector<cv::Point>&)(CalibValue) );
+	Checkpoint.ReadValue( CalibValue.SizeOfCells );
+}
+
+/**
+* @brief Constructor
+*/
+CheckpointWriter::CheckpointWriter() : HasPending(false), ReportedFailure(false)
+{
+}
+
+/**
+* @brief Virtual destructor, stop the thread and write the waiting checkpoint
+*/
+/* virtual */ CheckpointWriter::~CheckpointWriter()
+{
+	Stop();
+}
+
+/**
+* @brief Start the thread if needed
+* @param _FileName [in] Checkpoint file name
+*/
+void CheckpointWriter::Start( const Omiscid::SimpleString& _FileName )
+{
+	if ( IsRunning() == true )
+	{
+		return;
+	}
+
+	FileName = _FileName;
+	TmpFileName = _FileName + ".tmp";
+	ReportedFailure = false;
+	StartThread();
+}
+
+/**
+* @brief Stop the thread and write the waiting checkpoint, if any
+*/
+void CheckpointWriter::Stop()
+{
+	if ( IsRunning() == true )
+	{
+		StopThread( 0 );
+	}
+	WritePending();
+}
+
+/**
+* @brief Submit a new checkpoint, it replaces a waiting one
+* @param Data [in,out] Serialised checkpoint, gets an old buffer back
+*/
+void CheckpointWriter::Submit( std::vector<char>& Data )
+{
+	Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+	Pending.swap( Data );
+	HasPending = true;
+	SL_ProtectPending.Unlock();
+
+	NewCheckpoint.Signal();
+}
+
+/** @brief Write checkpoints until the thread stops
+*/
+void FUNCTION_CALL_TYPE CheckpointWriter::Run()
+{
+	while ( StopPending() == false )
+	{
+		// Wake up on submission, or regularly to check if we must stop
+		NewCheckpoint.Wait( CheckpointWriterWaitTime );
+		WritePending();
+	}
+}
+
+/** @brief Write the waiting checkpoint, if any
+*/
+void CheckpointWriter::WritePending()
+{
+	{
+		// Both buffers keep their capacity
+		Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+		if ( HasPending == false )
+		{
+			return;
+		}
+		Current.swap( Pending );
+		HasPending = false;
+	}
+
+	if ( WriteCheckpointFile( FileName.GetStr(), TmpFileName.GetStr(), Current ) == false && ReportedFailure == false )
+	{
+		fprintf( stderr, "Unable to write checkpoint '%s'\n", FileName.GetStr() );
+		ReportedFailure = true;
+	}
+}
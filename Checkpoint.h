@@ -0,0 +1,267 @@
+/**
+ * @file Checkpoint.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <System/SimpleString.h>
+#include <System/Mutex.h>
+#include <System/Thread.h>
+#include <System/Event.h>
+
+#include "Go-CamRecorder.h"
+#include "CalibrationContainer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define CheckpointMagic "GCRCKPT"				// First bytes of a checkpoint file (with the final '\0')
+#define CheckpointVersion 2						// Version of the checkpoint format
+#define MaxCheckpointVectorSize (1 << 24)		// Bigger vectors are considered as a corrupted file
+#define DefaultCheckpointInterval 2.0			// Time (s) between 2 checkpoints without commit
+#define CheckpointWriterWaitTime 100			// Max wait time (ms) of the writer thread before checking if it must stop
+
+class CheckpointWriter;
+
+/**
+ * @class BinaryCheckpoint
+ * @brief Compact binary file to save the state of a recording session and resume it after a crash.
+ *		  Values are written in the native byte order, the checkpoint is meant to be read back on the
+ *		  same computer. A new checkpoint is serialised in memory. Commit writes it in a temporary file,
+ *		  synced to the disk and renamed when complete, thus the previous one stays valid if the program or
+ *		  the system crashes while writing. Commit can also hand it to a CheckpointWriter thread.
+ */
+class BinaryCheckpoint
+{
+public:
+	/**
+    * @brief Constructor
+	*/
+	BinaryCheckpoint();
+
+	/**
+    * @brief Virtual destructor, an uncommitted checkpoint is removed
+	*/
+	virtual ~BinaryCheckpoint();
+
+	/**
+    * @brief Start serialising a new checkpoint in memory
+    * @param _FileName [in] Checkpoint file name
+    * @return true if the checkpoint could be started
+	*/
+	bool Create( const Omiscid::SimpleString& _FileName );
+
+	/**
+    * @brief Write a new checkpoint (in FileName.tmp) and replace the previous one
+    * @return true if everything was written
+	*/
+	bool Commit();
+
+	/**
+    * @brief Hand a new checkpoint to a writer thread, it writes it and replaces the previous one
+    * @param Writer [in] Writer thread of this checkpoint file
+    * @return true if everything was serialised
+	*/
+	bool Commit( CheckpointWriter& Writer );
+
+	/**
+    * @brief Open a checkpoint to read it, magic and version are checked
+    * @param _FileName [in] Checkpoint file name
+    * @return true if the file is a checkpoint of the current version
+	*/
+	bool Open( const Omiscid::SimpleString& _FileName );
+
+	/**
+    * @brief Close the file (a new checkpoint not committed is dropped)
+	*/
+	void Close();
+
+	/**
+    * @brief Did all reads or writes succeed?
+    * @return true if the file is open (or a new checkpoint started) and no error occured
+	*/
+	inline bool IsValid() const
+	{
+		return ( (File != nullptr || Writing == true) && Failed == false );
+	}
+
+	/**
+    * @brief Write raw bytes
+    * @param Data [in] Data to write
+    * @param Size [in] Number of bytes
+	*/
+	void WriteRaw( const void * Data, size_t Size );
+
+	/**
+    * @brief Read raw bytes, Data is zeroed on error
+    * @param Data [out] Data to read
+    * @param Size [in] Number of bytes
+	*/
+	void ReadRaw( void * Data, size_t Size );
+
+	/**
+    * @brief Write a value of a plain type
+    * @param Value [in] Value to write
+	*/
+	template<typename TYPE>
+	inline void WriteValue( const TYPE& Value )
+	{
+		WriteRaw( &Value, sizeof(TYPE) );
+	}
+
+	/**
+    * @brief Read a value of a plain type
+    * @param Value [out] Value to read
+	*/
+	template<typename TYPE>
+	inline void ReadValue( TYPE& Value )
+	{
+		ReadRaw( &Value, sizeof(TYPE) );
+	}
+
+	/**
+    * @brief Write a vector of a plain type, preceded by its size
+    * @param Values [in] Vector to write
+	*/
+	template<typename TYPE>
+	inline void WriteVector( const std::vector<TYPE>& Values )
+	{
+		WriteValue( (uint32_t)Values.size() );
+		if ( Values.empty() == false )
+		{
+			WriteRaw( &Values[0], Values.size()*sizeof(TYPE) );
+		}
+	}
+
+	/**
+    * @brief Read a vector of a plain type
+    * @param Values [out] Vector to read
+	*/
+	template<typename TYPE>
+	inline void ReadVector( std::vector<TYPE>& Values )
+	{
+		uint32_t Size = 0;
+		ReadValue( Size );
+		if ( Failed == true || Size > MaxCheckpointVectorSize )
+		{
+			Failed = true;
+			Values.clear();
+			return;
+		}
+
+		Values.resize( Size );
+		if ( Size > 0 )
+		{
+			ReadRaw( &Values[0], Size*sizeof(TYPE) );
+		}
+	}
+
+	/**
+    * @brief Write a string, preceded by its length
+    * @param Value [in] String to write
+	*/
+	void WriteString( const Omiscid::SimpleString& Value );
+
+	/**
+    * @brief Read a string
+    * @param Value [out] String to read
+	*/
+	void ReadString( Omiscid::SimpleString& Value );
+
+	/**
+    * @brief Write an OpenCV matrix (size, type and data)
+    * @param Value [in] Matrix to write
+	*/
+	void WriteMat( const cv::Mat& Value );
+
+	/**
+    * @brief Read an OpenCV matrix
+    * @param Value [out] Matrix to read
+	*/
+	void ReadMat( cv::Mat& Value );
+
+protected:
+	FILE * File;								// Current file (read only)
+	bool Writing;								// Is it a new checkpoint?
+	bool Failed;								// Did a read or write fail?
+	Omiscid::SimpleString FileName;				// Checkpoint file name
+	std::vector<char> Buffer;					// New checkpoint serialised in memory
+};
+
+/**
+ * @class CheckpointWriter
+ * @brief Thread writing checkpoints of a file: the frame thread serialises a checkpoint in memory, this thread
+ *		  writes it, syncs it to the disk and replaces the previous one. If several checkpoints wait, only the
+ *		  last one is written. Buffers are swapped and files are written with system calls: the writer thread
+ *		  does not allocate memory.
+ */
+class CheckpointWriter : public Omiscid::Thread
+{
+public:
+	/**
+    * @brief Constructor
+	*/
+	CheckpointWriter();
+
+	/**
+    * @brief Virtual destructor, stop the thread and write the waiting checkpoint
+	*/
+	virtual ~CheckpointWriter();
+
+	/**
+    * @brief Start the thread if needed
+    * @param _FileName [in] Checkpoint file name
+	*/
+	void Start( const Omiscid::SimpleString& _FileName );
+
+	/**
+    * @brief Stop the thread and write the waiting checkpoint, if any
+	*/
+	void Stop();
+
+	/**
+    * @brief Submit a new checkpoint, it replaces a waiting one
+    * @param Data [in,out] Serialised checkpoint, gets an old buffer back
+	*/
+	void Submit( std::vector<char>& Data );
+
+protected:
+	/** @brief Write checkpoints until the thread stops
+	 */
+	virtual void FUNCTION_CALL_TYPE Run();
+
+	/** @brief Write the waiting checkpoint, if any
+	 */
+	void WritePending();
+
+	Omiscid::SimpleString FileName;				// Checkpoint file name
+	Omiscid::SimpleString TmpFileName;			// Temporary file of a new checkpoint
+	Omiscid::Mutex ProtectPending;				// Mutex for multithreading access to Pending
+	Omiscid::Event NewCheckpoint;				// Signaled when a checkpoint is submitted
+	std::vector<char> Pending;					// Last submitted checkpoint not written yet
+	bool HasPending;							// Is there a checkpoint in Pending?
+	std::vector<char> Current;					// Checkpoint being written
+	bool ReportedFailure;						// Was a write failure already reported?
+};
+
+/**
+* @brief Operator<< to store calibration in a checkpoint
+* @param Checkpoint [in] Checkpoint
+* @param CalibValue [in] Calibration to store
+*/
+BinaryCheckpoint& operator<<( BinaryCheckpoint& Checkpoint, CalibrationContainer& CalibValue );
+
+/**
+* @brief Operator>> to read calibration from a checkpoint
+* @param Checkpoint [in] Checkpoint
+* @param CalibValue [out] Calibration to read
+*/
+void operator>>( BinaryCheckpoint& Checkpoint, CalibrationContainer& CalibValue );
+
+#endif // __CHECKPOINT_H__
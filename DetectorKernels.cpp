@@ -0,0 +1,84 @@
+/**
+ * @file DetectorKernels.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "DetectorKernels.h"
+
+/**
+* @brief Select specialised kernels for a tile size on a given goban size.
+* @param TileSize [in] Size of tiles in the rectified image
+* @param MotionKernel [out] Motion kernel
+* @param ScoreKernel [out] Score kernel
+* @return true if specialised kernels were found
+*/
+template<int BoardSize>
+static bool SelectDetectorKernelsForBoard( int TileSize, MotionKernelFunction& MotionKernel, ScoreKernelFunction& ScoreKernel )
+{
+	switch ( TileSize )
+	{
+		case 8:
+			MotionKernel = TiledMotionKernel<BoardSize, 8>;
+			ScoreKernel = TiledScoreKernel<BoardSize, 8>;
+			return true;
+
+		case 12:
+			MotionKernel = TiledMotionKernel<BoardSize, 12>;
+			ScoreKernel = TiledScoreKernel<BoardSize, 12>;
+			return true;
+
+		case 16:
+			MotionKernel = TiledMotionKernel<BoardSize, 16>;
+			ScoreKernel = TiledScoreKernel<BoardSize, 16>;
+			return true;
+
+		case 20:
+			MotionKernel = TiledMotionKernel<BoardSize, 20>;
+			ScoreKernel = TiledScoreKernel<BoardSize, 20>;
+			return true;
+
+		case 24:
+			MotionKernel = TiledMotionKernel<BoardSize, 24>;
+			ScoreKernel = TiledScoreKernel<BoardSize, 24>;
+			return true;
+
+		case 32:
+			MotionKernel = TiledMotionKernel<BoardSize, 32>;
+			ScoreKernel = TiledScoreKernel<BoardSize, 32>;
+			return true;
+	}
+
+	return false;
+}
+
+/**
+* @brief Select specialised kernels for a goban size and a tile size. If no instantiation matches,
+*		 kernels are set to nullptr and the generic detector code is used.
+* @param BoardSize [in] Number of lines of the goban, i.e. index stride of cells (a*BoardSize+b)
+* @param TileSize [in] Size of tiles in the rectified image (0 if not in rectified mode)
+* @param MotionKernel [out] Motion kernel
+* @param ScoreKernel [out] Score kernel
+* @return true if specialised kernels were found
+*/
+bool SelectDetectorKernels( int BoardSize, int TileSize, MotionKernelFunction& MotionKernel, ScoreKernelFunction& ScoreKernel )
+{
+	// Generic fallback
+	MotionKernel = nullptr;
+	ScoreKernel = nullptr;
+
+	switch ( BoardSize )
+	{
+		case 9:
+			return SelectDetectorKernelsForBoard<9>( TileSize, MotionKernel, ScoreKernel );
+
+		case 13:
+			return SelectDetectorKernelsForBoard<13>( TileSize, MotionKernel, ScoreKernel );
+
+		case 19:
+			return SelectDetectorKernelsForBoard<19>( TileSize, MotionKernel, ScoreKernel );
+	}
+
+	return false;
+}
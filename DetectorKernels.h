@@ -0,0 +1,170 @@
+/**
+ * @file DetectorKernels.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __DETECTOR_KERNELS_H__
+#define __DETECTOR_KERNELS_H__
+
+#include "Go-CamRecorder.h"
+
+#include "StoneDetector.h"
+
+/**
+* @brief Radius of stone detectors in the rectified goban image. Same percentage (90%) as GobanDetector::PercentageSizeOfStones.
+* @param TileSize [in] Size of tiles in the rectified image
+* @return Radius of the detectors (min 2 pixels)
+*/
+constexpr int RectifiedStoneRadius( int TileSize )
+{
+	return ( (int)(0.90f*(float)TileSize/2.0f) > 2 ) ? (int)(0.90f*(float)TileSize/2.0f) : 2;
+}
+
+// Kernel to compute mean motion value (0-255) on the detection area of a cell
+typedef unsigned int (*MotionKernelFunction)( cv::Mat& MotionImage, int CellIndex );
+
+// Kernel to compute stone detection score on the detection area of a cell (same result as StoneDetector::ComputeOverlappingAndScore)
+typedef double (*ScoreKernelFunction)( cv::Mat& Image, int CellIndex, const unsigned char * MaskStone, size_t MaskStep, int NbPixelsInStone, bool& found );
+
+/**
+* @brief Mean motion on a detector of the rectified image. Sizes are known at compile time.
+* @param MotionImage [in] Rectified motion image
+* @param CellIndex [in] Index of the cell (a*BoardSize+b)
+* @return mean motion value as computed by cv::mean
+*/
+template<int BoardSize, int TileSize>
+unsigned int TiledMotionKernel( cv::Mat& MotionImage, int CellIndex )
+{
+	enum { Radius = RectifiedStoneRadius(TileSize), DetectSize = 2*Radius };
+
+	const int x0 = (CellIndex/BoardSize)*TileSize + TileSize/2 - Radius;
+	const int y0 = (CellIndex%BoardSize)*TileSize + TileSize/2 - Radius;
+
+	unsigned int Sum = 0;
+	for ( int line = 0; line < DetectSize; line++ )
+	{
+		const unsigned char * line_ptr = MotionImage.ptr<unsigned char>( y0+line ) + x0;
+		for ( int col = 0; col < DetectSize; col++ )
+		{
+			Sum += line_ptr[col];
+		}
+	}
+
+	return (unsigned int)((double)Sum/(double)(DetectSize*DetectSize));
+}
+
+/**
+* @brief Compute detection on a sub detector (see StoneDetector::ComputeOnSubDetector).
+* @param LocalDetector [in] Pointer to the first pixel of the detector
+* @param Step [in] Step of the image
+* @param MaskStone [in] Mask of the stone
+* @param MaskStep [in] Step of the mask
+* @param startcol [in] Start col for stone detection
+* @param endcol [in] ending col
+* @param startline [in] starting line
+* @param endline [in] ending line
+* @param score [in,out] Score of the detection. Remain unchanged if not detection was done.
+* @return True if detection occurs.
+*/
+inline bool TiledSubDetectorKernel( const unsigned char * LocalDetector, size_t Step, const unsigned char * MaskStone, size_t MaskStep,
+									int startcol, int endcol, int startline, int endline, double& score )
+{
+	int minx = endcol+1, miny = endline+1;
+	int maxx = -1, maxy = -1;
+	for ( int line = startline; line < endline; line++ )
+	{
+		const unsigned char * line_ptr = LocalDetector + line*Step;
+		const unsigned char * mask_ptr = MaskStone + line*MaskStep;
+		for ( int col = startcol; col < endcol; col++ )
+		{
+			if ( mask_ptr[col] != 0 && line_ptr[col] == 255 )
+			{
+				miny = Min( miny, line );
+				minx = Min( minx, col );
+				maxy = Max( maxy, line );
+				maxx = Max( maxx, col );
+			}
+		}
+	}
+
+	if ( maxx < 0 )
+	{
+		return false;
+	}
+
+	// Recompute score of box as there are full but inside stone detection are
+	int NbOfPoints = 0;
+	for ( int line = miny; line <= maxy; line++ )
+	{
+		const unsigned char * mask_ptr = MaskStone + line*MaskStep;
+		for ( int col = minx; col <= maxx; col++ )
+		{
+			NbOfPoints += (mask_ptr[col] != 0);
+		}
+	}
+
+	score += (double)NbOfPoints;
+	return true;
+}
+
+/**
+* @brief Compute detection score on a detector of the rectified image. Sizes are known at compile time.
+* @param Image [in] Rectified detection image (black or white)
+* @param CellIndex [in] Index of the cell (a*BoardSize+b)
+* @param MaskStone [in] Mask of the stone
+* @param MaskStep [in] Step of the mask
+* @param NbPixelsInStone [in] Number of pixels in the mask
+* @param found [out] True if a stone is found.
+* @return Detection score.
+*/
+template<int BoardSize, int TileSize>
+double TiledScoreKernel( cv::Mat& Image, int CellIndex, const unsigned char * MaskStone, size_t MaskStep, int NbPixelsInStone, bool& found )
+{
+	enum { Radius = RectifiedStoneRadius(TileSize), DetectSize = 2*Radius };
+
+	const int x0 = (CellIndex/BoardSize)*TileSize + TileSize/2 - Radius;
+	const int y0 = (CellIndex%BoardSize)*TileSize + TileSize/2 - Radius;
+	const unsigned char * LocalDetector = Image.ptr<unsigned char>( y0 ) + x0;
+
+	// Bounds of sub detectors, computed with the same float accumulation as the generic version (folded by the compiler)
+	int Bounds[NbSubDetectorsOnEachAxis+1];
+	float Start = 0.0f;
+	for ( int i = 0; i <= NbSubDetectorsOnEachAxis; i++ )
+	{
+		Bounds[i] = (int)Start;
+		Start += (float)DetectSize/(float)NbSubDetectorsOnEachAxis;
+	}
+
+	double score = 0.0;
+	found = false;
+	for ( int i = 0; i < NbSubDetectorsOnEachAxis; i++ )
+	{
+		for ( int j = 0; j < NbSubDetectorsOnEachAxis; j++ )
+		{
+			found |= TiledSubDetectorKernel( LocalDetector, Image.step, MaskStone, MaskStep, Bounds[i], Bounds[i+1], Bounds[j], Bounds[j+1], score );
+		}
+	}
+
+	if ( found == false )
+	{
+		return 0.0;
+	}
+
+	return score/(double)NbPixelsInStone;
+}
+
+/**
+* @brief Select specialised kernels for a goban size and a tile size. If no instantiation matches,
+*		 kernels are set to nullptr and the generic detector code is used.
+* @param BoardSize [in] Number of lines of the goban, i.e. index stride of cells (a*BoardSize+b)
+* @param TileSize [in] Size of tiles in the rectified image (0 if not in rectified mode)
+* @param MotionKernel [out] Motion kernel
+* @param ScoreKernel [out] Score kernel
+* @return true if specialised kernels were found
+*/
+bool SelectDetectorKernels( int BoardSize, int TileSize, MotionKernelFunction& MotionKernel, ScoreKernelFunction& ScoreKernel );
+
+#endif // __DETECTOR_KERNELS_H__
@@ -0,0 +1,338 @@
+/**
+ * @file EventLog.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "EventLog.h"
+
+#include <string.h>
+
+/**
+* @brief Constructor
+*/
+EventLog::EventLog() : File(nullptr), NumColumns(0), NumLines(0), Capacity(DefaultEventLogCapacity), SnapshotInterval(DefaultSnapshotInterval),
+	LastSnapshotTimestamp(-1.0), NbWritten(0), NbDropped(0), NbGapRecords(0), NbDroppedInGap(0), GapTimestamp(0.0)
+{
+}
+
+/**
+* @brief Virtual destructor, buffered records are written
+*/
+EventLog::~EventLog()
+{
+	Close();
+}
+
+/**
+* @brief Create the log file and start the flush thread
+* @param FileName [in] Log file name
+* @param _NumColumns [in] Number of columns of the goban
+* @param _NumLines [in] Number of lines of the goban
+* @param _SnapshotInterval [in] Time (s) between 2 snapshots
+* @return true if the file could be created
+*/
+bool EventLog::Open( const Omiscid::SimpleString& FileName, int _NumColumns, int _NumLines, double _SnapshotInterval /* = DefaultSnapshotInterval */ )
+{
+	Close();
+
+	File = fopen( FileName.GetStr(), "wb" );
+	if ( File == nullptr )
+	{
+		fprintf( stderr, "Could not create event log '%s'\n", FileName.GetStr() );
+		return false;
+	}
+
+	NumColumns = _NumColumns;
+	NumLines = _NumLines;
+	SnapshotInterval = _SnapshotInterval;
+	LastSnapshotTimestamp = -1.0;
+	NbWritten = 0;
+	NbDropped = 0;
+	NbGapRecords = 0;
+	NbDroppedInGap = 0;
+
+	// All buffers are allocated here, appending a record never allocates
+	Pending.reserve( Capacity );
+	Writing.reserve( Capacity );
+	LastState.assign( NumColumns*NumLines, StoneState::Empty );
+	LastMotion.assign( NumColumns*NumLines, 0 );
+
+	EventLogHeader Header;
+	memset( &Header, 0, sizeof(Header) );
+	memcpy( Header.Magic, EventLogMagic, sizeof(EventLogMagic) );
+	Header.Version = EventLogVersion;
+	Header.NumColumns = NumColumns;
+	Header.NumLines = NumLines;
+	Header.RecordSize = (int32_t)sizeof(EventLogRecord);
+	fwrite( &Header, sizeof(Header), 1, File );
+
+	StartThread();
+	return true;
+}
+
+/**
+* @brief Stop the flush thread, write buffered records and close the file
+*/
+void EventLog::Close()
+{
+	if ( File == nullptr )
+	{
+		return;
+	}
+
+	StopThread( 0 );
+	Flush();
+
+	// Gap marked by the last flush, if any
+	Flush();
+
+	fclose( File );
+	File = nullptr;
+}
+
+/**
+* @brief Append a record, the buffer must be locked
+*/
+void EventLog::AppendLocked( double Timestamp, int Type, int Cell, int Value, int NumMove )
+{
+	AppendGapLocked();
+	if ( Pending.size() >= Capacity )
+	{
+		// Flush thread is late, never allocate on the processing threads
+		NbDropped++;
+		NbDroppedInGap++;
+		GapTimestamp = Timestamp;
+		return;
+	}
+
+	EventLogRecord Record;
+	Record.Timestamp = Timestamp;
+	Record.Type = Type;
+	Record.Cell = Cell;
+	Record.Value = Value;
+	Record.NumMove = NumMove;
+	Pending.push_back( Record );
+
+	if ( Pending.size() == Capacity/2 )
+	{
+		FlushRequest.Signal();
+	}
+}
+
+/**
+* @brief Append a Gap record for records dropped since the last one, if any and if there is room.
+*		 The buffer must be locked.
+*/
+void EventLog::AppendGapLocked()
+{
+	if ( NbDroppedInGap == 0 || Pending.size() >= Capacity )
+	{
+		return;
+	}
+
+	EventLogRecord Record;
+	Record.Timestamp = GapTimestamp;
+	Record.Type = EventLogRecord::Gap;
+	Record.Cell = -1;
+	Record.Value = NbDroppedInGap;
+	Record.NumMove = 0;
+	Pending.push_back( Record );
+	NbGapRecords++;
+	NbDroppedInGap = 0;
+
+	// The state after the gap is unknown to readers until the next snapshot
+	LastSnapshotTimestamp = -1.0;
+}
+
+/**
+* @brief Append a record, thread safe and without allocation
+* @param Timestamp [in] Timestamp of the frame
+* @param Type [in] EventLogRecord::RecordType
+* @param Cell [in] Cell (a*NumLines+b), -1 if none
+* @param Value [in] Detected state or color
+* @param NumMove [in] Move number (default 0)
+*/
+void EventLog::Append( double Timestamp, int Type, int Cell, int Value, int NumMove /* = 0 */ )
+{
+	if ( File == nullptr )
+	{
+		return;
+	}
+
+	Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+	AppendLocked( Timestamp, Type, Cell, Value, NumMove );
+}
+
+/**
+* @brief Append detector state changes since the last call. Called after each phase changing detected states,
+*		 the processing threads never lock the buffer for a single cell.
+* @param AllDetectors [in] Detectors of the goban
+* @param Timestamp [in] Timestamp of the frame
+*/
+void EventLog::LogDetectorStates( StoneDetectorStorage& AllDetectors, double Timestamp )
+{
+	if ( File == nullptr )
+	{
+		return;
+	}
+
+	Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+	for ( int Cell = 0; Cell < AllDetectors.NbDetectors; Cell++ )
+	{
+		if ( AllDetectors.State[Cell] == LastState[Cell] )
+		{
+			continue;
+		}
+
+		LastState[Cell] = AllDetectors.State[Cell];
+		AppendLocked( Timestamp, EventLogRecord::DetectorState, Cell, LastState[Cell], 0 );
+	}
+}
+
+/**
+* @brief Append motion start/stop of cells whose extended motion changed since the last call
+* @param AllDetectors [in] Detectors of the goban
+* @param Timestamp [in] Timestamp of the frame
+*/
+void EventLog::LogMotion( StoneDetectorStorage& AllDetectors, double Timestamp )
+{
+	if ( File == nullptr )
+	{
+		return;
+	}
+
+	Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+	for ( int Cell = 0; Cell < AllDetectors.NbDetectors; Cell++ )
+	{
+		unsigned char InMotion = ( AllDetectors.InMotionExtended[Cell] != 0 ) ? 1 : 0;
+		if ( InMotion == LastMotion[Cell] )
+		{
+			continue;
+		}
+
+		LastMotion[Cell] = InMotion;
+		AppendLocked( Timestamp, InMotion ? EventLogRecord::MotionStart : EventLogRecord::MotionStop, Cell, InMotion, 0 );
+	}
+}
+
+/**
+* @brief Append a snapshot of detectors and committed events if the snapshot interval elapsed
+* @param AllDetectors [in] Detectors of the goban
+* @param GameState [in] Committed game
+* @param Timestamp [in] Timestamp of the frame
+*/
+void EventLog::SnapshotIfNeeded( StoneDetectorStorage& AllDetectors, GobanState& GameState, double Timestamp )
+{
+	if ( File == nullptr )
+	{
+		return;
+	}
+
+	// Whole snapshot in one go, readers never see a partial one before a later record. A gap forces it.
+	Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+	if ( LastSnapshotTimestamp >= 0.0 && Timestamp - LastSnapshotTimestamp < SnapshotInterval )
+	{
+		return;
+	}
+	LastSnapshotTimestamp = Timestamp;
+
+	int NbEvents = 0;
+	for ( MoveHistory Event = GameState.History; Event != nullptr; Event = Event->Previous )
+	{
+		NbEvents++;
+	}
+
+	AppendGapLocked();
+	if ( Pending.size() + 1 + AllDetectors.NbDetectors + NbEvents > Capacity )
+	{
+		// Try again on next frame
+		LastSnapshotTimestamp = -1.0;
+		return;
+	}
+
+	AppendLocked( Timestamp, EventLogRecord::Snapshot, -1, AllDetectors.NbDetectors, NbEvents );
+	for ( int Cell = 0; Cell < AllDetectors.NbDetectors; Cell++ )
+	{
+		AppendLocked( Timestamp, EventLogRecord::SnapshotCell, Cell, AllDetectors.State[Cell], LastMotion[Cell] );
+	}
+	for ( MoveHistory Event = GameState.History; Event != nullptr; Event = Event->Previous )
+	{
+		int Type = ( Event->Kind == MoveHistoryNode::Move ) ? EventLogRecord::SnapshotMove : EventLogRecord::SnapshotRemoval;
+		AppendLocked( Timestamp, Type, Event->a*NumLines+Event->b, Event->Color, Event->NumMove );
+	}
+}
+
+/**
+* @brief Print number of written and dropped records
+* @param fout [in] Output file (default=stderr)
+*/
+void EventLog::Report( FILE * fout /* = stderr */ )
+{
+	fprintf( fout, "Event log: %lld records written, %lld dropped (%lld gaps)\n", NbWritten, NbDropped, NbGapRecords );
+}
+
+/**
+* @brief Write buffered records regularly
+*/
+void FUNCTION_CALL_TYPE EventLog::Run()
+{
+	while ( StopPending() == false )
+	{
+		FlushRequest.Wait( EventLogFlushPeriod );
+		Flush();
+	}
+}
+
+/**
+* @brief Write buffered records to the file, called by the flush thread only (or once stopped)
+*/
+void EventLog::Flush()
+{
+	{
+		// Both buffers keep their capacity, a gap is marked as soon as there is room
+		Omiscid::SmartLocker SL_ProtectPending( ProtectPending );
+		Writing.swap( Pending );
+		AppendGapLocked();
+	}
+
+	if ( Writing.empty() == false )
+	{
+		NbWritten += (long long)fwrite( &Writing[0], sizeof(EventLogRecord), Writing.size(), File );
+		fflush( File );
+		Writing.clear();
+	}
+}
+
+/**
+* @brief A stone is seen on a settled detector, not committed yet
+*/
+void EventLog::ProvisionalMove( int Color, int a, int b, double Timestamp )
+{
+	Append( Timestamp, EventLogRecord::ProvisionalMove, a*NumLines+b, Color );
+}
+
+/**
+* @brief A move is committed
+*/
+void EventLog::ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp )
+{
+	Append( Timestamp, EventLogRecord::ConfirmedMove, a*NumLines+b, Color, NumMove );
+}
+
+/**
+* @brief A provisional move disappeared (NumMove is 0) or a committed move was undone (NumMove > 0)
+*/
+void EventLog::RetractedMove( int NumMove, int Color, int a, int b, double Timestamp )
+{
+	Append( Timestamp, EventLogRecord::RetractedMove, a*NumLines+b, Color, NumMove );
+}
+
+/**
+* @brief A committed stone was removed by hand (not captured)
+*/
+void EventLog::RemovedStone( int NumMove, int Color, int a, int b, double Timestamp )
+{
+	Append( Timestamp, EventLogRecord::RemovedStone, a*NumLines+b, Color, NumMove );
+}
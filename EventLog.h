@@ -0,0 +1,163 @@
+/**
+ * @file EventLog.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __EVENT_LOG_H__
+#define __EVENT_LOG_H__
+
+#include <System/SimpleString.h>
+#include <System/Thread.h>
+#include <System/Event.h>
+#include <System/Mutex.h>
+
+#include "EventLogRecord.h"
+#include "GameEventListener.h"
+#include "GobanState.h"
+#include "StoneDetectorStorage.h"
+
+#include <stdio.h>
+#include <vector>
+
+#define DefaultEventLogCapacity (1 << 16)		// Number of records buffered between 2 flushes
+#define DefaultSnapshotInterval 30.0			// Time (s) between 2 snapshots
+#define EventLogFlushPeriod 200					// Time (ms) between 2 flushes of the buffered records
+
+/**
+ * @class EventLog
+ * @brief Binary event-sourced log of detector transitions, motion start/stop and game events. Records are
+ *		  appended to a bounded buffer from the processing threads, a thread writes them to the file.
+ *		  Snapshots of the whole goban are added regularly so that a state can be rebuilt from the nearest one
+ *		  (see Tools/ReplayEventLog). Records are dropped (and counted) if the buffer is full, a Gap record
+ *		  marks them in the file and the next snapshot is forced.
+ */
+class EventLog : public Omiscid::Thread, public GameEventListener
+{
+public:
+	/**
+    * @brief Constructor
+	*/
+	EventLog();
+
+	/**
+    * @brief Virtual destructor, buffered records are written
+	*/
+	virtual ~EventLog();
+
+	/**
+    * @brief Create the log file and start the flush thread
+    * @param FileName [in] Log file name
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+    * @param _SnapshotInterval [in] Time (s) between 2 snapshots
+    * @return true if the file could be created
+	*/
+	bool Open( const Omiscid::SimpleString& FileName, int _NumColumns, int _NumLines, double _SnapshotInterval = DefaultSnapshotInterval );
+
+	/**
+    * @brief Stop the flush thread, write buffered records and close the file
+	*/
+	void Close();
+
+	/**
+    * @brief Is the log open?
+    * @return true if records are written
+	*/
+	inline bool IsOpen() const
+	{
+		return ( File != nullptr );
+	}
+
+	/**
+    * @brief Append a record, thread safe and without allocation
+    * @param Timestamp [in] Timestamp of the frame
+    * @param Type [in] EventLogRecord::RecordType
+    * @param Cell [in] Cell (a*NumLines+b), -1 if none
+    * @param Value [in] Detected state or color
+    * @param NumMove [in] Move number (default 0)
+	*/
+	void Append( double Timestamp, int Type, int Cell, int Value, int NumMove = 0 );
+
+	/**
+    * @brief Append detector state changes since the last call. Called after each phase changing detected states,
+    *		 the processing threads never lock the buffer for a single cell.
+    * @param AllDetectors [in] Detectors of the goban
+    * @param Timestamp [in] Timestamp of the frame
+	*/
+	void LogDetectorStates( StoneDetectorStorage& AllDetectors, double Timestamp );
+
+	/**
+    * @brief Append motion start/stop of cells whose extended motion changed since the last call
+    * @param AllDetectors [in] Detectors of the goban
+    * @param Timestamp [in] Timestamp of the frame
+	*/
+	void LogMotion( StoneDetectorStorage& AllDetectors, double Timestamp );
+
+	/**
+    * @brief Append a snapshot of detectors and committed events if the snapshot interval elapsed
+    * @param AllDetectors [in] Detectors of the goban
+    * @param GameState [in] Committed game
+    * @param Timestamp [in] Timestamp of the frame
+	*/
+	void SnapshotIfNeeded( StoneDetectorStorage& AllDetectors, GobanState& GameState, double Timestamp );
+
+	/**
+    * @brief Print number of written and dropped records
+    * @param fout [in] Output file (default=stderr)
+	*/
+	void Report( FILE * fout = stderr );
+
+	// Game events
+	virtual void ProvisionalMove( int Color, int a, int b, double Timestamp );
+	virtual void ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp );
+	virtual void RetractedMove( int NumMove, int Color, int a, int b, double Timestamp );
+	virtual void RemovedStone( int NumMove, int Color, int a, int b, double Timestamp );
+
+protected:
+	/**
+    * @brief Write buffered records regularly
+	*/
+	virtual void FUNCTION_CALL_TYPE Run();
+
+	/**
+    * @brief Write buffered records to the file, called by the flush thread only (or once stopped)
+	*/
+	void Flush();
+
+	/**
+    * @brief Append a record, the buffer must be locked
+	*/
+	void AppendLocked( double Timestamp, int Type, int Cell, int Value, int NumMove );
+
+	/**
+    * @brief Append a Gap record for records dropped since the last one, if any and if there is room.
+    *		 The buffer must be locked.
+	*/
+	void AppendGapLocked();
+
+	FILE * File;								// Log file
+	int NumColumns;								// Number of columns of the goban
+	int NumLines;								// Number of lines of the goban
+	size_t Capacity;							// Maximum number of buffered records
+
+	Omiscid::Mutex ProtectPending;				// Protect Pending
+	std::vector<EventLogRecord> Pending;		// Records appended since the last flush
+	std::vector<EventLogRecord> Writing;		// Records being written by the flush thread
+	Omiscid::Event FlushRequest;				// Signaled when the buffer is half full
+
+	std::vector<int> LastState;					// Detected state of each cell at the last call of LogDetectorStates
+	std::vector<unsigned char> LastMotion;		// Extended motion of each cell at the last call of LogMotion
+	double SnapshotInterval;					// Time (s) between 2 snapshots
+	double LastSnapshotTimestamp;				// Timestamp of the last snapshot, -1 to force the next one
+
+	long long NbWritten;						// Number of written records
+	long long NbDropped;						// Number of records dropped because the buffer was full
+	long long NbGapRecords;						// Number of Gap records
+	int NbDroppedInGap;							// Records dropped since the last Gap record
+	double GapTimestamp;						// Timestamp of the last dropped record
+};
+
+#endif // __EVENT_LOG_H__
@@ -0,0 +1,64 @@
+/**
+ * @file EventLogRecord.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __EVENT_LOG_RECORD_H__
+#define __EVENT_LOG_RECORD_H__
+
+#include <stdint.h>
+
+#define EventLogMagic "GCREVLG"					// First bytes of an event log (with the final '\0')
+#define EventLogVersion 3						// Version of the event log format
+
+/**
+ * @class EventLogRecord
+ * @brief Fixed-size record of the binary event log. Records are appended in timestamp order, thus a log can
+ *		  be searched by timestamp. A snapshot is a Snapshot record followed by one SnapshotCell record per cell
+ *		  and one SnapshotMove/SnapshotRemoval record per committed event, newest first. A Gap record marks
+ *		  records dropped because the buffer was full, a snapshot is written after it.
+ */
+class EventLogRecord
+{
+public:
+	enum RecordType
+	{
+		DetectorState = 0,		// Cell, Value: new detected state
+		MotionStart,			// Cell: extended motion started on the cell
+		MotionStop,				// Cell: extended motion stopped on the cell
+		ProvisionalMove,		// Cell, Value: color
+		ConfirmedMove,			// Cell, Value: color, NumMove: move number
+		RetractedMove,			// Cell, Value: color, NumMove: undone move (0 for a provisional move)
+		RemovedStone,			// Cell, Value: color, NumMove: number of moves before the removal
+		Snapshot,				// Value: number of cells, NumMove: number of committed events listed afterwards
+		SnapshotCell,			// Cell, Value: detected state, NumMove: extended motion flag
+		SnapshotMove,			// Cell, Value: color, NumMove: move number
+		SnapshotRemoval,		// Cell, Value: color, NumMove: number of moves before the removal
+		Gap						// Value: number of records dropped before this one (timestamp of the last dropped one)
+	};
+
+	double Timestamp;			// Timestamp of the frame
+	int32_t Type;				// RecordType
+	int32_t Cell;				// Cell (a*NumLines+b), -1 if none
+	int32_t Value;				// Detected state or color, see RecordType
+	int32_t NumMove;			// Move number, see RecordType
+};
+
+/**
+ * @class EventLogHeader
+ * @brief Header of the binary event log, same size as a record
+ */
+class EventLogHeader
+{
+public:
+	char Magic[8];				// EventLogMagic
+	int32_t Version;			// EventLogVersion
+	int32_t NumColumns;			// Number of columns of the goban
+	int32_t NumLines;			// Number of lines of the goban
+	int32_t RecordSize;			// sizeof(EventLogRecord), to check the log is read on a compatible computer
+};
+
+#endif // __EVENT_LOG_RECORD_H__
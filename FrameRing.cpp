@@ -0,0 +1,108 @@
+/**
+ * @file FrameRing.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "FrameRing.h"
+
+#include <algorithm>
+
+/**
+* @brief Constructor, empty ring (Init must be called before adding frames)
+*/
+FrameRing::FrameRing() : First(0), NbFrames(0), FrameInterval(DefaultPreRollFrameInterval), Scale(DefaultPreRollScale), LastTimestamp(-1.0)
+{
+}
+
+/**
+* @brief Allocate the ring
+* @param FrameSize [in] Size of the working images
+* @param FrameType [in] OpenCV type of the working images
+* @param Duration [in] Time (s) covered by the ring
+* @param _FrameInterval [in] Minimum time (s) between 2 kept frames
+* @param _Scale [in] Scale of kept frames
+*/
+void FrameRing::Init( cv::Size FrameSize, int FrameType, double Duration, double _FrameInterval /* = DefaultPreRollFrameInterval */, double _Scale /* = DefaultPreRollScale */ )
+{
+	FrameInterval = _FrameInterval;
+	Scale = _Scale;
+
+	int Capacity = std::max( (int)(Duration/FrameInterval)+1, 2 );
+	cv::Size RingSize( std::max( (int)(FrameSize.width*Scale), 1 ), std::max( (int)(FrameSize.height*Scale), 1 ) );
+
+	Frames.resize( Capacity );
+	Timestamps.resize( Capacity );
+	for ( int NumFrame = 0; NumFrame < Capacity; NumFrame++ )
+	{
+		Frames[NumFrame].create( RingSize, FrameType );
+	}
+
+	First = 0;
+	NbFrames = 0;
+	LastTimestamp = -1.0;
+}
+
+/**
+* @brief Keep a frame if FrameInterval elapsed since the last kept one
+* @param Frame [in] Working image
+* @param Timestamp [in] Timestamp of the frame
+* @return true if the frame was kept
+*/
+bool FrameRing::Add( const cv::Mat& Frame, double Timestamp )
+{
+	if ( IsInitialized() == false || (LastTimestamp >= 0.0 && Timestamp - LastTimestamp < FrameInterval) )
+	{
+		return false;
+	}
+
+	// Overwrite the oldest frame when the ring is full
+	int Capacity = (int)Frames.size();
+	int Pos;
+	if ( NbFrames < Capacity )
+	{
+		Pos = (First + NbFrames) % Capacity;
+		NbFrames++;
+	}
+	else
+	{
+		Pos = First;
+		First = (First + 1) % Capacity;
+	}
+
+	// Same size and type as allocated, no allocation here
+	cv::resize( Frame, Frames[Pos], Frames[Pos].size(), 0.0, 0.0, cv::INTER_AREA );
+	Timestamps[Pos] = Timestamp;
+	LastTimestamp = Timestamp;
+
+	return true;
+}
+
+/**
+* @brief Copy frames of a time window, oldest first
+* @param Start [in] Start of the window (s)
+* @param End [in] End of the window (s)
+* @param WindowFrames [out] Copy of the frames
+* @param WindowTimestamps [out] Timestamps of the frames
+* @return Number of frames
+*/
+int FrameRing::CopyWindow( double Start, double End, std::vector<cv::Mat>& WindowFrames, std::vector<double>& WindowTimestamps )
+{
+	WindowFrames.clear();
+	WindowTimestamps.clear();
+
+	int Capacity = (int)Frames.size();
+	for ( int NumFrame = 0; NumFrame < NbFrames; NumFrame++ )
+	{
+		int Pos = (First + NumFrame) % Capacity;
+		if ( Timestamps[Pos] < Start || Timestamps[Pos] > End )
+		{
+			continue;
+		}
+		WindowFrames.push_back( Frames[Pos].clone() );
+		WindowTimestamps.push_back( Timestamps[Pos] );
+	}
+
+	return (int)WindowFrames.size();
+}
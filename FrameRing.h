@@ -0,0 +1,88 @@
+/**
+ * @file FrameRing.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __FRAME_RING_H__
+#define __FRAME_RING_H__
+
+#include "Go-CamRecorder.h"
+
+#include <vector>
+
+#define DefaultPreRollFrameInterval 0.2		// Time (s) between 2 frames kept in the ring (5 fps)
+#define DefaultPreRollScale 0.5				// Scale of frames kept in the ring
+
+/**
+ * @class FrameRing
+ * @brief Bounded ring of the last seconds of working images (goban area), downscaled and subsampled in time
+ *		  to limit memory. All frames are allocated by Init, adding a frame only overwrites the oldest one.
+ */
+class FrameRing
+{
+public:
+	/**
+    * @brief Constructor, empty ring (Init must be called before adding frames)
+	*/
+	FrameRing();
+
+	/**
+    * @brief Allocate the ring
+    * @param FrameSize [in] Size of the working images
+    * @param FrameType [in] OpenCV type of the working images
+    * @param Duration [in] Time (s) covered by the ring
+    * @param _FrameInterval [in] Minimum time (s) between 2 kept frames
+    * @param _Scale [in] Scale of kept frames
+	*/
+	void Init( cv::Size FrameSize, int FrameType, double Duration, double _FrameInterval = DefaultPreRollFrameInterval, double _Scale = DefaultPreRollScale );
+
+	/**
+    * @brief Is the ring allocated?
+    * @return true if Init was called
+	*/
+	inline bool IsInitialized() const
+	{
+		return ( Frames.empty() == false );
+	}
+
+	/**
+    * @brief Get scale of kept frames
+    * @return Scale from working images to kept frames
+	*/
+	inline double GetScale() const
+	{
+		return Scale;
+	}
+
+	/**
+    * @brief Keep a frame if FrameInterval elapsed since the last kept one
+    * @param Frame [in] Working image
+    * @param Timestamp [in] Timestamp of the frame
+    * @return true if the frame was kept
+	*/
+	bool Add( const cv::Mat& Frame, double Timestamp );
+
+	/**
+    * @brief Copy frames of a time window, oldest first
+    * @param Start [in] Start of the window (s)
+    * @param End [in] End of the window (s)
+    * @param WindowFrames [out] Copy of the frames
+    * @param WindowTimestamps [out] Timestamps of the frames
+    * @return Number of frames
+	*/
+	int CopyWindow( double Start, double End, std::vector<cv::Mat>& WindowFrames, std::vector<double>& WindowTimestamps );
+
+protected:
+	std::vector<cv::Mat> Frames;			// Frames of the ring
+	std::vector<double> Timestamps;			// Timestamp of each frame
+	int First;								// Oldest frame
+	int NbFrames;							// Number of valid frames
+	double FrameInterval;					// Minimum time between 2 kept frames
+	double Scale;							// Scale of kept frames
+	double LastTimestamp;					// Timestamp of the last kept frame
+};
+
+#endif // __FRAME_RING_H__
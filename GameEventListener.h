@@ -0,0 +1,68 @@
+/**
+ * @file GameEventListener.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __GAME_EVENT_LISTENER_H__
+#define __GAME_EVENT_LISTENER_H__
+
+/**
+ * @class GameEventListener
+ * @brief Consumer of move events of a GobanState. A move is first provisional, as soon as its detector settles,
+ *		  then confirmed when committed, or retracted. Consumers override the phases they need: live viewers
+ *		  use provisional moves (online upload), archives use confirmed ones (SGF file, event log).
+ *		  Calls come from the processing thread.
+ */
+class GameEventListener
+{
+public:
+	/**
+	* @brief Virtual destructor
+	*/
+	virtual ~GameEventListener() {}
+
+	/**
+	* @brief A stone is seen on a settled detector, not committed yet
+	* @param Color [in] Black or White
+	* @param a [in] column of the goban
+	* @param b [in] line of the goban
+	* @param Timestamp [in] Timestamp of the frame
+	*/
+	virtual void ProvisionalMove( int Color, int a, int b, double Timestamp ) {}
+
+	/**
+	* @brief A move is committed
+	* @param NumMove [in] Number of the move in the game (1 for the first one)
+	* @param Color [in] Black or White
+	* @param a [in] column of the goban
+	* @param b [in] line of the goban
+	* @param Comment [in] Comment of the move for the SGF file (empty if none)
+	* @param Timestamp [in] Timestamp of the frame
+	*/
+	virtual void ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp ) {}
+
+	/**
+	* @brief A provisional move disappeared (NumMove is 0) or a committed move was undone (NumMove > 0)
+	* @param NumMove [in] Number of the undone move, 0 for a provisional move
+	* @param Color [in] Black or White
+	* @param a [in] column of the goban
+	* @param b [in] line of the goban
+	* @param Timestamp [in] Timestamp of the frame
+	*/
+	virtual void RetractedMove( int NumMove, int Color, int a, int b, double Timestamp ) {}
+
+	/**
+	* @brief A committed stone was removed by hand (not captured)
+	* @param NumMove [in] Number of moves played before the removal
+	* @param Color [in] Black or White
+	* @param a [in] column of the goban
+	* @param b [in] line of the goban
+	* @param Timestamp [in] Timestamp of the frame
+	*/
+	virtual void RemovedStone( int NumMove, int Color, int a, int b, double Timestamp ) {}
+};
+
+#endif // __GAME_EVENT_LISTENER_H__
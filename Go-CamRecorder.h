@@ -18,7 +18,8 @@
 #include <opencv2/calib3d/calib3d.hpp>
 #include <opencv2//imgproc/imgproc.hpp>
 
-#define MaxNumCells 19							// Max goban size, square for the moment
+#define MinGobanSize 3							// Min number of columns or lines of a goban (motion is extended to neighbour cells)
+#define MaxGobanSize 25							// Max number of columns or lines of a goban
 #define MaxThresholdForColorDetection 100		// Max value set to 100 (thus percentage are used)
 #define CentralValueForBlackDetection 60		// Start threshold for black detection. May be overrided in config file.
 #define CentralValueForWhiteDetection 180		// Start threshold for white detection. May be overrided in config file.
@@ -10,42 +10,48 @@
 
 /**
 * @brief Compute goban area deformation using the camera calibration
-* @param NumCells [in] Goban size
+* @param NumColumns [in] Number of columns of the goban
+* @param NumLines [in] Number of lines of the goban
 * @param SizeOfCells [in] Theoretical size of cells
 * @param _2DPointsInImage [out] Points projected in the image
 * @param CurCalibration [out] Camera calibration
 */
-void ProjectGobanBoard( int NumCells, float SizeOfCells, CalibrationContainer& CurCalibration, std::vector<cv::Vec2f>& _2DPointsInImage )
+void ProjectGobanBoard( int NumColumns, int NumLines, float SizeOfCells, CalibrationContainer& CurCalibration, std::vector<cv::Vec2f>& _2DPointsInImage )
 {
 	std::vector<cv::Vec3f> _3DPoints;
 
+	// Goban is centered on the origin, half a cell around the outer lines
+	float HalfWidth = GobanHalfExtent( NumColumns, SizeOfCells )+SizeOfCells/2;
+	float HalfHeight = GobanHalfExtent( NumLines, SizeOfCells )+SizeOfCells/2;
+
 	// Top left angle
-	_3DPoints.push_back( cv::Vec3f( (-(NumCells/2))*SizeOfCells-SizeOfCells/2, (NumCells/2)*SizeOfCells+SizeOfCells/2, 0.0f ) );
+	_3DPoints.push_back( cv::Vec3f( -HalfWidth, HalfHeight, 0.0f ) );
 	// Bottom left angle
-	_3DPoints.push_back( cv::Vec3f( (-(NumCells/2))*SizeOfCells-SizeOfCells/2, (-NumCells/2)*SizeOfCells-SizeOfCells/2, 0.0f ) );
+	_3DPoints.push_back( cv::Vec3f( -HalfWidth, -HalfHeight, 0.0f ) );
 	// Bottom right angle
-	_3DPoints.push_back( cv::Vec3f( ((NumCells/2))*SizeOfCells+SizeOfCells/2, (-NumCells/2)*SizeOfCells-SizeOfCells/2, 0.0f ) );
+	_3DPoints.push_back( cv::Vec3f( HalfWidth, -HalfHeight, 0.0f ) );
 	// top right angle
-	_3DPoints.push_back( cv::Vec3f( ((NumCells/2))*SizeOfCells+SizeOfCells/2, (NumCells/2)*SizeOfCells+SizeOfCells/2, 0.0f ) );
+	_3DPoints.push_back( cv::Vec3f( HalfWidth, HalfHeight, 0.0f ) );
 
 	CurCalibration.ProjectPoints( _3DPoints, _2DPointsInImage );
 }
 
 /**
 * @brief Create a mask to exclude ourside part of thescene from processing
-* @param NumCells [in] Goban size
+* @param NumColumns [in] Number of columns of the goban
+* @param NumLines [in] Number of lines of the goban
 * @param SizeOfCells [in] Theoretical size of cells
 * @param CurCalibration [out] Camera calibration
 * @param ImageMask [out] Binary mask to exclude outside area
 * @return Contour points.
 */
-std::vector<cv::Point> DoGobanMask( int NumCells, float SizeOfCells, CalibrationContainer& CurCalibration, cv::Mat& ImageMask )
+std::vector<cv::Point> DoGobanMask( int NumColumns, int NumLines, float SizeOfCells, CalibrationContainer& CurCalibration, cv::Mat& ImageMask )
 {
 	std::vector<cv::Point> PolygoneToFill;
 	std::vector<cv::Vec2f> _2DPointsInImage;
 
 	// Get projection og goban board
-	ProjectGobanBoard( NumCells, SizeOfCells, CurCalibration, _2DPointsInImage );
+	ProjectGobanBoard( NumColumns, NumLines, SizeOfCells, CurCalibration, _2DPointsInImage );
 
 	// cv::Point PolygoneAngle;
 
@@ -75,11 +81,83 @@ std::vector<cv::Point> DoGobanMask( int NumCells, float SizeOfCells, Calibration
 */
 void GobanDetector::DrawAll( cv::Mat& Img )
 {
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
-			AllDetectors[a][b].Draw( Img );
+			AllDetectors( a, b ).Draw( Img );
+		}
+	}
+}
+
+/**
+* @brief Cross product of OA and OB, positive if O, A, B turn counter-clockwise
+*/
+static inline int Cross( const cv::Point& O, const cv::Point& A, const cv::Point& B )
+{
+	return (A.x-O.x)*(B.y-O.y) - (A.y-O.y)*(B.x-O.x);
+}
+
+/**
+* @brief Mark in HullFill all cells within the convex hull of ComponentCells
+*/
+void GobanDetector::FillConvexHull()
+{
+	int NbPoints = (int)ComponentCells.size();
+	if ( NbPoints < 3 )
+	{
+		// Cells are already moving, nothing to fill
+		return;
+	}
+
+	// Andrew's monotone chain, in place sort and hull in preallocated buffers
+	std::sort( ComponentCells.begin(), ComponentCells.end(), []( const cv::Point& p, const cv::Point& q ) { return p.x < q.x || (p.x == q.x && p.y < q.y); } );
+
+	ComponentHull.resize( 2*NbPoints );
+	int NbHull = 0;
+	for ( int i = 0; i < NbPoints; i++ )
+	{
+		while ( NbHull >= 2 && Cross( ComponentHull[NbHull-2], ComponentHull[NbHull-1], ComponentCells[i] ) <= 0 )
+		{
+			NbHull--;
+		}
+		ComponentHull[NbHull++] = ComponentCells[i];
+	}
+	for ( int i = NbPoints-2, LowerSize = NbHull+1; i >= 0; i-- )
+	{
+		while ( NbHull >= LowerSize && Cross( ComponentHull[NbHull-2], ComponentHull[NbHull-1], ComponentCells[i] ) <= 0 )
+		{
+			NbHull--;
+		}
+		ComponentHull[NbHull++] = ComponentCells[i];
+	}
+	// Last point is the first one (closed polygon)
+
+	// Cells of the bounding box inside or on the border of the hull (counter-clockwise)
+	int MinA = ComponentCells.front().x;
+	int MaxA = ComponentCells.back().x;
+	int MinB = NumLines, MaxB = -1;
+	for ( int i = 0; i < NbPoints; i++ )
+	{
+		MinB = Min( MinB, ComponentCells[i].y );
+		MaxB = Max( MaxB, ComponentCells[i].y );
+	}
+
+	for ( int a = MinA; a <= MaxA; a++ )
+	{
+		for ( int b = MinB; b <= MaxB; b++ )
+		{
+			cv::Point CurCell( a, b );
+			bool Inside = true;
+			for ( int Edge = 0; Edge < NbHull-1 && Inside == true; Edge++ )
+			{
+				Inside = ( Cross( ComponentHull[Edge], ComponentHull[Edge+1], CurCell ) >= 0 );
+			}
+
+			if ( Inside == true )
+			{
+				HullFill[AllDetectors.Index( a, b )] = true;
+			}
 		}
 	}
 }
@@ -93,130 +171,139 @@ void GobanDetector::ComputeExtendedMotion( double CurrentTimestamp )
 #ifdef GO_CAM_KINECT_VERSION
 
 	// First copy "simple" motion detection
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
-			if ( AllDetectors[a][b].InMotion == true )
+			int Cell = AllDetectors.Index( a, b );
+			if ( AllDetectors.InMotion[Cell] == true )
 			{
-				AllDetectors[a][b].InMotionExtended = true;
-				if ( a != 0 ) { AllDetectors[a-1][b].InMotionExtended = true; }
-				if ( b != 0 ) { AllDetectors[a][b-1].InMotionExtended = true; }
-				if ( a != NumCells-1 ) { AllDetectors[a+1][b].InMotionExtended = true; }
-				if ( b != NumCells-1 ) { AllDetectors[a][b+1].InMotionExtended = true; }
+				AllDetectors.InMotionExtended[Cell] = true;
+				if ( a != 0 ) { AllDetectors.InMotionExtended[AllDetectors.Index( a-1, b )] = true; }
+				if ( b != 0 ) { AllDetectors.InMotionExtended[AllDetectors.Index( a, b-1 )] = true; }
+				if ( a != NumColumns-1 ) { AllDetectors.InMotionExtended[AllDetectors.Index( a+1, b )] = true; }
+				if ( b != NumLines-1 ) { AllDetectors.InMotionExtended[AllDetectors.Index( a, b+1 )] = true; }
 			}
 			else
 			{
-				AllDetectors[a][b].InMotionExtended = false;
+				AllDetectors.InMotionExtended[Cell] = false;
 			}
 		}
 	}
 
 #else
 	// First copy "simple" motion detection
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
-			AllDetectors[a][b].InMotionExtended = AllDetectors[a][b].InMotion;
+			int Cell = AllDetectors.Index( a, b );
+			AllDetectors.InMotionExtended[Cell] = AllDetectors.InMotion[Cell];
 		}
 	}
 #endif
 
 	// extend points to border of the goban
-	for ( int a = 1; a < NumCells-1; a++ )
+	for ( int a = 1; a < NumColumns-1; a++ )
 	{
-		if ( AllDetectors[a][2].InMotionExtended == true )
+		if ( AllDetectors.InMotionExtended[AllDetectors.Index( a, 2 )] == true )
 		{
-			AllDetectors[a][1].InMotionExtended = true;
-			AllDetectors[a][0].InMotionExtended = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( a, 1 )] = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( a, 0 )] = true;
 		}
 	}
 
-	for ( int a = 1; a < NumCells-1; a++ )
+	for ( int a = 1; a < NumColumns-1; a++ )
 	{
-		if ( AllDetectors[a][NumCells-3].InMotionExtended == true )
+		if ( AllDetectors.InMotionExtended[AllDetectors.Index( a, NumLines-3 )] == true )
 		{
-			AllDetectors[a][NumCells-2].InMotionExtended = true;
-			AllDetectors[a][NumCells-1].InMotionExtended = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( a, NumLines-2 )] = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( a, NumLines-1 )] = true;
 		}
 	}
 
 	// extend points to border of the goban
-	for ( int b = 1; b < NumCells-1; b++ )
+	for ( int b = 1; b < NumLines-1; b++ )
 	{
-		if ( AllDetectors[2][b].InMotionExtended == true )
+		if ( AllDetectors.InMotionExtended[AllDetectors.Index( 2, b )] == true )
 		{
-			AllDetectors[1][b].InMotionExtended = true;
-			AllDetectors[0][b].InMotionExtended = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( 1, b )] = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( 0, b )] = true;
 		}
 	}
 
 	// extend points to border of the goban
-	for ( int b = 1; b < NumCells-1; b++ )
+	for ( int b = 1; b < NumLines-1; b++ )
 	{
-		if ( AllDetectors[NumCells-3][b].InMotionExtended == true )
+		if ( AllDetectors.InMotionExtended[AllDetectors.Index( NumColumns-3, b )] == true )
 		{
-			AllDetectors[NumCells-2][b].InMotionExtended = true;
-			AllDetectors[NumCells-1][b].InMotionExtended = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( NumColumns-2, b )] = true;
+			AllDetectors.InMotionExtended[AllDetectors.Index( NumColumns-1, b )] = true;
 		}
 	}
 
-	// Fill holes using convex hull algorithm
-
-	// ok, from extended motion, now, let compute conveh hull
-	Mat threshold_output( NumCells+4, NumCells+4, CV_8UC1, cv::Scalar( 0 ) );
-
-	for ( int a = 0; a < NumCells; a++ )
+	// Fill holes using convex hull algorithm: cells within the convex hull of each group of moving cells
+	// (8-connected) are moving. Done on the cell grid with preallocated buffers, no allocation per frame.
+	std::fill( MotionComponent.begin(), MotionComponent.end(), -1 );
+	std::fill( HullFill.begin(), HullFill.end(), false );
+	int NbComponents = 0;
+	for ( int Cell = 0; Cell < NumColumns*NumLines; Cell++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		if ( AllDetectors.InMotionExtended[Cell] == false || MotionComponent[Cell] != -1 )
 		{
-			if ( AllDetectors[a][b].InMotionExtended == true )
-			{
-				threshold_output.at<unsigned char>( a+2, b+2 ) = 255;
-			}
+			continue;
 		}
-	}
 
-	using namespace std;
+		// Collect cells of this group
+		ComponentCells.clear();
+		ComponentStack.clear();
+		ComponentStack.push_back( Cell );
+		MotionComponent[Cell] = NbComponents;
+		while ( ComponentStack.empty() == false )
+		{
+			int CurCell = ComponentStack.back();
+			ComponentStack.pop_back();
 
-	/// Find contours
-	vector<vector<Point> > contours;
-	vector<Vec4i> hierarchy;
-	findContours( threshold_output, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point( 0, 0 ) );
+			int a = CurCell/NumLines;
+			int b = CurCell%NumLines;
+			ComponentCells.push_back( cv::Point( a, b ) );
 
-	/// Find the convex hull object for each contour
-	vector<vector<Point> >hull( contours.size() );
-	for ( int i = 0; i < contours.size(); i++ )
-	{
-		convexHull( Mat( contours[i] ), hull[i], false );
-	}
+			for ( int na = Max( a-1, 0 ); na <= Min( a+1, NumColumns-1 ); na++ )
+			{
+				for ( int nb = Max( b-1, 0 ); nb <= Min( b+1, NumLines-1 ); nb++ )
+				{
+					int Neighbour = AllDetectors.Index( na, nb );
+					if ( AllDetectors.InMotionExtended[Neighbour] == true && MotionComponent[Neighbour] == -1 )
+					{
+						MotionComponent[Neighbour] = NbComponents;
+						ComponentStack.push_back( Neighbour );
+					}
+				}
+			}
+		}
 
-	/// Draw contours + hull results
-	Mat drawing = Mat::zeros( threshold_output.size(), CV_8UC1 );
-	for ( int i = 0; i< contours.size(); i++ )
-	{
-		Scalar color = Scalar( 255, 255, 255 );
-		drawContours( threshold_output, hull, i, color, -1 );
+		FillConvexHull();
+		NbComponents++;
 	}
 
 	// #define DRAW_EXTENDED_MOTION
 #ifdef DRAW_EXTENDED_MOTION
 	bool modif = false;
 
-	cv::Mat ExMotionResult( NumCells*10, NumCells * 10, CV_8UC1, cv::Scalar( 0 ) );
+	cv::Mat ExMotionResult( NumLines*10, NumColumns*10, CV_8UC1, cv::Scalar( 0 ) );
 #endif
 
 	// Result back to moving objects
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
-			if ( threshold_output.at<unsigned char>( a+2, b+2 ) == 255 && AllDetectors[a][b].InMotionExtended == false )
+			int Cell = AllDetectors.Index( a, b );
+			if ( HullFill[Cell] == true && AllDetectors.InMotionExtended[Cell] == false )
 			{
-				AllDetectors[a][b].InMotionExtended = true;
-				AllDetectors[a][b].LastMotionEvent.HValue = 255;
-				// AllDetectors[a][b].LastMotionEvent.Timestamp = CurrentTimestamp;
+				AllDetectors.InMotionExtended[Cell] = true;
+				AllDetectors.LastMotionEvent[Cell].HValue = 255;
+				// AllDetectors.LastMotionEvent[Cell].Timestamp = CurrentTimestamp;
 #ifdef DRAW_EXTENDED_MOTION
 				modif = true;
 				cv::rectangle( ExMotionResult, cv::Rect( a*10, b*10, 10, 10 ), cv::Scalar( 255 ), -1 );
@@ -235,24 +322,25 @@ void GobanDetector::ComputeExtendedMotion( double CurrentTimestamp )
 	}
 #endif
 
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
-			if ( AllDetectors[a][b].InMotionExtended == true )
+			int Cell = AllDetectors.Index( a, b );
+			if ( AllDetectors.InMotionExtended[Cell] == true )
 			{
 				// Reset counter
-				AllDetectors[a][b].MotionCount = 10;
+				AllDetectors.MotionCount[Cell] = 10;
 			}
 			else
 			{
-				if ( AllDetectors[a][b].MotionCount > 0 )
+				if ( AllDetectors.MotionCount[Cell] > 0 )
 				{
-					AllDetectors[a][b].MotionCount--;
+					AllDetectors.MotionCount[Cell]--;
 				}
-				if ( AllDetectors[a][b].MotionCount > 0 )
+				if ( AllDetectors.MotionCount[Cell] > 0 )
 				{
-					AllDetectors[a][b].InMotionExtended = true;
+					AllDetectors.InMotionExtended[Cell] = true;
 				}
 			}
 		}
@@ -507,59 +595,19 @@ bool GobanDetector::GetCalibration( Omiscid::SimpleString& InputName, MultiVideo
 		cv::destroyWindow( CalibrationWindowName );
 	}
 
-	// Make calibration check by user, clear vectors if we used them for calibration
-	std::vector<cv::Vec3f> _3DPoints;
+	// Make calibration check by user
 	std::vector<cv::Vec2f> _2DPoints;
-
-	// Compute min/max boudary
-	ProjectGobanBoard( NumCells, SizeOfCells, GobanViewCalibration, _2DPoints );
-
-	// Compute subimage rect
-	SubImageRect = cv::boundingRect( _2DPoints );
-
-	// To be usable for mp4 exporting, wize must be multiple of 2.
-	if ( SubImageRect.height % 2 == 1 )
-	{
-		SubImageRect.height -= 1;
-	}
-
-	if ( SubImageRect.width % 2 == 1 )
-	{
-		SubImageRect.width -= 1;
-	}
-
-	int init_x = SubImageRect.x;
-	int init_y = SubImageRect.y;
-
-	_2DPoints.clear();
-
-	// Percentage of considered stones
-	const float PercentageSizeOfStones = 0.90f;
-
-	// Construct position of all goban points in 3D
-	for ( int a = -(NumCells/2); a <= (NumCells/2); a++ )
-	{
-		for ( int b = (NumCells/2); b >= -(NumCells/2); b-- )
-		{
-			// Compute center of Cell
-			_3DPoints.push_back( cv::Vec3f( (a)*SizeOfCells, (b)*SizeOfCells, 0.0f ) );
-			// Compute radius of detection area
-			_3DPoints.push_back( cv::Vec3f( (a)*SizeOfCells+PercentageSizeOfStones*SizeOfCells/2.0f, (b)*SizeOfCells, 0.0f ) );
-			_3DPoints.push_back( cv::Vec3f( (a)*SizeOfCells, (b)*SizeOfCells+PercentageSizeOfStones*SizeOfCells/2.0f, 0.0f ) );
-		}
-	}
-
-	// Project them
-	GobanViewCalibration.ProjectPoints( _3DPoints, _2DPoints );
+	std::vector<cv::Point> ContourPoints;
+	ComputeWorkingArea( CurImage.size(), _2DPoints, ContourPoints );
 
 	// Copie original image
 	CurImage.copyTo( FirstImage );
 
 	// Project detector back in new subframe
 	int Curp = 0;
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
 			cv::Point p( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
 			Curp += 3;
@@ -570,10 +618,6 @@ bool GobanDetector::GetCalibration( Omiscid::SimpleString& InputName, MultiVideo
 		}
 	}
 
-	// Full image gray scale mask
-	FullImageMask = cv::Mat( FirstImage.size(), CV_8UC1 );
-	std::vector<cv::Point> ContourPoints = DoGobanMask( NumCells, SizeOfCells, GobanViewCalibration, FullImageMask );
-
 	// Create masked version
 	cv::Mat Masked;
 	FirstImage.copyTo( Masked );
@@ -599,30 +643,7 @@ bool GobanDetector::GetCalibration( Omiscid::SimpleString& InputName, MultiVideo
 			case 'y':
 			case 'Y':
 			{
-				// Project detector back in new subframe
-				int Curp = 0;
-				for ( int a = 0; a < NumCells; a++ )
-				{
-					for ( int b = 0; b < NumCells; b++ )
-					{
-						cv::Point p( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
-						Curp++;
-
-						// Get border of the stone
-						cv::Point borderx( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
-						Curp++;
-
-						cv::Point bordery( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
-						Curp++;
-
-						// Min 2 pixels, radius of the globing circle, rect area will be double
-						// int radius = Max( Min( abs(borderx.x - p.x), abs(bordery.y - p.y) ), 2 );
-						int radius = Max( abs( borderx.x - p.x ), 2 );
-
-						AllDetectors[a][b].radius2 = Max( abs( bordery.y - p.y ), 2 );
-						AllDetectors[a][b].Init( cv::Point( p.x-init_x, p.y-init_y ), radius, FirstImage );
-					}
-				}
+				InitDetectors( FirstImage, _2DPoints );
 
 				// Shall we save the calibration?
 				if ( LoadedCalibration == false )
@@ -669,6 +690,366 @@ bool GobanDetector::GetCalibration( Omiscid::SimpleString& InputName, MultiVideo
 	return false;
 }
 
+/**
+* @brief Compute goban area, detector positions and goban mask from the calibration
+* @param ImageSize [in] Size of the images of the source
+* @param _2DPoints [out] Center and radius points of each detector in the image, 3 points per cell
+* @param ContourPoints [out] Corners of the goban in the image
+*/
+void GobanDetector::ComputeWorkingArea( cv::Size ImageSize, std::vector<cv::Vec2f>& _2DPoints, std::vector<cv::Point>& ContourPoints )
+{
+	std::vector<cv::Vec3f> _3DPoints;
+
+	SourceImageSize = ImageSize;
+
+	// Compute min/max boudary
+	ProjectGobanBoard( NumColumns, NumLines, SizeOfCells, GobanViewCalibration, _2DPoints );
+
+	// Compute subimage rect
+	SubImageRect = cv::boundingRect( _2DPoints );
+
+	// To be usable for mp4 exporting, wize must be multiple of 2.
+	if ( SubImageRect.height % 2 == 1 )
+	{
+		SubImageRect.height -= 1;
+	}
+
+	if ( SubImageRect.width % 2 == 1 )
+	{
+		SubImageRect.width -= 1;
+	}
+
+	_2DPoints.clear();
+
+	// Construct position of all goban points in 3D, first column on the left, first line on the top
+	float StartX = -GobanHalfExtent( NumColumns, SizeOfCells );
+	float StartY = GobanHalfExtent( NumLines, SizeOfCells );
+	for ( int a = 0; a < NumColumns; a++ )
+	{
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			float x = StartX + (float)a*SizeOfCells;
+			float y = StartY - (float)b*SizeOfCells;
+
+			// Compute center of Cell
+			_3DPoints.push_back( cv::Vec3f( x, y, 0.0f ) );
+			// Compute radius of detection area
+			_3DPoints.push_back( cv::Vec3f( x+PercentageSizeOfStones*SizeOfCells/2.0f, y, 0.0f ) );
+			_3DPoints.push_back( cv::Vec3f( x, y+PercentageSizeOfStones*SizeOfCells/2.0f, 0.0f ) );
+		}
+	}
+
+	// Project them
+	GobanViewCalibration.ProjectPoints( _3DPoints, _2DPoints );
+
+	// Full image gray scale mask
+	FullImageMask = cv::Mat( ImageSize, CV_8UC1 );
+	ContourPoints = DoGobanMask( NumColumns, NumLines, SizeOfCells, GobanViewCalibration, FullImageMask );
+}
+
+/**
+* @brief Init all stone detectors from the working area (rectified tiles or projected stones)
+* @param InitImage [in] Image of the source
+* @param _2DPoints [in] Center and radius points of each detector in the image, from ComputeWorkingArea
+*/
+void GobanDetector::InitDetectors( cv::Mat& InitImage, const std::vector<cv::Vec2f>& _2DPoints )
+{
+	int init_x = SubImageRect.x;
+	int init_y = SubImageRect.y;
+
+	if ( RectifiedMode == true )
+	{
+		// Detectors work on tiles of the rectified goban
+		InitRectification();
+	}
+	else
+	{
+		ComputeProcessingScale();
+
+		// Project detector back in new subframe
+		int Curp = 0;
+		for ( int a = 0; a < NumColumns; a++ )
+		{
+			for ( int b = 0; b < NumLines; b++ )
+			{
+				cv::Point p( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
+				Curp++;
+
+				// Get border of the stone
+				cv::Point borderx( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
+				Curp++;
+
+				cv::Point bordery( (int)_2DPoints[Curp][0], (int)_2DPoints[Curp][1] );
+				Curp++;
+
+				// Min 2 pixels, radius of the globing circle, rect area will be double
+				// int radius = Max( Min( abs(borderx.x - p.x), abs(bordery.y - p.y) ), 2 );
+				int radius = Max( abs( borderx.x - p.x ), 2 );
+				int radius2 = Max( abs( bordery.y - p.y ), 2 );
+				cv::Point Center( p.x-init_x, p.y-init_y );
+
+				if ( ProcessingScale < 1.0 )
+				{
+					// Detector geometry in the downscaled image
+					Center = cv::Point( (int)(Center.x*ProcessingScale), (int)(Center.y*ProcessingScale) );
+					radius = Max( (int)(abs( borderx.x - p.x )*ProcessingScale), 2 );
+					radius2 = Max( (int)(abs( bordery.y - p.y )*ProcessingScale), 2 );
+				}
+
+				AllDetectors.radius2[AllDetectors.Index( a, b )] = radius2;
+				AllDetectors( a, b ).Init( Center, radius );
+			}
+		}
+
+		// Compute masks of all detectors in one atlas (on an image of the processed size when downscaled)
+		cv::Mat MaskImage = InitImage;
+		if ( ProcessingScale < 1.0 )
+		{
+			MaskImage = cv::Mat( ScaledSize, CV_8UC3 );
+		}
+		AllDetectors.InitMasks( MaskImage );
+		AllDetectors.InitSamples( MaskImage, NbSamplesPerCell );
+	}
+}
+
+/**
+* @brief Restore calibration, detectors, game and SGF file from the checkpoint instead of calibrating
+* @param CurSource [in] Source of images (video or device)
+* @return True if the session was restored.
+*/
+bool GobanDetector::ResumeFromCheckpoint( MultiVideoSource& CurSource )
+{
+	cv::Mat CurImage, CurDepth;			// To get data from Source, Depth won't be used
+	if ( CurSource.ReadFrame( CurImage, CurDepth ) == false )
+	{
+		fprintf( stderr, "Could not read first frame, abording..." );
+		return false;
+	}
+
+	BinaryCheckpoint Checkpoint;
+	if ( CheckpointFileName.IsEmpty() == true || Checkpoint.Open( CheckpointFileName ) == false )
+	{
+		fprintf( stderr, "Could not open checkpoint '%s'\n", CheckpointFileName.GetStr() );
+		return false;
+	}
+
+	int32_t Width = 0, Height = 0;
+	Checkpoint.ReadValue( Width );
+	Checkpoint.ReadValue( Height );
+	if ( Checkpoint.IsValid() == false || CurImage.cols != Width || CurImage.rows != Height )
+	{
+		fprintf( stderr, "Checkpoint was not recorded with %dx%d images\n", CurImage.cols, CurImage.rows );
+		return false;
+	}
+
+	Checkpoint >> GobanViewCalibration;
+	if ( Checkpoint.IsValid() == false || GobanViewCalibration.HasEnoughPoints() == false )
+	{
+		fprintf( stderr, "Checkpoint calibration is not valid\n" );
+		return false;
+	}
+
+	// Same working area and detectors as after validation of the calibration
+	std::vector<cv::Vec2f> _2DPoints;
+	std::vector<cv::Point> ContourPoints;
+	ComputeWorkingArea( CurImage.size(), _2DPoints, ContourPoints );
+	InitDetectors( CurImage, _2DPoints );
+
+	double CurrentTimestamp = CurSource.GetTimestamp();
+	if ( GameState.LoadCheckpoint( Checkpoint, AllDetectors, CurrentTimestamp ) == false )
+	{
+		return false;
+	}
+
+	LastCheckpointTimestamp = CurrentTimestamp;
+	LastCheckpointHistory = GameState.History;
+
+	fprintf( stderr, "Session resumed from '%s' after move %d\n", CheckpointFileName.GetStr(), GameState.GetNbMoves() );
+	return true;
+}
+
+/**
+* @brief Write a checkpoint after each committed change or when CheckpointInterval elapsed. Must not be
+*		 called while a frame is processed.
+* @param CurrentTimestamp [in] Timestamp of the frame
+* @return True if a checkpoint was written.
+*/
+bool GobanDetector::CheckpointIfNeeded( double CurrentTimestamp )
+{
+	if ( CheckpointFileName.IsEmpty() == true )
+	{
+		return false;
+	}
+
+	// Any commit, removal or rollback changes the last event of the history
+	bool Committed = ( GameState.History != LastCheckpointHistory );
+	if ( Committed == false && LastCheckpointTimestamp >= 0.0 && CurrentTimestamp - LastCheckpointTimestamp < CheckpointInterval )
+	{
+		return false;
+	}
+
+	// Serialised in memory here, file written, synced and replaced by the writer thread
+	CheckpointThread.Start( CheckpointFileName );
+	BinaryCheckpoint Checkpoint;
+	Checkpoint.Create( CheckpointFileName );
+
+	Checkpoint.WriteValue( (int32_t)SourceImageSize.width );
+	Checkpoint.WriteValue( (int32_t)SourceImageSize.height );
+	Checkpoint << GobanViewCalibration;
+	GameState.SaveCheckpoint( Checkpoint, AllDetectors, CurrentTimestamp );
+
+	LastCheckpointTimestamp = CurrentTimestamp;
+	LastCheckpointHistory = GameState.History;
+
+	return Checkpoint.Commit( CheckpointThread );
+}
+
+/**
+* @brief Remove checkpoint file, at the end of a game
+*/
+void GobanDetector::RemoveCheckpoint()
+{
+	CheckpointThread.Stop();
+	if ( CheckpointFileName.IsEmpty() == false )
+	{
+		remove( CheckpointFileName.GetStr() );
+	}
+}
+
+/**
+* @brief Compute processing scale from the number of pixels per cell of the goban view
+*/
+void GobanDetector::ComputeProcessingScale()
+{
+	double PixelsPerCell = std::max( (double)SubImageRect.width/(double)NumColumns, (double)SubImageRect.height/(double)NumLines );
+
+	ProcessingScale = 1.0;
+	ScaledSize = SubImageRect.size();
+	if ( TargetCellSize <= 0 || PixelsPerCell <= (double)TargetCellSize )
+	{
+		// Native resolution
+		return;
+	}
+
+	ProcessingScale = (double)TargetCellSize/PixelsPerCell;
+
+	// Even size to keep the image usable for mp4 export
+	ScaledSize = cv::Size( Max( (int)(SubImageRect.width*ProcessingScale) & ~1, 2 ), Max( (int)(SubImageRect.height*ProcessingScale) & ~1, 2 ) );
+
+	fprintf( stderr, "%.1lf pixels per cell, processing goban area at scale %.3lf (%dx%d)\n", PixelsPerCell, ProcessingScale, ScaledSize.width, ScaledSize.height );
+}
+
+/**
+* @brief Compute remap tables from calibration and init all detectors on the tiles of the rectified image
+*/
+void GobanDetector::InitRectification()
+{
+	// Tile size from the mean number of pixels per cell in the image, even to keep the image usable for mp4 export
+	int PixelsPerCell = Max( SubImageRect.width/NumColumns, SubImageRect.height/NumLines );
+	TileSize = PixelsPerCell;
+	if ( TargetCellSize > 0 && TileSize > TargetCellSize )
+	{
+		// High resolution view, sample it directly at the target cell size
+		TileSize = TargetCellSize;
+	}
+	TileSize = Max( (TileSize+1) & ~1, 8 );
+	ProcessingScale = std::min( (double)TileSize/(double)Max( PixelsPerCell, 1 ), 1.0 );
+
+	cv::Size RectifiedSize( NumColumns*TileSize, NumLines*TileSize );
+
+	// 3D position (on the goban plane) of each pixel center of the rectified image, top left angle first
+	std::vector<cv::Vec3f> _3DPoints;
+	std::vector<cv::Vec2f> _2DPoints;
+	_3DPoints.reserve( RectifiedSize.area() );
+
+	float StartX = -(GobanHalfExtent( NumColumns, SizeOfCells ) + 0.5f*SizeOfCells);
+	float StartY = GobanHalfExtent( NumLines, SizeOfCells ) + 0.5f*SizeOfCells;
+	float PixelSize = SizeOfCells/(float)TileSize;
+	for ( int line = 0; line < RectifiedSize.height; line++ )
+	{
+		for ( int col = 0; col < RectifiedSize.width; col++ )
+		{
+			_3DPoints.push_back( cv::Vec3f( StartX + ((float)col + 0.5f)*PixelSize, StartY - ((float)line + 0.5f)*PixelSize, 0.0f ) );
+		}
+	}
+
+	// Project them once in the image (with distorsion) to get the float remap table
+	GobanViewCalibration.ProjectPoints( _3DPoints, _2DPoints );
+	cv::Mat FloatMap( RectifiedSize, CV_32FC2, (void*)&_2DPoints[0] );
+
+	// Convert it to fixed-point tables for fast remapping
+	cv::convertMaps( FloatMap, cv::Mat(), RectifyMap1, RectifyMap2, CV_16SC2 );
+
+	RectifiedImage = cv::Mat( RectifiedSize, CV_8UC3, cv::Scalar( 0, 0, 0 ) );
+
+	// All detectors are identical, centered on their tile
+	int radius = RectifiedStoneRadius( TileSize );
+	for ( int a = 0; a < NumColumns; a++ )
+	{
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			AllDetectors.radius2[AllDetectors.Index( a, b )] = radius;
+			AllDetectors( a, b ).Init( cv::Point( a*TileSize + TileSize/2, b*TileSize + TileSize/2 ), radius );
+		}
+	}
+
+	// Compute masks of all detectors in one atlas
+	AllDetectors.InitMasks( RectifiedImage );
+	AllDetectors.InitSamples( RectifiedImage, NbSamplesPerCell );
+
+	// All tiles are identical, use kernels specialised for this tile and goban sizes if any
+	if ( SelectDetectorKernels( NumLines, TileSize, AllDetectors.MotionKernel, AllDetectors.ScoreKernel ) == true )
+	{
+		fprintf( stderr, "Using detector kernels specialised for %dx%d goban and %d pixel tiles\n", NumColumns, NumLines, TileSize );
+	}
+}
+
+/**
+* @brief Draw stone detectors of the current frame in the feedback image
+* @param LoadImage [in,out] Image from the current video source
+*/
+void GobanDetector::DrawDetections( cv::Mat& LoadImage )
+{
+	// Feedback stays at native resolution when processing is downscaled
+	cv::Mat FeedbackImage = GetFeedbackImage( LoadImage );
+	double DrawScale = ( RectifiedMode == false ) ? 1.0/ProcessingScale : 1.0;
+	for ( int a = 0; a < NumColumns; a++ )
+	{
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			AllDetectors( a, b ).Draw( FeedbackImage, -1, DrawScale );
+		}
+	}
+}
+
+/**
+* @brief Get working image from an input image: goban area cropped from the image or rectified goban image
+* @param InputImage [in] Full input image
+* @param RectifiedBuffer [in,out] Buffer to store rectified image (when in rectified mode)
+* @param Interpolation [in] Interpolation used for remapping
+* @return Image to process
+*/
+cv::Mat GobanDetector::GetWorkingImage( cv::Mat& InputImage, cv::Mat& RectifiedBuffer, int Interpolation )
+{
+	if ( RectifiedMode == false )
+	{
+		// crop image to necessary zone
+		cv::Mat GobanArea( InputImage, SubImageRect );
+		if ( ProcessingScale >= 1.0 )
+		{
+			return GobanArea;
+		}
+
+		// High resolution view, downscale it once for all processing (area averaging for colors, nearest for depth)
+		cv::Mat& ScaledBuffer = ( Interpolation == cv::INTER_NEAREST ) ? ScaledDepth : ScaledImage;
+		cv::resize( GobanArea, ScaledBuffer, ScaledSize, 0.0, 0.0, ( Interpolation == cv::INTER_NEAREST ) ? cv::INTER_NEAREST : cv::INTER_AREA );
+		return ScaledBuffer;
+	}
+
+	// Warp goban area using the precomputed tables
+	cv::remap( InputImage, RectifiedBuffer, RectifyMap1, RectifyMap2, Interpolation, cv::BORDER_CONSTANT );
+	return RectifiedBuffer;
+}
 
 /**
 * @brief Init detection process (motion detection, stone detectors)
@@ -676,8 +1057,23 @@ bool GobanDetector::GetCalibration( Omiscid::SimpleString& InputName, MultiVideo
 */
 void GobanDetector::InitDetection( cv::Mat& InputImage )
 {
-	SubImageMask = cv::Mat( FullImageMask, SubImageRect );
-	cv::Mat CropedImage( InputImage, SubImageRect );
+	cv::Mat CropedImage;
+	if ( RectifiedMode == true )
+	{
+		// The whole rectified image is on the goban
+		SubImageMask = cv::Mat( GetProcessedImageSize(), CV_8UC1, cv::Scalar( 255 ) );
+		CropedImage = GetWorkingImage( InputImage, InputImage.type() == CV_8UC3 ? RectifiedImage : RectifiedDepth, InputImage.type() == CV_8UC3 ? cv::INTER_LINEAR : cv::INTER_NEAREST );
+	}
+	else if ( ProcessingScale < 1.0 )
+	{
+		cv::resize( cv::Mat( FullImageMask, SubImageRect ), SubImageMask, ScaledSize, 0.0, 0.0, cv::INTER_NEAREST );
+		CropedImage = GetWorkingImage( InputImage, RectifiedImage, InputImage.type() == CV_8UC3 ? cv::INTER_LINEAR : cv::INTER_NEAREST );
+	}
+	else
+	{
+		SubImageMask = cv::Mat( FullImageMask, SubImageRect );
+		CropedImage = cv::Mat( InputImage, SubImageRect );
+	}
 
 	// Create history frames
 	HistoryFrames[0] = new cv::Mat( SubImageMask.size(), SubImageMask.type() );
@@ -689,6 +1085,349 @@ void GobanDetector::InitDetection( cv::Mat& InputImage )
 	HistoryFrames[0]->copyTo( *HistoryFrames[1] );
 #endif
 
+	// Tiles may have changed, owned parts are computed again on the next fused frame
+	OwnedTileMasks.clear();
+}
+
+/**
+* @brief Per thread image of the tile-fused pipeline. Buffers are only reallocated for larger images,
+*		 a view of the requested size is returned thus detector rects are the same as in shared images.
+* @param Index [in] Buffer to use (0 to 2)
+* @param Size [in] Size of the working image
+* @return Per thread image of Size
+*/
+static cv::Mat GetThreadImage( int Index, cv::Size Size )
+{
+	static thread_local cv::Mat Buffers[3];
+	cv::Mat& Buffer = Buffers[Index];
+	if ( Buffer.rows < Size.height || Buffer.cols < Size.width )
+	{
+		Buffer.create( Max( Buffer.rows, Size.height ), Max( Buffer.cols, Size.width ), CV_8UC1 );
+	}
+	return cv::Mat( Buffer, cv::Rect( 0, 0, Size.width, Size.height ) );
+}
+
+/**
+* @brief Process cells in range. Cells are numbered a*NumLines+b.
+* @param Cells [in] Range of cells to process
+*/
+/* virtual */ void GobanDetector::CellsParallelLoop::operator()( const cv::Range& Cells ) const
+{
+	for ( int Pos = Cells.start; Pos < Cells.end; Pos++ )
+	{
+		int Cell = ( CellList != nullptr ) ? (*CellList)[Pos] : Pos;
+		StoneDetector CurDetector = Owner.AllDetectors[Cell];
+
+		switch ( Phase )
+		{
+			case MotionPhase:
+				CurDetector.DoMotionDetection( Owner.Motion, CurrentTimestamp, DepthMode );
+				break;
+
+			case StonePhase:
+				CurDetector.DoStoneDetection( Owner.Motion, Owner.WhiteDetection, Owner.BlackDetection, CurrentTimestamp, DepthMode );
+				CurDetector.AccumulateEvidence( CurrentTimestamp, Owner.EvidenceTimeConstant );
+				break;
+
+			case PatchPhase:
+				PatchClassifier::ExtractPatch( Owner.CurrentImage, CurDetector.GetRect( Owner.CurrentImage, CurDetector.Center ), Owner.PatchBatch, Cell );
+				break;
+
+			case ClassifierPhase:
+				CurDetector.ApplyClassification( Owner.PatchClasses[Cell], CurrentTimestamp, DepthMode );
+				CurDetector.AccumulateEvidence( CurrentTimestamp, Owner.EvidenceTimeConstant );
+				break;
+
+			case FusedPhase:
+			{
+				// From pixels to motion decision on the same tile, stone scoring is left to the scheduled cells
+				cv::Mat LocalMotion = GetThreadImage( 0, Owner.CurrentImage.size() );
+				Owner.ProcessTile( Cell, CurDetector.GetRect( Owner.CurrentImage, CurDetector.Center ), LocalMotion );
+				CurDetector.DoMotionDetection( LocalMotion, CurrentTimestamp, DepthMode );
+				break;
+			}
+
+			case FusedStonePhase:
+			{
+				// Color detection of a scheduled cell, scored while its tile is in cache
+				cv::Mat LocalWhite = GetThreadImage( 1, Owner.CurrentImage.size() );
+				cv::Mat LocalBlack = GetThreadImage( 2, Owner.CurrentImage.size() );
+				Owner.DetectColorsOnTile( CurDetector.GetRect( Owner.CurrentImage, CurDetector.Center ), LocalWhite, LocalBlack );
+				CurDetector.DoStoneDetection( Owner.Motion, LocalWhite, LocalBlack, CurrentTimestamp, DepthMode );
+				CurDetector.AccumulateEvidence( CurrentTimestamp, Owner.EvidenceTimeConstant );
+				break;
+			}
+		}
+	}
+}
+
+/**
+* @brief Run a detection phase over all cells using cv::parallel_for_
+* @param Phase [in] CellsParallelLoop::MotionPhase or CellsParallelLoop::StonePhase
+* @param CurrentTimestamp [in] Timestamp of the frame
+* @param DepthMode [in] DepthMode: true if using Kinect.
+* @param CellList [in] Cells to process (default nullptr for all cells)
+* @param First [in] First position to process in the cell list (default 0)
+* @param Last [in] Position after the last one to process in the cell list (default -1 for the end of the list)
+*/
+void GobanDetector::ProcessAllCells( int Phase, double CurrentTimestamp, bool DepthMode, const std::vector<int> * CellList /* = nullptr */, int First /* = 0 */, int Last /* = -1 */ )
+{
+	if ( Last < 0 )
+	{
+		Last = ( CellList != nullptr ) ? (int)CellList->size() : NumColumns*NumLines;
+	}
+
+	int NbCells = Last - First;
+	if ( NbCells <= 0 )
+	{
+		return;
+	}
+
+#ifdef DEBUG
+	// In DEBUG, sub detectors draw in the shared detection images, stay sequential
+	double NbStripes = 1.0;
+#else
+	// One stripe per group of CellsPerTask cells
+	double NbStripes = (double)((NbCells + CellsPerTask - 1)/CellsPerTask);
+#endif
+
+	cv::parallel_for_( cv::Range( First, Last ), CellsParallelLoop( *this, Phase, CurrentTimestamp, DepthMode, CellList ), NbStripes );
+}
+
+/**
+* @brief Compute owned part of each tile and memory traffic estimations, once after calibration
+* @param ImageSize [in] Size of the working image
+*/
+void GobanDetector::InitFusedTiles( cv::Size ImageSize )
+{
+	// Each pixel belongs to the first tile covering it
+	cv::Mat Claimed( ImageSize, CV_8UC1, cv::Scalar( 0 ) );
+	double TilePixels = 0.0;
+
+	OwnedTileMasks.resize( NumColumns*NumLines );
+	for ( int Cell = 0; Cell < NumColumns*NumLines; Cell++ )
+	{
+		StoneDetector CurDetector = AllDetectors[Cell];
+		cv::Rect Tile = CurDetector.GetRect( Claimed, CurDetector.Center );
+		cv::Mat ClaimedTile( Claimed, Tile );
+
+		cv::compare( ClaimedTile, cv::Scalar( 0 ), OwnedTileMasks[Cell], cv::CMP_EQ );
+		ClaimedTile.setTo( cv::Scalar( 255 ) );
+		TilePixels += (double)Tile.area();
+	}
+
+	// Estimations from tile areas with all cells scored, not measured. Whole-image passes (images do not fit in cache):
+	// bytes read and written for each pixel by cvtColor (3+1), bitwise_and (2+1), absdiff (2+1), threshold (1+1)
+	// and the 2 inRange (2x(3+1)), then motion read again on tiles and both detection images read on tiles.
+	double ImagePixels = (double)ImageSize.area();
+	EstimatedPassesTraffic = 20.0*ImagePixels + 3.0*TilePixels;
+
+	// Tile-fused pipeline: color, mask and previous gray read once per tile pixel (5), gray and motion written (2),
+	// then color read again in the stone phase (3), detection images stay in the per thread buffers
+	EstimatedFusedTraffic = 10.0*TilePixels;
+}
+
+/**
+* @brief Compute gray and motion on the tile of a cell. Shared gray and motion images only receive owned pixels.
+* @param Cell [in] Cell of the tile
+* @param Tile [in] Area of the cell in the working image
+* @param LocalMotion [in,out] Per thread motion image (size of the working image) used for the motion decision
+*/
+void GobanDetector::ProcessTile( int Cell, const cv::Rect& Tile, cv::Mat& LocalMotion )
+{
+	static thread_local cv::Mat GrayBuffer;
+	static thread_local cv::Mat DiffBuffer;
+	if ( GrayBuffer.rows < Tile.height || GrayBuffer.cols < Tile.width )
+	{
+		// Buffers are only reallocated for larger tiles, sizes of tiles differ by a few pixels
+		GrayBuffer.create( Max( GrayBuffer.rows, Tile.height ), Max( GrayBuffer.cols, Tile.width ), CV_8UC1 );
+		DiffBuffer.create( GrayBuffer.size(), CV_8UC1 );
+	}
+	cv::Mat GrayTile( GrayBuffer, cv::Rect( 0, 0, Tile.width, Tile.height ) );
+	cv::Mat DiffTile( DiffBuffer, cv::Rect( 0, 0, Tile.width, Tile.height ) );
+
+	cv::Mat SourceTile( CurrentImage, Tile );
+	cv::Mat MotionTile( LocalMotion, Tile );
+	const cv::Mat& OwnedMask = OwnedTileMasks[Cell];
+
+	// Same operations as the whole-image passes of ProcessCurrentFrame
+	cv::cvtColor( SourceTile, GrayTile, cv::COLOR_BGR2GRAY );
+	cv::bitwise_and( GrayTile, cv::Mat( SubImageMask, Tile ), GrayTile );
+
+	cv::absdiff( cv::Mat( *HistoryFrames[1], Tile ), GrayTile, DiffTile );
+	cv::threshold( DiffTile, MotionTile, 40, 255, cv::THRESH_BINARY );
+
+	// Tiles of neighbour cells overlap, each shared pixel is written by one cell only
+	cv::Mat CurrentGrayTile( *HistoryFrames[0], Tile );
+	GrayTile.copyTo( CurrentGrayTile, OwnedMask );
+	cv::Mat SharedMotionTile( Motion, Tile );
+	MotionTile.copyTo( SharedMotionTile, OwnedMask );
+}
+
+/**
+* @brief Compute black and white detection on the tile of a cell
+* @param Tile [in] Area of the cell in the working image
+* @param LocalWhite [in,out] Per thread white detection image (size of the working image)
+* @param LocalBlack [in,out] Per thread black detection image (size of the working image)
+*/
+void GobanDetector::DetectColorsOnTile( const cv::Rect& Tile, cv::Mat& LocalWhite, cv::Mat& LocalBlack )
+{
+	cv::Mat SourceTile( CurrentImage, Tile );
+	cv::Mat BlackTile( LocalBlack, Tile );
+	cv::Mat WhiteTile( LocalWhite, Tile );
+
+	cv::inRange( SourceTile, cv::Scalar( 0, 0, 0 ), cv::Scalar( HighBlackValue, HighBlackValue, HighBlackValue ), BlackTile );
+	cv::inRange( SourceTile, cv::Scalar( LowWhiteValue, LowWhiteValue, LowWhiteValue ), cv::Scalar( 255, 255, 255 ), WhiteTile );
+}
+
+/**
+* @brief Print estimated memory traffic per frame of whole-image passes and of the tile-fused pipeline,
+*		 computed from tile areas (not measured), only in tile-fused mode
+* @param fout [in] Output file (default=stderr)
+*/
+void GobanDetector::ReportMemoryTraffic( FILE * fout /* = stderr */ )
+{
+	if ( FusedTiles == false || OwnedTileMasks.empty() == true )
+	{
+		return;
+	}
+
+	fprintf( fout, "Estimated memory traffic per frame from tile areas (not measured): whole-image passes=%.2lf MB, tile-fused=%.2lf MB (%.1lf%%)\n",
+		EstimatedPassesTraffic/(1024.0*1024.0), EstimatedFusedTraffic/(1024.0*1024.0),
+		EstimatedPassesTraffic > 0.0 ? 100.0*EstimatedFusedTraffic/EstimatedPassesTraffic : 0.0 );
+}
+
+/**
+* @brief Compare sparse and dense decisions of all detectors on the current detection images
+*/
+void GobanDetector::CompareSparseWithDense()
+{
+	for ( int Cell = 0; Cell < NumColumns*NumLines; Cell++ )
+	{
+		StoneDetector CurDetector = AllDetectors[Cell];
+		if ( CurDetector.NbSamples == 0 )
+		{
+			continue;
+		}
+
+		// Motion decision
+		unsigned int MotionThreshold = 255*CurDetector.PercentageThreshold/100;
+		bool SparseMotion = ( CurDetector.ComputeMeanMotion( Motion, true ) >= MotionThreshold );
+		bool DenseMotion = ( CurDetector.ComputeMeanMotion( Motion, false ) >= MotionThreshold );
+		NbComparedMotions++;
+		if ( SparseMotion != DenseMotion )
+		{
+			NbMotionDisagreements++;
+		}
+
+		// Stone decisions, compute sparse first as dense version draws in images in DEBUG mode
+		cv::Mat * DetectionImages[2] = { &WhiteDetection, &BlackDetection };
+		for ( int Color = 0; Color < 2; Color++ )
+		{
+			bool SparseFound, DenseFound;
+			double SparseScore = CurDetector.ComputeScore( *DetectionImages[Color], true, SparseFound );
+			double DenseScore = CurDetector.ComputeScore( *DetectionImages[Color], false, DenseFound );
+
+			bool SparseDetection = ( SparseFound == true && SparseScore >= CurDetector.ResultsScoreMin );
+			bool DenseDetection = ( DenseFound == true && DenseScore >= CurDetector.ResultsScoreMin );
+
+			NbComparedScores++;
+			SumScoreDifference += fabs( SparseScore-DenseScore );
+			if ( SparseDetection != DenseDetection )
+			{
+				NbScoreDisagreements++;
+			}
+		}
+	}
+}
+
+/**
+* @brief Print sparse vs dense comparison results
+* @param fout [in] Output file (default=stderr)
+*/
+void GobanDetector::ReportSparseComparison( FILE * fout /* = stderr */ )
+{
+	if ( NbComparedMotions == 0 || NbComparedScores == 0 )
+	{
+		fprintf( fout, "Sparse vs dense: nothing compared\n" );
+		return;
+	}
+
+	fprintf( fout, "Sparse vs dense (%d samples/cell): motion disagreements=%lld/%lld (%.3lf%%), stone disagreements=%lld/%lld (%.3lf%%), mean score difference=%.4lf\n",
+		NbSamplesPerCell, NbMotionDisagreements, NbComparedMotions, 100.0*(double)NbMotionDisagreements/(double)NbComparedMotions,
+		NbScoreDisagreements, NbComparedScores, 100.0*(double)NbScoreDisagreements/(double)NbComparedScores, SumScoreDifference/(double)NbComparedScores );
+}
+
+/**
+* @brief Load a patch classifier model and use it instead of stone detection
+* @param ModelFileName [in] Model file produced by the training tool
+* @return true if the model was loaded
+*/
+bool GobanDetector::LoadClassifier( const char * ModelFileName )
+{
+	UseClassifier = Classifier.Load( ModelFileName );
+	return UseClassifier;
+}
+
+/**
+* @brief Dump labelled patches (label from the current pipeline) to train a classifier
+* @param DumpFileName [in] Output file
+* @return true if the file was created
+*/
+bool GobanDetector::OpenPatchDump( const char * DumpFileName )
+{
+	ClosePatchDump();
+
+	PatchDumpFile = fopen( DumpFileName, "wb" );
+	if ( PatchDumpFile == nullptr )
+	{
+		fprintf( stderr, "Could not create patch file '%s'\n", DumpFileName );
+		return false;
+	}
+
+	NbFramesBeforeDump = 0;
+	return true;
+}
+
+/**
+* @brief Close patch dump file if any
+*/
+void GobanDetector::ClosePatchDump()
+{
+	if ( PatchDumpFile != nullptr )
+	{
+		fclose( PatchDumpFile );
+		PatchDumpFile = nullptr;
+	}
+}
+
+/**
+* @brief Dump patches of all cells not in motion, labelled with their current state
+*/
+void GobanDetector::DumpPatches()
+{
+	if ( NbFramesBeforeDump > 0 )
+	{
+		NbFramesBeforeDump--;
+		return;
+	}
+
+	if ( IsChanging() == true )
+	{
+		// Wait for a stable goban
+		return;
+	}
+
+	for ( int Cell = 0; Cell < NumColumns*NumLines; Cell++ )
+	{
+		StoneDetector CurDetector = AllDetectors[Cell];
+
+		// Cells in motion are not reliable (hands, arms), skip them
+		PatchLabels[Cell] = ( CurDetector.InMotionExtended == true ) ? -1 : CurDetector.State;
+	}
+
+	PatchClassifier::AppendToDump( PatchDumpFile, PatchBatch, PatchLabels );
+	NbFramesBeforeDump = DumpPatchesEveryNFrames-1;
 }
 
 /**
@@ -709,11 +1448,28 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 {
 	Omiscid::PerfElapsedTime ET;
 
-	// crop image to necessary zone
-	cv::Mat CurImage( LoadImage, SubImageRect );
+	// crop image to necessary zone (or rectify it)
+	cv::Mat CurImage = GetWorkingImage( LoadImage, RectifiedImage, cv::INTER_LINEAR );
 
 	bool DepthMode = (DepthImage.empty() == false);
 
+	// Keep last frames to re-analyse ambiguous moves
+	if ( PreRollDuration > 0.0 && DepthMode == false )
+	{
+		if ( PreRollFrames.IsInitialized() == false )
+		{
+			PreRollFrames.Init( CurImage.size(), CurImage.type(), PreRollDuration );
+		}
+		PreRollFrames.Add( CurImage, CurrentTimestamp );
+	}
+
+	// Thresholds of color detection
+	HighBlackValue = (CentralValueForBlackDetection - MaxThresholdForColorDetection/2) + BlackThreshold;
+	LowWhiteValue = (CentralValueForWhiteDetection + MaxThresholdForColorDetection/2) - WhiteThreshold;
+
+	// Tile-fused pipeline needs neither full motion nor full detection images
+	bool FusedFrame = ( FusedTiles == true && DepthMode == false && ShowMotion == false && ShowBWDetection == false && CompareSparse == false );
+
 	if ( DepthMode == true )
 	{
 		if ( Motion.empty() == true )
@@ -722,7 +1478,7 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 			Motion = cv::Mat( CurImage.size(), CV_8UC1 );
 		}
 
-		cv::Mat( DepthImage, SubImageRect ).copyTo( *HistoryFrames[1] );
+		GetWorkingImage( DepthImage, RectifiedDepth, cv::INTER_NEAREST ).copyTo( *HistoryFrames[1] );
 
 		// Remove ouside of the Goban
 		// bitwise_and( *HistoryFrames[0], SubImageMask, *HistoryFrames[0] );
@@ -753,6 +1509,16 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 			}
 		}
 	}
+	else if ( FusedFrame == true )
+	{
+		// Done tile by tile in the motion and stone phases, just be sure that the motion image exists
+		CurrentImage = CurImage;
+		Motion.create( CurImage.size(), CV_8UC1 );
+		if ( OwnedTileMasks.empty() == true )
+		{
+			InitFusedTiles( CurImage.size() );
+		}
+	}
 	else
 	{
 		// standard motion detection
@@ -775,30 +1541,87 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 	}
 
 	// Compute motion for all Detectors
-	for ( int a = 0; a < NumCells; a++ )
-	{
-		for ( int b = 0; b < NumCells; b++ )
-		{
-			AllDetectors[a][b].DoMotionDetection( Motion, CurrentTimestamp, DepthMode );
-		}
-	}
+	Omiscid::PerfElapsedTime PhaseET;
+	ProcessAllCells( FusedFrame ? CellsParallelLoop::FusedPhase : CellsParallelLoop::MotionPhase, CurrentTimestamp, DepthMode );
+	MotionPhaseTime = PhaseET.GetInSeconds();
 
 	// Extend motion to neighborhood
 	ComputeExtendedMotion( CurrentTimestamp );
+	if ( Log != nullptr )
+	{
+		Log->LogMotion( AllDetectors, CurrentTimestamp );
+	}
+
+	if ( FusedFrame == false )
+	{
+		// Compute White and Black masks
+		cv::inRange( CurImage, cv::Scalar( 0, 0, 0 ), cv::Scalar( HighBlackValue, HighBlackValue, HighBlackValue ), BlackDetection );
+		cv::inRange( CurImage, cv::Scalar( LowWhiteValue, LowWhiteValue, LowWhiteValue ), cv::Scalar( 255, 255, 255 ), WhiteDetection );
+	}
 
-	// Compute White and Black masks
-	int HighBlackValue = (CentralValueForBlackDetection - MaxThresholdForColorDetection/2) + BlackThreshold;
-	int LowWhiteValue = (CentralValueForWhiteDetection + MaxThresholdForColorDetection/2) - WhiteThreshold;
-	cv::inRange( CurImage, cv::Scalar( 0, 0, 0 ), cv::Scalar( HighBlackValue, HighBlackValue, HighBlackValue ), BlackDetection );
-	cv::inRange( CurImage, cv::Scalar( LowWhiteValue, LowWhiteValue, LowWhiteValue ), cv::Scalar( 255, 255, 255 ), WhiteDetection );
+	// Do actual detection of stones, only on cells that may have changed
+	PhaseET.Reset();
+	int NbMandatory;
+	Scheduler.Schedule( AllDetectors, GameState, ScheduledCells, NbMandatory );
+	if ( UseClassifier == true || PatchDumpFile != nullptr )
+	{
+		// Extract patches of all cells in one batch
+		CurrentImage = CurImage;
+		PatchBatch.create( NumColumns*NumLines, PatchFeatures, CV_8UC1 );
+		ProcessAllCells( CellsParallelLoop::PatchPhase, CurrentTimestamp, DepthMode );
+	}
 
-	// Do actual detection of stones
-	for ( int a = 0; a < NumCells; a++ )
+	if ( UseClassifier == true )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		// Classify all cells at once, then update detectors
+		Classifier.Classify( PatchBatch, PatchClasses );
+	}
+	int StonePhase = ( UseClassifier == true ) ? CellsParallelLoop::ClassifierPhase : ( FusedFrame ? CellsParallelLoop::FusedStonePhase : CellsParallelLoop::StonePhase );
+
+	// Mandatory cells first (all cells without budget)
+	Omiscid::PerfElapsedTime CellsET;
+	ProcessAllCells( StonePhase, CurrentTimestamp, DepthMode, &ScheduledCells, 0, NbMandatory );
+	Scheduler.UpdateCellCost( NbMandatory, CellsET.GetInSeconds() );
+	NbProcessedCells = NbMandatory;
+
+	// Then other cells, in chunks, while there is time left in the frame budget
+	int ChunkSize = Max( CellsPerTask*cv::getNumThreads(), CellsPerTask );
+	while ( NbProcessedCells < (int)ScheduledCells.size() )
+	{
+		int NbChunkCells = Min( ChunkSize, (int)ScheduledCells.size() - NbProcessedCells );
+		if ( Scheduler.HasTimeFor( NbChunkCells, ET.GetInSeconds() ) == false )
 		{
-			AllDetectors[a][b].DoStoneDetection( Motion, WhiteDetection, BlackDetection, CurrentTimestamp, DepthMode );
+			break;
 		}
+
+		CellsET.Reset();
+		ProcessAllCells( StonePhase, CurrentTimestamp, DepthMode, &ScheduledCells, NbProcessedCells, NbProcessedCells + NbChunkCells );
+		Scheduler.UpdateCellCost( NbChunkCells, CellsET.GetInSeconds() );
+		NbProcessedCells += NbChunkCells;
+	}
+	Scheduler.SetProcessed( ScheduledCells, NbProcessedCells, SkippedCells );
+
+	// Skipped cells keep their state, update their evidence
+	for ( size_t Pos = 0; Pos < SkippedCells.size(); Pos++ )
+	{
+		AllDetectors[SkippedCells[Pos]].AccumulateEvidence( CurrentTimestamp, EvidenceTimeConstant );
+	}
+	StonePhaseTime = PhaseET.GetInSeconds();
+	if ( Log != nullptr )
+	{
+		// Detector transitions of the phase, appended once the worker threads are done
+		Log->LogDetectorStates( AllDetectors, CurrentTimestamp );
+	}
+
+	if ( PatchDumpFile != nullptr )
+	{
+		DumpPatches();
+	}
+
+	if ( CompareSparse == true )
+	{
+		// Evaluate sparse sampling against dense processing
+		CompareSparseWithDense();
 	}
 
 	// If not using Kinect, swap frame
@@ -813,24 +1636,20 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 	// Draw detection/motion if mandatory
 	if ( DrawResult == true )
 	{
-		for ( int a = 0; a < NumCells; a++ )
-		{
-			for ( int b = 0; b < NumCells; b++ )
-			{
-				AllDetectors[a][b].Draw( CurImage );
-			}
-		}
+		DrawDetections( LoadImage );
 
 		// Drawing empty ellipses are *very* expensive in Opencv... Detection should be used only for debugging
 		if ( ShowBWDetection == true )
 		{
-			for ( int a = 0; a < NumCells; a++ )
+			for ( int a = 0; a < NumColumns; a++ )
 			{
-				for ( int b = 0; b < NumCells; b++ )
+				for ( int b = 0; b < NumLines; b++ )
 				{
-					cv::ellipse( BlackDetection, AllDetectors[a][b].Center, cv::Size( AllDetectors[a][b].radius, AllDetectors[a][b].radius2 ), 0.0, 0.0, 360.0, cv::Scalar( 127 ), 1 );
-					cv::ellipse( WhiteDetection, AllDetectors[a][b].Center, cv::Size( AllDetectors[a][b].radius, AllDetectors[a][b].radius2 ), 0.0, 0.0, 360.0, cv::Scalar( 127 ), 1 );
-					cv::ellipse( CurImage, AllDetectors[a][b].Center, cv::Size( AllDetectors[a][b].radius, AllDetectors[a][b].radius2 ), 0.0, 0.0, 360.0, cv::Scalar( 127 ), 1 );
+					int Cell = AllDetectors.Index( a, b );
+					cv::Size Axes( AllDetectors.radius[Cell], AllDetectors.radius2[Cell] );
+					cv::ellipse( BlackDetection, AllDetectors.Center[Cell], Axes, 0.0, 0.0, 360.0, cv::Scalar( 127 ), 1 );
+					cv::ellipse( WhiteDetection, AllDetectors.Center[Cell], Axes, 0.0, 0.0, 360.0, cv::Scalar( 127 ), 1 );
+					cv::ellipse( CurImage, AllDetectors.Center[Cell], Axes, 0.0, 0.0, 360.0, cv::Scalar( 127 ), 1 );
 				}
 			}
 
@@ -843,15 +1662,79 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 	{
 		// Update game state
 		GameState.UpdateCurrentState( AllDetectors, CurrentTimestamp );
+
+		if ( PreRollDuration > 0.0 )
+		{
+			CheckAmbiguousMoves( CurrentTimestamp );
+		}
+	}
+
+	if ( Log != nullptr )
+	{
+		// Captures and rollbacks change detected states too
+		Log->LogDetectorStates( AllDetectors, CurrentTimestamp );
+		Log->SnapshotIfNeeded( AllDetectors, GameState, CurrentTimestamp );
 	}
 
 	// Processing time including drawing and updating
 	double FrameProcessingTime = ET.GetInSeconds();
+	Scheduler.RecordFrameTime( FrameProcessingTime );
 
 	// return processing time in seconds
 	return FrameProcessingTime;
 }
 
+/**
+* @brief Apply the result of a move order re-analysis, or submit the last ambiguous move if any
+* @param CurrentTimestamp [in] Timestamp of the frame
+*/
+void GobanDetector::CheckAmbiguousMoves( double CurrentTimestamp )
+{
+	if ( OrderAnalyser.GetResult( OrderRequest ) == true )
+	{
+		GameState.ResolveMoveOrder( OrderRequest.FirstMove, OrderRequest.Cells, OrderRequest.AppearanceTimes, AllDetectors, CurrentTimestamp );
+		return;
+	}
+
+	// Wait for the next move (or a few seconds) to have the whole sequence in recorded frames
+	if ( GameState.AmbiguousMove == 0 || OrderAnalyser.IsIdle() == false ||
+		 (GameState.GetNbMoves() <= GameState.AmbiguousMove && CurrentTimestamp - GameState.AmbiguousTimestamp < AmbiguousMoveDelay) )
+	{
+		return;
+	}
+
+	OrderRequest.FirstMove = Max( GameState.AmbiguousMove-ReorderedMovesBefore, 1 );
+	GameState.AmbiguousMove = 0;
+
+	// Cells of the moves that may be reordered, in the coordinates of recorded frames
+	double Scale = PreRollFrames.GetScale();
+	OrderRequest.Cells.clear();
+	OrderRequest.Colors.clear();
+	OrderRequest.Centers.clear();
+	OrderRequest.Radius.clear();
+	for ( MoveHistory Event = GameState.History; Event != nullptr && Event->NumMove >= OrderRequest.FirstMove; Event = Event->Previous )
+	{
+		if ( Event->Kind != MoveHistoryNode::Move )
+		{
+			continue;
+		}
+
+		int Cell = AllDetectors.Index( Event->a, Event->b );
+		OrderRequest.Cells.push_back( Cell );
+		OrderRequest.Colors.push_back( Event->Color );
+		OrderRequest.Centers.push_back( cv::Point( (int)(AllDetectors.Center[Cell].x*Scale), (int)(AllDetectors.Center[Cell].y*Scale) ) );
+		OrderRequest.Radius.push_back( cv::Size( (int)(AllDetectors.radius[Cell]*Scale), (int)(AllDetectors.radius2[Cell]*Scale) ) );
+	}
+	OrderRequest.HighBlackValue = HighBlackValue;
+	OrderRequest.LowWhiteValue = LowWhiteValue;
+
+	if ( PreRollFrames.CopyWindow( CurrentTimestamp-PreRollDuration, CurrentTimestamp, OrderRequest.Frames, OrderRequest.Timestamps ) < DefaultStableFrames )
+	{
+		return;
+	}
+	OrderAnalyser.Submit( OrderRequest );
+}
+
 /**
 * @brief To retrive if there is motion over the goban
 * @return True is motion is ongoing.
@@ -859,16 +1742,17 @@ double GobanDetector::ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthIma
 bool GobanDetector::IsChanging()
 {
 	// Compute motion
-	for ( int a = 0; a < NumCells; a++ )
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		for ( int b = 0; b < NumLines; b++ )
 		{
+			int Cell = AllDetectors.Index( a, b );
 			// If motion cells have detected something
-			if ( AllDetectors[a][b].InMotionExtended == true && AllDetectors[a][b].State != StoneDetector::Empty )
+			if ( AllDetectors.InMotionExtended[Cell] == true && AllDetectors.State[Cell] != StoneDetector::Empty )
 			{
 				return true;
 			}
 		}
 	}
 	return false;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -14,30 +14,49 @@
 
 #include "CalibrationContainer.h"
 #include "GobanState.h"
-#include "StoneDetector.h"
+#include "StoneDetectorStorage.h"
+#include "PatchClassifier.h"
+#include "CellScheduler.h"
 #include "MultiSourceVideo.h"
+#include "FrameRing.h"
+#include "MoveOrderAnalyser.h"
+#include "Checkpoint.h"
+#include "EventLog.h"
 
 #define WhiteDetectionWindowName "White detection"
 #define BlackDetectionWindowName "Black detection"
 #define MotionDetectionWindowsName "Motion detection"
 
+#define DefaultCellsPerTask 8			// Default grain size of parallel loops over cells
+#define DefaultNbSamplesPerCell 64		// Default number of samples per cell in sparse mode
+#define DumpPatchesEveryNFrames 25		// Dump labelled patches once per second at 25 fps
+// With fast commit, a stone is committed after tau*ln(1/(1-CommitConfidence)) s of still, consistent detection:
+// 1.15 s for a new stone and 1.75 s for a removal with tau=0.5 s. Shorter delays commit reflections and stones
+// that are still being adjusted by the player.
+#define DefaultEvidenceTimeConstant 0.5	// Time constant (s) of the per-cell evidence decay
+#define DefaultTargetCellSize 24		// Target size (pixels) of cells in the processed image, larger views are downscaled
+#define AmbiguousMoveDelay 5.0			// Time (s) to wait for the next move before re-analysing an ambiguous move
+#define ReorderedMovesBefore 2			// Number of moves before an ambiguous one that may be reordered
+
 /**
 * @brief Static function to handle mouse click
-* @param NumCells [in] Size fo goban
+* @param NumColumns [in] Number of columns of the goban
+* @param NumLines [in] Number of lines of the goban
 * @param SizeOfCells [in] Size of goban cells
 * @param _2DPointsInImage [out] Projected points all over the goban
 * @param CurCalibration [in] Input calibration
 */
-void ProjectGobanBoard(int NumCells, float SizeOfCells, CalibrationContainer& CurCalibration, std::vector<cv::Vec2f>& _2DPointsInImage );
+void ProjectGobanBoard(int NumColumns, int NumLines, float SizeOfCells, CalibrationContainer& CurCalibration, std::vector<cv::Vec2f>& _2DPointsInImage );
 
 /**
 * @brief Static function to handle mouse click
-* @param NumCells [in] Size fo goban
+* @param NumColumns [in] Number of columns of the goban
+* @param NumLines [in] Number of lines of the goban
 * @param ImageMask [in,out] ImageMask from the goban
 * @param SizeOfCells [in] Size of goban cells
 * @param CurCalibration [in] Input calibration
 */
-std::vector<cv::Point> DoGobanMask(int NumCells, float SizeOfCells, CalibrationContainer& CurCalibration, cv::Mat& ImageMask );
+std::vector<cv::Point> DoGobanMask(int NumColumns, int NumLines, float SizeOfCells, CalibrationContainer& CurCalibration, cv::Mat& ImageMask );
 
 /**
  * @class GobanDetector 
@@ -52,19 +71,225 @@ protected:
 	// Work in millimeter
 	const float DefaultSizeOfCells = 22.5f;						// Default size of the cells. In this program, wells are square
 	const float DefaultSizeOfStone = 22; 
+	const float PercentageSizeOfStones = 0.90f;					// Percentage of considered stones
 
-	int NumCells;												// Number of Cells to work on, i.e. size of goban
+	int NumColumns;												// Number of columns of the goban
+	int NumLines;												// Number of lines of the goban
 
 	CalibrationContainer GobanViewCalibration;					// Container for camera of the Goban view
 
 	float SizeOfCells = DefaultSizeOfCells;						// Current size of cells
-	StoneDetector AllDetectors[MaxNumCells][MaxNumCells];		// Max supported size if 19x19
+	StoneDetectorStorage AllDetectors;							// All stone detectors, stored as structure of arrays
 
 	// To crop image on goban and mask moves outside it
 	cv::Rect SubImageRect;										// Goban rect within the image
 	cv::Mat  FullImageMask;										// Processing mask on the full image
 	cv::Mat  SubImageMask;										// Processing mask on the croped image
 
+	// Rectified mode: goban area warped into a top-down image where each intersection is a TileSize x TileSize tile
+	bool RectifiedMode = false;									// Do we work on the rectified goban image?
+	int TileSize = 0;											// Size of the tiles in the rectified image
+	cv::Mat RectifyMap1;										// Fixed-point remap table (integer positions)
+	cv::Mat RectifyMap2;										// Fixed-point remap table (interpolation weights)
+	cv::Mat RectifiedImage;										// Rectified image of the current frame
+	cv::Mat RectifiedDepth;										// Rectified depth image of the current frame (Kinect)
+
+	// Processing scale: high resolution views of the goban are downscaled once (at crop or rectification time)
+	int TargetCellSize = DefaultTargetCellSize;					// Target number of pixels per cell, 0 to process at native resolution
+	double ProcessingScale = 1.0;								// Scale from the goban view to the processed image (<= 1.0)
+	cv::Size ScaledSize;										// Size of the processed image when scaled (non rectified mode)
+	cv::Mat ScaledImage;										// Scaled goban area of the current frame
+	cv::Mat ScaledDepth;										// Scaled goban area of the current depth frame (Kinect)
+
+	/**
+	* @brief Compute processing scale from the number of pixels per cell of the goban view
+	*/
+	void ComputeProcessingScale();
+
+	/**
+	* @brief Compute remap tables from calibration and init all detectors on the tiles of the rectified image
+	*/
+	void InitRectification();
+
+	/**
+	* @brief Compute goban area, detector positions and goban mask from the calibration
+	* @param ImageSize [in] Size of the images of the source
+	* @param _2DPoints [out] Center and radius points of each detector in the image, 3 points per cell
+	* @param ContourPoints [out] Corners of the goban in the image
+	*/
+	void ComputeWorkingArea( cv::Size ImageSize, std::vector<cv::Vec2f>& _2DPoints, std::vector<cv::Point>& ContourPoints );
+
+	/**
+	* @brief Init all stone detectors from the working area (rectified tiles or projected stones)
+	* @param InitImage [in] Image of the source
+	* @param _2DPoints [in] Center and radius points of each detector in the image, from ComputeWorkingArea
+	*/
+	void InitDetectors( cv::Mat& InitImage, const std::vector<cv::Vec2f>& _2DPoints );
+
+	/**
+	* @brief Get working image from an input image: goban area cropped from the image or rectified goban image
+	* @param InputImage [in] Full input image
+	* @param RectifiedBuffer [in,out] Buffer to store rectified image (when in rectified mode)
+	* @param Interpolation [in] Interpolation used for remapping (cv::INTER_NEAREST for depth data)
+	* @return Image to process, downscaled if ProcessingScale is lower than 1
+	*/
+	cv::Mat GetWorkingImage( cv::Mat& InputImage, cv::Mat& RectifiedBuffer, int Interpolation );
+
+	// Parallel processing of cells
+	int CellsPerTask = DefaultCellsPerTask;						// Grain size: number of cells processed by each parallel task
+	double MotionPhaseTime = 0.0;								// Processing time of the motion phase for the last frame
+	double StonePhaseTime = 0.0;								// Processing time of the stone phase for the last frame
+	double EvidenceTimeConstant = DefaultEvidenceTimeConstant;	// Time constant of per-cell evidence accumulation
+
+	// Sparse sampling mode
+	int NbSamplesPerCell = 0;									// Number of samples per detector, 0 for dense processing
+	bool CompareSparse = false;									// Compare sparse and dense results on each frame
+	long long int NbComparedMotions = 0;						// Number of compared motion decisions
+	long long int NbMotionDisagreements = 0;					// Number of different motion decisions
+	long long int NbComparedScores = 0;							// Number of compared stone decisions
+	long long int NbScoreDisagreements = 0;						// Number of different stone decisions
+	double SumScoreDifference = 0.0;							// Sum of absolute differences of scores
+
+	/**
+	* @brief Compare sparse and dense decisions of all detectors on the current detection images
+	*/
+	void CompareSparseWithDense();
+
+	// Patch classifier
+	PatchClassifier Classifier;									// Classifier of cell patches
+	bool UseClassifier = false;									// Use classifier instead of stone detection
+	cv::Mat PatchBatch;											// Patches of all cells, one row per cell
+	std::vector<int> PatchClasses;								// Class of each cell patch
+	FILE * PatchDumpFile = nullptr;								// File to dump labelled patches (training)
+	int NbFramesBeforeDump = 0;									// Frames to wait before next dump
+	std::vector<int> PatchLabels;								// Label of each dumped patch
+
+	/**
+	* @brief Dump patches of all cells not in motion, labelled with their current state
+	*/
+	void DumpPatches();
+
+	// Tile-fused pipeline: for each cell, gray conversion, masking and motion are done on the tile of the cell
+	// and immediately followed by the motion decision. Color detection of scheduled cells is done on their tile
+	// in the stone phase, right before scoring. Decisions read per thread images, shared images only receive
+	// the pixels owned by each cell as tiles of neighbour cells overlap.
+	bool FusedTiles = false;									// Use the tile-fused pipeline (camera mode only)
+	int HighBlackValue = 0;										// Upper bound of black detection for the current frame
+	int LowWhiteValue = 255;									// Lower bound of white detection for the current frame
+	std::vector<cv::Mat> OwnedTileMasks;						// Pixels of each tile written by its cell only, empty until the first fused frame
+	double EstimatedPassesTraffic = 0.0;						// Estimated memory traffic (bytes) per frame with whole-image passes
+	double EstimatedFusedTraffic = 0.0;							// Estimated memory traffic (bytes) per frame with the tile-fused pipeline
+
+	/**
+	* @brief Compute owned part of each tile and memory traffic estimations, once after calibration
+	* @param ImageSize [in] Size of the working image
+	*/
+	void InitFusedTiles( cv::Size ImageSize );
+
+	/**
+	* @brief Compute gray and motion on the tile of a cell. Shared gray and motion images only receive owned pixels.
+	* @param Cell [in] Cell of the tile
+	* @param Tile [in] Area of the cell in the working image
+	* @param LocalMotion [in,out] Per thread motion image (size of the working image) used for the motion decision
+	*/
+	void ProcessTile( int Cell, const cv::Rect& Tile, cv::Mat& LocalMotion );
+
+	/**
+	* @brief Compute black and white detection on the tile of a cell
+	* @param Tile [in] Area of the cell in the working image
+	* @param LocalWhite [in,out] Per thread white detection image (size of the working image)
+	* @param LocalBlack [in,out] Per thread black detection image (size of the working image)
+	*/
+	void DetectColorsOnTile( const cv::Rect& Tile, cv::Mat& LocalWhite, cv::Mat& LocalBlack );
+
+	// Work buffers of ComputeExtendedMotion, allocated once
+	std::vector<int> MotionComponent;							// Group of each moving cell (-1 if not moving or not visited)
+	std::vector<int> ComponentStack;							// Cells to visit in the current group
+	std::vector<cv::Point> ComponentCells;						// Cells (a, b) of the current group
+	std::vector<cv::Point> ComponentHull;						// Convex hull of the current group
+	std::vector<unsigned char> HullFill;						// Cells within the convex hull of a group
+
+	/**
+	* @brief Mark in HullFill all cells within the convex hull of ComponentCells (ComponentCells is sorted)
+	*/
+	void FillConvexHull();
+
+	/**
+	 * @class CellsParallelLoop 
+	 * @brief Parallel loop body to process one detection phase (motion or stone) over a range of cells.
+	 *		  Each cell only writes its own detector, thus the result does not depend on the number of threads.
+	 */
+	class CellsParallelLoop : public cv::ParallelLoopBody
+	{
+	public:
+		enum { MotionPhase, StonePhase, PatchPhase, ClassifierPhase, FusedPhase, FusedStonePhase };
+
+		/**
+		* @brief Constructor
+		* @param _Owner [in] GobanDetector holding all detectors
+		* @param _Phase [in] Phase to compute (MotionPhase, StonePhase, PatchPhase, ClassifierPhase, FusedPhase or FusedStonePhase)
+		* @param _CurrentTimestamp [in] Timestamp of the frame
+		* @param _DepthMode [in] DepthMode: true if using Kinect.
+		*/
+		CellsParallelLoop( GobanDetector& _Owner, int _Phase, double _CurrentTimestamp, bool _DepthMode, const std::vector<int> * _CellList ) :
+			Owner(_Owner), Phase(_Phase), CurrentTimestamp(_CurrentTimestamp), DepthMode(_DepthMode), CellList(_CellList)
+		{
+		}
+
+		/**
+		* @brief Process cells in range. Cells are numbered a*NumLines+b, or are indexes in CellList if any.
+		* @param Cells [in] Range of cells to process
+		*/
+		virtual void operator()( const cv::Range& Cells ) const;
+
+	protected:
+		GobanDetector& Owner;					// GobanDetector holding all detectors
+		int Phase;								// Current phase
+		double CurrentTimestamp;				// Timestamp of the frame
+		bool DepthMode;							// Kinect mode
+		const std::vector<int> * CellList;		// Cells to process (nullptr for all cells)
+	};
+
+	/**
+	* @brief Run a detection phase over all cells using cv::parallel_for_
+	* @param Phase [in] CellsParallelLoop::MotionPhase, StonePhase, PatchPhase, ClassifierPhase, FusedPhase or FusedStonePhase
+	* @param CurrentTimestamp [in] Timestamp of the frame
+	* @param DepthMode [in] DepthMode: true if using Kinect.
+	* @param CellList [in] Cells to process (default nullptr for all cells)
+	* @param First [in] First position to process in the cell list (default 0)
+	* @param Last [in] Position after the last one to process in the cell list (default -1 for the end of the list)
+	*/
+	void ProcessAllCells( int Phase, double CurrentTimestamp, bool DepthMode, const std::vector<int> * CellList = nullptr, int First = 0, int Last = -1 );
+
+	// Incremental scheduling of stone detection
+	CellScheduler Scheduler;									// Select cells to process on each frame
+	std::vector<int> ScheduledCells;							// Ordered cells to process by stone detection for the current frame
+	std::vector<int> SkippedCells;								// Cells not processed for the current frame (quiet or out of budget)
+	int NbProcessedCells = 0;									// Number of cells actually processed for the current frame
+
+	// Pre-roll: last frames of the goban area to re-analyse ambiguous move orders in background
+	double PreRollDuration = 0.0;								// Time (s) covered by recorded frames, 0 to disable
+	FrameRing PreRollFrames;									// Last frames of the goban area
+	MoveOrderAnalyser OrderAnalyser;							// Background re-analysis of recorded frames
+	MoveOrderRequest OrderRequest;								// Request to submit or result to apply
+
+	// Crash-safe checkpoint of the recording session
+	Omiscid::SimpleString CheckpointFileName;					// Checkpoint file, empty to disable checkpoints
+	double CheckpointInterval = DefaultCheckpointInterval;		// Time (s) between 2 checkpoints without commit
+	double LastCheckpointTimestamp = -1.0;						// Timestamp of the last checkpoint
+	MoveHistory LastCheckpointHistory;							// Last committed event at the last checkpoint
+	CheckpointWriter CheckpointThread;							// Writes checkpoints out of the frame thread
+	cv::Size SourceImageSize;									// Size of the images of the source
+
+	// Binary log of detector transitions and game events
+	EventLog * Log = nullptr;									// Event log, nullptr if none
+
+	/**
+	* @brief Apply the result of a move order re-analysis, or submit the last ambiguous move if any
+	* @param CurrentTimestamp [in] Timestamp of the frame
+	*/
+	void CheckAmbiguousMoves( double CurrentTimestamp );
+
 public:
 
 	/**
@@ -101,17 +326,29 @@ public:
 
 	/**
     * @brief Constructor
-    * @param _NumCells [in] Size of the goban
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
 	*/
-	GobanDetector(int _NumCells) : NumCells(_NumCells), GobanViewCalibration(_NumCells, DefaultSizeOfCells), GameState(_NumCells)
+	GobanDetector(int _NumColumns, int _NumLines) : NumColumns(_NumColumns), NumLines(_NumLines), GobanViewCalibration(_NumColumns, _NumLines, DefaultSizeOfCells),
+		AllDetectors(_NumColumns, _NumLines), Scheduler(_NumColumns, _NumLines), GameState(_NumColumns, _NumLines)
 	{
-		if ( _NumCells <= 0 || _NumCells > 19 )
+		if ( _NumColumns < MinGobanSize || _NumColumns > MaxGobanSize || _NumLines < MinGobanSize || _NumLines > MaxGobanSize )
 		{
-			Omiscid::SimpleException Ex("Unsupported goban size (" + Omiscid::SimpleString(_NumCells) + ")" );
-			Ex.msg += _NumCells;
+			Omiscid::SimpleException Ex("Unsupported goban size (" + Omiscid::SimpleString(_NumColumns) + "x" + Omiscid::SimpleString(_NumLines) + ")" );
 			fprintf( stderr, "%s\n", Ex.msg.GetStr() );
 			throw Ex;
 		}
+
+		// Per frame buffers are allocated once, sized to the goban
+		int NbCells = _NumColumns*_NumLines;
+		MotionComponent.resize( NbCells );
+		HullFill.resize( NbCells );
+		ComponentStack.reserve( NbCells );
+		ComponentCells.reserve( NbCells );
+		ComponentHull.reserve( 2*NbCells );
+		ScheduledCells.reserve( NbCells );
+		SkippedCells.reserve( NbCells );
+		PatchLabels.resize( NbCells );
 	}
 
 	/**
@@ -119,6 +356,7 @@ public:
 	*/
 	virtual ~GobanDetector()
 	{
+		ClosePatchDump();
 	}
 
 	/**
@@ -130,6 +368,68 @@ public:
 		return (const cv::Rect&)SubImageRect;
 	}
 
+	/**
+    * @brief Ask to work on a rectified goban image. Must be set before calibration.
+    * @param _RectifiedMode [in] true to process the rectified goban image
+	*/
+	inline void SetRectifiedMode( bool _RectifiedMode )
+	{
+		RectifiedMode = _RectifiedMode;
+	}
+
+	/**
+    * @brief Get size of processed image (goban rect or rectified goban)
+    * @return Size of the image used for processing and feedback
+	*/
+	inline cv::Size GetProcessedImageSize()
+	{
+		if ( RectifiedMode == true )
+		{
+			return cv::Size( NumColumns*TileSize, NumLines*TileSize );
+		}
+		if ( ProcessingScale < 1.0 )
+		{
+			return ScaledSize;
+		}
+		return SubImageRect.size();
+	}
+
+	/**
+    * @brief Get size of feedback image (goban rect at native resolution or rectified goban)
+    * @return Size of the image given by GetFeedbackImage
+	*/
+	inline cv::Size GetFeedbackImageSize()
+	{
+		if ( RectifiedMode == true )
+		{
+			return GetProcessedImageSize();
+		}
+		return SubImageRect.size();
+	}
+
+	/**
+    * @brief Set target size of cells in the processed image. Must be set before calibration.
+    * @param _TargetCellSize [in] Target number of pixels per cell, 0 to process at native resolution
+	*/
+	inline void SetTargetCellSize( int _TargetCellSize )
+	{
+		TargetCellSize = Max( _TargetCellSize, 0 );
+	}
+
+	/**
+    * @brief Get image where detection feedback has been drawn for the current frame
+    * @param LoadImage [in] Image from the current video source
+    * @return Goban area of LoadImage or rectified goban image
+	*/
+	inline cv::Mat GetFeedbackImage( cv::Mat& LoadImage )
+	{
+		if ( RectifiedMode == true )
+		{
+			return RectifiedImage;
+		}
+		return cv::Mat( LoadImage, SubImageRect );
+	}
+
 	/**
     * @brief Static function to handle mouse click
     * @param event [in] standard data from opencv, button event, ...
@@ -173,6 +473,61 @@ public:
 	*/
 	bool GetCalibration(Omiscid::SimpleString& InputName, MultiVideoSource& CurSource, bool RestartCalibration = false );
 
+	/**
+    * @brief Set checkpoint file of the recording session. Must be set before calibration or resume.
+    * @param FileName [in] Checkpoint file name, empty to disable checkpoints
+    * @param Interval [in] Time (s) between 2 checkpoints without commit
+	*/
+	inline void SetCheckpoint( const Omiscid::SimpleString& FileName, double Interval = DefaultCheckpointInterval )
+	{
+		CheckpointFileName = FileName;
+		CheckpointInterval = Interval;
+	}
+
+	/**
+	* @brief Restore calibration, detectors, game and SGF file from the checkpoint instead of calibrating
+	* @param CurSource [in] Source of images (video or device)
+	* @return True if the session was restored.
+	*/
+	bool ResumeFromCheckpoint( MultiVideoSource& CurSource );
+
+	/**
+	* @brief Write a checkpoint after each committed change or when CheckpointInterval elapsed. Must not be
+	*		 called while a frame is processed. The checkpoint is serialised in memory, CheckpointThread
+	*		 writes it to the disk.
+	* @param CurrentTimestamp [in] Timestamp of the frame
+	* @return True if a checkpoint was serialised.
+	*/
+	bool CheckpointIfNeeded( double CurrentTimestamp );
+
+	/**
+	* @brief Remove checkpoint file, at the end of a game (waiting checkpoint is written before)
+	*/
+	void RemoveCheckpoint();
+
+	/**
+    * @brief Log detector transitions, motion and game events of this goban
+    * @param _Log [in] Open event log (not owned, must outlive the detector)
+	*/
+	inline void SetEventLog( EventLog * _Log )
+	{
+		Log = _Log;
+		GameState.AddListener( _Log );
+	}
+
+	/**
+    * @brief Move a committed move to another cell and replay the following moves (see GobanState::CorrectMove)
+    * @param NumMove [in] Move to correct (1 for the first move)
+    * @param a [in] corrected column of the goban
+    * @param b [in] corrected line of the goban
+    * @param CurrentTimestamp [in] Current timestamp of the working frame
+    * @return false if NumMove or the cell is not valid
+	*/
+	inline bool CorrectMove( int NumMove, int a, int b, double CurrentTimestamp )
+	{
+		return GameState.CorrectMove( NumMove, a, b, AllDetectors, CurrentTimestamp );
+	}
+
 	cv::Mat * HistoryFrames[2];		// History frame to compute motion detection
 
 	/**
@@ -184,7 +539,8 @@ public:
 	// do not recreate them all the time
 	cv::Mat WhiteDetection,			// Detection of White area to detect white stones
 			BlackDetection,			// Detection of black area to detect black stones
-			Motion;					// Motion detection
+			Motion,					// Motion detection
+			CurrentImage;			// Working image of the current frame (for patch extraction)
 
 	/**
     * @brief Process current frame. Do motion detection and stone detection
@@ -202,6 +558,164 @@ public:
 	double ProcessCurrentFrame( cv::Mat& LoadImage, cv::Mat& DepthImage, double CurrentTimestamp, int BlackThreshold, int WhiteThreshold,
 								bool DrawResult = false, bool ShowBWDetection = false, bool ShowMotion = false );
 
+	/**
+    * @brief Draw stone detectors of the current frame in the feedback image
+    * @param LoadImage [in,out] Image from the current video source
+	*/
+	void DrawDetections( cv::Mat& LoadImage );
+
+	/**
+    * @brief Set grain size of the parallel loops over cells
+    * @param _CellsPerTask [in] Number of cells for each parallel task (min 1)
+	*/
+	inline void SetCellsPerTask( int _CellsPerTask )
+	{
+		CellsPerTask = Max( _CellsPerTask, 1 );
+	}
+
+	/**
+    * @brief Use sample points instead of all pixels for detection. Must be set before calibration.
+    * @param _NbSamplesPerCell [in] Number of samples per detector (0 for dense processing)
+	*/
+	inline void SetSparseMode( int _NbSamplesPerCell )
+	{
+		NbSamplesPerCell = Max( _NbSamplesPerCell, 0 );
+	}
+
+	/**
+    * @brief Stop stone detection of a cell as soon as the decision is known (same decisions as the full computation)
+    * @param EarlyExit [in] true to use coarse-to-fine detection (default)
+	*/
+	inline void SetEarlyExit( bool EarlyExit )
+	{
+		AllDetectors.EarlyExit = EarlyExit;
+	}
+
+	/**
+    * @brief Keep the last seconds of frames to re-analyse moves committed with the wrong color. Must be set before processing.
+    * @param Duration [in] Time (s) covered by recorded frames, 0 to disable
+	*/
+	inline void SetPreRoll( double Duration )
+	{
+		PreRollDuration = std::max( Duration, 0.0 );
+		if ( PreRollDuration > 0.0 )
+		{
+			OrderAnalyser.StartThread();
+		}
+	}
+
+	/**
+    * @brief Process each cell tile from pixels to motion decision in one go, and detect colors on the tile of scheduled
+	*		 cells right before scoring them, instead of whole-image passes.
+	*		 Whole-image passes are still used with depth data, when motion/detection images are shown
+	*		 or when sparse and dense detections are compared.
+    * @param Fused [in] true to use the tile-fused pipeline
+	*/
+	inline void SetFusedTiles( bool Fused )
+	{
+		FusedTiles = Fused;
+	}
+
+	/**
+    * @brief Print estimated memory traffic per frame of whole-image passes and of the tile-fused pipeline,
+	*		 computed from tile areas (not measured), only in tile-fused mode
+    * @param fout [in] Output file (default=stderr)
+	*/
+	void ReportMemoryTraffic( FILE * fout = stderr );
+
+	/**
+    * @brief Compare sparse decisions with dense ones on each frame (to evaluate sparse mode on recorded games)
+    * @param _CompareSparse [in] true to do the comparison
+	*/
+	inline void SetSparseComparison( bool _CompareSparse )
+	{
+		CompareSparse = _CompareSparse;
+	}
+
+	/**
+    * @brief Print sparse vs dense comparison results
+    * @param fout [in] Output file (default=stderr)
+	*/
+	void ReportSparseComparison( FILE * fout = stderr );
+
+	/**
+    * @brief Load a patch classifier model and use it instead of stone detection
+    * @param ModelFileName [in] Model file produced by the training tool
+    * @return true if the model was loaded
+	*/
+	bool LoadClassifier( const char * ModelFileName );
+
+	/**
+    * @brief Dump labelled patches (label from the current pipeline) to train a classifier
+    * @param DumpFileName [in] Output file
+    * @return true if the file was created
+	*/
+	bool OpenPatchDump( const char * DumpFileName );
+
+	/**
+    * @brief Close patch dump file if any
+	*/
+	void ClosePatchDump();
+
+	/**
+    * @brief Skip stone detection on committed stones with quiet neighbourhoods
+    * @param Skip [in] true to skip them (default)
+    * @param HeartbeatPeriod [in] Max number of frames between 2 checks of a committed stone
+	*/
+	inline void SetSkipQuietStones( bool Skip, int HeartbeatPeriod = DefaultHeartbeatPeriod )
+	{
+		Scheduler.Enabled = Skip;
+		Scheduler.HeartbeatPeriod = Max( HeartbeatPeriod, 1 );
+	}
+
+	/**
+    * @brief Get number of cells processed by stone detection for the last frame
+    * @return Number of cells
+	*/
+	inline int GetNbProcessedCells()
+	{
+		return NbProcessedCells;
+	}
+
+	/**
+    * @brief Set a processing time budget for each frame. Cells in or near motion are processed first,
+	*		 stable cells are rechecked round-robin with the remaining time.
+    * @param Budget [in] Budget in seconds (0 for no limit)
+    * @param MaxFramesWithoutCheck [in] Max number of frames between 2 checks of a cell, whatever the budget
+	*/
+	inline void SetFrameBudget( double Budget, int MaxFramesWithoutCheck = DefaultMaxFramesWithoutCheck )
+	{
+		Scheduler.FrameBudget = std::max( Budget, 0.0 );
+		Scheduler.MaxFramesWithoutCheck = Max( MaxFramesWithoutCheck, 1 );
+	}
+
+	/**
+    * @brief Print frame budget statistics (overruns)
+    * @param fout [in] Output file (default=stderr)
+	*/
+	inline void ReportBudget( FILE * fout = stderr )
+	{
+		Scheduler.ReportBudget( fout );
+	}
+
+	/**
+    * @brief Get processing time of the motion phase of the last frame
+    * @return Time in seconds
+	*/
+	inline double GetMotionPhaseTime()
+	{
+		return MotionPhaseTime;
+	}
+
+	/**
+    * @brief Get processing time of the stone phase of the last frame
+    * @return Time in seconds
+	*/
+	inline double GetStonePhaseTime()
+	{
+		return StonePhaseTime;
+	}
+
 	/**
     * @brief To retrive if there is motion over the goban
 	* @return True is motion is ongoing.
@@ -6,193 +6,671 @@
  */
 
 #include "GobanState.h"
+#include "Checkpoint.h"
 
+#include <algorithm>
 
-// Validdate capture, i.e do not find any liberty
-void GobanState::CheckLibertiesRecursive( int a, int b, int StoneColor, Omiscid::SimpleList<cv::Point>& CurrentChain )
+
+bool GobanState::ValidateCapture( int a, int b, int StoneColor, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
 {
-	if ( Goban[a][b].CaptureChecked == true )
+	// Only groups of the other color can be captured
+	if ( Groups.Play( a, b, StoneColor, CapturedCells ) == 0 )
+	{
+		return false;
+	}
+
+	// Captured stones are already removed from groups, detectors must see them removed
+	for ( size_t Pos = 0; Pos < CapturedCells.size(); Pos++ )
+	{
+		int ca = CapturedCells[Pos]/NumLines;
+		int cb = CapturedCells[Pos]%NumLines;
+
+		StoneDetector Captured = AllDetectors( ca, cb );
+		Captured.State     = Empty;
+		Captured.Timestamp = CurrentTimestamp;
+		Captured.ResetEvidenceAfterCapture( CurrentTimestamp );
+		AllDetectors.PendingEvents.Remove( CapturedCells[Pos] );
+	}
+
+	return true;
+}
+
+void GobanState::UpdateProvisionalMove( int Cell, int StoneColor, double DetectionTimestamp, double CurrentTimestamp )
+{
+	int PreviousColor = ProvisionalStones[Cell];
+	if ( PreviousColor == StoneColor )
 	{
-		// Already check, current validation is still questionned, go ahead
 		return;
 	}
 
-	// Check if Current is Empty
-	if ( Goban[a][b].State == Empty )
+	int a = Cell/NumLines;
+	int b = Cell%NumLines;
+
+	// Provisional stone gone or replaced by the other color
+	ProvisionalStones[Cell] = StoneColor;
+	if ( PreviousColor != Empty )
+	{
+		for ( size_t Pos = 0; Pos < Listeners.size(); Pos++ )
+		{
+			Listeners[Pos]->RetractedMove( 0, PreviousColor, a, b, CurrentTimestamp );
+		}
+	}
+
+	if ( StoneColor != Empty )
+	{
+		ProvisionalLatencies.push_back( CurrentTimestamp - DetectionTimestamp );
+		for ( size_t Pos = 0; Pos < Listeners.size(); Pos++ )
+		{
+			Listeners[Pos]->ProvisionalMove( StoneColor, a, b, CurrentTimestamp );
+		}
+	}
+}
+
+bool GobanState::IsLegalMove( int a, int b, int StoneColor )
+{
+	if ( Goban[a][b].State != Empty )
+	{
+		// Committed stone replaced by another one, can not be checked before playing it
+		return true;
+	}
+
+	uint64_t NewHash;
+	if ( Groups.CheckMove( a, b, StoneColor, NewHash ) == false )
 	{
-		// Found liberty, go out!
-		throw Omiscid::SimpleException( "Liberty found" );
+		// Suicide
+		return false;
 	}
 
-	// if Stone is from another color, no liberty
-	if ( Goban[a][b].State != StoneColor )
+	// Simple ko is a repetition of the previous position, superko of any older one
+	return ( PastPositions.find( NewHash ) == PastPositions.end() );
+}
+
+bool GobanState::IsEventConfirmed( StoneDetector Detector, double CurrentTimestamp )
+{
+	double Age = CurrentTimestamp - Detector.Timestamp;
+
+	// Captured stones still on the goban keep the fixed delays, evidence was reset by the capture
+	if ( FastCommit == false || Detector.AwaitingRemoval == true )
 	{
+		if ( Detector.State == Empty )
+		{
+			return ( Age >= LegacyRemovalCommitDelay );
+		}
+		return ( Age >= LegacyMoveCommitDelay );
+	}
+
+	if ( Detector.State == Empty )
+	{
+		return ( Detector.GetConfidence( Empty ) >= RemovalConfidence );
+	}
+	return ( Detector.GetConfidence( Detector.State ) >= CommitConfidence );
+}
+
+/**
+* @brief Print one latency distribution
+* @param fout [in] Output file
+* @param Title [in] Name of the distribution
+* @param Latencies [in] Latencies in seconds
+*/
+static void ReportLatencyDistribution( FILE * fout, const char * Title, std::vector<double> Latencies )
+{
+	if ( Latencies.empty() == true )
+	{
+		fprintf( fout, "%s: none\n", Title );
 		return;
 	}
 
-	// Ok, we have check this stone, add it to the current chain
-	Goban[a][b].CaptureChecked = true;
-	CurrentChain.AddTail( cv::Point( a, b ) );
+	std::sort( Latencies.begin(), Latencies.end() );
 
-	// Check points in a cross manner, TO CHECK : do we need to check diagonals?
-	if ( a > 0 )
+	double Sum = 0.0;
+	for ( size_t i = 0; i < Latencies.size(); i++ )
 	{
-		CheckLibertiesRecursive( a-1, b, StoneColor, CurrentChain );
+		Sum += Latencies[i];
 	}
-	if ( a < (NumCells-1) )
+
+	fprintf( fout, "%s: %d, mean=%.3lf, min=%.3lf, median=%.3lf, p90=%.3lf, max=%.3lf\n", Title, (int)Latencies.size(), Sum/(double)Latencies.size(),
+		Latencies.front(), Latencies[Latencies.size()/2], Latencies[(Latencies.size()*9)/10], Latencies.back() );
+
+	// Histogram
+	const double Bounds[] = { 0.25, 0.5, 1.0, 2.0, 5.0, 10.0 };
+	const int NbBounds = sizeof(Bounds)/sizeof(Bounds[0]);
+	size_t Pos = 0;
+	fprintf( fout, "  " );
+	for ( int Bound = 0; Bound <= NbBounds; Bound++ )
 	{
-		CheckLibertiesRecursive( a+1, b, StoneColor, CurrentChain );
+		int Count = 0;
+		while ( Pos < Latencies.size() && (Bound == NbBounds || Latencies[Pos] < Bounds[Bound]) )
+		{
+			Count++;
+			Pos++;
+		}
+
+		if ( Bound < NbBounds )
+		{
+			fprintf( fout, "<%.2lfs:%d ", Bounds[Bound], Count );
+		}
+		else
+		{
+			fprintf( fout, ">=%.2lfs:%d\n", Bounds[NbBounds-1], Count );
+		}
 	}
-	if ( b > 0 )
+}
+
+void GobanState::ReportCommitLatencies( FILE * fout /* = stderr */ )
+{
+	fprintf( fout, "Commit latencies (%s):\n", FastCommit ? "evidence" : "fixed delays" );
+	ReportLatencyDistribution( fout, "Provisional moves", ProvisionalLatencies );
+	ReportLatencyDistribution( fout, "Moves", MoveCommitLatencies );
+	ReportLatencyDistribution( fout, "Removals", RemovalCommitLatencies );
+	fprintf( fout, "Rejected illegal candidates (suicide, ko, superko): %d\n", NbIllegalCandidates );
+	fprintf( fout, "Retracted moves: %d\n", NbRetractedMoves );
+	fprintf( fout, "Move sequences reordered from recorded frames: %d\n", NbReorderedSequences );
+}
+
+void GobanState::CommitMove( int a, int b, const char * Comment, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
+{
+	int StoneColor = SearchFor;
+	AllDetectors.Fixed[AllDetectors.Index( a, b )] = true;		// Still interesting?
+
+	// Switch for next search
+	SwitchState();
+
+	// Put the stone in groups and check if we need to remove stones!
+	ValidateCapture( a, b, StoneColor, AllDetectors, CurrentTimestamp );
+	PastPositions.insert( Groups.GetHash() );
+
+	std::shared_ptr<MoveHistoryNode> NewEvent = std::make_shared<MoveHistoryNode>();
+	NewEvent->Kind = MoveHistoryNode::Move;
+	NewEvent->Color = StoneColor;
+	NewEvent->a = a;
+	NewEvent->b = b;
+	NewEvent->NumMove = GetNbMoves()+1;
+	NewEvent->Comment = Comment;
+	NewEvent->Captured = CapturedCells;
+	NewEvent->Hash = Groups.GetHash();
+	NewEvent->Previous = History;
+	History = NewEvent;
+
+	// Provisional move, if any, is now confirmed. The SGF writer adds it to the Kifu sgf file.
+	ProvisionalStones[a*NumLines+b] = Empty;
+	RecheckProvisionalMoves = true;
+	for ( size_t Pos = 0; Pos < Listeners.size(); Pos++ )
 	{
-		CheckLibertiesRecursive( a, b-1, StoneColor, CurrentChain );
+		Listeners[Pos]->ConfirmedMove( NewEvent->NumMove, StoneColor, a, b, Comment, CurrentTimestamp );
 	}
-	if ( b < (NumCells-1) )
+}
+
+void GobanState::CommitRemoval( int a, int b, double CurrentTimestamp )
+{
+	std::shared_ptr<MoveHistoryNode> NewEvent = std::make_shared<MoveHistoryNode>();
+	NewEvent->Kind = MoveHistoryNode::Removal;
+	NewEvent->Color = Goban[a][b].State;
+	NewEvent->a = a;
+	NewEvent->b = b;
+	NewEvent->NumMove = GetNbMoves();
+
+	Groups.Remove( a, b );
+
+	NewEvent->Hash = Groups.GetHash();
+	NewEvent->Previous = History;
+	History = NewEvent;
+	RecheckProvisionalMoves = true;
+
+	for ( size_t Pos = 0; Pos < Listeners.size(); Pos++ )
 	{
-		CheckLibertiesRecursive( a, b+1, StoneColor, CurrentChain );
+		Listeners[Pos]->RemovedStone( NewEvent->NumMove, NewEvent->Color, a, b, CurrentTimestamp );
 	}
 }
 
+int GobanState::GetNextColor() const
+{
+	for ( MoveHistory Event = History; Event != nullptr; Event = Event->Previous )
+	{
+		if ( Event->Kind == MoveHistoryNode::Move )
+		{
+			return (Event->Color+1)%StateModulo;
+		}
+	}
+	return Black;
+}
 
-bool GobanState::CheckLiberties( int a, int b, int StoneColor, StoneDetector( &AllDetectors )[MaxNumCells][MaxNumCells], double CurrentTimestamp )
+bool GobanState::RollbackTo( int NbMoves, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
 {
-	if ( Goban[a][b].State != StoneColor )
+	if ( NbMoves < 0 || NbMoves > GetNbMoves() )
 	{
-		// Not a stone in the opposite color, do not check
 		return false;
 	}
 
-	Omiscid::SimpleList<cv::Point> CurrentChain;
+	// Undo events from the last one, nodes are shared thus only the pointer to the last event changes
+	while ( History != nullptr && History->NumMove > NbMoves )
+	{
+		MoveHistory Event = History;
+		int Cell = Event->a*NumLines+Event->b;
+
+		if ( Event->Kind == MoveHistoryNode::Move )
+		{
+			PastPositions.erase( Event->Hash );
+			Groups.Remove( Event->a, Event->b );
+			AllDetectors.Fixed[Cell] = false;
+
+			// Captured stones are back, detectors will have to see them removed by hand
+			int CapturedColor = (Event->Color+1)%StateModulo;
+			for ( size_t Pos = 0; Pos < Event->Captured.size(); Pos++ )
+			{
+				int CapturedCell = Event->Captured[Pos];
+				Groups.Play( CapturedCell/NumLines, CapturedCell%NumLines, CapturedColor, CapturedCells );
+				AllDetectors.State[CapturedCell] = CapturedColor;
+				AllDetectors.AwaitingRemoval[CapturedCell] = false;
+			}
+
+			for ( size_t Pos = 0; Pos < Listeners.size(); Pos++ )
+			{
+				Listeners[Pos]->RetractedMove( Event->NumMove, Event->Color, Event->a, Event->b, CurrentTimestamp );
+			}
+		}
+		else
+		{
+			// Stone removed by hand is back
+			Groups.Play( Event->a, Event->b, Event->Color, CapturedCells );
+		}
+
+		// Detected state must be compared again with the committed one
+		AllDetectors.PendingEvents.Push( Cell, AllDetectors.Timestamp[Cell] );
+		History = Event->Previous;
+	}
+
+	// The SGF writer rewrote only the end of the SGF file on retracted moves
+	SearchFor = GetNextColor();
+	RecheckProvisionalMoves = true;
 
-	try
+	return true;
+}
+
+bool GobanState::CorrectMove( int NumMove, int a, int b, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
+{
+	if ( NumMove < 1 || NumMove > GetNbMoves() || a < 0 || a >= NumColumns || b < 0 || b >= NumLines )
 	{
-		CheckLibertiesRecursive( a, b, StoneColor, CurrentChain );
+		return false;
+	}
 
-		// Here, capture is validated (not exception thrown), remove stone
-		for ( CurrentChain.First(); CurrentChain.NotAtEnd(); CurrentChain.Next() )
+	// Moves to replay, from the corrected one to the last one
+	std::vector<MoveHistory> Replay;
+	for ( MoveHistory Event = History; Event != nullptr && Event->NumMove >= NumMove; Event = Event->Previous )
+	{
+		if ( Event->Kind == MoveHistoryNode::Move )
 		{
-			cv::Point& p = CurrentChain.GetCurrent();
-			Goban[p.x][p.y].State		   = Empty;
-			Goban[p.x][p.y].CaptureChecked = false;
+			Replay.push_back( Event );
+		}
+	}
+	std::reverse( Replay.begin(), Replay.end() );
+
+	RollbackTo( NumMove-1, AllDetectors, CurrentTimestamp );
+
+	// Removals by hand are not replayed, detectors will find them again
+	for ( size_t Pos = 0; Pos < Replay.size(); Pos++ )
+	{
+		int ReplayA = ( Pos == 0 ) ? a : Replay[Pos]->a;
+		int ReplayB = ( Pos == 0 ) ? b : Replay[Pos]->b;
 
-			AllDetectors[p.x][p.y].State     = Empty;
-			AllDetectors[p.x][p.y].Timestamp = CurrentTimestamp;
+		SearchFor = Replay[Pos]->Color;
+		if ( Goban[ReplayA][ReplayB].State != Empty || IsLegalMove( ReplayA, ReplayB, SearchFor ) == false )
+		{
+			// Can not be played anymore, let the detectors tell what is on the goban
+			AllDetectors.PendingEvents.Push( ReplayA*NumLines+ReplayB, AllDetectors.Timestamp[ReplayA*NumLines+ReplayB] );
+			continue;
 		}
+		CommitMove( ReplayA, ReplayB, Replay[Pos]->Comment.GetStr(), AllDetectors, CurrentTimestamp );
+	}
 
-		return true;
+	SearchFor = GetNextColor();
+	return true;
+}
+
+bool GobanState::ResolveMoveOrder( int FirstMove, const std::vector<int>& Cells, const std::vector<double>& AppearanceTimes, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
+{
+	if ( FirstMove < 1 || FirstMove > GetNbMoves() )
+	{
+		// Game changed since the request
+		return false;
+	}
+
+	// Moves from FirstMove to the last one, oldest first, with their appearance times
+	std::vector<MoveHistory> Moves;
+	for ( MoveHistory Event = History; Event != nullptr && Event->NumMove >= FirstMove; Event = Event->Previous )
+	{
+		if ( Event->Kind == MoveHistoryNode::Move )
+		{
+			Moves.push_back( Event );
+		}
 	}
-	catch ( Omiscid::SimpleException& /* Exception */ )
+	std::reverse( Moves.begin(), Moves.end() );
+
+	std::vector<std::pair<double, size_t> > Order;
+	for ( size_t Pos = 0; Pos < Moves.size(); Pos++ )
 	{
-		// Here Liberty found, remove CaptureChecked flag
-		for ( CurrentChain.First(); CurrentChain.NotAtEnd(); CurrentChain.Next() )
+		int Cell = Moves[Pos]->a*NumLines+Moves[Pos]->b;
+		std::vector<int>::const_iterator Found = std::find( Cells.begin(), Cells.end(), Cell );
+		if ( Found == Cells.end() || AppearanceTimes[Found-Cells.begin()] < 0.0 )
 		{
-			cv::Point& p = CurrentChain.GetCurrent();
-			Goban[p.x][p.y].CaptureChecked = false;
+			// Not seen in the frames, order can not be checked
+			return false;
 		}
+		Order.push_back( std::make_pair( AppearanceTimes[Found-Cells.begin()], Pos ) );
+	}
+	std::stable_sort( Order.begin(), Order.end() );
 
-		// liberty found
+	// New order must keep colors alternating after move FirstMove-1 and be different from the current one
+	int StartColor = Black;
+	for ( MoveHistory Event = History; Event != nullptr; Event = Event->Previous )
+	{
+		if ( Event->Kind == MoveHistoryNode::Move && Event->NumMove == FirstMove-1 )
+		{
+			StartColor = (Event->Color+1)%StateModulo;
+			break;
+		}
+	}
+	bool SameOrder = true;
+	for ( size_t Pos = 0; Pos < Order.size(); Pos++ )
+	{
+		if ( Moves[Order[Pos].second]->Color != (StartColor+(int)Pos)%StateModulo )
+		{
+			return false;
+		}
+		SameOrder = SameOrder && ( Order[Pos].second == Pos );
+	}
+	if ( SameOrder == true )
+	{
 		return false;
 	}
+
+	// Replay moves in the order seen on the frames, only the SGF tail is rewritten
+	RollbackTo( FirstMove-1, AllDetectors, CurrentTimestamp );
+	for ( size_t Pos = 0; Pos < Order.size(); Pos++ )
+	{
+		const MoveHistoryNode& CurMove = *Moves[Order[Pos].second];
+		SearchFor = CurMove.Color;
+		if ( Goban[CurMove.a][CurMove.b].State != Empty || IsLegalMove( CurMove.a, CurMove.b, SearchFor ) == false )
+		{
+			AllDetectors.PendingEvents.Push( CurMove.a*NumLines+CurMove.b, AllDetectors.Timestamp[CurMove.a*NumLines+CurMove.b] );
+			continue;
+		}
+		CommitMove( CurMove.a, CurMove.b, "Move order checked on recorded frames", AllDetectors, CurrentTimestamp );
+	}
+	SearchFor = GetNextColor();
+	NbReorderedSequences++;
+
+	return true;
 }
 
-bool GobanState::ValidateCapture( int a, int b, int StoneColor, StoneDetector( &AllDetectors )[MaxNumCells][MaxNumCells], double CurrentTimestamp )
+void GobanState::SaveCheckpoint( BinaryCheckpoint& Checkpoint, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
 {
-	// Check points in a crossed manner
-	if ( a > 0 )
+	// Committed events, oldest first
+	std::vector<MoveHistory> Events;
+	for ( MoveHistory Event = History; Event != nullptr; Event = Event->Previous )
+	{
+		Events.push_back( Event );
+	}
+	std::reverse( Events.begin(), Events.end() );
+
+	Checkpoint.WriteValue( (int32_t)NumColumns );
+	Checkpoint.WriteValue( (int32_t)NumLines );
+	Checkpoint.WriteValue( (uint32_t)Events.size() );
+	for ( size_t Pos = 0; Pos < Events.size(); Pos++ )
+	{
+		Checkpoint.WriteValue( (int32_t)Events[Pos]->Kind );
+		Checkpoint.WriteValue( (int32_t)Events[Pos]->Color );
+		Checkpoint.WriteValue( (int32_t)Events[Pos]->a );
+		Checkpoint.WriteValue( (int32_t)Events[Pos]->b );
+		Checkpoint.WriteString( Events[Pos]->Comment );
+	}
+	Checkpoint.WriteValue( (int32_t)SearchFor );
+	Checkpoint.WriteValue( Groups.GetHash() );
+
+	AllDetectors.SaveState( Checkpoint, CurrentTimestamp );
+	SGFWriter.SaveCheckpoint( Checkpoint );
+}
+
+bool GobanState::LoadCheckpoint( BinaryCheckpoint& Checkpoint, StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
+{
+	int32_t SavedNumColumns = 0, SavedNumLines = 0;
+	uint32_t NbEvents = 0;
+	Checkpoint.ReadValue( SavedNumColumns );
+	Checkpoint.ReadValue( SavedNumLines );
+	Checkpoint.ReadValue( NbEvents );
+	if ( Checkpoint.IsValid() == false || SavedNumColumns != NumColumns || SavedNumLines != NumLines )
+	{
+		fprintf( stderr, "Checkpoint does not match goban size %dx%d\n", NumColumns, NumLines );
+		return false;
+	}
+
+	// Restored events are not new ones for the listeners. The SGF file is not opened yet, nothing is written.
+	std::vector<GameEventListener*> SavedListeners;
+	SavedListeners.swap( Listeners );
+
+	bool Valid = true;
+	for ( uint32_t NumEvent = 0; NumEvent < NbEvents && Valid == true; NumEvent++ )
 	{
-		CheckLiberties( a-1, b, StoneColor, AllDetectors, CurrentTimestamp );
+		int32_t Kind = 0, Color = 0, a = 0, b = 0;
+		Omiscid::SimpleString Comment;
+		Checkpoint.ReadValue( Kind );
+		Checkpoint.ReadValue( Color );
+		Checkpoint.ReadValue( a );
+		Checkpoint.ReadValue( b );
+		Checkpoint.ReadString( Comment );
+
+		Valid = ( Checkpoint.IsValid() == true && a >= 0 && a < NumColumns && b >= 0 && b < NumLines );
+		if ( Valid == false )
+		{
+			break;
+		}
+
+		if ( Kind == MoveHistoryNode::Move )
+		{
+			Valid = ( (Color == Black || Color == White) && Goban[a][b].State == Empty );
+			if ( Valid == true )
+			{
+				SearchFor = Color;
+				CommitMove( a, b, Comment.GetStr(), AllDetectors, CurrentTimestamp );
+			}
+		}
+		else
+		{
+			Valid = ( Goban[a][b].State != Empty );
+			if ( Valid == true )
+			{
+				CommitRemoval( a, b, CurrentTimestamp );
+			}
+		}
 	}
-	if ( a < (NumCells-1) )
+	SavedListeners.swap( Listeners );
+
+	int32_t SavedSearchFor = Black;
+	uint64_t SavedHash = 0;
+	Checkpoint.ReadValue( SavedSearchFor );
+	Checkpoint.ReadValue( SavedHash );
+	if ( Valid == false || Checkpoint.IsValid() == false || SavedHash != Groups.GetHash() )
 	{
-		CheckLiberties( a+1, b, StoneColor, AllDetectors, CurrentTimestamp );
+		fprintf( stderr, "Checkpoint game is not valid\n" );
+		return false;
 	}
-	if ( b > 0 )
+	SearchFor = SavedSearchFor;
+
+	// Detected states overwrite changes done by captures while playing events again
+	if ( AllDetectors.LoadState( Checkpoint, CurrentTimestamp ) == false )
 	{
-		CheckLiberties( a, b-1, StoneColor, AllDetectors, CurrentTimestamp );
+		fprintf( stderr, "Checkpoint detectors are not valid\n" );
+		return false;
 	}
-	if ( b < (NumCells-1) )
+
+	// Detected states not committed yet are pending again
+	AllDetectors.PendingEvents.Clear();
+	RecheckProvisionalMoves = true;
+	for ( int Cell = 0; Cell < NumColumns*NumLines; Cell++ )
 	{
-		CheckLiberties( a, b+1, StoneColor, AllDetectors, CurrentTimestamp );
+		if ( AllDetectors.State[Cell] != GetState( Cell ) )
+		{
+			AllDetectors.PendingEvents.Push( Cell, AllDetectors.Timestamp[Cell] );
+		}
+	}
+
+	// SGF file must hold the committed moves
+	if ( SGFWriter.Resume( Checkpoint ) == false || SGFWriter.GetNbMoves() != GetNbMoves() )
+	{
+		fprintf( stderr, "Checkpoint SGF file is not valid\n" );
+		return false;
 	}
 
 	return true;
 }
 
-// Could be done in one pass by making an ordered list of new event... 
-bool GobanState::LookupForOlderEvent( StoneDetector( &AllDetectors )[MaxNumCells][MaxNumCells], double CurrentTimestamp, Omiscid::SimpleString Comment /* = "" */, bool EndKifu /* = false */ )
+void GobanState::UpdateProvisionalMoves( StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
+{
+	PendingEventQueue& PendingEvents = AllDetectors.PendingEvents;
+
+	// Changed cells, cells still moving at the last update, or all pending cells if committed stones changed
+	PendingEvents.TakePushedCells( ProvisionalCells );
+	if ( RecheckProvisionalMoves == true )
+	{
+		PendingEvents.GetCellsOlderThan( CurrentTimestamp, ProvisionalCells );
+		RecheckProvisionalMoves = false;
+	}
+	ProvisionalCells.insert( ProvisionalCells.end(), UnsettledCells.begin(), UnsettledCells.end() );
+	std::sort( ProvisionalCells.begin(), ProvisionalCells.end() );
+	ProvisionalCells.erase( std::unique( ProvisionalCells.begin(), ProvisionalCells.end() ), ProvisionalCells.end() );
+	UnsettledCells.clear();
+
+	for ( size_t Pos = 0; Pos < ProvisionalCells.size(); Pos++ )
+	{
+		int Cell = ProvisionalCells[Pos];
+		int a = Cell/NumLines;
+		int b = Cell%NumLines;
+		int CurrentStoneState = AllDetectors.State[Cell];
+
+		if ( CurrentStoneState == Goban[a][b].State )
+		{
+			// Back to the committed state, nothing to do but retracting a provisional move
+			UpdateProvisionalMove( Cell, Empty, AllDetectors.Timestamp[Cell], CurrentTimestamp );
+			IllegalCandidates[Cell] = Empty;
+			PendingEvents.Remove( Cell );
+			continue;
+		}
+
+		if ( Goban[a][b].State != Empty )
+		{
+			continue;
+		}
+
+		if ( AllDetectors.InMotionExtended[Cell] == true )
+		{
+			// Check it again once settled
+			UnsettledCells.push_back( Cell );
+			continue;
+		}
+
+		// A settled stone on an empty cell is a provisional move if it could be played
+		UpdateProvisionalMove( Cell, IsLegalMove( a, b, CurrentStoneState ) ? CurrentStoneState : Empty, AllDetectors.Timestamp[Cell], CurrentTimestamp );
+	}
+}
+
+bool GobanState::LookupForOlderEvent( StoneDetectorStorage& AllDetectors, double CurrentTimestamp, const char * Comment /* = "" */, bool EndKifu /* = false */, bool AllowSwitch /* = true */ )
 {
+	// Candidates are confirmed events of settled cells, the queue is not drained. Without fast commit, all events
+	// wait for at least LegacyMoveCommitDelay: younger events and their subtrees in the queue are not visited.
+	PendingEventQueue& PendingEvents = AllDetectors.PendingEvents;
+	PendingEvents.GetCellsOlderThan( FastCommit ? CurrentTimestamp : CurrentTimestamp-LegacyMoveCommitDelay, CandidateEvents );
+
+	size_t NbCandidates = 0;
+	for ( size_t Pos = 0; Pos < CandidateEvents.size(); Pos++ )
+	{
+		int Cell = CandidateEvents[Pos];
+		if ( AllDetectors.InMotionExtended[Cell] == false && IsEventConfirmed( AllDetectors[Cell], CurrentTimestamp ) == true )
+		{
+			CandidateEvents[NbCandidates++] = Cell;
+		}
+	}
+	CandidateEvents.resize( NbCandidates );
+
+	// Oldest first, same order as the queue
+	std::vector<double>& Timestamps = AllDetectors.Timestamp;
+	std::sort( CandidateEvents.begin(), CandidateEvents.end(), [&Timestamps]( int Cell1, int Cell2 )
+	{
+		if ( Timestamps[Cell1] != Timestamps[Cell2] )
+		{
+			return ( Timestamps[Cell1] < Timestamps[Cell2] );
+		}
+		return ( Cell1 < Cell2 );
+	} );
+
 	int posa = -1, posb = -1;
-	// +1.0 will include current event
-	double lTimestamp = CurrentTimestamp + 1.0;
 	int NbNewFoundOlder = 0;
-	for ( int a = 0; a < NumCells; a++ )
+	for ( size_t Pos = 0; Pos < CandidateEvents.size(); Pos++ )
 	{
-		for ( int b = 0; b < NumCells; b++ )
+		int Cell = CandidateEvents[Pos];
+		int a = Cell/NumLines;
+		int b = Cell%NumLines;
+
+		int CurrentStoneState = AllDetectors.State[Cell];
+		if ( CurrentStoneState == Goban[a][b].State )
+		{
+			// Back to the committed state after a previous candidate (capture, rollback), nothing to commit
+			UpdateProvisionalMove( Cell, Empty, AllDetectors.Timestamp[Cell], CurrentTimestamp );
+			IllegalCandidates[Cell] = Empty;
+			PendingEvents.Remove( Cell );
+			continue;
+		}
+
+		if ( CurrentStoneState == Empty )
 		{
-			// Do not consider moving cells
-			if ( AllDetectors[a][b].InMotionExtended == true )
+			PendingEvents.Remove( Cell );
+
+			// Last move disappeared without any capture: false detection or move taken back, remove it from the game
+			if ( RetractDisappearedMove == true && History != nullptr && History->Kind == MoveHistoryNode::Move && History->a == a && History->b == b && History->Captured.empty() == true )
 			{
+				NbRetractedMoves++;
+				RollbackTo( History->NumMove-1, AllDetectors, CurrentTimestamp );
 				continue;
 			}
-			int CurrentStoneState = AllDetectors[a][b].State;				// ComputeAndRetrieveState(CurrentTimestamp);
 
-			if ( CurrentStoneState != Goban[a][b].State &&					// Is it a different event, aka new event?
-				(CurrentTimestamp - AllDetectors[a][b].Timestamp) >= 5.0 )	// Older enough?
+			// Ok, back to empty state
+			CommitRemoval( a, b, CurrentTimestamp );
+			RemovalCommitLatencies.push_back( CurrentTimestamp - AllDetectors.Timestamp[Cell] );
+
+			// Do not count it as event
+			continue;
+		}
+
+		if ( IsLegalMove( a, b, CurrentStoneState ) == false )
+		{
+			// Most probably a false detection, wait for the goban to change. Count it once, not at each frame.
+			if ( IllegalCandidates[Cell] != CurrentStoneState )
 			{
-				if ( CurrentStoneState == Empty )
-				{
-					// Ok, back to empty state
-					if ( (CurrentTimestamp - AllDetectors[a][b].Timestamp) >= 10.0 )
-					{
-						Goban[a][b].State = Empty;
-					}
-
-					// Do not count it as event
-					continue;
-				}
-
-				// New event, not empty
-				NbNewFoundOlder++;
-				if ( CurrentStoneState == SearchFor && AllDetectors[a][b].Timestamp < lTimestamp )
-				{
-					// Do we already found a search event?
-					if ( posa == -1 )
-					{
-						//	no, first one !
-						posa = a;
-						posb = b;
-					}
-					else
-					{
-						if ( AllDetectors[a][b].Timestamp > AllDetectors[a][b].Timestamp )
-						{
-							// New oldest event of the good color
-							posa = a;
-							posb = b;
-						}
-						// Not better, we already count it, and we keep previous posa, posb event
-					}
-				}
+				IllegalCandidates[Cell] = CurrentStoneState;
+				NbIllegalCandidates++;
 			}
+			continue;
+		}
+		IllegalCandidates[Cell] = Empty;
+
+		// New event, not empty
+		NbNewFoundOlder++;
+		if ( CurrentStoneState == SearchFor )
+		{
+			// Oldest event of the good color
+			posa = a;
+			posb = b;
+			break;
 		}
+
+		// Wrong color, it stays in the queue for later
 	}
 
 	// did we found an event ?
 	if ( posa >= 0 )
 	{
 		// yes, fixe it !
-		Goban[posa][posb].State = SearchFor;
-		AllDetectors[posa][posb].Fixed = true;		// Still interesting?
-
-		// Add move to the Kifu sgf file
-		SGFWriter.AddMove( SearchFor, posa, posb, Comment );
-
-		// Switch for next search
-		SwitchState();
-
-		// Check if we need to remove stones!
-		// Use new value for SearchFor (that has been switched) as color for possibly removal stones
-		ValidateCapture( posa, posb, SearchFor, AllDetectors, CurrentTimestamp );
+		PendingEvents.Remove( AllDetectors.Index( posa, posb ) );
+		MoveCommitLatencies.push_back( CurrentTimestamp - AllDetectors.Timestamp[AllDetectors.Index( posa, posb )] );
+		CommitMove( posa, posb, Comment, AllDetectors, CurrentTimestamp );
 
 		return true;
 	}
@@ -201,10 +679,28 @@ bool GobanState::LookupForOlderEvent( StoneDetector( &AllDetectors )[MaxNumCells
 	if ( NbNewFoundOlder >= 1 )
 	{
 		// here, we have 2 consecutive bad event, do not wait longer to solve it...
+		if ( AllowSwitch == false )
+		{
+			return false;
+		}
 
-		// call recursively, we already know that the state will match
+		// call recursively once with the other color, the legal candidate of this color is committed unless
+		// its evidence changed in between
 		SwitchState();
-		return LookupForOlderEvent( AllDetectors, CurrentTimestamp, "Check this move" );
+		bool Found = LookupForOlderEvent( AllDetectors, CurrentTimestamp, "Check this move", EndKifu, false );
+		if ( Found == false )
+		{
+			// Nothing committed, keep searching for the expected color
+			SwitchState();
+			return false;
+		}
+		if ( AmbiguousMove == 0 )
+		{
+			// Frames of this move may tell the actual order
+			AmbiguousMove = GetNbMoves();
+			AmbiguousTimestamp = CurrentTimestamp;
+		}
+		return true;
 	}
 
 	// Here not found, or only 1 event but with the wrong color, wait for next event to try to solve it
@@ -212,50 +708,59 @@ bool GobanState::LookupForOlderEvent( StoneDetector( &AllDetectors )[MaxNumCells
 	return false;
 }
 
-void GobanState::UpdateCurrentState( StoneDetector( &AllDetectors )[MaxNumCells][MaxNumCells], double CurrentTimestamp )
+void GobanState::UpdateCurrentState( StoneDetectorStorage& AllDetectors, double CurrentTimestamp )
 {
+	UpdateProvisionalMoves( AllDetectors, CurrentTimestamp );
+
 	// Search iteratively alternatively for stones: black, white, black, white...
 	while ( LookupForOlderEvent( AllDetectors, CurrentTimestamp ) );
+
+	if ( RecheckProvisionalMoves == true )
+	{
+		// Committed stones changed, legality of provisional moves too
+		UpdateProvisionalMoves( AllDetectors, CurrentTimestamp );
+	}
 }
 
 // Draw a empty goban centered within the drawing area
 void GobanState::DrawGoban( cv::Mat& WhereToDraw )
 {
-	// Compute goban size
-	int minSize = Min( WhereToDraw.cols, WhereToDraw.rows );
-
-	// NumCells for the grid +1 for the space arround the goban
-	int DrawingCellSize = minSize/(NumCells+1);
+	// Columns and lines for the grid +1 for the space arround the goban
+	int DrawingCellSize = Min( WhereToDraw.cols/(NumColumns+1), WhereToDraw.rows/(NumLines+1) );
 
 	// Compute center
 	int CenterX = WhereToDraw.cols/2;
 	int CenterY = WhereToDraw.rows/2;
 
 	// Comput starting point from center of image
-	int StartCol = CenterX - DrawingCellSize*(NumCells/2);
-	int StartRow = CenterY - DrawingCellSize*(NumCells/2);
+	int StartCol = CenterX - DrawingCellSize*(NumColumns-1)/2;
+	int StartRow = CenterY - DrawingCellSize*(NumLines-1)/2;
 
 	// Fond blanc
 	WhereToDraw = cv::Scalar( 255, 255, 255 );
 
 	// Draw goban
-	cv::rectangle( WhereToDraw, cv::Rect( StartCol-DrawingCellSize/2, StartRow-DrawingCellSize/2, DrawingCellSize*NumCells, DrawingCellSize*NumCells ), cv::Scalar( 110, 190, 235 ), -1 );
+	cv::rectangle( WhereToDraw, cv::Rect( StartCol-DrawingCellSize/2, StartRow-DrawingCellSize/2, DrawingCellSize*NumColumns, DrawingCellSize*NumLines ), cv::Scalar( 110, 190, 235 ), -1 );
 
 	// Draw lines
-	int LineSize = (NumCells-1)*DrawingCellSize;
-	for ( int a = 0; a < NumCells; a++ )
+	int ColumnSize = (NumLines-1)*DrawingCellSize;
+	int LineSize = (NumColumns-1)*DrawingCellSize;
+	for ( int a = 0; a < NumColumns; a++ )
 	{
-		cv::line( WhereToDraw, cv::Point( StartCol+a*DrawingCellSize, StartRow ), cv::Point( StartCol+a*DrawingCellSize, StartRow+LineSize ), cv::Scalar( 0, 0, 0 ), 2 );
-		cv::line( WhereToDraw, cv::Point( StartCol, StartRow+a*DrawingCellSize ), cv::Point( StartCol+LineSize, StartRow+a*DrawingCellSize ), cv::Scalar( 0, 0, 0 ), 2 );
+		cv::line( WhereToDraw, cv::Point( StartCol+a*DrawingCellSize, StartRow ), cv::Point( StartCol+a*DrawingCellSize, StartRow+ColumnSize ), cv::Scalar( 0, 0, 0 ), 2 );
+	}
+	for ( int b = 0; b < NumLines; b++ )
+	{
+		cv::line( WhereToDraw, cv::Point( StartCol, StartRow+b*DrawingCellSize ), cv::Point( StartCol+LineSize, StartRow+b*DrawingCellSize ), cv::Scalar( 0, 0, 0 ), 2 );
 	}
 
 	// TO CHECK, point name
 	// Draw points on goban
-	if ( NumCells == 7 )
+	if ( NumColumns == 7 )
 	{
-		for ( int a = 3; a < NumCells; a += NumCells/2 )
+		for ( int a = 3; a < NumColumns; a += NumColumns/2 )
 		{
-			for ( int b = 3; b < NumCells; b += 6 )
+			for ( int b = 3; b < NumLines; b += 6 )
 			{
 				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingCellSize*15/100, cv::Scalar( 0, 0, 0 ), -1 );
 			}
@@ -263,9 +768,9 @@ void GobanState::DrawGoban( cv::Mat& WhereToDraw )
 	}
 	else
 	{
-		for ( int a = 3; a < NumCells; a += 6 )
+		for ( int a = 3; a < NumColumns; a += 6 )
 		{
-			for ( int b = 3; b < NumCells; b += 6 )
+			for ( int b = 3; b < NumLines; b += 6 )
 			{
 				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingCellSize*15/100, cv::Scalar( 0, 0, 0 ), -1 );
 			}
@@ -276,38 +781,44 @@ void GobanState::DrawGoban( cv::Mat& WhereToDraw )
 
 void GobanState::DrawCurrentState( cv::Mat& WhereToDraw, double CurrentTimestamp )
 {
-	// Compute goban size
-	int minSize = Min( WhereToDraw.cols, WhereToDraw.rows );
-
-	// NumCells for the grid +1 for the space arround the goban
-	int DrawingCellSize = minSize/(NumCells+1);
+	// Columns and lines for the grid +1 for the space arround the goban
+	int DrawingCellSize = Min( WhereToDraw.cols/(NumColumns+1), WhereToDraw.rows/(NumLines+1) );
 	int DrawingStoneSize = (DrawingCellSize/2)*90/100;
 
 	// Comput starting point from center of image
-	int StartCol = WhereToDraw.cols/2-DrawingCellSize*(NumCells/2);
-	int StartRow = WhereToDraw.rows/2-DrawingCellSize*(NumCells/2);
+	int StartCol = WhereToDraw.cols/2-DrawingCellSize*(NumColumns-1)/2;
+	int StartRow = WhereToDraw.rows/2-DrawingCellSize*(NumLines-1)/2;
 
 	DrawGoban( WhereToDraw );
 
 	// Draw stones if any
 	int colpos = StartCol;
-	for ( int a = 0; a < NumCells; a++, colpos += DrawingCellSize )
+	for ( int a = 0; a < NumColumns; a++, colpos += DrawingCellSize )
 	{
 		int rowpos = StartRow;
-		for ( int b = 0; b < NumCells; b++, rowpos += DrawingCellSize )
+		for ( int b = 0; b < NumLines; b++, rowpos += DrawingCellSize )
 		{
 
 			if ( Goban[a][b].State == StoneDetector::Black )
 			{
-				// AllDetectors[a][b].Fixed = true;
+				// AllDetectors( a, b ).Fixed = true;
 				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingStoneSize, cv::Scalar( 0, 0, 0 ), -1 );
 			}
 			else if ( Goban[a][b].State == StoneDetector::White )
 			{
-				// AllDetectors[a][b].Fixed = true;
+				// AllDetectors( a, b ).Fixed = true;
 				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingStoneSize, cv::Scalar( 20, 20, 20 ), -1 );
 				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingStoneSize-2, cv::Scalar( 255, 255, 255 ), -1 );
 			}
+			else if ( ProvisionalStones[a*NumLines+b] == StoneDetector::Black )
+			{
+				// Provisional moves, not committed yet
+				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingStoneSize-2, cv::Scalar( 0, 0, 0 ), 2 );
+			}
+			else if ( ProvisionalStones[a*NumLines+b] == StoneDetector::White )
+			{
+				cv::circle( WhereToDraw, cv::Point( StartCol+(a)*DrawingCellSize, StartRow+(b)*DrawingCellSize ), DrawingStoneSize-2, cv::Scalar( 255, 255, 255 ), 2 );
+			}
 		}
 	}
 }
\ No newline at end of file
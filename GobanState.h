@@ -11,13 +11,26 @@
 
 
 #include <System/SimpleString.h>
-#include <System/SimpleList.h>
 #include <Messaging/Serializable.h>
 
 #include "Go-CamRecorder.h"
 #include "StoneState.h"
-#include "StoneDetector.h"
+#include "StoneDetectorStorage.h"
 #include "SGFGenerator.h"
+#include "StoneGroups.h"
+#include "MoveHistory.h"
+#include "GameEventListener.h"
+
+class BinaryCheckpoint;
+
+#include <stdint.h>
+#include <unordered_set>
+#include <vector>
+
+#define LegacyMoveCommitDelay 5.0			// Time (s) before committing a new stone without fast commit
+#define LegacyRemovalCommitDelay 10.0		// Time (s) before committing a removal without fast commit
+#define DefaultCommitConfidence 0.90f		// Evidence needed to commit a new stone with fast commit
+#define DefaultRemovalConfidence 0.97f		// Evidence needed to commit a removal with fast commit
 
 /**
  * @class GobanState 
@@ -28,26 +41,126 @@ class GobanState : public StoneState
 public:
 	/**
 	 * @class Intersection 
-	 * @brief Container class to handle state of a goban position
+	 * @brief Thin read-only view on the state of a goban position stored in the groups. Goban[a][b].State
+	 *		  reads as Black, White or Empty, committed stones change only through the groups.
 	 */
 	class Intersection 
 	{
 	public:
-		int  State = Empty;								// Current state of detection
-		bool CaptureChecked = false;					// Flag used to limite recursive work when searching for capture
+		class StateView
+		{
+		public:
+			StateView( GobanState& _Owner, int _Cell ) : Owner(_Owner), Cell(_Cell) {}
+
+			inline operator int() const
+			{
+				return Owner.GetState( Cell );
+			}
+
+		protected:
+			GobanState& Owner;
+			int Cell;
+		};
+
+		Intersection( GobanState& Owner, int Cell ) : State( Owner, Cell ) {}
+
+		StateView State;								// Current state of the position
 	};
 
-	Intersection Goban[MaxNumCells][MaxNumCells];		// State of all goban positions (max goban size = 19)
-	
-	int NumCells;										// Number of Cells, i.e. goban size
+	/**
+	 * @class GobanView 
+	 * @brief Goban[a][b] access to positions, kept for drawing and scheduling code
+	 */
+	class GobanView 
+	{
+	public:
+		class Column
+		{
+		public:
+			Column( GobanState& _Owner, int _a ) : Owner(_Owner), a(_a) {}
+
+			inline Intersection operator[]( int b ) const
+			{
+				return Intersection( Owner, a*Owner.NumLines+b );
+			}
+
+		protected:
+			GobanState& Owner;
+			int a;
+		};
+
+		GobanView( GobanState& _Owner ) : Owner(_Owner) {}
+
+		inline Column operator[]( int a ) const
+		{
+			return Column( Owner, a );
+		}
+
+	protected:
+		GobanState& Owner;
+	};
+
+	int NumColumns;										// Number of columns of the goban
+	int NumLines;										// Number of lines of the goban
+
+	GobanView Goban;									// State of all goban positions, view on the groups
+
 	int SearchFor = StoneState::Black;					// First event, it is black
 
+	// Commit of detected events
+	bool FastCommit = false;							// Commit on evidence instead of fixed delays
+	float CommitConfidence = DefaultCommitConfidence;	// Evidence needed to commit a new stone
+	float RemovalConfidence = DefaultRemovalConfidence;	// Evidence needed to commit a removal
+	std::vector<double> MoveCommitLatencies;			// Time between detection and commit of each move
+	std::vector<double> RemovalCommitLatencies;			// Time between detection and commit of each removal
+
+	// Groups of committed stones, captures are known as soon as a move is committed
+	StoneGroups Groups;									// Committed stones, their groups and liberties
+	std::vector<int> CapturedCells;						// Cells captured by the last committed move
+	std::vector<int> CandidateEvents;					// Confirmed pending events of settled cells, oldest first
+
+	// Position history, candidate moves repeating a position (ko, superko) or suicides are not committed
+	std::unordered_set<uint64_t> PastPositions;			// Zobrist hashes of all positions of the game
+	int NbIllegalCandidates = 0;						// Number of rejected candidate moves
+	std::vector<int> IllegalCandidates;					// Rejected color on each cell, Empty if none
+
+	// Persistent history of committed events, moves can be corrected afterwards
+	MoveHistory History;								// Last committed event (nullptr at the beginning)
+	bool RetractDisappearedMove = false;				// Remove the last move from the game when it disappears without capture
+	int NbRetractedMoves = 0;							// Number of last moves removed from the game
+
+	// Ambiguous move order ("Check this move"), resolved later on recorded frames
+	int AmbiguousMove = 0;								// Move committed with the wrong color, 0 if none
+	double AmbiguousTimestamp = 0.0;					// Time of this commit
+	int NbReorderedSequences = 0;						// Number of sequences replayed in the order seen on frames
+
+	// Two-phase move events: provisional as soon as a detector settles, then confirmed or retracted
+	std::vector<GameEventListener*> Listeners;			// Consumers of move events (not owned)
+	std::vector<int> ProvisionalStones;					// Provisional move on each cell, Empty if none
+	std::vector<int> ProvisionalCells;					// Cells to check for a provisional move at this update
+	std::vector<int> UnsettledCells;					// Changed cells still in motion, checked again at next update
+	bool RecheckProvisionalMoves = true;				// Committed stones changed, check all pending cells
+	std::vector<double> ProvisionalLatencies;			// Time between detection and provisional event of each move
+
 	/**
     * @brief Constructor
-    * @param _NumCells [in] Size of the goban
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
 	*/
-	GobanState(int _NumCells) : NumCells(_NumCells), SGFWriter(_NumCells)
+	GobanState(int _NumColumns, int _NumLines) : NumColumns(_NumColumns), NumLines(_NumLines), Goban(*this),
+		Groups(_NumColumns, _NumLines), SGFWriter(_NumColumns, _NumLines)
 	{
+		CapturedCells.reserve( _NumColumns*_NumLines );
+		CandidateEvents.reserve( _NumColumns*_NumLines );
+		ProvisionalCells.reserve( 2*_NumColumns*_NumLines );
+		UnsettledCells.reserve( _NumColumns*_NumLines );
+		ProvisionalStones.assign( _NumColumns*_NumLines, Empty );
+		IllegalCandidates.assign( _NumColumns*_NumLines, Empty );
+		PastPositions.insert( Groups.GetHash() );
+
+		// Confirmed moves go to the SGF file, provisional ones are uploaded as soon as they are seen
+		AddListener( &SGFWriter );
+		AddListener( &SGFWriter.GetUploader() );
 	}
 
 	/**
@@ -58,6 +171,16 @@ public:
 
 	SGFGenerator SGFWriter;								// Writer of the SGF file
 
+	/**
+	* @brief Get committed state of a cell
+	* @param Cell [in] Cell number (a*NumLines+b)
+	* @return Black, White or Empty
+	*/
+	inline int GetState( int Cell ) const
+	{
+		return Groups.GetColor( Cell/NumLines, Cell%NumLines );
+	}
+
 	/**
 	* @brief Inline function to switc search stone color. Black/White/Black/white...
 	*/
@@ -67,45 +190,196 @@ public:
 	}
 
 	/**
-	* @brief Check if the new move do a capture by searching recursively for liberties
+	* @brief Commit events as soon as per-cell evidence is high enough instead of waiting fixed delays
+	* @param _FastCommit [in] true to use evidence
+	* @param _CommitConfidence [in] Evidence needed to commit a new stone
+	* @param _RemovalConfidence [in] Evidence needed to commit a removal
+	*/
+	inline void SetFastCommit( bool _FastCommit, float _CommitConfidence = DefaultCommitConfidence, float _RemovalConfidence = DefaultRemovalConfidence )
+	{
+		FastCommit = _FastCommit;
+		CommitConfidence = _CommitConfidence;
+		RemovalConfidence = _RemovalConfidence;
+	}
+
+	/**
+	* @brief Remove the last move from the game (and the SGF file) when its stone disappears without capture,
+	*		 instead of committing a removal by hand. The stone was a false detection or the move was taken back.
+	* @param _RetractDisappearedMove [in] true to retract the move
+	*/
+	inline void SetRetractDisappearedMove( bool _RetractDisappearedMove )
+	{
+		RetractDisappearedMove = _RetractDisappearedMove;
+	}
+
+	/**
+	* @brief Is the detected state of a cell confirmed enough to be committed?
+	* @param Detector [in] Detector of the cell
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	* @return true if the event can be committed
+	*/
+	bool IsEventConfirmed( StoneDetector Detector, double CurrentTimestamp );
+
+	/**
+	* @brief Print distributions of commit latencies of moves and removals
+	* @param fout [in] Output file (default=stderr)
+	*/
+	void ReportCommitLatencies( FILE * fout = stderr );
+
+	/**
+	* @brief Get number of committed events (moves and removals) since the beginning
+	* @return Number of events
+	*/
+	inline size_t GetNbCommits()
+	{
+		return MoveCommitLatencies.size() + RemovalCommitLatencies.size();
+	}
+
+	/**
+	* @brief Subscribe to move events
+	* @param Listener [in] Consumer of events, must live as long as the GobanState
+	*/
+	inline void AddListener( GameEventListener * Listener )
+	{
+		Listeners.push_back( Listener );
+	}
+
+	/**
+	* @brief Update provisional move of a settled cell, listeners are told when it appears, changes or disappears
+	* @param Cell [in] Cell number (a*NumLines+b)
+	* @param StoneColor [in] Black or White for a provisional move, Empty to retract it
+	* @param DetectionTimestamp [in] Timestamp of the detected state
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	*/
+	void UpdateProvisionalMove( int Cell, int StoneColor, double DetectionTimestamp, double CurrentTimestamp );
+
+	/**
+	* @brief Update provisional moves of cells pushed in the pending event queue since the last update, and of
+	*		 changed cells that were still in motion. All pending cells are checked after a change of committed
+	*		 stones. Events back to the committed state leave the queue.
+	* @param AllDetectors [in] Actual detection state on the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	*/
+	void UpdateProvisionalMoves( StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
+
+	/**
+	* @brief Check a candidate move before committing it, in O(1): suicide, ko and positional superko
+	* @param a [in] current column of the goban
+	* @param b [in] current line of the goban
+	* @param StoneColor [in] Color of the candidate stone
+	* @return false if the move is illegal
+	*/
+	bool IsLegalMove( int a, int b, int StoneColor );
+
+	/**
+	* @brief Get number of committed moves
+	* @return Number of moves
+	*/
+	inline int GetNbMoves() const
+	{
+		return ( History != nullptr ) ? History->NumMove : 0;
+	}
+
+	/**
+	* @brief Get color of the next move from the history
+	* @return Black or White
+	*/
+	int GetNextColor() const;
+
+	/**
+	* @brief Commit a move of the SearchFor color: goban, SGF, captures and history
 	* @param a [in] current column of the goban
 	* @param b [in] current line of the goban
-	* @param StoneColor [in] Color of the stone on which we are searching for liberties
-	* @param CurrentChain [in,out] List of all goban positions winthin the current territory
-	* @throw This function will throw an exception if a liberty is found
+	* @param Comment [in] Comment to add to the move in SGF
+	* @param StoneDetector [in] Actual detection state on the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
 	*/
-	void CheckLibertiesRecursive( int a, int b, int StoneColor, Omiscid::SimpleList<cv::Point>& CurrentChain );
+	void CommitMove( int a, int b, const char * Comment, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
 
 	/**
-	* @brief Check if the new move do a capture by searching recursively for liberties
+	* @brief Commit a stone removed by hand (not captured)
 	* @param a [in] current column of the goban
 	* @param b [in] current line of the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	*/
+	void CommitRemoval( int a, int b, double CurrentTimestamp );
+
+	/**
+	* @brief Go back to the position after a move: later events are undone in O(events since the move),
+	*		 the SGF file is truncated after the move. Undone cells are pushed in the pending event queue.
+	* @param NbMoves [in] Number of moves to keep
+	* @param StoneDetector [in] Actual detection state on the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	* @return false if NbMoves is not valid
+	*/
+	bool RollbackTo( int NbMoves, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
+
+	/**
+	* @brief Move a committed move to another cell and replay the following moves. Only the SGF tail from
+	*		 this move is rewritten. Moves that can not be replayed are left to the detectors.
+	* @param NumMove [in] Move to correct (1 for the first move)
+	* @param a [in] corrected column of the goban
+	* @param b [in] corrected line of the goban
+	* @param StoneDetector [in] Actual detection state on the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	* @return false if NumMove or the cell is not valid
+	*/
+	bool CorrectMove( int NumMove, int a, int b, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
+
+	/**
+	* @brief Replay moves from FirstMove in the order in which their stones appeared on recorded frames.
+	*		 Nothing is done if a move was not seen or if the new order does not alternate colors.
+	* @param FirstMove [in] First move to reorder
+	* @param Cells [in] Analysed cells
+	* @param AppearanceTimes [in] Time at which a stone appeared on each cell (-1.0 if not seen)
 	* @param StoneDetector [in] Actual detection state on the goban
 	* @param CurrentTimestamp [in] Current timestamp of the working frame
-	* @return false if no liberty have been found
+	* @return true if moves were reordered
+	*/
+	bool ResolveMoveOrder( int FirstMove, const std::vector<int>& Cells, const std::vector<double>& AppearanceTimes, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
+
+	/**
+	* @brief Save committed events, detected states and SGF state in a checkpoint
+	* @param Checkpoint [in] Checkpoint being written
+	* @param StoneDetector [in] Actual detection state on the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	*/
+	void SaveCheckpoint( BinaryCheckpoint& Checkpoint, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
+
+	/**
+	* @brief Restore a game saved by SaveCheckpoint on a new GobanState: committed events are played again
+	*		 without writing them, detected states are restored and the SGF file is reopened to continue it.
+	* @param Checkpoint [in] Checkpoint being read
+	* @param StoneDetector [in] Initialized detectors of the goban
+	* @param CurrentTimestamp [in] Current timestamp of the working frame
+	* @return false if the checkpoint is not valid
 	*/
-	bool CheckLiberties( int a, int b, int StoneColor, StoneDetector (&AllDetectors)[MaxNumCells][MaxNumCells], double CurrentTimestamp );
+	bool LoadCheckpoint( BinaryCheckpoint& Checkpoint, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
 
 	/**
-	* @brief Check if the new move do a capture by searching recursively for liberties. If there
-			 is at least a liberty, no capture.
+	* @brief Add the new committed move to groups and remove captured stones, i.e. adjacent groups
+			 of the other color left without liberty.
 	* @param a [in] current column of the goban
 	* @param b [in] current line of the goban
+	* @param StoneColor [in] Color of the committed move, stones of the other color may be captured
 	* @param StoneDetector [in] Actual detection state on the goban
 	* @param CurrentTimestamp [in] Current timestamp of the working frame
 	* @return false if there is no cpature
 	*/
-	bool ValidateCapture( int a, int b, int StoneColor, StoneDetector (&AllDetectors)[MaxNumCells][MaxNumCells], double CurrentTimestamp );
+	bool ValidateCapture( int a, int b, int StoneColor, StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
 
 	/**
-	* @brief Search for the older event of the current searched stone color
+	* @brief Search for the older event of the current searched stone color. Confirmed events of settled cells are
+	*		 taken from the queue filled by StoneDetector::SetState, oldest first, instead of scanning the whole goban.
+	*		 Other events stay in the queue. Without fast commit, younger events than LegacyMoveCommitDelay are not visited.
 	* @param StoneDetector [in] Actual detection state on the goban
 	* @param CurrentTimestamp [in] Current timestamp of the working frame
 	* @param Comment [in] Comment to add to the current move in SGF (default is no comment)
 	* @param EndKifu [in] Is it the end of search? (default=false)
+	* @param AllowSwitch [in] Search for the other color if only its candidates were found (default=true)
 	* @return true if an event was found
 	*/
-	bool LookupForOlderEvent( StoneDetector (&AllDetectors)[MaxNumCells][MaxNumCells], double CurrentTimestamp, Omiscid::SimpleString Comment = "", bool EndKifu = false );
+	bool LookupForOlderEvent( StoneDetectorStorage& AllDetectors, double CurrentTimestamp, const char * Comment = "", bool EndKifu = false, bool AllowSwitch = true );
 
 	/**
 	* @brief Search alternatively for the older event of the current searched stone color, siwtch color and restart until it failed.
@@ -113,7 +387,7 @@ public:
 	* @param StoneDetector [in] Actual detection state on the goban
 	* @param CurrentTimestamp [in] Current timestamp of the working frame
 	*/
-	void UpdateCurrentState( StoneDetector (&AllDetectors)[MaxNumCells][MaxNumCells], double CurrentTimestamp );
+	void UpdateCurrentState( StoneDetectorStorage& AllDetectors, double CurrentTimestamp );
 
 	/**
 	* @brief Draw an empty square goban centered in the image
@@ -122,7 +396,7 @@ public:
 	void DrawGoban( cv::Mat& WhereToDraw );
 
 	/**
-	* @brief Draw an goban centered in the image. Draw stone at their current detected place.
+	* @brief Draw an goban centered in the image. Draw stone at their current detected place, provisional moves as rings.
 	* @param WhereToDraw [in,out] Actual detection state on the goban
 	*/
 	void DrawCurrentState( cv::Mat& WhereToDraw, double CurrentTimestamp );
@@ -12,6 +12,7 @@
 #include "Go-CamRecorder.h"
 #include "GobanDetector.h"
 #include "MultiSourceVideo.h"	// will include VideoIO also
+#include "TournamentHost.h"
 
 
 #include <sys/stat.h>
@@ -46,6 +47,10 @@ public:
 	
 	double MinProcessingTime;			// Min processing time
 	double MaxProcessingTime;			// Max processing time
+	double SumMotionPhaseTime;			// Accumulated time of the motion phase
+	double SumStonePhaseTime;			// Accumulated time of the stone phase
+	int NbPhaseSamples;					// Number of accumulated phase times
+	long long int SumProcessedCells;	// Accumulated number of cells processed by stone detection
 
     /**
     * @brief Constructor
@@ -70,6 +75,10 @@ public:
 		FpsStartFrame = NumFrame;					// Current frame number 
 		MinProcessingTime = 24.0*60.0*60.0*1000;	// 1 day in millisecond as min
 		MaxProcessingTime = 0.0;					// 0 ms, as max
+		SumMotionPhaseTime = 0.0;
+		SumStonePhaseTime = 0.0;
+		NbPhaseSamples = 0;
+		SumProcessedCells = 0;
 		FpsTime.Reset();
 	}
 
@@ -77,10 +86,19 @@ public:
     * @brief Virtual destructor
 	* @param NumFrame [in] Current frame number
 	* @param ProcessingTime [in] Current processing time
+	* @param MotionPhaseTime [in] Current processing time of the motion phase
+	* @param StonePhaseTime [in] Current processing time of the stone phase
+	* @param ProcessedCells [in] Number of cells processed by stone detection
 	* @param fout [in] Current file to output statictics (default=stderr)
 	*/
-	void UpdateAndReportStats(int NumFrame, double ProcessingTime, FILE * fout = stderr)
+	void UpdateAndReportStats(int NumFrame, double ProcessingTime, double MotionPhaseTime, double StonePhaseTime, int ProcessedCells, FILE * fout = stderr)
 	{
+		// Accumulate phase times to report mean values
+		SumMotionPhaseTime += MotionPhaseTime;
+		SumStonePhaseTime += StonePhaseTime;
+		SumProcessedCells += ProcessedCells;
+		NbPhaseSamples++;
+
 		// UpdateStats about processing time
 		if ( ProcessingTime < MinProcessingTime )
 		{
@@ -99,11 +117,66 @@ public:
 			return;
 		}
 
-		fprintf( fout, "\rfps=%3.3lf (min=%.6lf, max=%.6lf)", (double)(NumFrame-FpsStartFrame)/CurrentFpsTime, MinProcessingTime, MaxProcessingTime );
+		fprintf( fout, "\rfps=%3.3lf (min=%.6lf, max=%.6lf, motion=%.6lf, stone=%.6lf, cells=%.1lf, threads=%d)", (double)(NumFrame-FpsStartFrame)/CurrentFpsTime, MinProcessingTime, MaxProcessingTime,
+			SumMotionPhaseTime/(double)NbPhaseSamples, SumStonePhaseTime/(double)NbPhaseSamples, (double)SumProcessedCells/(double)NbPhaseSamples, cv::getNumThreads() );
 		Init(NumFrame);
 	}
 };
 
+/**
+ * @class BoardsParallelLoop
+ * @brief Parallel loop body to process the same decoded frame with several goban detectors.
+ *		  Boards only read the shared frame, feedback must be drawn afterwards if goban areas overlap.
+ */
+class BoardsParallelLoop : public cv::ParallelLoopBody
+{
+public:
+	/**
+	* @brief Constructor
+	* @param _Gobans [in] Goban detectors, one per board
+	* @param _ProcessingTimes [out] Processing time of each board
+	* @param _LoadImage [in] Image from the current video source
+	* @param _DepthImage [in] Image from the current depth source (Kinect) if any
+	* @param _CurrentTimestamp [in] Timestamp of the frame
+	* @param _BlackThreshold [in] Threasold to detect black areas
+	* @param _WhiteThreshold [in] Threasold to detect white areas
+	* @param _DrawResult [in] Shall each board draw its detection result in LoadImage?
+	* @param _ShowBWDetection [in] Shall we show Black/White detection result?
+	* @param _ShowMotion [in] Shall we show motion detection result?
+	*/
+	BoardsParallelLoop( std::vector<GobanDetector*>& _Gobans, std::vector<double>& _ProcessingTimes, cv::Mat& _LoadImage, cv::Mat& _DepthImage,
+						double _CurrentTimestamp, int _BlackThreshold, int _WhiteThreshold, bool _DrawResult, bool _ShowBWDetection, bool _ShowMotion ) :
+		Gobans(_Gobans), ProcessingTimes(_ProcessingTimes), LoadImage(_LoadImage), DepthImage(_DepthImage), CurrentTimestamp(_CurrentTimestamp),
+		BlackThreshold(_BlackThreshold), WhiteThreshold(_WhiteThreshold), DrawResult(_DrawResult), ShowBWDetection(_ShowBWDetection), ShowMotion(_ShowMotion)
+	{
+	}
+
+	/**
+	* @brief Process boards in range
+	* @param Boards [in] Range of boards to process
+	*/
+	virtual void operator()( const cv::Range& Boards ) const
+	{
+		for ( int Board = Boards.start; Board < Boards.end; Board++ )
+		{
+			ProcessingTimes[Board] = Gobans[Board]->ProcessCurrentFrame( LoadImage, DepthImage, CurrentTimestamp, BlackThreshold, WhiteThreshold,
+				DrawResult, ShowBWDetection, ShowMotion );
+		}
+	}
+
+protected:
+	std::vector<GobanDetector*>& Gobans;		// Goban detectors, one per board
+	std::vector<double>& ProcessingTimes;		// Processing time of each board
+	cv::Mat& LoadImage;							// Shared color frame
+	cv::Mat& DepthImage;						// Shared depth frame
+	double CurrentTimestamp;					// Timestamp of the frame
+	int BlackThreshold;							// Threasold to detect black areas
+	int WhiteThreshold;							// Threasold to detect white areas
+	bool DrawResult;							// Draw detection in LoadImage
+	bool ShowBWDetection;						// Show Black/White detection
+	bool ShowMotion;							// Show motion detection
+};
+
 /**
 * @brief Utility function to get current time as an Omiscid::SimpleString
 */
@@ -173,6 +246,52 @@ void CheckAndSetVariable(Omiscid::SimpleString& Variable, Omiscid::SimpleString
 	}
 }
 
+/**
+* @brief Ask in the console for a committed move to correct and move it. Following moves are replayed and
+*		 the end of the SGF file is rewritten.
+* @param Gobans [in] Goban detectors, one per board
+* @param CurrentTimestamp [in] Current timestamp of the working frame
+*/
+void AskMoveCorrection( std::vector<GobanDetector*>& Gobans, double CurrentTimestamp )
+{
+	char Tmpc[512];
+	int Board = 0;
+	int NumMove = 0;
+	char Coordinates[3] = { 0 };
+
+	if ( Gobans.size() > 1 )
+	{
+		printf( "Correct move: board (1 to %d), move number and SGF coordinates (e.g. '1 42 dd'):", (int)Gobans.size() );
+		Tmpc[0] = '\0';
+		fgets(Tmpc, 512, stdin);
+		if ( sscanf( Tmpc, "%d %d %2s", &Board, &NumMove, Coordinates ) != 3 || Board < 1 || Board > (int)Gobans.size() )
+		{
+			fprintf( stderr, "Bad correction, nothing changed\n" );
+			return;
+		}
+		Board--;
+	}
+	else
+	{
+		printf( "Correct move: move number and SGF coordinates (e.g. '42 dd'):" );
+		Tmpc[0] = '\0';
+		fgets(Tmpc, 512, stdin);
+		if ( sscanf( Tmpc, "%d %2s", &NumMove, Coordinates ) != 2 )
+		{
+			fprintf( stderr, "Bad correction, nothing changed\n" );
+			return;
+		}
+	}
+
+	// Range of move number and coordinates is checked by the goban
+	if ( Coordinates[1] == '\0' || Gobans[Board]->CorrectMove( NumMove, Coordinates[0]-'a', Coordinates[1]-'a', CurrentTimestamp ) == false )
+	{
+		fprintf( stderr, "Bad correction, nothing changed\n" );
+		return;
+	}
+	fprintf( stderr, "Move %d moved to '%s', %d moves in the game\n", NumMove, Coordinates, Gobans[Board]->GameState.GetNbMoves() );
+}
+
 #define OutputFolderName "Results/"		// Default output folder for sgf file
 
 /**
@@ -192,12 +311,38 @@ int main( int argc, char *argv[] )
 	Omiscid::SimpleString Rule;				// Rule used during the game
 	Omiscid::SimpleString Komi;				// Komi
 
-	int GobanSize = 19;						// Default goban size
+	int NumColumns = 19;					// Default goban size
+	int NumLines = 19;
 
 	bool ExportResultVideo = false;			// Flag to know if we want to produce and mp4 file.
 
 	bool AutomaticRescaleOutput = true;		// Flag to indicate if we want to resclae video and feedback
 
+	int NbThreads = -1;						// Number of threads for cell processing (-1 = OpenCV default)
+	int CellsPerTask = DefaultCellsPerTask;	// Grain size of parallel processing
+
+	bool RectifiedMode = false;				// Flag to process a rectified (top-down) image of the goban
+
+	int NbSamplesPerCell = 0;				// Number of samples per cell in sparse mode (0 = dense processing)
+	bool CompareSparse = false;				// Flag to compare sparse mode with dense processing
+
+	Omiscid::SimpleString ClassifierModel;	// Patch classifier model, if any
+	Omiscid::SimpleString PatchDumpFile;	// File to dump labelled patches, if any
+
+	bool FastCommit = false;				// Commit moves on per-cell evidence instead of fixed delays
+	bool RetractDisappearedMove = false;	// Remove the last move from the game when its stone disappears without capture
+	double PreRollDuration = 0.0;			// Seconds of frames kept to re-analyse ambiguous moves (0 = disabled)
+	bool ResumeSession = false;				// Restore the session from its checkpoint instead of calibrating
+	bool WriteEventLog = false;				// Log detector transitions and game events in a binary file per board
+
+	bool EarlyExit = true;					// Coarse-to-fine stone detection
+	bool SkipQuietStones = true;			// Do not recheck committed stones with quiet neighbourhoods on each frame
+	double FrameBudget = 0.0;				// Processing time budget of a frame in seconds (0 for no limit)
+	bool FusedTiles = false;				// Process each cell tile from pixels to decisions instead of whole-image passes
+	int TargetCellSize = DefaultTargetCellSize;	// Target size of cells in the processed image (0 for native resolution)
+	int NbBoards = 1;						// Number of gobans seen by the camera
+	Omiscid::SimpleString HostFileName;		// Host file listing the sources of a tournament, if any
+
 	// First load config file, if exists
 	SingleConfig.Load();
 	EventName = SingleConfig.EventName;
@@ -218,11 +363,29 @@ int main( int argc, char *argv[] )
 		}
 		if ( strcasecmp("-h", argv[PosArg]) == 0 || strcasecmp("-help", argv[PosArg]) == 0 || strcasecmp("--help", argv[PosArg]) == 0 )
 		{
-			fprintf( stderr, "Usage: %s [-source <source_name>] [-export] [-noauto] [-sz <goban size>] [-ev <event_name>] [-ro <round>] [-pb <black player name>] [-pw <white player name>] ", argv[0] );
-			fprintf( stderr, "[-km <Komi>] [-ru <rules>]\n" );
+			fprintf( stderr, "Usage: %s [-source <source_name>] [-export] [-noauto] [-sz <goban size|columnsxlines>] [-ev <event_name>] [-ro <round>] [-pb <black player name>] [-pw <white player name>] ", argv[0] );
+			fprintf( stderr, "[-km <Komi>] [-ru <rules>] [-threads <n>] [-grain <n>] [-rectify] [-sparse <n>] [-compare-sparse]\n" );
+			fprintf( stderr, "[-classifier <model>] [-dump-patches <file>] [-fastcommit] [-retract] [-preroll <s>] [-resume] [-eventlog] [-noearlyexit] [-noskip] [-budget <ms>] [-fused] [-cellsize <n>] [-boards <n>] [-host <file>]\n" );
 			fprintf( stderr, "-source: Defaul source is '0' (default camera). Source must be a device number, 'kinect1:' or a video file.\n" );
 			fprintf( stderr, "-export: Export result also as an mp4 file using ffmpeg.\n-noauto: do not auto resize too small image." );
-			fprintf( stderr, "-sz: Size of goban (Default=19)\n//// SGF content ///" );
+			fprintf( stderr, "-sz: Size of goban, N or CxL for a rectangular one (Default=19, %d to %d lines)\n", MinGobanSize, MaxGobanSize );
+			fprintf( stderr, "-threads: Number of threads for cell processing (Default=OpenCV default, 1=sequential).\n-grain: Number of cells per parallel task (Default=%d).\n", DefaultCellsPerTask );
+			fprintf( stderr, "-rectify: Process an undistorted top-down image of the goban where all cells have the same size.\n" );
+			fprintf( stderr, "-sparse: Use n sample points per cell instead of all pixels (Default=%d).\n-compare-sparse: Report disagreements between sparse and dense detection at the end.\n", DefaultNbSamplesPerCell );
+			fprintf( stderr, "-classifier: Classify cell patches using a model from TrainPatchClassifier instead of stone detection.\n" );
+			fprintf( stderr, "-dump-patches: Dump labelled cell patches to train a classifier with TrainPatchClassifier.\n" );
+			fprintf( stderr, "-fastcommit: Commit moves as soon as detection is confident (about 1 s of still detection) instead of waiting %.0lf s (%.0lf s for removals).\n", LegacyMoveCommitDelay, LegacyRemovalCommitDelay );
+			fprintf( stderr, "-retract: Remove the last move from the game when its stone disappears without capture, instead of committing a removal.\n" );
+			fprintf( stderr, "-preroll: Keep the last s seconds of frames (downscaled, %.0lf fps) to find the actual order of moves seen with the wrong color.\n", 1.0/DefaultPreRollFrameInterval );
+			fprintf( stderr, "-resume: Continue the session of the same source after a crash from its checkpoint (no calibration, same SGF file).\n" );
+			fprintf( stderr, "-eventlog: Log detector transitions, motion and game events in a binary .evlog file per board (see ReplayEventLog).\n" );
+			fprintf( stderr, "-noearlyexit: Always compute full stone detection scores (for benchmarking).\n" );
+			fprintf( stderr, "-noskip: Recheck committed stones on each frame, even without motion around them.\n" );
+			fprintf( stderr, "-budget: Processing time budget of a frame in ms, stable cells are rechecked round-robin with the remaining time (Default=no limit).\n" );
+			fprintf( stderr, "-fused: Process each cell tile from pixels to motion decision, and colors of scheduled cells, while in cache instead of whole-image passes.\n" );
+			fprintf( stderr, "-cellsize: Downscale high resolution views to process cells of about n pixels, 0 for native resolution (Default=%d).\n", DefaultTargetCellSize );
+			fprintf( stderr, "-boards: Number of gobans seen by the camera, each with its own calibration and SGF file, processed in parallel (Default=1).\n" );
+			fprintf( stderr, "-host: Record all boards listed in file (one 'source[;black player[;white player]]' per line) in this process,\n       using a work-stealing pool of -threads workers that favours boards with motion ('n'/'p' select the shown board).\n//// SGF content ///" );
 			fprintf( stderr, "-ev: Event name.\n-ro: Round.\n-pb: Black player name.\n-pw: White player name.\n-km: Komi (Default=7.5)\n-ru: Rules (Default none)\n\n" );
 			return 0;
 		}
@@ -312,13 +475,228 @@ int main( int argc, char *argv[] )
 				fprintf( stderr, "Missing parameter after '-SZ' option\n" );
 				return -1;
 			}
-			int tmpi = atoi(argv[PosArg]);
-			if ( tmpi != 9 && tmpi != 13 && tmpi != 19 )
+			int tmpc = 0, tmpl = 0;
+			int NbRead = sscanf( argv[PosArg], "%dx%d", &tmpc, &tmpl );
+			if ( NbRead == 1 )
+			{
+				tmpl = tmpc;
+			}
+			if ( NbRead < 1 || tmpc < MinGobanSize || tmpc > MaxGobanSize || tmpl < MinGobanSize || tmpl > MaxGobanSize )
+			{
+				fprintf( stderr, "Bad goban size after '-SZ' option (should be N or CxL, from %d to %d)\n", MinGobanSize, MaxGobanSize );
+				return -1;
+			}
+			NumColumns = tmpc;
+			NumLines = tmpl;
+			continue;
+		}
+
+		if ( strcasecmp("-threads", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-threads' option\n" );
+				return -1;
+			}
+			NbThreads = atoi(argv[PosArg]);
+			if ( NbThreads <= 0 )
+			{
+				fprintf( stderr, "Bad number of threads after '-threads' option\n" );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( strcasecmp("-grain", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-grain' option\n" );
+				return -1;
+			}
+			CellsPerTask = atoi(argv[PosArg]);
+			if ( CellsPerTask <= 0 )
+			{
+				fprintf( stderr, "Bad grain size after '-grain' option\n" );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( strcasecmp("-rectify", argv[PosArg]) == 0 )
+		{
+			RectifiedMode = true;
+			continue;
+		}
+
+		if ( strcasecmp("-sparse", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-sparse' option\n" );
+				return -1;
+			}
+			NbSamplesPerCell = atoi(argv[PosArg]);
+			if ( NbSamplesPerCell <= 0 )
+			{
+				fprintf( stderr, "Bad number of samples after '-sparse' option\n" );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( strcasecmp("-compare-sparse", argv[PosArg]) == 0 )
+		{
+			CompareSparse = true;
+			continue;
+		}
+
+		if ( strcasecmp("-classifier", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-classifier' option\n" );
+				return -1;
+			}
+			ClassifierModel = argv[PosArg];
+			continue;
+		}
+
+		if ( strcasecmp("-dump-patches", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-dump-patches' option\n" );
+				return -1;
+			}
+			PatchDumpFile = argv[PosArg];
+			continue;
+		}
+
+		if ( strcasecmp("-fastcommit", argv[PosArg]) == 0 )
+		{
+			FastCommit = true;
+			continue;
+		}
+
+		if ( strcasecmp("-retract", argv[PosArg]) == 0 )
+		{
+			RetractDisappearedMove = true;
+			continue;
+		}
+
+		if ( strcasecmp("-preroll", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-preroll' option\n" );
+				return -1;
+			}
+			PreRollDuration = atof(argv[PosArg]);
+			if ( PreRollDuration < 0.0 )
+			{
+				fprintf( stderr, "Bad duration after '-preroll' option\n" );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( strcasecmp("-resume", argv[PosArg]) == 0 )
+		{
+			ResumeSession = true;
+			continue;
+		}
+
+		if ( strcasecmp("-eventlog", argv[PosArg]) == 0 )
+		{
+			WriteEventLog = true;
+			continue;
+		}
+
+		if ( strcasecmp("-noearlyexit", argv[PosArg]) == 0 )
+		{
+			EarlyExit = false;
+			continue;
+		}
+
+		if ( strcasecmp("-noskip", argv[PosArg]) == 0 )
+		{
+			SkipQuietStones = false;
+			continue;
+		}
+
+		if ( strcasecmp("-cellsize", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-cellsize' option\n" );
+				return -1;
+			}
+			TargetCellSize = atoi(argv[PosArg]);
+			if ( TargetCellSize < 0 || (TargetCellSize > 0 && TargetCellSize < 8) )
+			{
+				fprintf( stderr, "Bad cell size after '-cellsize' option (0 or at least 8)\n" );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( strcasecmp("-boards", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-boards' option\n" );
+				return -1;
+			}
+			NbBoards = atoi(argv[PosArg]);
+			if ( NbBoards < 1 )
+			{
+				fprintf( stderr, "Bad number of boards after '-boards' option\n" );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( strcasecmp("-host", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-host' option\n" );
+				return -1;
+			}
+			HostFileName = argv[PosArg];
+			continue;
+		}
+
+		if ( strcasecmp("-fused", argv[PosArg]) == 0 )
+		{
+			FusedTiles = true;
+			continue;
+		}
+
+		if ( strcasecmp("-budget", argv[PosArg]) == 0 )
+		{
+			PosArg++;
+			if ( PosArg >= argc )
+			{
+				fprintf( stderr, "Missing parameter after '-budget' option\n" );
+				return -1;
+			}
+			FrameBudget = atof(argv[PosArg])/1000.0;
+			if ( FrameBudget < 0.0 )
 			{
-				fprintf( stderr, "Bad goban size after '-SZ' option (should be 7, 13 or 19)\n" );
+				fprintf( stderr, "Bad budget after '-budget' option\n" );
 				return -1;
 			}
-			GobanSize = tmpi;
 			continue;
 		}
 
@@ -332,18 +710,133 @@ int main( int argc, char *argv[] )
 		return -1;
 	}
 
-	// Check variable
-	CheckAndSetVariable( EventName, "Enter event name", "" );
-	CheckAndSetVariable( RoundName, "Enter round name", "" );
-	// Later support
-	// CheckAndSetVariable( Rules, "Enter rules", "" );
-	CheckAndSetVariable( Komi, "Enter komi", DefaultKomi );
-	CheckAndSetVariable( BlackPlayerName, "Enter black player name", "BlackPlayer" );
-	CheckAndSetVariable( WhitePlayerName, "Enter white player name", "WhitePlayer" );
+	if ( HostFileName.IsEmpty() == false && NbBoards > 1 )
+	{
+		fprintf( stderr, "'-boards' and '-host' options can not be used together\n" );
+		return -1;
+	}
+
+	// Check variable, a resumed session continues its SGF file
+	if ( ResumeSession == false )
+	{
+		CheckAndSetVariable( EventName, "Enter event name", "" );
+		CheckAndSetVariable( RoundName, "Enter round name", "" );
+		// Later support
+		// CheckAndSetVariable( Rules, "Enter rules", "" );
+		CheckAndSetVariable( Komi, "Enter komi", DefaultKomi );
+	}
 
 	Omiscid::SimpleString Date, Time;
 	GetDateAndTimeAsStrings( Date, Time );
 
+	// Same settings for all goban detectors
+	if ( CompareSparse == true && NbSamplesPerCell == 0 )
+	{
+		// Comparison needs samples
+		NbSamplesPerCell = DefaultNbSamplesPerCell;
+	}
+
+	auto ConfigureGoban = [&]( GobanDetector& Goban ) -> bool
+	{
+		Goban.SetCellsPerTask( CellsPerTask );
+		Goban.SetRectifiedMode( RectifiedMode );
+		Goban.SetTargetCellSize( TargetCellSize );
+		Goban.SetSparseMode( NbSamplesPerCell );
+		Goban.SetSparseComparison( CompareSparse );
+		Goban.SetEarlyExit( EarlyExit );
+		Goban.SetSkipQuietStones( SkipQuietStones );
+		Goban.SetFrameBudget( FrameBudget );
+		Goban.SetFusedTiles( FusedTiles );
+
+		Goban.GameState.SetFastCommit( FastCommit );
+		Goban.GameState.SetRetractDisappearedMove( RetractDisappearedMove );
+		Goban.SetPreRoll( PreRollDuration );
+
+		return ( ClassifierModel.IsEmpty() == true || Goban.LoadClassifier( ClassifierModel.GetStr() ) == true );
+	};
+
+	// Tournament host mode: all sources in this process, boards share a pool of workers
+	if ( HostFileName.IsEmpty() == false )
+	{
+		if ( ResumeSession == true )
+		{
+			fprintf( stderr, "'-resume' option is not available with '-host'\n" );
+			return -1;
+		}
+
+		TournamentHost Host( NumColumns, NumLines );
+		if ( Host.LoadBoards( HostFileName.GetStr() ) == false )
+		{
+			return -1;
+		}
+
+		for ( size_t Board = 0; Board < Host.Boards.size(); Board++ )
+		{
+			if ( ConfigureGoban( Host.Boards[Board]->Goban ) == false )
+			{
+				return -1;
+			}
+
+			char Message[128];
+			snprintf( Message, sizeof(Message), "Enter black player name of board %d (%s)", (int)Board+1, Host.Boards[Board]->SourceName.GetStr() );
+			CheckAndSetVariable( Host.Boards[Board]->BlackPlayerName, Message, "BlackPlayer" );
+			snprintf( Message, sizeof(Message), "Enter white player name of board %d (%s)", (int)Board+1, Host.Boards[Board]->SourceName.GetStr() );
+			CheckAndSetVariable( Host.Boards[Board]->WhitePlayerName, Message, "WhitePlayer" );
+		}
+
+		if ( Host.Calibrate() == false )
+		{
+			return -1;
+		}
+
+		// Create output folder
+		CreateDirectory( OutputFolderName, NULL );
+
+		if ( Host.Start( OutputFolderName, EventName, RoundName, Rule, Komi, Date, Time ) == false )
+		{
+			return -4;
+		}
+
+		Host.Run( NbThreads > 0 ? NbThreads : cv::getNumberOfCPUs() );
+		Host.Report( stderr );
+
+		for ( size_t Board = 0; Board < Host.Boards.size(); Board++ )
+		{
+			// Ask score
+			Omiscid::SimpleString Result;
+			char Message[128];
+			snprintf( Message, sizeof(Message), "\n\nEnter game result of board %d (%s)", (int)Board+1, Host.Boards[Board]->SourceName.GetStr() );
+			CheckAndSetVariable( Result, Message, "" );
+
+			// Close file
+			Host.Boards[Board]->Goban.GameState.SGFWriter.Close(Result);
+		}
+
+		// Save config
+		SingleConfig.Save();
+
+		return 0;
+	}
+
+	if ( ResumeSession == false )
+	{
+		CheckAndSetVariable( BlackPlayerName, "Enter black player name", "BlackPlayer" );
+		CheckAndSetVariable( WhitePlayerName, "Enter white player name", "WhitePlayer" );
+	}
+
+	// Other boards have their own players
+	std::vector<Omiscid::SimpleString> BlackPlayerNames( NbBoards ), WhitePlayerNames( NbBoards );
+	BlackPlayerNames[0] = BlackPlayerName;
+	WhitePlayerNames[0] = WhitePlayerName;
+	for ( int Board = 1; Board < NbBoards && ResumeSession == false; Board++ )
+	{
+		char Message[128];
+		snprintf( Message, sizeof(Message), "Enter black player name of board %d", Board+1 );
+		CheckAndSetVariable( BlackPlayerNames[Board], Message, "BlackPlayer" );
+		snprintf( Message, sizeof(Message), "Enter white player name of board %d", Board+1 );
+		CheckAndSetVariable( WhitePlayerNames[Board], Message, "WhitePlayer" );
+	}
+
 	// Set angles
 	MultiVideoSource Vid;
 	Vid.Open(RecordingDeviceOrFile.GetStr());
@@ -357,8 +850,28 @@ int main( int argc, char *argv[] )
 	// Create output folder
 	CreateDirectory( OutputFolderName, NULL );
 
-	// Create Goban detector
-	GobanDetector Goban(GobanSize);
+	// Set number of threads for parallel processing
+	if ( NbThreads > 0 )
+	{
+		cv::setNumThreads( NbThreads );
+	}
+
+	// Create one Goban detector per board, all of them will process the same decoded frame
+	std::vector<GobanDetector*> Gobans( NbBoards );
+	for ( int Board = 0; Board < NbBoards; Board++ )
+	{
+		Gobans[Board] = new GobanDetector(NumColumns, NumLines);
+		if ( ConfigureGoban( *Gobans[Board] ) == false )
+		{
+			return -1;
+		}
+	}
+
+	// Patches are dumped from the first board only
+	if ( PatchDumpFile.IsEmpty() == false && Gobans[0]->OpenPatchDump( PatchDumpFile.GetStr() ) == false )
+	{
+		return -1;
+	}
 
 	// Remove trailing ":" or '/' here from RecordingDeviceOrFile => store calibration file
 	char TrailingChar = RecordingDeviceOrFile[RecordingDeviceOrFile.GetLength()-1];
@@ -368,36 +881,93 @@ int main( int argc, char *argv[] )
 		RecordingDeviceOrFile.pop_back();
 	}
 	
-	// Retrieve or compute calibration
-	if ( Goban.GetCalibration( RecordingDeviceOrFile, Vid ) == false )
+	// Retrieve or compute calibration of each board, first board keeps the single board calibration file
+	for ( int Board = 0; Board < NbBoards; Board++ )
 	{
-		// We did not get calibration, exit!
-		return -1;
+		Omiscid::SimpleString CalibrationName = RecordingDeviceOrFile;
+		if ( Board > 0 )
+		{
+			char BoardSuffix[32];
+			snprintf( BoardSuffix, sizeof(BoardSuffix), ".board%d", Board+1 );
+			CalibrationName += BoardSuffix;
+		}
+
+		// Checkpoint is stored next to the calibration file
+		Gobans[Board]->SetCheckpoint( CalibrationName + ".checkpoint" );
+		if ( ResumeSession == true )
+		{
+			if ( Gobans[Board]->ResumeFromCheckpoint( Vid ) == false )
+			{
+				fprintf( stderr, "Could not resume session of board %d, abording...\n", Board+1 );
+				return -1;
+			}
+			continue;
+		}
+
+		if ( NbBoards > 1 )
+		{
+			fprintf( stderr, "Calibration of board %d/%d\n", Board+1, NbBoards );
+		}
+
+		if ( Gobans[Board]->GetCalibration( CalibrationName, Vid ) == false )
+		{
+			// We did not get calibration, exit!
+			return -1;
+		}
 	}
 
-	// SubImage for image processing and video
-	cv::Rect SubImageRect = Goban.GetSubImageRect();
+	// Event log of each board, starts with a snapshot of the calibrated (or resumed) goban
+	std::vector<EventLog*> EventLogs( NbBoards, nullptr );
+	for ( int Board = 0; Board < NbBoards && WriteEventLog == true; Board++ )
+	{
+		Omiscid::SimpleString EventLogName = OutputFolderName + Date + "." + Time;
+		if ( NbBoards > 1 )
+		{
+			char BoardSuffix[32];
+			snprintf( BoardSuffix, sizeof(BoardSuffix), ".board%d", Board+1 );
+			EventLogName += BoardSuffix;
+		}
+		EventLogName += ".evlog";
+
+		EventLogs[Board] = new EventLog;
+		if ( EventLogs[Board]->Open( EventLogName, NumColumns, NumLines ) == false )
+		{
+			return -1;
+		}
+		Gobans[Board]->SetEventLog( EventLogs[Board] );
+	}
 
-	cv::Rect VideoRect = SubImageRect;
-	int ScaleOutputImage = 1;
+	// SubImage for video and feedback (goban rect at native resolution or rectified goban), large enough for all boards
+	cv::Rect VideoRect( 0, 0, 0, 0 );
+	for ( int Board = 0; Board < NbBoards; Board++ )
+	{
+		cv::Size FeedbackImageSize = Gobans[Board]->GetFeedbackImageSize();
+		VideoRect.width = Max( VideoRect.width, FeedbackImageSize.width );
+		VideoRect.height = Max( VideoRect.height, FeedbackImageSize.height );
+	}
 
 	// Do we rescale output?
 	if ( AutomaticRescaleOutput == true )
 	{
 		if ( VideoRect.height < 200 || VideoRect.width < 200 )
 		{
-			ScaleOutputImage = 2;
 			VideoRect.width *= 2;
 			VideoRect.height *= 2;
 		}
 	}
 	
-	// To create output video
+	// To create output video, one line per board (game state, then feedback)
 	VideoIO WriteVideo;
-	cv::Mat VideoImage( VideoRect.height, VideoRect.width*2, CV_8UC3 );
-	cv::Mat PlaceImage( VideoImage, cv::Rect( VideoRect.width, 0, VideoRect.width, VideoRect.height ) );
-	cv::Mat GobanImage( VideoImage, cv::Rect( 0, 0, VideoRect.width, VideoRect.height )  );
-	Goban.GameState.DrawGoban( GobanImage );
+	cv::Mat VideoImage( VideoRect.height*NbBoards, VideoRect.width*2, CV_8UC3 );
+	cv::Mat GobansImage( VideoImage, cv::Rect( 0, 0, VideoRect.width, VideoRect.height*NbBoards ) );
+	std::vector<cv::Mat> PlaceImages( NbBoards );
+	std::vector<cv::Mat> GobanImages( NbBoards );
+	for ( int Board = 0; Board < NbBoards; Board++ )
+	{
+		PlaceImages[Board] = cv::Mat( VideoImage, cv::Rect( VideoRect.width, Board*VideoRect.height, VideoRect.width, VideoRect.height ) );
+		GobanImages[Board] = cv::Mat( VideoImage, cv::Rect( 0, Board*VideoRect.height, VideoRect.width, VideoRect.height ) );
+		Gobans[Board]->GameState.DrawGoban( GobanImages[Board] );
+	}
 
 	if ( ExportResultVideo == true )
 	{
@@ -423,14 +993,17 @@ int main( int argc, char *argv[] )
 	}
 
 	// Init undelying detection algorithm
-	if ( DepthImage.empty() == false )
-	{
-		// Depth is present, use it as motion detector
-		Goban.InitDetection(DepthImage);
-	}
-	else
+	for ( int Board = 0; Board < NbBoards; Board++ )
 	{
-		Goban.InitDetection(LoadImage);
+		if ( DepthImage.empty() == false )
+		{
+			// Depth is present, use it as motion detector
+			Gobans[Board]->InitDetection(DepthImage);
+		}
+		else
+		{
+			Gobans[Board]->InitDetection(LoadImage);
+		}
 	}
 
 	// Set loop parameters and statistics
@@ -444,12 +1017,16 @@ int main( int argc, char *argv[] )
 	bool ShowMotion = false;				// Show detection?
 
 	ProcessingStatistics ProcStats(10.0f);	// Report Stats every 10s
+	std::vector<double> BoardProcessingTimes( NbBoards, 0.0 );	// Processing time of each board for the current frame
 
-	// GenerateSGF into OutputFolderName folder
-	if ( Goban.GameState.SGFWriter.Open( OutputFolderName, EventName, RoundName, Rule, Komi, Date, Time, BlackPlayerName, WhitePlayerName ) == false )
+	// GenerateSGF into OutputFolderName folder, one file per board (already reopened when resuming)
+	for ( int Board = 0; Board < NbBoards && ResumeSession == false; Board++ )
 	{
-		fprintf( stderr, "Could not open output SGF file, abording...\n" );
-		return -4;
+		if ( Gobans[Board]->GameState.SGFWriter.Open( OutputFolderName, EventName, RoundName, Rule, Komi, Date, Time, BlackPlayerNames[Board], WhitePlayerNames[Board] ) == false )
+		{
+			fprintf( stderr, "Could not open output SGF file, abording...\n" );
+			return -4;
+		}
 	}
 
 	#define MainWindoName "Processing... ESC to terminate game recording."
@@ -481,24 +1058,55 @@ int main( int argc, char *argv[] )
 		}
 
 		// Process current frame, draw feedback on video if feddback is active or video is exported
-		double FrameProcessingTime = Goban.ProcessCurrentFrame(LoadImage, DepthImage, CurTime, SingleConfig.BlackThreshold, SingleConfig.WhiteThreshold,
-				ShowFeedback == true || ExportResultVideo == true, ShowStoneDetection, ShowMotion );
+		bool DrawFeedback = ( ShowFeedback == true || ExportResultVideo == true );
+		// With several boards, goban areas may overlap: boards only read the frame, feedback is drawn afterwards
+		Omiscid::PerfElapsedTime FrameET;
+		BoardsParallelLoop ProcessBoards( Gobans, BoardProcessingTimes, LoadImage, DepthImage, CurTime, SingleConfig.BlackThreshold, SingleConfig.WhiteThreshold,
+			DrawFeedback == true && NbBoards == 1, ShowStoneDetection, ShowMotion );
+		if ( NbBoards > 1 && ShowMotion == false && ShowStoneDetection == false )
+		{
+			cv::parallel_for_( cv::Range( 0, NbBoards ), ProcessBoards, NbBoards );
+		}
+		else
+		{
+			// Single board (parallel inside) or debug windows (not thread safe)
+			ProcessBoards( cv::Range( 0, NbBoards ) );
+		}
 
-		if ( ShowFeedback == true || ExportResultVideo == true )
+		if ( DrawFeedback == true && NbBoards > 1 )
 		{
-			// copy it only if we need to draw feedback
-			if ( ScaleOutputImage == 1 )
+			for ( int Board = 0; Board < NbBoards; Board++ )
 			{
-				cv::Mat( LoadImage, SubImageRect ).copyTo( PlaceImage );
+				Gobans[Board]->DrawDetections( LoadImage );
 			}
-			else
+		}
+		double FrameProcessingTime = ( NbBoards == 1 ) ? BoardProcessingTimes[0] : FrameET.GetInSeconds();
+
+		// Checkpoints are written between frames
+		for ( int Board = 0; Board < NbBoards; Board++ )
+		{
+			Gobans[Board]->CheckpointIfNeeded( CurTime );
+		}
+
+		for ( int Board = 0; Board < NbBoards; Board++ )
+		{
+			if ( DrawFeedback == true )
 			{
-				cv::resize( cv::Mat( LoadImage, SubImageRect ), PlaceImage, cv::Size( VideoRect.width, VideoRect.height ) );
+				// copy it only if we need to draw feedback
+				cv::Mat FeedbackImage = Gobans[Board]->GetFeedbackImage( LoadImage );
+				if ( FeedbackImage.size() == PlaceImages[Board].size() )
+				{
+					FeedbackImage.copyTo( PlaceImages[Board] );
+				}
+				else
+				{
+					cv::resize( FeedbackImage, PlaceImages[Board], PlaceImages[Board].size() );
+				}
 			}
-		}
 
-		// Always draw game state
-		Goban.GameState.DrawCurrentState( GobanImage, CurTime );
+			// Always draw game state
+			Gobans[Board]->GameState.DrawCurrentState( GobanImages[Board], CurTime );
+		}
 
 		// Write current frame to video
 		if ( ExportResultVideo == true )
@@ -510,7 +1118,7 @@ int main( int argc, char *argv[] )
 		if ( ShowFeedback == false )
 		{
 			// Show only goban
-			cv::imshow( MainWindoName, GobanImage );
+			cv::imshow( MainWindoName, GobansImage );
 			char KeyPressed = 0;
 
 			KeyPressed = cv::waitKey( 1 );		// 1 means 1ms, fatest way to process
@@ -563,6 +1171,12 @@ int main( int argc, char *argv[] )
 			{
 				Paused = !Paused;
 			}
+
+			// Correct a committed move
+			if ( KeyPressed == 'c' || KeyPressed == 'C' )
+			{
+				AskMoveCorrection( Gobans, CurTime );
+			}
 		}
 
 		if ( ShowFeedback == true )
@@ -633,6 +1247,12 @@ int main( int argc, char *argv[] )
 					Paused = !Paused;
 				}
 
+				// Correct a committed move
+				if ( KeyPressed == 'c' || KeyPressed == 'C' )
+				{
+					AskMoveCorrection( Gobans, CurTime );
+				}
+
 				// When not paused : go back to processing
 				// In pause mode, 'x' or 'X' will process the next frame
 				if ( Paused == false || KeyPressed == 'x' || KeyPressed == 'X' )
@@ -650,19 +1270,70 @@ int main( int argc, char *argv[] )
 			// A new frame was processed
 			NumFrame += 1;
 
-			ProcStats.UpdateAndReportStats( NumFrame, FrameProcessingTime, stderr );
+			// Phase times and processed cells of all boards
+			double MotionPhaseTime = 0.0;
+			double StonePhaseTime = 0.0;
+			int NbProcessedCells = 0;
+			for ( int Board = 0; Board < NbBoards; Board++ )
+			{
+				MotionPhaseTime += Gobans[Board]->GetMotionPhaseTime();
+				StonePhaseTime += Gobans[Board]->GetStonePhaseTime();
+				NbProcessedCells += Gobans[Board]->GetNbProcessedCells();
+			}
+
+			ProcStats.UpdateAndReportStats( NumFrame, FrameProcessingTime, MotionPhaseTime, StonePhaseTime, NbProcessedCells, stderr );
 		}
 	}
 
 	// Close every window left
 	cv::destroyAllWindows();
 
-	// Ask score
-	Omiscid::SimpleString Result;
-	CheckAndSetVariable( Result, "\n\nEnter game result", "" );
+	for ( int Board = 0; Board < NbBoards; Board++ )
+	{
+		GobanDetector& Goban = *Gobans[Board];
+
+		if ( NbBoards > 1 )
+		{
+			fprintf( stderr, "\nBoard %d/%d\n", Board+1, NbBoards );
+		}
+
+		if ( CompareSparse == true )
+		{
+			Goban.ReportSparseComparison( stderr );
+		}
+
+		Goban.GameState.ReportCommitLatencies( stderr );
+		Goban.ReportBudget( stderr );
+		Goban.ReportMemoryTraffic( stderr );
+
+		if ( EventLogs[Board] != nullptr )
+		{
+			EventLogs[Board]->Close();
+			EventLogs[Board]->Report( stderr );
+		}
+	}
+
+	for ( int Board = 0; Board < NbBoards; Board++ )
+	{
+		// Ask score
+		Omiscid::SimpleString Result;
+		if ( NbBoards > 1 )
+		{
+			char Message[128];
+			snprintf( Message, sizeof(Message), "\n\nEnter game result of board %d", Board+1 );
+			CheckAndSetVariable( Result, Message, "" );
+		}
+		else
+		{
+			CheckAndSetVariable( Result, "\n\nEnter game result", "" );
+		}
 
-	// Close file
-	Goban.GameState.SGFWriter.Close(Result);
+		// Close file, game is over and can not be resumed anymore
+		Gobans[Board]->GameState.SGFWriter.Close(Result);
+		Gobans[Board]->RemoveCheckpoint();
+		delete Gobans[Board];
+		delete EventLogs[Board];
+	}
 
 	if ( ExportResultVideo == true )
 	{
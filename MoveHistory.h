@@ -0,0 +1,42 @@
+/**
+ * @file MoveHistory.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __MOVE_HISTORY_H__
+#define __MOVE_HISTORY_H__
+
+#include <System/SimpleString.h>
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+/**
+ * @class MoveHistoryNode
+ * @brief Committed event of the game (move or removal by hand) in a persistent list. Each node points to the
+ *		  previous one and is never modified: a history is a pointer to its last node and histories share
+ *		  their common beginning. Going back k events is following k pointers.
+ */
+class MoveHistoryNode
+{
+public:
+	enum EventKind { Move = 0, Removal };
+
+	int Kind;								// Move or Removal
+	int Color;								// Color of the stone played or removed
+	int a;									// Column of the event
+	int b;									// Line of the event
+	int NumMove;							// Number of moves up to this event (included)
+	Omiscid::SimpleString Comment;			// SGF comment of the move
+	std::vector<int> Captured;				// Cells captured by the move
+	uint64_t Hash;							// Zobrist hash of the position after the event
+	std::shared_ptr<const MoveHistoryNode> Previous;	// Previous event, nullptr for the first one
+};
+
+typedef std::shared_ptr<const MoveHistoryNode> MoveHistory;
+
+#endif // __MOVE_HISTORY_H__
@@ -0,0 +1,167 @@
+/**
+ * @file MoveOrderAnalyser.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "MoveOrderAnalyser.h"
+#include "StoneState.h"
+
+#include <algorithm>
+
+/**
+* @brief Constructor
+*/
+MoveOrderAnalyser::MoveOrderAnalyser() : Status(Idle)
+{
+}
+
+/**
+* @brief Virtual destructor, stop the thread
+*/
+MoveOrderAnalyser::~MoveOrderAnalyser()
+{
+	StopThread( 0 );
+}
+
+/**
+* @brief Start analysis of a request. The request is swapped with the internal one (no frame copy).
+* @param Request [in,out] Request to analyse
+* @return false if an analysis is already running or its result was not retrieved
+*/
+bool MoveOrderAnalyser::Submit( MoveOrderRequest& Request )
+{
+	if ( Status != Idle )
+	{
+		return false;
+	}
+
+	std::swap( CurrentRequest, Request );
+	Status = Working;
+	NewRequest.Signal();
+	return true;
+}
+
+/**
+* @brief Get result of the last analysis if done
+* @param Result [out] Analysed request with AppearanceTimes
+* @return true if a result was available
+*/
+bool MoveOrderAnalyser::GetResult( MoveOrderRequest& Result )
+{
+	if ( Status != Done )
+	{
+		return false;
+	}
+
+	std::swap( Result, CurrentRequest );
+	Status = Idle;
+	return true;
+}
+
+/**
+* @brief Wait for requests and analyse them
+*/
+void FUNCTION_CALL_TYPE MoveOrderAnalyser::Run()
+{
+	while ( StopPending() == false )
+	{
+		// Wake up regularly to check if we must stop
+		NewRequest.Wait( 100 );
+		if ( Status != Working )
+		{
+			continue;
+		}
+
+		Analyse();
+		Status = Done;
+	}
+}
+
+/**
+* @brief Part of the inner area of a stone with its color in a frame
+* @param Frame [in] Frame
+* @param NumCell [in] Cell in the request
+* @return Coverage between 0 and 1
+*/
+double MoveOrderAnalyser::GetCoverage( const cv::Mat& Frame, int NumCell )
+{
+	const cv::Point& Center = CurrentRequest.Centers[NumCell];
+	const cv::Size& Radius = CurrentRequest.Radius[NumCell];
+	bool SearchBlack = ( CurrentRequest.Colors[NumCell] == StoneState::Black );
+
+	// Inner part of the stone only, borders are shared with neighbours and shadows
+	double rx = std::max( 0.7*Radius.width, 1.0 );
+	double ry = std::max( 0.7*Radius.height, 1.0 );
+
+	int NbPixels = 0;
+	int NbStonePixels = 0;
+	for ( int y = std::max( Center.y-(int)ry, 0 ); y <= std::min( Center.y+(int)ry, Frame.rows-1 ); y++ )
+	{
+		const unsigned char * Line = Frame.ptr<unsigned char>( y );
+		double dy = (y-Center.y)/ry;
+		for ( int x = std::max( Center.x-(int)rx, 0 ); x <= std::min( Center.x+(int)rx, Frame.cols-1 ); x++ )
+		{
+			double dx = (x-Center.x)/rx;
+			if ( dx*dx + dy*dy > 1.0 )
+			{
+				continue;
+			}
+
+			// Same color thresholds as stone detection, on the 3 channels
+			const unsigned char * Pixel = Line + 3*x;
+			bool IsStoneColor;
+			if ( SearchBlack == true )
+			{
+				IsStoneColor = ( Pixel[0] <= CurrentRequest.HighBlackValue && Pixel[1] <= CurrentRequest.HighBlackValue && Pixel[2] <= CurrentRequest.HighBlackValue );
+			}
+			else
+			{
+				IsStoneColor = ( Pixel[0] >= CurrentRequest.LowWhiteValue && Pixel[1] >= CurrentRequest.LowWhiteValue && Pixel[2] >= CurrentRequest.LowWhiteValue );
+			}
+
+			NbPixels++;
+			if ( IsStoneColor == true )
+			{
+				NbStonePixels++;
+			}
+		}
+	}
+
+	return ( NbPixels == 0 ) ? 0.0 : (double)NbStonePixels/(double)NbPixels;
+}
+
+/**
+* @brief Compute appearance time of each cell of the current request
+*/
+void MoveOrderAnalyser::Analyse()
+{
+	size_t NbCells = CurrentRequest.Cells.size();
+	CurrentRequest.AppearanceTimes.assign( NbCells, -1.0 );
+
+	// A stone is placed at the first frame of DefaultStableFrames successive frames where it is seen.
+	// Thus arms passing over the cell or a stone put and taken back are not considered.
+	for ( size_t NumCell = 0; NumCell < NbCells; NumCell++ )
+	{
+		int NbSuccessiveFrames = 0;
+		for ( size_t NumFrame = 0; NumFrame < CurrentRequest.Frames.size(); NumFrame++ )
+		{
+			if ( GetCoverage( CurrentRequest.Frames[NumFrame], (int)NumCell ) < DefaultStoneCoverage )
+			{
+				NbSuccessiveFrames = 0;
+				continue;
+			}
+
+			NbSuccessiveFrames++;
+			if ( NbSuccessiveFrames == DefaultStableFrames )
+			{
+				CurrentRequest.AppearanceTimes[NumCell] = CurrentRequest.Timestamps[NumFrame+1-DefaultStableFrames];
+				break;
+			}
+		}
+	}
+
+	// Frames are not needed anymore
+	CurrentRequest.Frames.clear();
+}
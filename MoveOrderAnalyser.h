@@ -0,0 +1,111 @@
+/**
+ * @file MoveOrderAnalyser.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __MOVE_ORDER_ANALYSER_H__
+#define __MOVE_ORDER_ANALYSER_H__
+
+#include <System/Thread.h>
+#include <System/Event.h>
+
+#include "Go-CamRecorder.h"
+
+#include <atomic>
+#include <vector>
+
+#define DefaultStableFrames 3				// Number of successive frames a stone must be seen to be considered as placed
+#define DefaultStoneCoverage 0.5			// Part of the inner stone area that must have the stone color
+
+/**
+ * @class MoveOrderRequest
+ * @brief Frames and cells to analyse to find when each stone appeared
+ */
+class MoveOrderRequest
+{
+public:
+	int FirstMove = 0;							// First move concerned by the analysis
+	std::vector<cv::Mat> Frames;				// Frames of the window, oldest first
+	std::vector<double> Timestamps;				// Timestamp of each frame
+	std::vector<int> Cells;						// Cells to analyse
+	std::vector<int> Colors;					// Stone color on each cell
+	std::vector<cv::Point> Centers;				// Center of each cell in the frames
+	std::vector<cv::Size> Radius;				// Radius of each stone in the frames
+	int HighBlackValue = 0;						// Upper bound of black detection
+	int LowWhiteValue = 255;					// Lower bound of white detection
+
+	// Result
+	std::vector<double> AppearanceTimes;		// First timestamp of each stone, -1.0 if not seen
+};
+
+/**
+ * @class MoveOrderAnalyser
+ * @brief Background thread re-analysing recorded frames frame by frame to find the order in which stones
+ *		  appeared. It handles one request at a time, the processing thread submits and polls the result.
+ */
+class MoveOrderAnalyser : public Omiscid::Thread
+{
+public:
+	/**
+    * @brief Constructor
+	*/
+	MoveOrderAnalyser();
+
+	/**
+    * @brief Virtual destructor, stop the thread
+	*/
+	virtual ~MoveOrderAnalyser();
+
+	/**
+    * @brief Start analysis of a request. The request is swapped with the internal one (no frame copy).
+    * @param Request [in,out] Request to analyse
+    * @return false if an analysis is already running or its result was not retrieved
+	*/
+	bool Submit( MoveOrderRequest& Request );
+
+	/**
+    * @brief Get result of the last analysis if done
+    * @param Result [out] Analysed request with AppearanceTimes
+    * @return true if a result was available
+	*/
+	bool GetResult( MoveOrderRequest& Result );
+
+	/**
+    * @brief Is the analyser waiting for a request?
+    * @return true if idle
+	*/
+	inline bool IsIdle() const
+	{
+		return ( Status == Idle );
+	}
+
+protected:
+	enum { Idle = 0, Working, Done };
+
+	/**
+    * @brief Wait for requests and analyse them
+	*/
+	virtual void FUNCTION_CALL_TYPE Run();
+
+	/**
+    * @brief Compute appearance time of each cell of the current request
+	*/
+	void Analyse();
+
+	/**
+    * @brief Part of the inner area of a stone with its color in a frame
+    * @param Frame [in] Frame
+    * @param NumCell [in] Cell in the request
+    * @return Coverage between 0 and 1
+	*/
+	double GetCoverage( const cv::Mat& Frame, int NumCell );
+
+	MoveOrderRequest CurrentRequest;			// Request being analysed
+	std::atomic<int> Status;					// Idle, Working or Done
+	Omiscid::Event NewRequest;					// Signaled when a request is submitted
+};
+
+#endif // __MOVE_ORDER_ANALYSER_H__
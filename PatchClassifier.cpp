@@ -0,0 +1,319 @@
+/**
+ * @file PatchClassifier.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "PatchClassifier.h"
+
+#include <string.h>
+#include <math.h>
+
+/**
+* @brief Constructor
+*/
+PatchClassifier::PatchClassifier()
+{
+}
+
+/**
+* @brief Load model (float weights) and quantise it
+* @param FileName [in] Model file (OpenCV FileStorage format)
+* @return true if the model was loaded
+*/
+bool PatchClassifier::Load( const char * FileName )
+{
+	cv::FileStorage fs;
+	if ( fs.open( FileName, cv::FileStorage::READ ) == false )
+	{
+		fprintf( stderr, "Could not open classifier model '%s'\n", FileName );
+		return false;
+	}
+
+	int ModelPatchSize = 0;
+	cv::Mat _W1, _b1, _W2, _b2;
+	fs["PatchSize"] >> ModelPatchSize;
+	fs["W1"] >> _W1;
+	fs["b1"] >> _b1;
+	fs["W2"] >> _W2;
+	fs["b2"] >> _b2;
+	fs.release();
+
+	if ( ModelPatchSize != PatchSize || _W1.cols != PatchFeatures || _b1.total() != (size_t)_W1.rows )
+	{
+		fprintf( stderr, "Bad classifier model in '%s'\n", FileName );
+		return false;
+	}
+
+	if ( (_W2.empty() == true && _W1.rows != NbClasses) || (_W2.empty() == false && (_W2.rows != NbClasses || _W2.cols != _W1.rows)) )
+	{
+		fprintf( stderr, "Bad classifier model in '%s'\n", FileName );
+		return false;
+	}
+
+	SetModel( _W1, _b1, _W2, _b2 );
+	return true;
+}
+
+/**
+* @brief Save float model
+* @param FileName [in] Model file (OpenCV FileStorage format)
+* @return true if the model was saved
+*/
+bool PatchClassifier::Save( const char * FileName )
+{
+	cv::FileStorage fs;
+	if ( fs.open( FileName, cv::FileStorage::WRITE ) == false )
+	{
+		fprintf( stderr, "Could not create classifier model '%s'\n", FileName );
+		return false;
+	}
+
+	fs << "PatchSize" << PatchSize;
+	fs << "W1" << W1;
+	fs << "b1" << b1;
+	fs << "W2" << W2;
+	fs << "b2" << b2;
+	fs.release();
+
+	return true;
+}
+
+/**
+* @brief Set float model and quantise it (used by the training tool)
+* @param _W1 [in] Weights of first layer (NbHidden x PatchFeatures or NbClasses x PatchFeatures if linear), CV_32F
+* @param _b1 [in] Bias of first layer (1 row), CV_32F
+* @param _W2 [in] Weights of second layer (NbClasses x NbHidden), empty for a linear model
+* @param _b2 [in] Bias of second layer (1 row), empty for a linear model
+*/
+void PatchClassifier::SetModel( const cv::Mat& _W1, const cv::Mat& _b1, const cv::Mat& _W2, const cv::Mat& _b2 )
+{
+	_W1.convertTo( W1, CV_32F );
+	_b1.reshape( 1, 1 ).convertTo( b1, CV_32F );
+
+	if ( _W2.empty() == true )
+	{
+		W2.release();
+		b2.release();
+	}
+	else
+	{
+		_W2.convertTo( W2, CV_32F );
+		_b2.reshape( 1, 1 ).convertTo( b2, CV_32F );
+	}
+
+	Quantise();
+}
+
+/**
+* @brief Quantise first layer to int8
+*/
+void PatchClassifier::Quantise()
+{
+	W1Quantised = cv::Mat( W1.rows, W1.cols, CV_8SC1 );
+	W1Scale.resize( W1.rows );
+
+	for ( int Output = 0; Output < W1.rows; Output++ )
+	{
+		const float * Weights = W1.ptr<float>( Output );
+
+		// Symmetric quantisation, one scale per output
+		float MaxAbs = 0.0f;
+		for ( int Feature = 0; Feature < W1.cols; Feature++ )
+		{
+			MaxAbs = std::max( MaxAbs, (float)fabs( Weights[Feature] ) );
+		}
+
+		float Scale = ( MaxAbs > 0.0f ) ? MaxAbs/127.0f : 1.0f;
+		W1Scale[Output] = Scale;
+
+		signed char * QWeights = W1Quantised.ptr<signed char>( Output );
+		for ( int Feature = 0; Feature < W1.cols; Feature++ )
+		{
+			QWeights[Feature] = (signed char)cvRound( Weights[Feature]/Scale );
+		}
+	}
+}
+
+/**
+* @brief Extract a patch from an image area into a row of the batch
+* @param Image [in] Color image
+* @param Area [in] Area of the cell in the image
+* @param Batch [in,out] Batch of patches (one row per cell, PatchFeatures columns, CV_8UC1)
+* @param Row [in] Row of the patch in the batch
+*/
+void PatchClassifier::ExtractPatch( cv::Mat& Image, const cv::Rect& Area, cv::Mat& Batch, int Row )
+{
+	// Patch is a view on the batch row, resize will write directly in it
+	cv::Mat Patch( PatchSize, PatchSize, CV_8UC3, Batch.ptr<unsigned char>( Row ) );
+	cv::resize( cv::Mat( Image, Area ), Patch, Patch.size(), 0.0, 0.0, cv::INTER_AREA );
+}
+
+/**
+* @brief Compute class scores of all patches using the quantised model
+* @param Batch [in] Batch of patches (one row per patch, PatchFeatures columns, CV_8UC1)
+* @param Scores [out] Scores (one row per patch, NbClasses columns, CV_32F)
+*/
+void PatchClassifier::ComputeScores( const cv::Mat& Batch, cv::Mat& Scores )
+{
+	const int NbPatches = Batch.rows;
+	const int NbOutputs = W1Quantised.rows;
+
+	// First layer: one int8 matrix multiply for all patches, pixels are centered on 0 ([-128, 127])
+	Accumulators.create( NbPatches, NbOutputs, CV_32SC1 );
+	for ( int Patch = 0; Patch < NbPatches; Patch++ )
+	{
+		const unsigned char * Features = Batch.ptr<unsigned char>( Patch );
+		int * Acc = Accumulators.ptr<int>( Patch );
+		for ( int Output = 0; Output < NbOutputs; Output++ )
+		{
+			const signed char * QWeights = W1Quantised.ptr<signed char>( Output );
+			int Sum = 0;
+			for ( int Feature = 0; Feature < PatchFeatures; Feature++ )
+			{
+				Sum += ((int)Features[Feature]-128)*(int)QWeights[Feature];
+			}
+			Acc[Output] = Sum;
+		}
+	}
+
+	// Back to float, features were scaled by 1/128 during training
+	cv::Mat& FirstLayer = W2.empty() ? Scores : Hidden;
+	FirstLayer.create( NbPatches, NbOutputs, CV_32FC1 );
+	const float * Bias1 = b1.ptr<float>( 0 );
+	for ( int Patch = 0; Patch < NbPatches; Patch++ )
+	{
+		const int * Acc = Accumulators.ptr<int>( Patch );
+		float * Out = FirstLayer.ptr<float>( Patch );
+		for ( int Output = 0; Output < NbOutputs; Output++ )
+		{
+			Out[Output] = (float)Acc[Output]*W1Scale[Output]/128.0f + Bias1[Output];
+		}
+	}
+
+	if ( W2.empty() == true )
+	{
+		// Linear model
+		return;
+	}
+
+	// MLP: ReLU, then small float layer
+	Scores.create( NbPatches, NbClasses, CV_32FC1 );
+	const float * Bias2 = b2.ptr<float>( 0 );
+	for ( int Patch = 0; Patch < NbPatches; Patch++ )
+	{
+		const float * H = Hidden.ptr<float>( Patch );
+		float * Out = Scores.ptr<float>( Patch );
+		for ( int Class = 0; Class < NbClasses; Class++ )
+		{
+			const float * Weights = W2.ptr<float>( Class );
+			float Sum = Bias2[Class];
+			for ( int Output = 0; Output < NbOutputs; Output++ )
+			{
+				Sum += std::max( H[Output], 0.0f )*Weights[Output];
+			}
+			Out[Class] = Sum;
+		}
+	}
+}
+
+/**
+* @brief Classify all patches using the quantised model
+* @param Batch [in] Batch of patches (one row per patch, PatchFeatures columns, CV_8UC1)
+* @param Classes [out] Class of each patch (White, Black or Empty)
+*/
+void PatchClassifier::Classify( const cv::Mat& Batch, std::vector<int>& Classes )
+{
+	ComputeScores( Batch, BatchScores );
+
+	Classes.resize( Batch.rows );
+	for ( int Patch = 0; Patch < Batch.rows; Patch++ )
+	{
+		const float * Out = BatchScores.ptr<float>( Patch );
+		int BestClass = 0;
+		for ( int Class = 1; Class < NbClasses; Class++ )
+		{
+			if ( Out[Class] > Out[BestClass] )
+			{
+				BestClass = Class;
+			}
+		}
+		Classes[Patch] = BestClass;
+	}
+}
+
+/**
+* @brief Append labelled patches to a dump file (to train a model)
+* @param fout [in] Dump file, opened in binary mode
+* @param Batch [in] Batch of patches
+* @param Labels [in] Label of each patch, patches with a negative label are skipped
+* @return Number of written patches
+*/
+int PatchClassifier::AppendToDump( FILE * fout, const cv::Mat& Batch, const std::vector<int>& Labels )
+{
+	if ( ftell( fout ) == 0 )
+	{
+		// New file, write signature
+		fwrite( PatchDumpSignature, 1, strlen(PatchDumpSignature), fout );
+	}
+
+	int NbWritten = 0;
+	for ( int Patch = 0; Patch < Batch.rows && Patch < (int)Labels.size(); Patch++ )
+	{
+		if ( Labels[Patch] < 0 )
+		{
+			continue;
+		}
+
+		// One byte for label, then the patch
+		unsigned char Label = (unsigned char)Labels[Patch];
+		fwrite( &Label, 1, 1, fout );
+		fwrite( Batch.ptr<unsigned char>( Patch ), 1, PatchFeatures, fout );
+		NbWritten++;
+	}
+
+	return NbWritten;
+}
+
+/**
+* @brief Read all labelled patches from a dump file
+* @param FileName [in] Dump file
+* @param Batch [in,out] Patches are appended to this batch
+* @param Labels [in,out] Labels are appended to this vector
+* @return true if the file was read
+*/
+bool PatchClassifier::ReadDump( const char * FileName, cv::Mat& Batch, std::vector<int>& Labels )
+{
+	FILE * fin = fopen( FileName, "rb" );
+	if ( fin == nullptr )
+	{
+		fprintf( stderr, "Could not open patch file '%s'\n", FileName );
+		return false;
+	}
+
+	char Signature[16];
+	size_t SignatureLength = strlen(PatchDumpSignature);
+	if ( fread( Signature, 1, SignatureLength, fin ) != SignatureLength || memcmp( Signature, PatchDumpSignature, SignatureLength ) != 0 )
+	{
+		fprintf( stderr, "Bad patch file '%s'\n", FileName );
+		fclose( fin );
+		return false;
+	}
+
+	cv::Mat Patch( 1, PatchFeatures, CV_8UC1 );
+	unsigned char Label;
+	while ( fread( &Label, 1, 1, fin ) == 1 && fread( Patch.ptr<unsigned char>( 0 ), 1, PatchFeatures, fin ) == PatchFeatures )
+	{
+		if ( Label >= NbClasses )
+		{
+			continue;
+		}
+
+		Batch.push_back( Patch );
+		Labels.push_back( (int)Label );
+	}
+
+	fclose( fin );
+	return true;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file PatchClassifier.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __PATCH_CLASSIFIER_H__
+#define __PATCH_CLASSIFIER_H__
+
+// Only OpenCV here, this class is also used by the training tool
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <vector>
+#include <stdio.h>
+
+#include "StoneState.h"
+
+#define PatchSize 8											// Patches are downsampled to PatchSize x PatchSize
+#define PatchChannels 3										// Color patches (BGR)
+#define PatchFeatures (PatchSize*PatchSize*PatchChannels)	// Number of values in a patch
+#define PatchDumpSignature "GoPatch1"						// Signature of patch dump files
+
+/**
+ * @class PatchClassifier
+ * @brief Classify all cell patches of the goban as White, Black or Empty (StoneState values) at once.
+ *		  Patches are stored as rows of one contiguous batch and the model (linear, or MLP with one hidden layer)
+ *		  is evaluated as one matrix multiply with int8 quantised weights for the first layer.
+ */
+class PatchClassifier : public StoneState
+{
+public:
+	enum { NbClasses = 3 };				// White, Black, Empty
+
+	/**
+    * @brief Constructor
+	*/
+	PatchClassifier();
+
+	/**
+    * @brief Virtual destructor
+	*/
+	virtual ~PatchClassifier() {}
+
+	/**
+    * @brief Is a model loaded?
+    * @return true if the classifier can be used
+	*/
+	inline bool IsLoaded()
+	{
+		return ( W1.empty() == false );
+	}
+
+	/**
+    * @brief Load model (float weights) and quantise it
+    * @param FileName [in] Model file (OpenCV FileStorage format)
+    * @return true if the model was loaded
+	*/
+	bool Load( const char * FileName );
+
+	/**
+    * @brief Save float model
+    * @param FileName [in] Model file (OpenCV FileStorage format)
+    * @return true if the model was saved
+	*/
+	bool Save( const char * FileName );
+
+	/**
+    * @brief Set float model and quantise it (used by the training tool)
+    * @param _W1 [in] Weights of first layer (NbHidden x PatchFeatures or NbClasses x PatchFeatures if linear), CV_32F
+    * @param _b1 [in] Bias of first layer (1 row), CV_32F
+    * @param _W2 [in] Weights of second layer (NbClasses x NbHidden), empty for a linear model
+    * @param _b2 [in] Bias of second layer (1 row), empty for a linear model
+	*/
+	void SetModel( const cv::Mat& _W1, const cv::Mat& _b1, const cv::Mat& _W2, const cv::Mat& _b2 );
+
+	/**
+    * @brief Extract a patch from an image area into a row of the batch
+    * @param Image [in] Color image
+    * @param Area [in] Area of the cell in the image
+    * @param Batch [in,out] Batch of patches (one row per cell, PatchFeatures columns, CV_8UC1)
+    * @param Row [in] Row of the patch in the batch
+	*/
+	static void ExtractPatch( cv::Mat& Image, const cv::Rect& Area, cv::Mat& Batch, int Row );
+
+	/**
+    * @brief Compute class scores of all patches using the quantised model
+    * @param Batch [in] Batch of patches (one row per patch, PatchFeatures columns, CV_8UC1)
+    * @param Scores [out] Scores (one row per patch, NbClasses columns, CV_32F)
+	*/
+	void ComputeScores( const cv::Mat& Batch, cv::Mat& Scores );
+
+	/**
+    * @brief Classify all patches using the quantised model
+    * @param Batch [in] Batch of patches (one row per patch, PatchFeatures columns, CV_8UC1)
+    * @param Classes [out] Class of each patch (White, Black or Empty)
+	*/
+	void Classify( const cv::Mat& Batch, std::vector<int>& Classes );
+
+	/**
+    * @brief Append labelled patches to a dump file (to train a model)
+    * @param fout [in] Dump file, opened in binary mode
+    * @param Batch [in] Batch of patches
+    * @param Labels [in] Label of each patch, patches with a negative label are skipped
+    * @return Number of written patches
+	*/
+	static int AppendToDump( FILE * fout, const cv::Mat& Batch, const std::vector<int>& Labels );
+
+	/**
+    * @brief Read all labelled patches from a dump file
+    * @param FileName [in] Dump file
+    * @param Batch [in,out] Patches are appended to this batch
+    * @param Labels [in,out] Labels are appended to this vector
+    * @return true if the file was read
+	*/
+	static bool ReadDump( const char * FileName, cv::Mat& Batch, std::vector<int>& Labels );
+
+protected:
+	// Float model
+	cv::Mat W1;							// First layer weights
+	cv::Mat b1;							// First layer bias
+	cv::Mat W2;							// Second layer weights (empty for linear model)
+	cv::Mat b2;							// Second layer bias
+
+	// Quantised first layer
+	cv::Mat W1Quantised;				// int8 weights, CV_8SC1
+	std::vector<float> W1Scale;			// Scale of each output of the first layer
+
+	cv::Mat Accumulators;				// int32 accumulators of the first layer (kept to prevent allocations)
+	cv::Mat Hidden;						// Hidden layer values
+	cv::Mat BatchScores;				// Scores computed by Classify (kept to prevent allocations)
+
+	/**
+    * @brief Quantise first layer to int8
+	*/
+	void Quantise();
+};
+
+#endif // __PATCH_CLASSIFIER_H__
@@ -0,0 +1,218 @@
+/**
+ * @file PendingEventQueue.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "PendingEventQueue.h"
+
+/**
+* @brief Constructor
+* @param NbCells [in] Number of cells of the goban
+*/
+PendingEventQueue::PendingEventQueue( int NbCells ) : HeapPos(NbCells, -1), Pushed(NbCells, false)
+{
+	Heap.reserve( NbCells );
+	PushedCells.reserve( NbCells );
+}
+
+/**
+* @brief Remove all events
+*/
+void PendingEventQueue::Clear()
+{
+	Omiscid::SmartLocker SL_ProtectQueue( ProtectQueue );
+
+	for ( size_t Pos = 0; Pos < Heap.size(); Pos++ )
+	{
+		HeapPos[Heap[Pos].Cell] = -1;
+	}
+	Heap.clear();
+}
+
+/**
+* @brief Add an event or move it to a new timestamp. Thread safe, detectors are processed in parallel.
+* @param Cell [in] Cell of the event
+* @param Timestamp [in] Timestamp of the event
+*/
+void PendingEventQueue::Push( int Cell, double Timestamp )
+{
+	Omiscid::SmartLocker SL_ProtectQueue( ProtectQueue );
+
+	Event NewEvent;
+	NewEvent.Timestamp = Timestamp;
+	NewEvent.Cell = Cell;
+
+	if ( Pushed[Cell] == false )
+	{
+		Pushed[Cell] = true;
+		PushedCells.push_back( Cell );
+	}
+
+	if ( HeapPos[Cell] >= 0 )
+	{
+		// Already pending, move it to its new place
+		size_t Pos = (size_t)HeapPos[Cell];
+		Place( Pos, NewEvent );
+		SiftUp( Pos );
+		SiftDown( (size_t)HeapPos[Cell] );
+		return;
+	}
+
+	Heap.push_back( NewEvent );
+	Place( Heap.size()-1, NewEvent );
+	SiftUp( Heap.size()-1 );
+}
+
+/**
+* @brief Take the oldest event out of the queue
+* @return Cell of the oldest event (-1 if the queue is empty)
+*/
+int PendingEventQueue::Pop()
+{
+	Omiscid::SmartLocker SL_ProtectQueue( ProtectQueue );
+
+	if ( Heap.empty() == true )
+	{
+		return -1;
+	}
+
+	int Cell = Heap[0].Cell;
+	RemoveAt( 0 );
+	return Cell;
+}
+
+/**
+* @brief Remove the event of a cell if any
+* @param Cell [in] Cell to remove
+*/
+void PendingEventQueue::Remove( int Cell )
+{
+	Omiscid::SmartLocker SL_ProtectQueue( ProtectQueue );
+
+	if ( HeapPos[Cell] >= 0 )
+	{
+		RemoveAt( (size_t)HeapPos[Cell] );
+	}
+}
+
+/**
+* @brief Get cells of events not younger than a timestamp, without taking them out of the queue.
+*		 Subtrees of younger events are not visited: cost is O(number of returned cells).
+* @param MaxTimestamp [in] Timestamp of the youngest event to return
+* @param Cells [out] Cells of these events, not ordered (capacity must be the number of cells)
+*/
+void PendingEventQueue::GetCellsOlderThan( double MaxTimestamp, std::vector<int>& Cells )
+{
+	Omiscid::SmartLocker SL_ProtectQueue( ProtectQueue );
+
+	// Breadth first walk of the heap storing positions, children of a younger event are younger
+	Cells.clear();
+	if ( Heap.empty() == false && Heap[0].Timestamp <= MaxTimestamp )
+	{
+		Cells.push_back( 0 );
+	}
+	for ( size_t Pos = 0; Pos < Cells.size(); Pos++ )
+	{
+		size_t Child = 2*(size_t)Cells[Pos]+1;
+		for ( size_t LastChild = Child+1; Child <= LastChild && Child < Heap.size(); Child++ )
+		{
+			if ( Heap[Child].Timestamp <= MaxTimestamp )
+			{
+				Cells.push_back( (int)Child );
+			}
+		}
+	}
+
+	// Positions to cells
+	for ( size_t Pos = 0; Pos < Cells.size(); Pos++ )
+	{
+		Cells[Pos] = Heap[Cells[Pos]].Cell;
+	}
+}
+
+/**
+* @brief Get cells pushed since the last call, each one once
+* @param Cells [out] Pushed cells (capacity must be the number of cells)
+*/
+void PendingEventQueue::TakePushedCells( std::vector<int>& Cells )
+{
+	Omiscid::SmartLocker SL_ProtectQueue( ProtectQueue );
+
+	Cells.assign( PushedCells.begin(), PushedCells.end() );
+	PushedCells.clear();
+	for ( size_t Pos = 0; Pos < Cells.size(); Pos++ )
+	{
+		Pushed[Cells[Pos]] = false;
+	}
+}
+
+/**
+* @brief Remove the event at a position of the heap (without lock)
+* @param Pos [in] Position of the event in the heap
+*/
+void PendingEventQueue::RemoveAt( size_t Pos )
+{
+	HeapPos[Heap[Pos].Cell] = -1;
+
+	// Last event takes the place of the removed one
+	Event LastEvent = Heap.back();
+	Heap.pop_back();
+	if ( Pos == Heap.size() )
+	{
+		return;
+	}
+
+	Place( Pos, LastEvent );
+	SiftUp( Pos );
+	SiftDown( (size_t)HeapPos[LastEvent.Cell] );
+}
+
+/**
+* @brief Move an event to its place toward the top of the heap
+* @param Pos [in] Position of the event in the heap
+*/
+void PendingEventQueue::SiftUp( size_t Pos )
+{
+	Event CurEvent = Heap[Pos];
+	while ( Pos > 0 )
+	{
+		size_t Parent = (Pos-1)/2;
+		if ( IsOlder( CurEvent, Heap[Parent] ) == false )
+		{
+			break;
+		}
+		Place( Pos, Heap[Parent] );
+		Pos = Parent;
+	}
+	Place( Pos, CurEvent );
+}
+
+/**
+* @brief Move an event to its place toward the bottom of the heap
+* @param Pos [in] Position of the event in the heap
+*/
+void PendingEventQueue::SiftDown( size_t Pos )
+{
+	Event CurEvent = Heap[Pos];
+	for(;;)
+	{
+		size_t Child = 2*Pos+1;
+		if ( Child >= Heap.size() )
+		{
+			break;
+		}
+		if ( Child+1 < Heap.size() && IsOlder( Heap[Child+1], Heap[Child] ) )
+		{
+			Child++;
+		}
+		if ( IsOlder( Heap[Child], CurEvent ) == false )
+		{
+			break;
+		}
+		Place( Pos, Heap[Child] );
+		Pos = Child;
+	}
+	Place( Pos, CurEvent );
+}
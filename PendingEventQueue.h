@@ -0,0 +1,147 @@
+/**
+ * @file PendingEventQueue.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __PENDING_EVENT_QUEUE_H__
+#define __PENDING_EVENT_QUEUE_H__
+
+#include <System/Mutex.h>
+
+#include <stddef.h>
+#include <vector>
+
+/**
+ * @class PendingEventQueue
+ * @brief Cells with a detected state change not handled yet, ordered by event timestamp (oldest first).
+ *		  Indexed binary heap: a cell is at most once in the queue, pushing it again moves it to its new
+ *		  timestamp. Events of the same timestamp come in cell order. Push, Pop and Remove are O(log n).
+ *		  Cells pushed since the last call to TakePushedCells are recorded for incremental updates.
+ *		  Memory is allocated in the constructor only.
+ */
+class PendingEventQueue
+{
+public:
+	/**
+    * @brief Constructor
+    * @param NbCells [in] Number of cells of the goban
+	*/
+	PendingEventQueue( int NbCells );
+
+	/**
+    * @brief Remove all events
+	*/
+	void Clear();
+
+	/**
+    * @brief Is there any pending event?
+    * @return true if the queue is empty
+	*/
+	inline bool IsEmpty() const
+	{
+		return Heap.empty();
+	}
+
+	/**
+    * @brief Number of pending events
+    * @return Number of cells in the queue
+	*/
+	inline size_t GetSize() const
+	{
+		return Heap.size();
+	}
+
+	/**
+    * @brief Add an event or move it to a new timestamp. Thread safe, detectors are processed in parallel.
+    * @param Cell [in] Cell of the event
+    * @param Timestamp [in] Timestamp of the event
+	*/
+	void Push( int Cell, double Timestamp );
+
+	/**
+    * @brief Take the oldest event out of the queue
+    * @return Cell of the oldest event (-1 if the queue is empty)
+	*/
+	int Pop();
+
+	/**
+    * @brief Remove the event of a cell if any
+    * @param Cell [in] Cell to remove
+	*/
+	void Remove( int Cell );
+
+	/**
+    * @brief Get cells of events not younger than a timestamp, without taking them out of the queue.
+    *		  Subtrees of younger events are not visited: cost is O(number of returned cells).
+    * @param MaxTimestamp [in] Timestamp of the youngest event to return
+    * @param Cells [out] Cells of these events, not ordered (capacity must be the number of cells)
+	*/
+	void GetCellsOlderThan( double MaxTimestamp, std::vector<int>& Cells );
+
+	/**
+    * @brief Get cells pushed since the last call, each one once
+    * @param Cells [out] Pushed cells (capacity must be the number of cells)
+	*/
+	void TakePushedCells( std::vector<int>& Cells );
+
+protected:
+	class Event
+	{
+	public:
+		double Timestamp;		// Timestamp of the event
+		int Cell;				// Cell of the event
+	};
+
+	/**
+    * @brief Order of events in the heap
+    * @return true if event e1 must be handled before e2
+	*/
+	inline bool IsOlder( const Event& e1, const Event& e2 ) const
+	{
+		if ( e1.Timestamp != e2.Timestamp )
+		{
+			return ( e1.Timestamp < e2.Timestamp );
+		}
+		return ( e1.Cell < e2.Cell );
+	}
+
+	/**
+    * @brief Move an event to its place toward the top of the heap
+    * @param Pos [in] Position of the event in the heap
+	*/
+	void SiftUp( size_t Pos );
+
+	/**
+    * @brief Move an event to its place toward the bottom of the heap
+    * @param Pos [in] Position of the event in the heap
+	*/
+	void SiftDown( size_t Pos );
+
+	/**
+    * @brief Remove the event at a position of the heap (without lock)
+    * @param Pos [in] Position of the event in the heap
+	*/
+	void RemoveAt( size_t Pos );
+
+	/**
+    * @brief Put an event at a position of the heap and update its index
+    * @param Pos [in] Position in the heap
+    * @param CurEvent [in] Event
+	*/
+	inline void Place( size_t Pos, const Event& CurEvent )
+	{
+		Heap[Pos] = CurEvent;
+		HeapPos[CurEvent.Cell] = (int)Pos;
+	}
+
+	std::vector<Event> Heap;				// Binary heap of events, oldest first
+	std::vector<int> HeapPos;				// Position of each cell in the heap, -1 if not pending
+	std::vector<int> PushedCells;			// Cells pushed since the last call to TakePushedCells
+	std::vector<unsigned char> Pushed;		// Is each cell in PushedCells?
+	Omiscid::Mutex ProtectQueue;			// Mutex for multithreading access to the queue
+};
+
+#endif // __PENDING_EVENT_QUEUE_H__
@@ -6,6 +6,17 @@
  */
 
 #include "SGFGenerator.h"
+#include "Checkpoint.h"
+
+#include <string.h>
+
+#ifdef OMISCID_ON_WINDOWS
+	#include <io.h>
+	#define TruncateFile( File, Length ) _chsize( _fileno( File ), Length )
+#else
+	#include <unistd.h>
+	#define TruncateFile( File, Length ) ftruncate( fileno( File ), Length )
+#endif
 
 /**
 * @brief Open a new SGF file in a Folder. File name is generated with date, time and a random number to autorized multiple instance to run at the same time
@@ -60,16 +71,18 @@ bool SGFGenerator::Open( Omiscid::SimpleString Folder, Omiscid::SimpleString& Ev
 	setbuf( fout, NULL );
 
 	// Generate SGF Header
-	FileContent = GenerateSGFHeader( NumCells, FileName, Event, Round, Rule, Komi, Date, BlackPlayerName, WhitePlayerName );
+	FileContent = GenerateSGFHeader( NumColumns, NumLines, FileName, Event, Round, Rule, Komi, Date, BlackPlayerName, WhitePlayerName );
 
 	// Write header of the file, need to check variation code for ST
 	fprintf( fout, "%s\n", FileContent.GetStr() );
 
 	// Init upload (if upload server and URL are not define, this call is effectless)
-	OnlineUploader.InitDistantSGF( NumCells, FileName, FileContent );
+	OnlineUploader.InitDistantSGF( NumColumns, NumLines, FileName, FileContent );
 
 	// FileContent must now have a '\n', maybe be done in a better way
 	FileContent += '\n';
+	MoveFileOffsets.clear();
+	MoveContentOffsets.clear();
 
 	return true;
 }
@@ -85,7 +98,7 @@ bool SGFGenerator::Open( Omiscid::SimpleString Folder, Omiscid::SimpleString& Ev
 */
 bool SGFGenerator::AddMove( int Color, int Col, int Row, Omiscid::SimpleString Comment /* = "" */ )
 {
-	if ( fout == nullptr || Col >= NumCells || Row >= NumCells )
+	if ( fout == nullptr || Col >= NumColumns || Row >= NumLines )
 	{
 		return false;
 	}
@@ -107,6 +120,10 @@ bool SGFGenerator::AddMove( int Color, int Col, int Row, Omiscid::SimpleString C
 	// Add current move (and comment) to the file and later to the file content
 
 
+	// Keep place of the move to rewrite the end of the file if needed
+	MoveFileOffsets.push_back( ftell( fout ) );
+	MoveContentOffsets.push_back( FileContent.GetLength() );
+
 	// Print current move in file
 	fprintf( fout, "%s\n", CurrentMove.GetStr() );
 
@@ -119,6 +136,120 @@ bool SGFGenerator::AddMove( int Color, int Col, int Row, Omiscid::SimpleString C
 	return true;
 }
 
+/**
+* @brief Remove moves at the end of the SGF file, the file is truncated after the last kept move.
+* @param NbMoves [in] Number of moves to keep
+* @return true if moves have been removed.
+*/
+bool SGFGenerator::TruncateMoves( int NbMoves )
+{
+	if ( fout == nullptr || NbMoves < 0 || NbMoves >= GetNbMoves() )
+	{
+		return false;
+	}
+
+	// Only the end of the file is rewritten, next moves are written from here
+	if ( TruncateFile( fout, MoveFileOffsets[NbMoves] ) != 0 )
+	{
+		fprintf( stderr, "Unable to truncate SGF file '%s'\n", SGFFileName.GetStr() );
+		return false;
+	}
+	fseek( fout, MoveFileOffsets[NbMoves], SEEK_SET );
+
+	FileContent = FileContent.SubString( 0, MoveContentOffsets[NbMoves] );
+	MoveFileOffsets.resize( NbMoves );
+	MoveContentOffsets.resize( NbMoves );
+
+	// Same on the distant SGF (if configured)
+	OnlineUploader.TruncateMoves( NbMoves );
+
+	return true;
+}
+
+/**
+* @brief Save file name, offsets of moves and upload version in a checkpoint
+* @param Checkpoint [in] Checkpoint being written
+*/
+void SGFGenerator::SaveCheckpoint( BinaryCheckpoint& Checkpoint )
+{
+	// The file is not buffered, its content is FileContent. Only offsets are needed to read it back.
+	Checkpoint.WriteString( SGFFileName );
+	Checkpoint.WriteValue( (int64_t)FileContent.GetLength() );
+	Checkpoint.WriteVector( MoveFileOffsets );
+	Checkpoint.WriteValue( (int32_t)OnlineUploader.GetVersion() );
+}
+
+/**
+* @brief Reopen the SGF file saved by SaveCheckpoint to continue it. Moves written after the checkpoint
+*		 are removed, they are still on the goban and will be detected again.
+* @param Checkpoint [in] Checkpoint being read
+* @return true if the SGF file could be reopened.
+*/
+bool SGFGenerator::Resume( BinaryCheckpoint& Checkpoint )
+{
+	Omiscid::SimpleString SavedFileName;
+	int64_t FileLength = 0;
+	std::vector<long> SavedOffsets;
+	int32_t UploadVersion = 0;
+
+	Checkpoint.ReadString( SavedFileName );
+	Checkpoint.ReadValue( FileLength );
+	Checkpoint.ReadVector( SavedOffsets );
+	Checkpoint.ReadValue( UploadVersion );
+	if ( Checkpoint.IsValid() == false || FileLength <= 0 )
+	{
+		return false;
+	}
+
+	for ( size_t Pos = 0; Pos < SavedOffsets.size(); Pos++ )
+	{
+		if ( SavedOffsets[Pos] <= 0 || SavedOffsets[Pos] >= FileLength || (Pos > 0 && SavedOffsets[Pos] <= SavedOffsets[Pos-1]) )
+		{
+			return false;
+		}
+	}
+
+	fout = fopen( SavedFileName.GetStr(), "r+b" );
+	if ( fout == nullptr )
+	{
+		fprintf( stderr, "Unable to reopen SGF file '%s'\n", SavedFileName.GetStr() );
+		return false;
+	}
+	setbuf( fout, NULL );
+	SGFFileName = SavedFileName;
+
+	// Read back the content known by the checkpoint
+	std::vector<char> Buffer( (size_t)FileLength+1, '\0' );
+	if ( fread( &Buffer[0], 1, (size_t)FileLength, fout ) != (size_t)FileLength || TruncateFile( fout, (long)FileLength ) != 0 )
+	{
+		fprintf( stderr, "SGF file '%s' does not match the checkpoint\n", SGFFileName.GetStr() );
+		fclose( fout );
+		fout = nullptr;
+		return false;
+	}
+	fseek( fout, (long)FileLength, SEEK_SET );
+
+	FileContent = &Buffer[0];
+	MoveFileOffsets = SavedOffsets;
+	MoveContentOffsets.assign( SavedOffsets.begin(), SavedOffsets.end() );
+
+	// Same content on the distant SGF (if configured), without the line returns
+	int HeaderEnd = SavedOffsets.empty() ? (int)FileLength : (int)SavedOffsets[0];
+	Omiscid::SimpleString Header = FileContent.SubString( 0, HeaderEnd-1 );
+	std::vector<Omiscid::SimpleString> Moves;
+	for ( size_t Pos = 0; Pos < SavedOffsets.size(); Pos++ )
+	{
+		int MoveEnd = ( Pos+1 < SavedOffsets.size() ) ? (int)SavedOffsets[Pos+1] : (int)FileLength;
+		Moves.push_back( FileContent.SubString( (int)SavedOffsets[Pos], MoveEnd-1 ) );
+	}
+
+	const char * ShortFileName = strrchr( SGFFileName.GetStr(), '/' );
+	ShortFileName = ( ShortFileName == nullptr ) ? SGFFileName.GetStr() : ShortFileName+1;
+	OnlineUploader.ResumeDistantSGF( NumColumns, NumLines, ShortFileName, Header, Moves, UploadVersion );
+
+	return true;
+}
+
 /**
 * @brief Close SGF file. Add Result if any.
 * @param Result [in] Result of the game.
@@ -149,4 +280,23 @@ void SGFGenerator::Close( Omiscid::SimpleString& Result )
 
 	// End distant SGF (if configured)
 	OnlineUploader.EndDistantSGF( Result );
+}
+
+/**
+* @brief A move is committed, add it to the SGF file
+*/
+void SGFGenerator::ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp )
+{
+	AddMove( Color, a, b, Comment );
+}
+
+/**
+* @brief A committed move was undone: rewrite only the end of the SGF file. Provisional moves are not in the file.
+*/
+void SGFGenerator::RetractedMove( int NumMove, int Color, int a, int b, double Timestamp )
+{
+	if ( NumMove > 0 )
+	{
+		TruncateMoves( NumMove-1 );
+	}
 }
\ No newline at end of file
@@ -21,19 +21,31 @@
 #include "Go-CamRecorder.h"
 #include "StoneDetector.h"
 #include "UpdateOnline.h"
+#include "GameEventListener.h"
+
+#include <vector>
+
+class BinaryCheckpoint;
 
 /**
 * @brief Utility function. Generate an SGF header from data.
 * @return SgfHeader as SimpleString
 */
-inline Omiscid::SimpleString GenerateSGFHeader( const int GobanSize, Omiscid::SimpleString& FileName, Omiscid::SimpleString& EventName, Omiscid::SimpleString& RoundName,
+inline Omiscid::SimpleString GenerateSGFHeader( const int NumColumns, const int NumLines, Omiscid::SimpleString& FileName, Omiscid::SimpleString& EventName, Omiscid::SimpleString& RoundName,
 	Omiscid::SimpleString& Rule, Omiscid::SimpleString& Komi, Omiscid::SimpleString& Date, Omiscid::SimpleString& BlackPlayerName, Omiscid::SimpleString& WhitePlayerName )
 {
 	Omiscid::SimpleString Result;
 
 	Omiscid::SimpleString Version = "Go-CamRecorder:1.0a";
 
-	Result = "(;GM[1]FF[4]CA[latin1]AP[" + Version + "]ST[2]SZ[" + Omiscid::SimpleString(GobanSize) + "]PB[" + BlackPlayerName + "]PW[" + WhitePlayerName + "]DT[" + Date + "]RE[?]";
+	// Rectangular gobans are written SZ[columns:lines]
+	Omiscid::SimpleString GobanSize = Omiscid::SimpleString(NumColumns);
+	if ( NumLines != NumColumns )
+	{
+		GobanSize += ":" + Omiscid::SimpleString(NumLines);
+	}
+
+	Result = "(;GM[1]FF[4]CA[latin1]AP[" + Version + "]ST[2]SZ[" + GobanSize + "]PB[" + BlackPlayerName + "]PW[" + WhitePlayerName + "]DT[" + Date + "]RE[?]";
 	if ( EventName.IsEmpty() == false )
 	{
 		Result += "EV[" + EventName + "]";
@@ -61,21 +73,28 @@ inline Omiscid::SimpleString GenerateSGFHeader( const int GobanSize, Omiscid::Si
  * @class SGFGenerator 
  * @brief Generate SGF from information and moves. The file is generated in a simple forward maner. Could be improved.
 		Each time a action is done on SGF, a copy of it is upload on the web server (if configured).
+		Offsets of each move are kept to rewrite only the end of the file when moves are corrected.
+		Confirmed and retracted moves of the game are received as a GameEventListener.
  */
-class SGFGenerator
+class SGFGenerator : public GameEventListener
 {
 protected:
 	FILE * fout;						// Local file pointer
 	UploadOnline OnlineUploader;		// To upload online
-	int NumCells;						// Number of cells, i.e. size of goban
+	int NumColumns;						// Number of columns of the goban
+	int NumLines;						// Number of lines of the goban
 	Omiscid::SimpleString SGFFileName;	// SGF File name, generate from time and date
 	Omiscid::SimpleString FileContent;	// Will contain the file
+	std::vector<long> MoveFileOffsets;	// Offset in the file of each move
+	std::vector<unsigned int> MoveContentOffsets;	// Offset in FileContent of each move
 
 public:
 	/**
     * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
 	*/
-	SGFGenerator(int _NumCells) : NumCells(_NumCells), OnlineUploader( SingleConfig.UploadWebSite, SingleConfig.UploadURL )
+	SGFGenerator(int _NumColumns, int _NumLines) : NumColumns(_NumColumns), NumLines(_NumLines), OnlineUploader( SingleConfig.UploadWebSite, SingleConfig.UploadURL )
 	{
 		fout = nullptr;
 	}
@@ -115,11 +134,63 @@ public:
 	*/
 	bool AddMove( int Color, int Col, int Row, Omiscid::SimpleString Comment = "" );
 
+	/**
+	* @brief Get number of moves in the SGF file
+	* @return Number of moves
+	*/
+	inline int GetNbMoves() const
+	{
+		return (int)MoveFileOffsets.size();
+	}
+
+	/**
+	* @brief Get name of the SGF file
+	* @return Local file name, empty if no file was opened
+	*/
+	inline const Omiscid::SimpleString& GetFileName() const
+	{
+		return SGFFileName;
+	}
+
+	/**
+	* @brief Get uploader of the SGF file, it listens to provisional moves
+	* @return Online uploader
+	*/
+	inline UploadOnline& GetUploader()
+	{
+		return OnlineUploader;
+	}
+
+	/**
+	* @brief Remove moves at the end of the SGF file, the file is truncated after the last kept move.
+	* @param NbMoves [in] Number of moves to keep
+	* @return true if moves have been removed.
+	*/
+	bool TruncateMoves( int NbMoves );
+
+	/**
+	* @brief Save file name, offsets of moves and upload version in a checkpoint
+	* @param Checkpoint [in] Checkpoint being written
+	*/
+	void SaveCheckpoint( BinaryCheckpoint& Checkpoint );
+
+	/**
+	* @brief Reopen the SGF file saved by SaveCheckpoint to continue it. Moves written after the checkpoint
+	*		 are removed, they are still on the goban and will be detected again.
+	* @param Checkpoint [in] Checkpoint being read
+	* @return true if the SGF file could be reopened.
+	*/
+	bool Resume( BinaryCheckpoint& Checkpoint );
+
 	/**
 	* @brief Close SGF file. Add Result if any.
 	* @param Result [in] Result of the game.
 	*/
 	void Close(Omiscid::SimpleString& Result);
+
+	// Game events
+	virtual void ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp );
+	virtual void RetractedMove( int NumMove, int Color, int a, int b, double Timestamp );
 };
 
 #endif // __SGF_GENERATOR_H__
@@ -6,14 +6,14 @@
  */
 
 #include "StoneDetector.h"
+#include "PendingEventQueue.h"
 
 /**
-* @brief Initialisation of a stone detector
+* @brief Initialisation of a stone detector. Mask is computed later for all detectors by StoneDetectorStorage::InitMasks.
 * @param p [in] Center point
 * @param size [in]size of the area (will be refine after intiialisation)
-* @param InitImage [in] Initialisation image (for croping)
 */
-void StoneDetector::Init( const cv::Point&p, int size, cv::Mat& InitImage )
+void StoneDetector::Init( const cv::Point&p, int size )
 {
 	Center = p;
 	radius = size;
@@ -26,19 +26,11 @@ void StoneDetector::Init( const cv::Point&p, int size, cv::Mat& InitImage )
 	InMotionExtended = false;
 
 	Fixed = false;
-
-	cv::Rect DetectionRect =  GetRect( InitImage, Center );
-
-	// #define SQRT2_1 14142/10000
-
-	MaskStone = cv::Mat( DetectionRect.height, DetectionRect.width, CV_8UC1, cv::Scalar( 0 ) );
-	cv::ellipse( MaskStone, cv::Point( DetectionRect.width/2, DetectionRect.height/2 ), cv::Size( radius, radius2 ), 0.0, 0.0, 360.0, cv::Scalar( 255 ), -1 );
-
-	NbPixelsInStone = cv::countNonZero( MaskStone );
 }
 
 /**
 * @brief Set new detected state of the detector. If state is the same as the previous one, nothing is done.
+*		 A change is pushed in the pending event queue for GobanState.
 * @param NewState [in] New detected color
 * @param CurrentTimestamp [in] Frame timestamp
 * @param True if state has changed, i.e. it is not the same state as the previous one.
@@ -54,6 +46,7 @@ bool StoneDetector::SetState( int NewState, double CurrentTimestamp )
 	// Timestamp of this detection
 	State = NewState;
 	Timestamp = CurrentTimestamp;
+	PendingEvents.Push( CellIndex, CurrentTimestamp );
 
 	return true;
 }
@@ -76,7 +69,7 @@ bool StoneDetector::ComputeOnSubDetector( cv::Mat& LocalDetector, int startcol,
 	for ( int line = startline; line < endline; line++ )
 	{
 		unsigned char * line_ptr = LocalDetector.ptr<unsigned char>( line );
-		unsigned char * mask_ptr = MaskStone.ptr<unsigned char>( line );
+		unsigned char * mask_ptr = MaskStoneLine( line );
 		for ( int col = startcol; col < endcol; col++ )
 		{
 			if ( mask_ptr[col] == 0 )
@@ -122,7 +115,7 @@ bool StoneDetector::ComputeOnSubDetector( cv::Mat& LocalDetector, int startcol,
 #ifdef DEBUG
 		unsigned char * line_ptr = LocalDetector.ptr<unsigned char>( line );
 #endif
-		unsigned char * mask_ptr = MaskStone.ptr<unsigned char>( line );
+		unsigned char * mask_ptr = MaskStoneLine( line );
 		for ( int col = UpperLeft.x; col <= BottomRight.x; col++ )
 		{
 			if ( mask_ptr[col] == 0 )
@@ -181,6 +174,143 @@ double StoneDetector::ComputeOverlappingAndScore( cv::Mat& LocalDetector, cv::Po
 	return score;
 }
 
+/**
+* @brief Compute detection score using only sample points. Same principle as ComputeOverlappingAndScore:
+*		 bounding box of detected samples within each sub detector, score is the ratio of samples within the boxes.
+* @param Image [in] Current detection image
+* @param found [out] True if a stone is found.
+* @return Detection score.
+*/
+double StoneDetector::ComputeSparseScore( cv::Mat& Image, bool& found )
+{
+	cv::Rect DetectionRect = GetRect( Image, Center );
+
+	// Bounding box of detected samples for each sub detector
+	cv::Point UpperLeft[NbSubDetectors];
+	cv::Point BottomRight[NbSubDetectors];
+	for ( int SubDetector = 0; SubDetector < NbSubDetectors; SubDetector++ )
+	{
+		UpperLeft[SubDetector] = cv::Point( DetectionRect.width, DetectionRect.height );
+		BottomRight[SubDetector] = cv::Point( -1, -1 );
+	}
+
+	found = false;
+	for ( int Sample = 0; Sample < NbSamples; Sample++ )
+	{
+		const cv::Point& p = SamplePoints[Sample];
+		if ( Image.ptr<unsigned char>( DetectionRect.y+p.y )[DetectionRect.x+p.x] != 255 )
+		{
+			continue;
+		}
+
+		found = true;
+
+		int SubDetector = SampleSubDetector[Sample];
+		UpperLeft[SubDetector].x = Min( UpperLeft[SubDetector].x, p.x );
+		UpperLeft[SubDetector].y = Min( UpperLeft[SubDetector].y, p.y );
+		BottomRight[SubDetector].x = Max( BottomRight[SubDetector].x, p.x );
+		BottomRight[SubDetector].y = Max( BottomRight[SubDetector].y, p.y );
+	}
+
+	if ( found == false )
+	{
+		return 0.0;
+	}
+
+	// Count samples inside the boxes, as all mask pixels are counted in the dense version
+	int NbOfPoints = 0;
+	for ( int Sample = 0; Sample < NbSamples; Sample++ )
+	{
+		const cv::Point& p = SamplePoints[Sample];
+		int SubDetector = SampleSubDetector[Sample];
+		if ( p.x >= UpperLeft[SubDetector].x && p.x <= BottomRight[SubDetector].x &&
+			 p.y >= UpperLeft[SubDetector].y && p.y <= BottomRight[SubDetector].y )
+		{
+			NbOfPoints++;
+		}
+	}
+
+	return (double)NbOfPoints/(double)NbSamples;
+}
+
+/**
+* @brief Coarse-to-fine version of the dense decision of IsDetected. Sub detectors are evaluated by decreasing
+*		 number of mask pixels (centre first) and evaluation stops as soon as the threshold is reached or
+*		 can not be reached anymore with the remaining sub detectors. Decision is the same as the full computation.
+* @param LocalDetector [in] LocalDetector is the complete image for the detector
+* @return true if a stone is detected.
+*/
+bool StoneDetector::IsDetectedCoarseToFine( cv::Mat& LocalDetector )
+{
+	int BoundsX[NbSubDetectorsOnEachAxis+1];
+	int BoundsY[NbSubDetectorsOnEachAxis+1];
+	ComputeSubDetectorBounds( LocalDetector.cols, BoundsX );
+	ComputeSubDetectorBounds( LocalDetector.rows, BoundsY );
+
+	// Max score that remaining sub detectors could add (a sub detector can not count more than its mask pixels)
+	double Remaining = 0.0;
+	for ( int SubDetector = 0; SubDetector < NbSubDetectors; SubDetector++ )
+	{
+		Remaining += (double)SubDetectorPixels[SubDetector];
+	}
+
+	// Scores are integer values stored in double, thus partial sums are exact
+	double score = 0.0;
+	bool found = false;
+	for ( int Rank = 0; Rank < NbSubDetectors; Rank++ )
+	{
+		int SubDetector = SubDetectorOrder[Rank];
+		int i = SubDetector/NbSubDetectorsOnEachAxis;
+		int j = SubDetector%NbSubDetectorsOnEachAxis;
+
+		found |= ComputeOnSubDetector( LocalDetector, BoundsX[i], BoundsX[i+1], BoundsY[j], BoundsY[j+1], score );
+		Remaining -= (double)SubDetectorPixels[SubDetector];
+
+		// Enough, other sub detectors can only increase the score
+		if ( found == true && score/(double)NbPixelsInStone >= ResultsScoreMin )
+		{
+			return true;
+		}
+
+		// Threshold can not be reached anymore
+		if ( (score+Remaining)/(double)NbPixelsInStone < ResultsScoreMin )
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+/**
+* @brief Compute detection score, sparse or dense version.
+* @param Image [in] Current detection image
+* @param Sparse [in] Use sample points (true) or all pixels (false)
+* @param found [out] True if a stone is found.
+* @return Detection score.
+*/
+double StoneDetector::ComputeScore( cv::Mat& Image, bool Sparse, bool& found )
+{
+	if ( Sparse == true )
+	{
+		return ComputeSparseScore( Image, found );
+	}
+
+	if ( ScoreKernel != nullptr )
+	{
+		// Specialised version for the current tile and goban sizes
+		return ScoreKernel( Image, CellIndex, MaskStone, MaskStep, NbPixelsInStone, found );
+	}
+
+	cv::Mat LocalDetector( Image, GetRect( Image, Center ) );
+
+	// Bounding box outside the image
+	cv::Point UpperLeft;
+	cv::Point BottomRight;
+
+	return ComputeOverlappingAndScore( LocalDetector, UpperLeft, BottomRight, found );
+}
+
 /**
 * @brief After color detection, IsDEtected will serach for a Black or White stone
 * @param Image [in] Current image
@@ -190,14 +320,20 @@ double StoneDetector::ComputeOverlappingAndScore( cv::Mat& LocalDetector, cv::Po
 */
 bool StoneDetector::IsDetected( cv::Mat& Image, int CurrentSearch, double score )
 {
-	cv::Mat LocalDetector( Image, GetRect( Image, Center ) );
-
-	// Bounding box outside the image
-	cv::Point UpperLeft;
-	cv::Point BottomRight;
 	bool found = false;
 
-	score = ComputeOverlappingAndScore( LocalDetector, UpperLeft, BottomRight, found );
+	if ( EarlyExit == true && IsSparse() == false )
+	{
+		cv::Mat LocalDetector( Image, GetRect( Image, Center ) );
+
+		// Sub detector pixel counts are valid only if the detection area was not croped differently
+		if ( LocalDetector.size() == MaskSize )
+		{
+			return IsDetectedCoarseToFine( LocalDetector );
+		}
+	}
+
+	score = ComputeScore( Image, IsSparse(), found );
 
 	if ( found == false )	// no point is present
 	{
@@ -291,6 +427,63 @@ bool StoneDetector::DoStoneDetection( cv::Mat& Image, cv::Mat& WhiteImage, cv::M
 	return SetState( Empty, CurrentTimestamp );
 }
 
+/**
+* @brief Use the class found by the patch classifier instead of doing stone detection on this cell.
+*		 Motion is handled as in DoStoneDetection.
+* @param DetectedState [in] Class of the patch (White, Black or Empty)
+* @param CurrentTimestamp [in] Frame timestamp
+* @param DepthMode [in] DepthMode: true if using Kinect.
+* @return true if state has changed.
+*/
+bool StoneDetector::ApplyClassification( int DetectedState, double CurrentTimestamp, bool DepthMode )
+{
+	if ( InMotionExtended == true && (DepthMode == true || State != Empty) )
+	{
+		// Hands or arms over the cell, keep previous state
+		return false;
+	}
+
+	return SetState( DetectedState, CurrentTimestamp );
+}
+
+/**
+* @brief Accumulate evidence of the current detected state. Older observations decay exponentially,
+*		 observations while in motion are ignored.
+* @param CurrentTimestamp [in] Frame timestamp
+* @param TimeConstant [in] Time constant of the decay in seconds
+*/
+void StoneDetector::AccumulateEvidence( double CurrentTimestamp, double TimeConstant )
+{
+	double Elapsed = CurrentTimestamp - EvidenceTimestamp;
+	EvidenceTimestamp = CurrentTimestamp;
+
+	if ( InMotionExtended == true )
+	{
+		// Hands or arms over the cell, do not learn from this frame
+		return;
+	}
+
+	float Decay = (float)exp( -std::max( Elapsed, 0.0 )/TimeConstant );
+	Evidence *= Decay;
+	Evidence[State] += 1.0f - Decay;
+
+	if ( State == Empty )
+	{
+		// Captured stone has been removed
+		AwaitingRemoval = false;
+	}
+}
+
+/**
+* @brief Reset evidence after a capture: cell is empty for the game, stone must be removed
+* @param CurrentTimestamp [in] Frame timestamp
+*/
+void StoneDetector::ResetEvidenceAfterCapture( double CurrentTimestamp )
+{
+	Evidence = cv::Vec3f( 0.0f, 0.0f, 1.0f );
+	EvidenceTimestamp = CurrentTimestamp;
+	AwaitingRemoval = true;
+}
 
 /**
 * @brief Aggragate motion detection score.
@@ -320,6 +513,42 @@ unsigned int StoneDetector::AndValueAndComputeMotion( unsigned int NewValue, dou
 }					
 
 
+/**
+* @brief Compute mean motion value on the detector, sparse or dense version.
+* @param MotionImage [in] Motion image
+* @param Sparse [in] Use sample points (true) or all pixels (false)
+* @return mean motion value (0-255)
+*/
+unsigned int StoneDetector::ComputeMeanMotion( cv::Mat& MotionImage, bool Sparse )
+{
+	if ( Sparse == true )
+	{
+		if ( NbSamples == 0 )
+		{
+			return 0;
+		}
+
+		cv::Rect DetectionRect = GetRect( MotionImage, Center );
+
+		unsigned int Sum = 0;
+		for ( int Sample = 0; Sample < NbSamples; Sample++ )
+		{
+			const cv::Point& p = SamplePoints[Sample];
+			Sum += MotionImage.ptr<unsigned char>( DetectionRect.y+p.y )[DetectionRect.x+p.x];
+		}
+		return (unsigned int)((double)Sum/(double)NbSamples);
+	}
+
+	if ( MotionKernel != nullptr )
+	{
+		// Specialised version for the current tile and goban sizes
+		return MotionKernel( MotionImage, CellIndex );
+	}
+
+	cv::Mat srcMotion( MotionImage, GetRect( MotionImage, Center ) );
+	return (unsigned int)cv::mean( srcMotion )[0];
+}
+
 /**
 * @brief Aggragate motion detection score and compute motion event.
 * @param MotionImage [in] Motion image (defference from previous image or difference from background depth image).
@@ -329,10 +558,8 @@ unsigned int StoneDetector::AndValueAndComputeMotion( unsigned int NewValue, dou
 */
 bool StoneDetector::DoMotionDetection( cv::Mat& MotionImage, double CurrentTimestamp, bool UsingDepth /* = false */ )
 {
-	cv::Mat srcMotion( MotionImage, GetRect( MotionImage, Center ) );
-
 	// Compute motion state
-	unsigned int NewMotion = AndValueAndComputeMotion( (unsigned int)cv::mean( srcMotion )[0], CurrentTimestamp, UsingDepth );
+	unsigned int NewMotion = AndValueAndComputeMotion( ComputeMeanMotion( MotionImage, IsSparse() ), CurrentTimestamp, UsingDepth );
 
 	// Compute is this a motion
 	bool NewInMotionEvent = (NewMotion >= (255*PercentageThreshold/100));
@@ -356,8 +583,9 @@ bool StoneDetector::DoMotionDetection( cv::Mat& MotionImage, double CurrentTimes
 * @brief Draw current detection and/or motion.
 * @param WhereToDraw [in] Image to draw in
 * @param draw_size [in] If set to positive value, limite the size of drawing
+* @param DrawScale [in] Scale from the processed image to WhereToDraw (default 1.0)
 */
-void StoneDetector::Draw( cv::Mat& WhereToDraw, int draw_size /* = -1 */ )
+void StoneDetector::Draw( cv::Mat& WhereToDraw, int draw_size /* = -1 */, double DrawScale /* = 1.0 */ )
 {
 	// return;
 
@@ -371,7 +599,16 @@ void StoneDetector::Draw( cv::Mat& WhereToDraw, int draw_size /* = -1 */ )
 	}
 	else
 	{
-		rad_draw = Max( radius/2, 3 );
+		rad_draw = Max( (int)(radius*DrawScale)/2, 3 );
+	}
+
+	// Detection area and center in WhereToDraw
+	cv::Point DrawCenter = Center;
+	cv::Rect DrawRect = GetRect( WhereToDraw, Center );
+	if ( DrawScale != 1.0 )
+	{
+		DrawCenter = cv::Point( cvRound( Center.x*DrawScale ), cvRound( Center.y*DrawScale ) );
+		DrawRect = cv::Rect( cvRound( (Center.x-radius)*DrawScale ), cvRound( (Center.y-radius2)*DrawScale ), cvRound( 2*radius*DrawScale ), cvRound( 2*radius2*DrawScale ) );
 	}
 
 	if ( State == White )
@@ -387,7 +624,7 @@ void StoneDetector::Draw( cv::Mat& WhereToDraw, int draw_size /* = -1 */ )
 
 	if ( InMotionExtended == true )
 	{
-		cv::rectangle( WhereToDraw, GetRect( WhereToDraw, Center ), CV_RGB( 255, 0, 0 ), 2 );
+		cv::rectangle( WhereToDraw, DrawRect, CV_RGB( 255, 0, 0 ), 2 );
 	}
 
 	if ( State == Empty )
@@ -395,10 +632,10 @@ void StoneDetector::Draw( cv::Mat& WhereToDraw, int draw_size /* = -1 */ )
 		return;
 	}
 
-	cv::circle( WhereToDraw, Center, rad_draw, OutsideColor, -1 );
+	cv::circle( WhereToDraw, DrawCenter, rad_draw, OutsideColor, -1 );
 	if ( rad_draw-3 > 0 )
 	{
-		cv::circle( WhereToDraw, Center, rad_draw-3, CurColor, -1 );
+		cv::circle( WhereToDraw, DrawCenter, rad_draw-3, CurColor, -1 );
 	}
 }
 
@@ -20,6 +20,9 @@ using namespace cv;
 
 #include <algorithm>
 
+class StoneDetectorStorage;
+class PendingEventQueue;
+
 /**
 * @brief Utility function for max (not template as std::max is).
 */
@@ -46,21 +49,24 @@ inline int Min(int a, int b)
 
 /**
  * @class StoneDetector 
- * @brief Class for detection fo stones at each cells on the goban
+ * @brief Class for detection fo stones at each cells on the goban. A StoneDetector is a lightweight view
+ *		  on one cell of a StoneDetectorStorage: members are references to the storage arrays.
  */
 class StoneDetector : public StoneState
 {
 public:
 	// Detector position and state
-	cv::Point Center;								// Center of detection area
-	int radius;										// Radius in x for the stone (ellipse)	
-	int radius2;									// Radius in y for the stone (ellipse)	
-	bool Fixed;										// Fixe detection, may be removed...
-	cv::Mat MaskStone;								// Mask of the projected stone on the detection
-	int NbPixelsInStone;							// Number of pixel within the stone detector
+	cv::Point& Center;								// Center of detection area
+	int& radius;									// Radius in x for the stone (ellipse)	
+	int& radius2;									// Radius in y for the stone (ellipse)	
+	unsigned char& Fixed;							// Fixe detection, may be removed...
+	unsigned char * MaskStone;						// Mask of the projected stone on the detection (within the mask atlas)
+	size_t MaskStep;								// Step of the mask atlas
+	int& NbPixelsInStone;							// Number of pixel within the stone detector
 	double ResultsScoreMin = 0.33;					// Area of an overlapping ellipse on the middle cross
-	int State;										// Current detected state
-	double Timestamp;								// Detected event timestamp
+	int& State;										// Current detected state
+	double& Timestamp;								// Detected event timestamp
+	PendingEventQueue& PendingEvents;				// Queue of state changes of all detectors
 
 
 // Utility functions
@@ -92,29 +98,34 @@ public:
 	}
 
 	/**
-	* @brief Initialisation of a stone detector
-	* @param p [in] Center point
-	* @param size [in]size of the area (will be refine after intiialisation)
-	* @param InitImage [in] Initialisation image (for croping)
+	* @brief Get a line of the mask of the stone
+	* @param line [in] Line number in the detection area
+	* @return Pointer to the first pixel of the line
 	*/
-	void Init(const cv::Point&p, int size, cv::Mat& InitImage);
+	inline unsigned char * MaskStoneLine( int line )
+	{
+		return MaskStone + line*MaskStep;
+	}
 
 	/**
-	* @brief Default constructor
+	* @brief Initialisation of a stone detector. Mask is computed later for all detectors by StoneDetectorStorage::InitMasks.
+	* @param p [in] Center point
+	* @param size [in]size of the area (will be refine after intiialisation)
 	*/
-	StoneDetector(): Center(0,0), radius(0), State(Empty), InMotion(false), Timestamp(0.0)
-	{
-	}
+	void Init(const cv::Point&p, int size);
 
 	/**
-	* @brief Virtual desconstructor
+	* @brief Constructor of a view on a detector (defined in StoneDetectorStorage.h)
+	* @param Storage [in] Storage of all detectors
+	* @param CellIndex [in] Index of the detector within the storage
 	*/
-	virtual ~StoneDetector() {};
+	inline StoneDetector( StoneDetectorStorage& Storage, int CellIndex );
 
 
 // Stone detection
 	/**
 	* @brief Set new detected state of the detector. If state is the same as the previous one, nothing is done.
+	*		 A change is pushed in the pending event queue for GobanState.
 	* @param NewState [in] New detected color
 	* @param CurrentTimestamp [in] Frame timestamp
 	* @param True if state has changed, i.e. it is not the same state as the previous one.
@@ -122,6 +133,23 @@ public:
 	bool SetState(int NewState, double CurrentTimestamp);
 
 	#define NbSubDetectorsOnEachAxis 3		// Number of sub detector, in x, and y. #define because we do not want to use static const int...
+	#define NbSubDetectors (NbSubDetectorsOnEachAxis*NbSubDetectorsOnEachAxis)
+
+	/**
+	* @brief Compute bounds of sub detectors along one axis, same float accumulation as ComputeOverlappingAndScore
+	* @param Size [in] Size of the detection area along the axis
+	* @param Bounds [out] Sub detector i is [Bounds[i], Bounds[i+1])
+	*/
+	static inline void ComputeSubDetectorBounds( int Size, int Bounds[NbSubDetectorsOnEachAxis+1] )
+	{
+		float SubDetectorsSize = (float)Size/(float)NbSubDetectorsOnEachAxis;
+		float Start = 0.0f;
+		for ( int i = 0; i <= NbSubDetectorsOnEachAxis; i++ )
+		{
+			Bounds[i] = (int)Start;
+			Start += SubDetectorsSize;
+		}
+	}
 
 	/**
 	* @brief Compute detection on a sub detector. Subdetector will be merge to tackle refection on stones.
@@ -154,6 +182,15 @@ public:
 	*/
 	bool IsDetected(cv::Mat& Image, int CurrentSearch, double score );
 
+	/**
+	* @brief Coarse-to-fine version of the dense decision of IsDetected. Sub detectors are evaluated by decreasing
+	*		 number of mask pixels (centre first) and evaluation stops as soon as the threshold is reached or
+	*		 can not be reached anymore with the remaining sub detectors. Decision is the same as the full computation.
+	* @param LocalDetector [in] LocalDetector is the complete image for the detector
+	* @return true if a stone is detected.
+	*/
+	bool IsDetectedCoarseToFine( cv::Mat& LocalDetector );
+
 	/**
 	* @brief Do stone detection on this cell.
 	* @param Image [in] Current image
@@ -165,14 +202,104 @@ public:
 	*/
 	bool DoStoneDetection( cv::Mat& Image, cv::Mat& WhiteImage, cv::Mat& BlackImage, double CurrentTimestamp, bool DepthMode );
 
+	/**
+	* @brief Use the class found by the patch classifier instead of doing stone detection on this cell.
+	*		 Motion is handled as in DoStoneDetection.
+	* @param DetectedState [in] Class of the patch (White, Black or Empty)
+	* @param CurrentTimestamp [in] Frame timestamp
+	* @param DepthMode [in] DepthMode: true if using Kinect.
+	* @return true if state has changed.
+	*/
+	bool ApplyClassification( int DetectedState, double CurrentTimestamp, bool DepthMode );
+
 // Motion detection
-	bool InMotion;									// Boolean set by premiary motion detection
-	bool InMotionExtended;							// Boolean set by extended motion detection
-	int MotionCount = 0;							// Third integration of motion, number of succesive frames
+	unsigned char& InMotion;						// Boolean set by premiary motion detection
+	unsigned char& InMotionExtended;				// Boolean set by extended motion detection
+	int& MotionCount;								// Third integration of motion, number of succesive frames
 	const unsigned int PercentageThreshold = 5;		// 5% is a threshold for motion in color/depth data
-	HistoryValue<unsigned int> LastMotionEvent;		// Last motion event on the detector
+	HistoryValue<unsigned int>& LastMotionEvent;	// Last motion event on the detector
 	const double OldValues = 0.500;					// Integration time, 1/2 seconde
 
+// Temporal evidence
+	cv::Vec3f& Evidence;							// Exponentially decayed evidence of White, Black and Empty (sum is 1)
+	double& EvidenceTimestamp;						// Timestamp of last evidence update
+	unsigned char& AwaitingRemoval;					// Captured stone not removed yet from the goban
+
+	/**
+	* @brief Accumulate evidence of the current detected state. Older observations decay exponentially,
+	*		 observations while in motion are ignored.
+	* @param CurrentTimestamp [in] Frame timestamp
+	* @param TimeConstant [in] Time constant of the decay in seconds
+	*/
+	void AccumulateEvidence( double CurrentTimestamp, double TimeConstant );
+
+	/**
+	* @brief Get confidence in a state
+	* @param StateToCheck [in] White, Black or Empty
+	* @return confidence between 0 and 1
+	*/
+	inline float GetConfidence( int StateToCheck )
+	{
+		return Evidence[StateToCheck];
+	}
+
+	/**
+	* @brief Reset evidence after a capture: cell is empty for the game, stone must be removed
+	* @param CurrentTimestamp [in] Frame timestamp
+	*/
+	void ResetEvidenceAfterCapture( double CurrentTimestamp );
+
+// Specialised kernels
+	int CellIndex;									// Index of the detector in the storage
+	unsigned int (*MotionKernel)( cv::Mat& MotionImage, int CellIndex );	// Specialised motion kernel or nullptr
+	double (*ScoreKernel)( cv::Mat& Image, int CellIndex, const unsigned char * MaskStone, size_t MaskStep, int NbPixelsInStone, bool& found );	// Specialised score kernel or nullptr
+
+// Coarse-to-fine detection
+	bool EarlyExit;									// Use coarse-to-fine evaluation
+	cv::Size MaskSize;								// Size of the detection area when masks were computed
+	const int * SubDetectorPixels;					// Number of mask pixels in each sub detector
+	const unsigned char * SubDetectorOrder;			// Evaluation order of sub detectors
+
+// Sparse sampling
+	int NbSamples;									// Number of samples of the detector
+	const cv::Point * SamplePoints;					// Samples within the detection area, nullptr in dense mode
+	const unsigned char * SampleSubDetector;		// Sub detector of each sample
+
+	/**
+	* @brief Do we work on sample points instead of all pixels?
+	* @return true if in sparse mode
+	*/
+	inline bool IsSparse()
+	{
+		return ( SamplePoints != nullptr );
+	}
+
+	/**
+	* @brief Compute detection score using only sample points. Same principle as ComputeOverlappingAndScore:
+	*		 bounding box of detected samples within each sub detector, score is the ratio of samples within the boxes.
+	* @param Image [in] Current detection image
+	* @param found [out] True if a stone is found.
+	* @return Detection score.
+	*/
+	double ComputeSparseScore( cv::Mat& Image, bool& found );
+
+	/**
+	* @brief Compute detection score, sparse or dense version.
+	* @param Image [in] Current detection image
+	* @param Sparse [in] Use sample points (true) or all pixels (false)
+	* @param found [out] True if a stone is found.
+	* @return Detection score.
+	*/
+	double ComputeScore( cv::Mat& Image, bool Sparse, bool& found );
+
+	/**
+	* @brief Compute mean motion value on the detector, sparse or dense version.
+	* @param MotionImage [in] Motion image
+	* @param Sparse [in] Use sample points (true) or all pixels (false)
+	* @return mean motion value (0-255)
+	*/
+	unsigned int ComputeMeanMotion( cv::Mat& MotionImage, bool Sparse );
+
 	/**
 	* @brief Aggragate motion detection score.
 	* @param NewValue [in] New motion dection value
@@ -197,8 +324,9 @@ public:
 	* @brief Draw current detection and/or motion.
 	* @param WhereToDraw [in] Image to draw in
 	* @param draw_size [in] If set to positive value, limite the size of drawing
+	* @param DrawScale [in] Scale from the processed image to WhereToDraw (default 1.0)
 	*/
-	void Draw(cv::Mat& WhereToDraw, int draw_size = -1);
+	void Draw(cv::Mat& WhereToDraw, int draw_size = -1, double DrawScale = 1.0);
 };
 
 
@@ -0,0 +1,222 @@
+/**
+ * @file StoneDetectorStorage.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "StoneDetectorStorage.h"
+#include "Checkpoint.h"
+
+#include <algorithm>
+
+/**
+* @brief Create masks of all projected stones in the atlas. Must be called once all detectors are initialized.
+* @param InitImage [in] Initialisation image (for croping)
+*/
+void StoneDetectorStorage::InitMasks( cv::Mat& InitImage )
+{
+	// Search for the biggest detection area to size the atlas grid
+	int MaxWidth = 1;
+	int MaxHeight = 1;
+	for ( int CellIndex = 0; CellIndex < NbDetectors; CellIndex++ )
+	{
+		cv::Rect DetectionRect = operator[]( CellIndex ).GetRect( InitImage, Center[CellIndex] );
+		MaxWidth = Max( MaxWidth, DetectionRect.width );
+		MaxHeight = Max( MaxHeight, DetectionRect.height );
+	}
+
+	// One contiguous image for all masks, cell (a,b) is at line a, column b of the grid
+	MaskAtlas = cv::Mat( NumColumns*MaxHeight, NumLines*MaxWidth, CV_8UC1, cv::Scalar( 0 ) );
+
+	for ( int a = 0; a < NumColumns; a++ )
+	{
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			int CellIndex = Index( a, b );
+			cv::Rect DetectionRect = operator[]( CellIndex ).GetRect( InitImage, Center[CellIndex] );
+
+			MaskRect[CellIndex] = cv::Rect( b*MaxWidth, a*MaxHeight, DetectionRect.width, DetectionRect.height );
+
+			cv::Mat MaskStone( MaskAtlas, MaskRect[CellIndex] );
+			cv::ellipse( MaskStone, cv::Point( DetectionRect.width/2, DetectionRect.height/2 ), cv::Size( radius[CellIndex], radius2[CellIndex] ), 0.0, 0.0, 360.0, cv::Scalar( 255 ), -1 );
+
+			NbPixelsInStone[CellIndex] = cv::countNonZero( MaskStone );
+
+			// Number of mask pixels in each sub detector, bound of their contribution to the score
+			int BoundsX[NbSubDetectorsOnEachAxis+1];
+			int BoundsY[NbSubDetectorsOnEachAxis+1];
+			StoneDetector::ComputeSubDetectorBounds( DetectionRect.width, BoundsX );
+			StoneDetector::ComputeSubDetectorBounds( DetectionRect.height, BoundsY );
+
+			int * CellSubDetectorPixels = &SubDetectorPixels[CellIndex*NbSubDetectors];
+			for ( int i = 0; i < NbSubDetectorsOnEachAxis; i++ )
+			{
+				for ( int j = 0; j < NbSubDetectorsOnEachAxis; j++ )
+				{
+					cv::Rect SubRect( BoundsX[i], BoundsY[j], BoundsX[i+1]-BoundsX[i], BoundsY[j+1]-BoundsY[j] );
+					CellSubDetectorPixels[i*NbSubDetectorsOnEachAxis+j] = ( SubRect.area() > 0 ) ? cv::countNonZero( cv::Mat( MaskStone, SubRect ) ) : 0;
+				}
+			}
+
+			// Evaluation order: centre, then sides, then corners, reordered by decreasing number of pixels
+			static const unsigned char CentreFirst[NbSubDetectors] = { 4, 1, 3, 5, 7, 0, 2, 6, 8 };
+			unsigned char * CellOrder = &SubDetectorOrder[CellIndex*NbSubDetectors];
+			std::copy( CentreFirst, CentreFirst+NbSubDetectors, CellOrder );
+			std::stable_sort( CellOrder, CellOrder+NbSubDetectors, [CellSubDetectorPixels]( unsigned char s1, unsigned char s2 )
+				{ return CellSubDetectorPixels[s1] > CellSubDetectorPixels[s2]; } );
+		}
+	}
+}
+
+/**
+* @brief Create sample points of all detectors using a jittered grid over each projected stone.
+*		 Must be called after InitMasks. The pattern is the same for each run (fixed seed).
+* @param InitImage [in] Initialisation image (for croping)
+* @param _NbSamplesPerCell [in] Number of samples per detector (0 to go back to dense processing)
+*/
+void StoneDetectorStorage::InitSamples( cv::Mat& InitImage, int _NbSamplesPerCell )
+{
+	NbSamplesPerCell = Max( _NbSamplesPerCell, 0 );
+	NbSamples.assign( NbDetectors, 0 );
+
+	if ( NbSamplesPerCell == 0 )
+	{
+		// Dense processing
+		SampleStride = 0;
+		SamplePoints.clear();
+		SampleSubDetector.clear();
+		return;
+	}
+
+	// The ellipse covers PI/4 of its bounding box, use a grid with enough points to get NbSamplesPerCell inside
+	int GridSize = (int)ceil( sqrt( (double)NbSamplesPerCell*4.0/CV_PI ) );
+	SampleStride = Max( GridSize*GridSize, NbSamplesPerCell );
+
+	SamplePoints.assign( NbDetectors*SampleStride, cv::Point( 0, 0 ) );
+	SampleSubDetector.assign( NbDetectors*SampleStride, 0 );
+
+	// Fixed seed, thus results on recorded games are reproducible
+	cv::RNG Jitter( 0x476F );
+
+	for ( int CellIndex = 0; CellIndex < NbDetectors; CellIndex++ )
+	{
+		cv::Rect DetectionRect = operator[]( CellIndex ).GetRect( InitImage, Center[CellIndex] );
+		cv::Mat MaskStone( MaskAtlas, MaskRect[CellIndex] );
+
+		// Bounds of sub detectors, same computation as StoneDetector::ComputeOverlappingAndScore
+		int BoundsX[NbSubDetectorsOnEachAxis+1];
+		int BoundsY[NbSubDetectorsOnEachAxis+1];
+		StoneDetector::ComputeSubDetectorBounds( DetectionRect.width, BoundsX );
+		StoneDetector::ComputeSubDetectorBounds( DetectionRect.height, BoundsY );
+
+		cv::Point * CellSamples = &SamplePoints[CellIndex*SampleStride];
+		unsigned char * CellSubDetectors = &SampleSubDetector[CellIndex*SampleStride];
+		int& Nb = NbSamples[CellIndex];
+
+		bool AllPixels = ( NbPixelsInStone[CellIndex] <= NbSamplesPerCell );
+		int NbLines = AllPixels ? DetectionRect.height : GridSize;
+		int NbCols = AllPixels ? DetectionRect.width : GridSize;
+		float CellSizeX = (float)DetectionRect.width/(float)NbCols;
+		float CellSizeY = (float)DetectionRect.height/(float)NbLines;
+
+		for ( int line = 0; line < NbLines && Nb < SampleStride; line++ )
+		{
+			for ( int col = 0; col < NbCols && Nb < SampleStride; col++ )
+			{
+				cv::Point p;
+				if ( AllPixels == true )
+				{
+					// Small stone, take every pixel of the mask
+					p = cv::Point( col, line );
+				}
+				else
+				{
+					// One random point within each cell of the grid
+					p.x = Min( (int)(((float)col + Jitter.uniform( 0.0f, 1.0f ))*CellSizeX), DetectionRect.width-1 );
+					p.y = Min( (int)(((float)line + Jitter.uniform( 0.0f, 1.0f ))*CellSizeY), DetectionRect.height-1 );
+				}
+
+				if ( MaskStone.at<unsigned char>( p.y, p.x ) == 0 )
+				{
+					continue;
+				}
+
+				// Search sub detector, pixels outside all of them are not used by the dense version
+				int SubX, SubY;
+				for ( SubX = 0; SubX < NbSubDetectorsOnEachAxis && p.x >= BoundsX[SubX+1]; SubX++ );
+				for ( SubY = 0; SubY < NbSubDetectorsOnEachAxis && p.y >= BoundsY[SubY+1]; SubY++ );
+				if ( SubX == NbSubDetectorsOnEachAxis || SubY == NbSubDetectorsOnEachAxis )
+				{
+					continue;
+				}
+
+				CellSamples[Nb] = p;
+				CellSubDetectors[Nb] = (unsigned char)(SubX*NbSubDetectorsOnEachAxis+SubY);
+				Nb++;
+			}
+		}
+	}
+}
+
+/**
+* @brief Save detected states, evidence and ages of the events in a checkpoint
+* @param Checkpoint [in] Checkpoint being written
+* @param CurrentTimestamp [in] Current timestamp, timestamps are saved relative to it
+*/
+void StoneDetectorStorage::SaveState( BinaryCheckpoint& Checkpoint, double CurrentTimestamp )
+{
+	// Timestamps of a new session do not start at the same value, keep ages
+	std::vector<double> Ages( NbDetectors ), EvidenceAges( NbDetectors );
+	for ( int CellIndex = 0; CellIndex < NbDetectors; CellIndex++ )
+	{
+		Ages[CellIndex] = CurrentTimestamp - Timestamp[CellIndex];
+		EvidenceAges[CellIndex] = CurrentTimestamp - EvidenceTimestamp[CellIndex];
+	}
+
+	Checkpoint.WriteVector( State );
+	Checkpoint.WriteVector( Ages );
+	Checkpoint.WriteVector( Fixed );
+	Checkpoint.WriteVector( Evidence );
+	Checkpoint.WriteVector( EvidenceAges );
+	Checkpoint.WriteVector( AwaitingRemoval );
+}
+
+/**
+* @brief Restore detected states saved by SaveState. Detectors must be initialized.
+* @param Checkpoint [in] Checkpoint being read
+* @param CurrentTimestamp [in] Current timestamp, saved ages are restored relative to it
+* @return false if the checkpoint does not match this goban
+*/
+bool StoneDetectorStorage::LoadState( BinaryCheckpoint& Checkpoint, double CurrentTimestamp )
+{
+	std::vector<int> SavedState;
+	std::vector<double> Ages, EvidenceAges;
+	std::vector<unsigned char> SavedFixed, SavedAwaitingRemoval;
+	std::vector<cv::Vec3f> SavedEvidence;
+
+	Checkpoint.ReadVector( SavedState );
+	Checkpoint.ReadVector( Ages );
+	Checkpoint.ReadVector( SavedFixed );
+	Checkpoint.ReadVector( SavedEvidence );
+	Checkpoint.ReadVector( EvidenceAges );
+	Checkpoint.ReadVector( SavedAwaitingRemoval );
+
+	if ( Checkpoint.IsValid() == false || (int)SavedState.size() != NbDetectors || (int)Ages.size() != NbDetectors || (int)SavedFixed.size() != NbDetectors ||
+		(int)SavedEvidence.size() != NbDetectors || (int)EvidenceAges.size() != NbDetectors || (int)SavedAwaitingRemoval.size() != NbDetectors )
+	{
+		return false;
+	}
+
+	State.swap( SavedState );
+	Fixed.swap( SavedFixed );
+	Evidence.swap( SavedEvidence );
+	AwaitingRemoval.swap( SavedAwaitingRemoval );
+	for ( int CellIndex = 0; CellIndex < NbDetectors; CellIndex++ )
+	{
+		Timestamp[CellIndex] = CurrentTimestamp - Ages[CellIndex];
+		EvidenceTimestamp[CellIndex] = CurrentTimestamp - EvidenceAges[CellIndex];
+	}
+
+	return true;
+}
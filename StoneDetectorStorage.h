@@ -0,0 +1,197 @@
+/**
+ * @file StoneDetectorStorage.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __STONE_DETECTOR_STORAGE_H__
+#define __STONE_DETECTOR_STORAGE_H__
+
+#include "Go-CamRecorder.h"
+
+#include <vector>
+
+#include "HistoryValue.h"
+#include "StoneState.h"
+#include "StoneDetector.h"
+#include "DetectorKernels.h"
+#include "PendingEventQueue.h"
+
+class BinaryCheckpoint;
+
+/**
+ * @class StoneDetectorStorage
+ * @brief Structure of arrays holding data of all stone detectors of the goban. Each field is stored
+ *		  in a contiguous array indexed by cell (a*NumLines+b) and all stone masks are packed in one atlas.
+ *		  StoneDetector objects are lightweight views on one cell of this storage.
+ */
+class StoneDetectorStorage : public StoneState
+{
+public:
+	int NumColumns;											// Number of columns of the goban
+	int NumLines;											// Number of lines of the goban
+	int NbDetectors;										// Number of detectors, NumColumns*NumLines
+
+	// Detector position and state
+	std::vector<cv::Point> Center;							// Center of detection area
+	std::vector<int> radius;								// Radius in x for the stone (ellipse)
+	std::vector<int> radius2;								// Radius in y for the stone (ellipse)
+	std::vector<unsigned char> Fixed;						// Fixe detection, may be removed... (bool stored as byte to be addressable)
+	std::vector<int> NbPixelsInStone;						// Number of pixel within the stone detector
+	std::vector<int> State;									// Current detected state
+	std::vector<double> Timestamp;							// Detected event timestamp
+	PendingEventQueue PendingEvents;						// State changes not handled yet by GobanState, oldest first
+
+	// Motion detection
+	std::vector<unsigned char> InMotion;					// Boolean set by premiary motion detection
+	std::vector<unsigned char> InMotionExtended;			// Boolean set by extended motion detection
+	std::vector<int> MotionCount;							// Third integration of motion, number of succesive frames
+	std::vector< HistoryValue<unsigned int> > LastMotionEvent;	// Last motion event on the detector
+
+	// Temporal evidence of each state
+	std::vector<cv::Vec3f> Evidence;						// Exponentially decayed evidence of White, Black and Empty (sum is 1)
+	std::vector<double> EvidenceTimestamp;					// Timestamp of last evidence update
+	std::vector<unsigned char> AwaitingRemoval;				// Captured stone not removed yet from the goban
+
+	// Masks of the projected stones
+	cv::Mat MaskAtlas;										// All masks packed in a NumColumns x NumLines grid
+	std::vector<cv::Rect> MaskRect;							// Rect of each mask within the atlas
+
+	// Coarse-to-fine detection
+	bool EarlyExit = true;									// Stop stone detection as soon as decision is known
+	std::vector<int> SubDetectorPixels;						// Number of mask pixels in each sub detector, NbSubDetectors per detector
+	std::vector<unsigned char> SubDetectorOrder;			// Evaluation order of sub detectors (most pixels first)
+
+	// Sparse sampling: fixed set of points within each projected stone (NbSamplesPerCell == 0 for dense processing)
+	int NbSamplesPerCell = 0;								// Requested number of samples per detector
+	int SampleStride = 0;									// Room for samples of each detector in the arrays
+	std::vector<int> NbSamples;								// Actual number of samples of each detector
+	std::vector<cv::Point> SamplePoints;					// Sample positions within the detection area
+	std::vector<unsigned char> SampleSubDetector;			// Sub detector (see NbSubDetectorsOnEachAxis) of each sample
+
+	// Specialised kernels (nullptr to use the generic code)
+	MotionKernelFunction MotionKernel = nullptr;			// Kernel for motion
+	ScoreKernelFunction ScoreKernel = nullptr;				// Kernel for stone score
+
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+	*/
+	StoneDetectorStorage( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines), NbDetectors(_NumColumns*_NumLines),
+		Center(NbDetectors, cv::Point(0,0)), radius(NbDetectors, 0), radius2(NbDetectors, 0), Fixed(NbDetectors, false),
+		NbPixelsInStone(NbDetectors, 0), State(NbDetectors, Empty), Timestamp(NbDetectors, 0.0), PendingEvents(NbDetectors),
+		InMotion(NbDetectors, false), InMotionExtended(NbDetectors, false), MotionCount(NbDetectors, 0),
+		LastMotionEvent(NbDetectors), Evidence(NbDetectors, cv::Vec3f( 0.0f, 0.0f, 1.0f )), EvidenceTimestamp(NbDetectors, 0.0),
+		AwaitingRemoval(NbDetectors, false), MaskRect(NbDetectors), SubDetectorPixels(NbDetectors*NbSubDetectors, 0),
+		SubDetectorOrder(NbDetectors*NbSubDetectors, 0), NbSamples(NbDetectors, 0)
+	{
+	}
+
+	/**
+    * @brief Get index of a cell in the arrays
+    * @param a [in] current column of the goban
+	* @param b [in] current line of the goban
+	* @return Index of the cell
+	*/
+	inline int Index( int a, int b ) const
+	{
+		return a*NumLines + b;
+	}
+
+	/**
+    * @brief Get a view on the detector of a cell
+    * @param a [in] current column of the goban
+	* @param b [in] current line of the goban
+	* @return StoneDetector view
+	*/
+	inline StoneDetector operator()( int a, int b )
+	{
+		return StoneDetector( *this, Index( a, b ) );
+	}
+
+	/**
+    * @brief Get a view on the detector of a cell
+    * @param CellIndex [in] Index of the cell (a*NumLines+b)
+	* @return StoneDetector view
+	*/
+	inline StoneDetector operator[]( int CellIndex )
+	{
+		return StoneDetector( *this, CellIndex );
+	}
+
+	/**
+    * @brief Create masks of all projected stones in the atlas. Must be called once all detectors are initialized.
+    * @param InitImage [in] Initialisation image (for croping)
+	*/
+	void InitMasks( cv::Mat& InitImage );
+
+	/**
+    * @brief Create sample points of all detectors using a jittered grid over each projected stone.
+	*		 Must be called after InitMasks. The pattern is the same for each run (fixed seed).
+    * @param InitImage [in] Initialisation image (for croping)
+	* @param _NbSamplesPerCell [in] Number of samples per detector (0 to go back to dense processing)
+	*/
+	void InitSamples( cv::Mat& InitImage, int _NbSamplesPerCell );
+
+	/**
+    * @brief Save detected states, evidence and ages of the events in a checkpoint
+    * @param Checkpoint [in] Checkpoint being written
+	* @param CurrentTimestamp [in] Current timestamp, timestamps are saved relative to it
+	*/
+	void SaveState( BinaryCheckpoint& Checkpoint, double CurrentTimestamp );
+
+	/**
+    * @brief Restore detected states saved by SaveState. Detectors must be initialized.
+    * @param Checkpoint [in] Checkpoint being read
+	* @param CurrentTimestamp [in] Current timestamp, saved ages are restored relative to it
+	* @return false if the checkpoint does not match this goban
+	*/
+	bool LoadState( BinaryCheckpoint& Checkpoint, double CurrentTimestamp );
+};
+
+/**
+* @brief Constructor of a view on a detector
+* @param Storage [in] Storage of all detectors
+* @param CellIndex [in] Index of the detector within the storage
+*/
+inline StoneDetector::StoneDetector( StoneDetectorStorage& Storage, int CellIndex ) :
+	Center(Storage.Center[CellIndex]), radius(Storage.radius[CellIndex]), radius2(Storage.radius2[CellIndex]),
+	Fixed(Storage.Fixed[CellIndex]), NbPixelsInStone(Storage.NbPixelsInStone[CellIndex]),
+	State(Storage.State[CellIndex]), Timestamp(Storage.Timestamp[CellIndex]), PendingEvents(Storage.PendingEvents),
+	InMotion(Storage.InMotion[CellIndex]), InMotionExtended(Storage.InMotionExtended[CellIndex]),
+	MotionCount(Storage.MotionCount[CellIndex]), LastMotionEvent(Storage.LastMotionEvent[CellIndex]),
+	Evidence(Storage.Evidence[CellIndex]), EvidenceTimestamp(Storage.EvidenceTimestamp[CellIndex]), AwaitingRemoval(Storage.AwaitingRemoval[CellIndex]),
+	CellIndex(CellIndex), MotionKernel(Storage.MotionKernel), ScoreKernel(Storage.ScoreKernel),
+	EarlyExit(Storage.EarlyExit), MaskSize(Storage.MaskRect[CellIndex].size()),
+	SubDetectorPixels(&Storage.SubDetectorPixels[CellIndex*NbSubDetectors]), SubDetectorOrder(&Storage.SubDetectorOrder[CellIndex*NbSubDetectors]),
+	NbSamples(Storage.NbSamples[CellIndex])
+{
+	if ( Storage.NbSamplesPerCell > 0 )
+	{
+		SamplePoints = &Storage.SamplePoints[CellIndex*Storage.SampleStride];
+		SampleSubDetector = &Storage.SampleSubDetector[CellIndex*Storage.SampleStride];
+	}
+	else
+	{
+		// Dense processing
+		SamplePoints = nullptr;
+		SampleSubDetector = nullptr;
+	}
+
+	if ( Storage.MaskAtlas.empty() == true )
+	{
+		// Masks not computed yet
+		MaskStone = nullptr;
+		MaskStep = 0;
+		return;
+	}
+
+	const cv::Rect& CurMaskRect = Storage.MaskRect[CellIndex];
+	MaskStep = Storage.MaskAtlas.step;
+	MaskStone = Storage.MaskAtlas.ptr<unsigned char>( CurMaskRect.y ) + CurMaskRect.x;
+}
+
+#endif // __STONE_DETECTOR_STORAGE_H__
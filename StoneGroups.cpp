@@ -0,0 +1,327 @@
+/**
+ * @file StoneGroups.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "StoneGroups.h"
+
+/**
+* @brief Constructor
+* @param _NumColumns [in] Number of columns of the goban
+* @param _NumLines [in] Number of lines of the goban
+*/
+StoneGroups::StoneGroups( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines), NbCells(_NumColumns*_NumLines),
+	Color(NbCells, Empty), Parent(NbCells), Size(NbCells), Liberties(NbCells), Next(NbCells),
+	Keys(NbCells*StateModulo), GroupHash(NbCells)
+{
+	Rebuild.reserve( NbCells );
+
+	// Same keys for each run (splitmix64 with a fixed seed)
+	uint64_t Seed = 0x476F2D43616D5265ULL;
+	for ( size_t NumKey = 0; NumKey < Keys.size(); NumKey++ )
+	{
+		Seed += 0x9E3779B97F4A7C15ULL;
+		uint64_t Key = Seed;
+		Key = (Key ^ (Key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		Key = (Key ^ (Key >> 27)) * 0x94D049BB133111EBULL;
+		Keys[NumKey] = Key ^ (Key >> 31);
+	}
+
+	Clear();
+}
+
+/**
+* @brief Remove all stones
+*/
+void StoneGroups::Clear()
+{
+	for ( int Cell = 0; Cell < NbCells; Cell++ )
+	{
+		Color[Cell] = Empty;
+		MakeSingleton( Cell );
+		Liberties[Cell] = 0;
+	}
+	Hash = 0;
+}
+
+/**
+* @brief Set a stone as a group on its own
+* @param Cell [in] Cell of the stone
+*/
+void StoneGroups::MakeSingleton( int Cell )
+{
+	Parent[Cell] = Cell;
+	Next[Cell] = Cell;
+	Size[Cell] = 1;
+	GroupHash[Cell] = ( Color[Cell] == Empty ) ? 0 : GetKey( Cell, Color[Cell] );
+}
+
+/**
+* @brief Merge groups of 2 stones of the same color (union by size)
+* @param Cell1 [in] First stone
+* @param Cell2 [in] Second stone
+*/
+void StoneGroups::Union( int Cell1, int Cell2 )
+{
+	int Root1 = Find( Cell1 );
+	int Root2 = Find( Cell2 );
+	if ( Root1 == Root2 )
+	{
+		return;
+	}
+
+	if ( Size[Root1] < Size[Root2] )
+	{
+		int Tmp = Root1;
+		Root1 = Root2;
+		Root2 = Tmp;
+	}
+
+	Parent[Root2] = Root1;
+	Size[Root1] += Size[Root2];
+	Liberties[Root1] += Liberties[Root2];
+	GroupHash[Root1] ^= GroupHash[Root2];
+
+	// Splice circular lists of stones
+	int Tmp = Next[Root1];
+	Next[Root1] = Next[Root2];
+	Next[Root2] = Tmp;
+}
+
+/**
+* @brief Remove a whole group from the goban and give back liberties to its neighbours
+* @param Root [in] Root cell of the group
+* @param Removed [out] Removed cells are added at the end
+*/
+void StoneGroups::RemoveGroup( int Root, std::vector<int>& Removed )
+{
+	size_t FirstRemoved = Removed.size();
+	Hash ^= GroupHash[Root];
+
+	// Take all stones away first, then give back liberties to remaining neighbours
+	int Cell = Root;
+	do
+	{
+		Removed.push_back( Cell );
+		Color[Cell] = Empty;
+		Cell = Next[Cell];
+	}
+	while ( Cell != Root );
+
+	for ( size_t Pos = FirstRemoved; Pos < Removed.size(); Pos++ )
+	{
+		int Neighbours[4];
+		int NbNeighbours = GetNeighbours( Removed[Pos], Neighbours );
+		for ( int n = 0; n < NbNeighbours; n++ )
+		{
+			if ( Color[Neighbours[n]] != Empty )
+			{
+				Liberties[Find( Neighbours[n] )]++;
+			}
+		}
+	}
+
+	for ( size_t Pos = FirstRemoved; Pos < Removed.size(); Pos++ )
+	{
+		MakeSingleton( Removed[Pos] );
+		Liberties[Removed[Pos]] = 0;
+	}
+}
+
+/**
+* @brief Check a move on an empty cell without playing it, in O(1)
+* @param a [in] column of the goban
+* @param b [in] line of the goban
+* @param StoneColor [in] Color of the stone (Black or White)
+* @param NewHash [out] Hash of the position after the move and its captures
+* @return false if the move is a suicide
+*/
+bool StoneGroups::CheckMove( int a, int b, int StoneColor, uint64_t& NewHash )
+{
+	int Cell = a*NumLines+b;
+	NewHash = Hash ^ GetKey( Cell, StoneColor );
+
+	int Neighbours[4];
+	int Roots[4];
+	int NbNeighbours = GetNeighbours( Cell, Neighbours );
+	for ( int n = 0; n < NbNeighbours; n++ )
+	{
+		Roots[n] = ( Color[Neighbours[n]] == Empty ) ? -1 : Find( Neighbours[n] );
+	}
+
+	bool HasLiberty = false;
+	for ( int n = 0; n < NbNeighbours; n++ )
+	{
+		if ( Roots[n] == -1 )
+		{
+			HasLiberty = true;
+			continue;
+		}
+
+		// Each adjacent group once: the move takes one pseudo-liberty per adjacent stone of the group
+		int NbAdjacent = 1;
+		bool AlreadySeen = false;
+		for ( int m = 0; m < NbNeighbours; m++ )
+		{
+			if ( m != n && Roots[m] == Roots[n] )
+			{
+				AlreadySeen = AlreadySeen || ( m < n );
+				NbAdjacent++;
+			}
+		}
+		if ( AlreadySeen == true )
+		{
+			continue;
+		}
+
+		bool NoLibertyLeft = ( Liberties[Roots[n]] == NbAdjacent );
+		if ( Color[Neighbours[n]] == StoneColor )
+		{
+			// Connected to a friendly group with another liberty
+			HasLiberty = HasLiberty || ( NoLibertyLeft == false );
+		}
+		else if ( NoLibertyLeft == true )
+		{
+			// Opponent group captured, its stones leave the position and give a liberty
+			NewHash ^= GroupHash[Roots[n]];
+			HasLiberty = true;
+		}
+	}
+
+	return HasLiberty;
+}
+
+/**
+* @brief Play a stone on an empty cell and remove opponent groups left without liberty
+* @param a [in] column of the goban
+* @param b [in] line of the goban
+* @param StoneColor [in] Color of the stone (Black or White)
+* @param Captured [out] Captured cells (capacity reserved for the whole goban, no allocation)
+* @return Number of captured stones
+*/
+int StoneGroups::Play( int a, int b, int StoneColor, std::vector<int>& Captured )
+{
+	int Cell = a*NumLines+b;
+	Captured.clear();
+
+	if ( Color[Cell] != Empty )
+	{
+		// Stone replaced by hand, start from an empty cell
+		Remove( a, b );
+	}
+
+	int Neighbours[4];
+	int NbNeighbours = GetNeighbours( Cell, Neighbours );
+
+	Color[Cell] = StoneColor;
+	MakeSingleton( Cell );
+	Liberties[Cell] = 0;
+	Hash ^= GetKey( Cell, StoneColor );
+
+	for ( int n = 0; n < NbNeighbours; n++ )
+	{
+		if ( Color[Neighbours[n]] == Empty )
+		{
+			Liberties[Cell]++;
+		}
+	}
+
+	for ( int n = 0; n < NbNeighbours; n++ )
+	{
+		int Neighbour = Neighbours[n];
+		if ( Color[Neighbour] == Empty )
+		{
+			continue;
+		}
+
+		// The new stone takes one liberty of each adjacent group, once per adjacent stone
+		Liberties[Find( Neighbour )]--;
+		if ( Color[Neighbour] == StoneColor )
+		{
+			Union( Cell, Neighbour );
+		}
+	}
+
+	// Opponent groups without liberty are captured
+	for ( int n = 0; n < NbNeighbours; n++ )
+	{
+		int Neighbour = Neighbours[n];
+		if ( Color[Neighbour] != Empty && Color[Neighbour] != StoneColor && Liberties[Find( Neighbour )] == 0 )
+		{
+			RemoveGroup( Find( Neighbour ), Captured );
+		}
+	}
+
+	return (int)Captured.size();
+}
+
+/**
+* @brief Remove a single stone (removed by hand, not captured). The rest of its group is rebuilt.
+* @param a [in] column of the goban
+* @param b [in] line of the goban
+*/
+void StoneGroups::Remove( int a, int b )
+{
+	int Cell = a*NumLines+b;
+	int StoneColor = Color[Cell];
+	if ( StoneColor == Empty )
+	{
+		return;
+	}
+
+	// Other stones of the group
+	Rebuild.clear();
+	for ( int Member = Next[Cell]; Member != Cell; Member = Next[Member] )
+	{
+		Rebuild.push_back( Member );
+	}
+
+	Color[Cell] = Empty;
+	MakeSingleton( Cell );
+	Liberties[Cell] = 0;
+	Hash ^= GetKey( Cell, StoneColor );
+
+	// Remaining stones may be split in several groups, rebuild them
+	for ( size_t Pos = 0; Pos < Rebuild.size(); Pos++ )
+	{
+		int Member = Rebuild[Pos];
+		int Neighbours[4];
+		int NbNeighbours = GetNeighbours( Member, Neighbours );
+
+		MakeSingleton( Member );
+		Liberties[Member] = 0;
+		for ( int n = 0; n < NbNeighbours; n++ )
+		{
+			if ( Color[Neighbours[n]] == Empty )
+			{
+				Liberties[Member]++;
+			}
+		}
+	}
+
+	for ( size_t Pos = 0; Pos < Rebuild.size(); Pos++ )
+	{
+		int Neighbours[4];
+		int NbNeighbours = GetNeighbours( Rebuild[Pos], Neighbours );
+		for ( int n = 0; n < NbNeighbours; n++ )
+		{
+			if ( Color[Neighbours[n]] == StoneColor )
+			{
+				Union( Rebuild[Pos], Neighbours[n] );
+			}
+		}
+	}
+
+	// Opponent groups around get a liberty back (rebuilt groups already counted it)
+	int Neighbours[4];
+	int NbNeighbours = GetNeighbours( Cell, Neighbours );
+	for ( int n = 0; n < NbNeighbours; n++ )
+	{
+		if ( Color[Neighbours[n]] != Empty && Color[Neighbours[n]] != StoneColor )
+		{
+			Liberties[Find( Neighbours[n] )]++;
+		}
+	}
+}
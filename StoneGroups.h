@@ -0,0 +1,198 @@
+/**
+ * @file StoneGroups.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __STONE_GROUPS_H__
+#define __STONE_GROUPS_H__
+
+#include "StoneState.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @class StoneGroups
+ * @brief Incremental tracking of groups (chains) of stones using a union-find structure. Each group holds
+ *		  its pseudo-liberty count (empty neighbours counted once per adjacent stone): a group has no liberty
+ *		  if and only if this count is 0. Placing a stone costs O(alpha), a capture costs the size of the captured
+ *		  group. Memory is allocated in the constructor only. Cells are numbered a*NumLines+b.
+ *		  A Zobrist hash of the position is kept up to date, each group holding the hash of its stones.
+ */
+class StoneGroups : public StoneState
+{
+public:
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+	*/
+	StoneGroups( int _NumColumns, int _NumLines );
+
+	/**
+    * @brief Virtual destructor
+	*/
+	virtual ~StoneGroups() {}
+
+	/**
+    * @brief Remove all stones
+	*/
+	void Clear();
+
+	/**
+    * @brief Get color of a cell
+    * @param a [in] column of the goban
+    * @param b [in] line of the goban
+    * @return Black, White or Empty
+	*/
+	inline int GetColor( int a, int b ) const
+	{
+		return Color[a*NumLines+b];
+	}
+
+	/**
+    * @brief Get number of pseudo-liberties of the group of a stone
+    * @param a [in] column of the goban
+    * @param b [in] line of the goban
+    * @return Pseudo-liberties, 0 if the group has no liberty (or if the cell is empty)
+	*/
+	inline int GetPseudoLiberties( int a, int b )
+	{
+		int Cell = a*NumLines+b;
+		return ( Color[Cell] == Empty ) ? 0 : Liberties[Find( Cell )];
+	}
+
+	/**
+    * @brief Get number of stones of the group of a stone
+    * @param a [in] column of the goban
+    * @param b [in] line of the goban
+    * @return Size of the group (0 if the cell is empty)
+	*/
+	inline int GetGroupSize( int a, int b )
+	{
+		int Cell = a*NumLines+b;
+		return ( Color[Cell] == Empty ) ? 0 : Size[Find( Cell )];
+	}
+
+	/**
+    * @brief Get Zobrist hash of the current position
+    * @return Hash (0 for an empty goban)
+	*/
+	inline uint64_t GetHash() const
+	{
+		return Hash;
+	}
+
+	/**
+    * @brief Check a move on an empty cell without playing it, in O(1)
+    * @param a [in] column of the goban
+    * @param b [in] line of the goban
+    * @param StoneColor [in] Color of the stone (Black or White)
+    * @param NewHash [out] Hash of the position after the move and its captures
+    * @return false if the move is a suicide
+	*/
+	bool CheckMove( int a, int b, int StoneColor, uint64_t& NewHash );
+
+	/**
+    * @brief Play a stone on an empty cell and remove opponent groups left without liberty
+    * @param a [in] column of the goban
+    * @param b [in] line of the goban
+    * @param StoneColor [in] Color of the stone (Black or White)
+    * @param Captured [out] Captured cells (capacity reserved for the whole goban, no allocation)
+    * @return Number of captured stones
+	*/
+	int Play( int a, int b, int StoneColor, std::vector<int>& Captured );
+
+	/**
+    * @brief Remove a single stone (removed by hand, not captured). The rest of its group is rebuilt.
+    * @param a [in] column of the goban
+    * @param b [in] line of the goban
+	*/
+	void Remove( int a, int b );
+
+protected:
+	/**
+    * @brief Find root of the group of a stone, with path halving
+    * @param Cell [in] Cell of a stone
+    * @return Root cell of the group
+	*/
+	inline int Find( int Cell )
+	{
+		while ( Parent[Cell] != Cell )
+		{
+			Parent[Cell] = Parent[Parent[Cell]];
+			Cell = Parent[Cell];
+		}
+		return Cell;
+	}
+
+	/**
+    * @brief Merge groups of 2 stones of the same color (union by size)
+    * @param Cell1 [in] First stone
+    * @param Cell2 [in] Second stone
+	*/
+	void Union( int Cell1, int Cell2 );
+
+	/**
+    * @brief Set a stone as a group on its own
+    * @param Cell [in] Cell of the stone
+	*/
+	void MakeSingleton( int Cell );
+
+	/**
+    * @brief Get Zobrist key of a stone
+    * @param Cell [in] Cell of the stone
+    * @param StoneColor [in] Black or White
+    * @return Random key
+	*/
+	inline uint64_t GetKey( int Cell, int StoneColor ) const
+	{
+		return Keys[Cell*StateModulo+StoneColor];
+	}
+
+	/**
+    * @brief Get neighbours of a cell
+    * @param Cell [in] Cell
+    * @param Neighbours [out] Neighbour cells (4 max)
+    * @return Number of neighbours
+	*/
+	inline int GetNeighbours( int Cell, int Neighbours[4] ) const
+	{
+		int a = Cell/NumLines;
+		int b = Cell%NumLines;
+		int NbNeighbours = 0;
+
+		if ( a > 0 )			{ Neighbours[NbNeighbours++] = Cell-NumLines; }
+		if ( a < NumColumns-1 )	{ Neighbours[NbNeighbours++] = Cell+NumLines; }
+		if ( b > 0 )			{ Neighbours[NbNeighbours++] = Cell-1; }
+		if ( b < NumLines-1 )	{ Neighbours[NbNeighbours++] = Cell+1; }
+
+		return NbNeighbours;
+	}
+
+	/**
+    * @brief Remove a whole group from the goban and give back liberties to its neighbours
+    * @param Root [in] Root cell of the group
+    * @param Removed [out] Removed cells are added at the end
+	*/
+	void RemoveGroup( int Root, std::vector<int>& Removed );
+
+	int NumColumns;							// Number of columns of the goban
+	int NumLines;							// Number of lines of the goban
+	int NbCells;							// NumColumns*NumLines
+	std::vector<int> Color;					// Color of each cell
+	std::vector<int> Parent;				// Union-find parent of each stone
+	std::vector<int> Size;					// Number of stones of each group (valid for roots)
+	std::vector<int> Liberties;				// Pseudo-liberties of each group (valid for roots)
+	std::vector<int> Next;					// Circular list of the stones of each group
+	std::vector<int> Rebuild;				// Stones of a group to rebuild after a single removal
+	std::vector<uint64_t> Keys;				// Zobrist key of each cell and color
+	std::vector<uint64_t> GroupHash;		// Xor of the keys of the stones of each group (valid for roots)
+	uint64_t Hash;							// Zobrist hash of the position
+};
+
+#endif // __STONE_GROUPS_H__
@@ -0,0 +1,54 @@
+/**
+ * @file Bitboard.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "Bitboard.h"
+
+/**
+* @brief Constructor
+* @param _NumColumns [in] Number of columns of the goban
+* @param _NumLines [in] Number of lines of the goban (less than 64)
+*/
+BitboardGeometry::BitboardGeometry( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines)
+{
+	for ( int a = 0; a < NumColumns; a++ )
+	{
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			int Cell = a*NumLines+b;
+			OnBoard.Set( Cell );
+			if ( b > 0 )
+			{
+				NotFirstLine.Set( Cell );
+			}
+			if ( b < NumLines-1 )
+			{
+				NotLastLine.Set( Cell );
+			}
+		}
+	}
+}
+
+/**
+* @brief Group of cells connected to a seed within a set (flood fill)
+* @param Seed [in] Starting cells
+* @param Within [in] Cells the group may contain
+* @return Connected cells of Within reached from Seed
+*/
+Bitboard BitboardGeometry::FloodFill( const Bitboard& Seed, const Bitboard& Within ) const
+{
+	// Grow the whole frontier at once until it is stable
+	Bitboard Group = Seed & Within;
+	for(;;)
+	{
+		Bitboard Frontier = Neighbours( Group ) & Within;
+		if ( Frontier.IsEmpty() == true )
+		{
+			return Group;
+		}
+		Group |= Frontier;
+	}
+}
@@ -0,0 +1,270 @@
+/**
+ * @file Bitboard.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __BITBOARD_H__
+#define __BITBOARD_H__
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+	#define BitboardPopCount(Word) ((int)__popcnt64(Word))
+#else
+	#define BitboardPopCount(Word) __builtin_popcountll(Word)
+#endif
+
+#define MaxBitboardCells 640	// Capacity of a bitboard, enough for a 25x25 goban (625 cells)
+#define BitboardWords (MaxBitboardCells/64)	// 64 bits words of a bitboard
+
+/**
+ * @class Bitboard
+ * @brief Set of goban cells stored as bits. Cells are numbered a*NumLines+b, thus b+1 is the next bit
+ *		  and a+1 is NumLines bits further. Geometry (borders) is handled by BitboardGeometry.
+ *		  Capacity is fixed so that bitboards are plain values, never allocated on the capture path.
+ */
+class Bitboard
+{
+public:
+	uint64_t Words[BitboardWords];		// Bits of the set
+
+	/**
+    * @brief Constructor, empty set
+	*/
+	Bitboard()
+	{
+		Clear();
+	}
+
+	/**
+    * @brief Remove all cells
+	*/
+	inline void Clear()
+	{
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Words[w] = 0;
+		}
+	}
+
+	/**
+    * @brief Is a cell in the set?
+    * @param Cell [in] Cell number
+    * @return true if the cell is in the set
+	*/
+	inline bool Test( int Cell ) const
+	{
+		return ( (Words[Cell >> 6] >> (Cell & 63)) & 1 ) != 0;
+	}
+
+	/**
+    * @brief Add a cell
+    * @param Cell [in] Cell number
+	*/
+	inline void Set( int Cell )
+	{
+		Words[Cell >> 6] |= (uint64_t)1 << (Cell & 63);
+	}
+
+	/**
+    * @brief Remove a cell
+    * @param Cell [in] Cell number
+	*/
+	inline void Reset( int Cell )
+	{
+		Words[Cell >> 6] &= ~((uint64_t)1 << (Cell & 63));
+	}
+
+	/**
+    * @brief Is the set empty?
+    * @return true if no cell is in the set
+	*/
+	inline bool IsEmpty() const
+	{
+		uint64_t All = 0;
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			All |= Words[w];
+		}
+		return ( All == 0 );
+	}
+
+	/**
+    * @brief Number of cells in the set
+    * @return Number of cells
+	*/
+	inline int PopCount() const
+	{
+		int Count = 0;
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Count += BitboardPopCount( Words[w] );
+		}
+		return Count;
+	}
+
+	/**
+    * @brief Set comparison
+    * @param Other [in] Other set
+    * @return true if both sets hold the same cells
+	*/
+	inline bool operator==( const Bitboard& Other ) const
+	{
+		uint64_t Diff = 0;
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Diff |= Words[w] ^ Other.Words[w];
+		}
+		return ( Diff == 0 );
+	}
+
+	inline bool operator!=( const Bitboard& Other ) const
+	{
+		return !(*this == Other);
+	}
+
+	inline Bitboard operator|( const Bitboard& Other ) const
+	{
+		Bitboard Result;
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Result.Words[w] = Words[w] | Other.Words[w];
+		}
+		return Result;
+	}
+
+	inline Bitboard operator&( const Bitboard& Other ) const
+	{
+		Bitboard Result;
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Result.Words[w] = Words[w] & Other.Words[w];
+		}
+		return Result;
+	}
+
+	/**
+    * @brief Set difference
+    * @param Other [in] Cells to remove
+    * @return Cells of this set not in Other
+	*/
+	inline Bitboard AndNot( const Bitboard& Other ) const
+	{
+		Bitboard Result;
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Result.Words[w] = Words[w] & ~Other.Words[w];
+		}
+		return Result;
+	}
+
+	inline Bitboard& operator|=( const Bitboard& Other )
+	{
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Words[w] |= Other.Words[w];
+		}
+		return *this;
+	}
+
+	/**
+    * @brief Remove cells of another set
+    * @param Other [in] Cells to remove
+	*/
+	inline void Remove( const Bitboard& Other )
+	{
+		for ( int w = 0; w < BitboardWords; w++ )
+		{
+			Words[w] &= ~Other.Words[w];
+		}
+	}
+
+	/**
+    * @brief Move all cells to higher cell numbers
+    * @param Shift [in] Number of cells (0 < Shift < 64)
+    * @return Shifted set, cells going out of the words are lost
+	*/
+	inline Bitboard ShiftUp( int Shift ) const
+	{
+		Bitboard Result;
+		Result.Words[0] = Words[0] << Shift;
+		for ( int w = 1; w < BitboardWords; w++ )
+		{
+			Result.Words[w] = (Words[w] << Shift) | (Words[w-1] >> (64-Shift));
+		}
+		return Result;
+	}
+
+	/**
+    * @brief Move all cells to lower cell numbers
+    * @param Shift [in] Number of cells (0 < Shift < 64)
+    * @return Shifted set
+	*/
+	inline Bitboard ShiftDown( int Shift ) const
+	{
+		Bitboard Result;
+		for ( int w = 0; w < BitboardWords-1; w++ )
+		{
+			Result.Words[w] = (Words[w] >> Shift) | (Words[w+1] << (64-Shift));
+		}
+		Result.Words[BitboardWords-1] = Words[BitboardWords-1] >> Shift;
+		return Result;
+	}
+};
+
+/**
+ * @class BitboardGeometry
+ * @brief Masks of a goban size to compute neighbours, liberties and groups with word-wide shifts
+ */
+class BitboardGeometry
+{
+public:
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban (less than 64)
+	*/
+	BitboardGeometry( int _NumColumns, int _NumLines );
+
+	int NumColumns;					// Number of columns of the goban
+	int NumLines;					// Number of lines of the goban
+	Bitboard OnBoard;				// All cells of the goban
+	Bitboard NotFirstLine;			// Cells with b > 0
+	Bitboard NotLastLine;			// Cells with b < NumLines-1
+
+	/**
+    * @brief Cells adjacent (4-connexity) to a set, not in the set
+    * @param Set [in] Set of cells
+    * @return Neighbours of the set
+	*/
+	inline Bitboard Neighbours( const Bitboard& Set ) const
+	{
+		Bitboard Result = (Set.ShiftUp( 1 ) & NotFirstLine) | (Set.ShiftDown( 1 ) & NotLastLine) | Set.ShiftUp( NumLines ) | Set.ShiftDown( NumLines );
+		return (Result & OnBoard).AndNot( Set );
+	}
+
+	/**
+    * @brief Group of cells connected to a seed within a set (flood fill)
+    * @param Seed [in] Starting cells
+    * @param Within [in] Cells the group may contain
+    * @return Connected cells of Within reached from Seed
+	*/
+	Bitboard FloodFill( const Bitboard& Seed, const Bitboard& Within ) const;
+
+	/**
+    * @brief Number of liberties of a group
+    * @param Group [in] Stones of the group
+    * @param EmptyCells [in] Empty cells of the goban
+    * @return Number of distinct empty cells adjacent to the group
+	*/
+	inline int CountLiberties( const Bitboard& Group, const Bitboard& EmptyCells ) const
+	{
+		return (Neighbours( Group ) & EmptyCells).PopCount();
+	}
+};
+
+#endif // __BITBOARD_H__
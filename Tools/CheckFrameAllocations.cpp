@@ -0,0 +1,194 @@
+/**
+ * @file CheckFrameAllocations.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "../Go-CamRecorder.h"
+#include "../GobanDetector.h"
+#include "../MultiSourceVideo.h"
+#include "../AllocationCounter.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/**
+* @brief Replay a calibrated video with the frame loop of the recorder and check that steady state frames do not
+*		 allocate. The whole loop body is counted: frame decoding, processing, checkpoint, feedback and game drawing.
+*		 Frames with a committed event or a written checkpoint may allocate (SGF and checkpoint files), they are only reported.
+*/
+int main( int argc, char *argv[] )
+{
+	if ( argc < 2 || strcasecmp("-h", argv[1]) == 0 || strcasecmp("-help", argv[1]) == 0 || strcasecmp("--help", argv[1]) == 0 )
+	{
+		fprintf( stderr, "Usage: %s <video file> [-sz <goban size|columnsxlines>] [-rectify] [-fused] [-budget <ms>] [-o <output folder>]\n", argv[0] );
+		fprintf( stderr, "Replay a video calibrated with Go-CamRecorder ('<video file>.calib' must exist) and fail if a steady state frame allocates.\n" );
+		return ( argc >= 2 ) ? 0 : -1;
+	}
+
+	if ( AllocationCounter::IsEnabled() == false )
+	{
+		fprintf( stderr, "Allocations are not counted, build with cmake -DCOUNT_ALLOCATIONS=1\n" );
+		return -1;
+	}
+
+	Omiscid::SimpleString VideoFileName = argv[1];
+	Omiscid::SimpleString OutputFolderName = "./";
+	int NumColumns = 19;
+	int NumLines = 19;
+	bool RectifiedMode = false;
+	bool FusedTiles = false;
+	double FrameBudget = 0.0;
+
+	for ( int PosArg = 2; PosArg < argc; PosArg++ )
+	{
+		if ( strcasecmp("-sz", argv[PosArg]) == 0 && PosArg+1 < argc )
+		{
+			PosArg++;
+			if ( sscanf( argv[PosArg], "%dx%d", &NumColumns, &NumLines ) == 1 )
+			{
+				NumLines = NumColumns;
+			}
+		}
+		else if ( strcasecmp("-rectify", argv[PosArg]) == 0 )
+		{
+			RectifiedMode = true;
+		}
+		else if ( strcasecmp("-fused", argv[PosArg]) == 0 )
+		{
+			FusedTiles = true;
+		}
+		else if ( strcasecmp("-budget", argv[PosArg]) == 0 && PosArg+1 < argc )
+		{
+			PosArg++;
+			FrameBudget = atof(argv[PosArg])/1000.0;
+		}
+		else if ( strcasecmp("-o", argv[PosArg]) == 0 && PosArg+1 < argc )
+		{
+			PosArg++;
+			OutputFolderName = argv[PosArg];
+		}
+		else
+		{
+			fprintf( stderr, "Unknown option '%s'\n", argv[PosArg] );
+			return -1;
+		}
+	}
+
+	// No interactive calibration here
+	FILE * CalibrationFile = fopen( (VideoFileName + ".calib").GetStr(), "r" );
+	if ( CalibrationFile == nullptr )
+	{
+		fprintf( stderr, "Could not find calibration '%s.calib'\n", VideoFileName.GetStr() );
+		return -1;
+	}
+	fclose( CalibrationFile );
+
+	ConfigInfo Config;
+	Config.Load();
+
+	MultiVideoSource Vid;
+	Vid.Open( VideoFileName.GetStr() );
+	if ( Vid.IsOpen() == false )
+	{
+		fprintf( stderr, "Could not open video file '%s'\n", VideoFileName.GetStr() );
+		return -1;
+	}
+
+	GobanDetector Goban( NumColumns, NumLines );
+	Goban.SetRectifiedMode( RectifiedMode );
+	Goban.SetFusedTiles( FusedTiles );
+	Goban.SetFrameBudget( FrameBudget );
+	Goban.SetCheckpoint( OutputFolderName + "CheckFrameAllocations.checkpoint" );
+	if ( Goban.GetCalibration( VideoFileName, Vid ) == false )
+	{
+		return -1;
+	}
+
+	Omiscid::SimpleString EventName = "CheckFrameAllocations", RoundName, Rule = "Japanese", Komi = DefaultKomi;
+	Omiscid::SimpleString Date = "Check", Time = "Allocations", BlackPlayerName = "Black", WhitePlayerName = "White";
+	if ( Goban.GameState.SGFWriter.Open( OutputFolderName, EventName, RoundName, Rule, Komi, Date, Time, BlackPlayerName, WhitePlayerName ) == false )
+	{
+		fprintf( stderr, "Could not open output SGF file in '%s'\n", OutputFolderName.GetStr() );
+		return -1;
+	}
+
+	// Same images as the recorder: feedback and game state drawn in a video image
+	cv::Size FeedbackSize = Goban.GetFeedbackImageSize();
+	cv::Mat VideoImage( FeedbackSize.height, FeedbackSize.width*2, CV_8UC3 );
+	cv::Mat GobanImage( VideoImage, cv::Rect( 0, 0, FeedbackSize.width, FeedbackSize.height ) );
+	cv::Mat PlaceImage( VideoImage, cv::Rect( FeedbackSize.width, 0, FeedbackSize.width, FeedbackSize.height ) );
+	Goban.GameState.DrawGoban( GobanImage );
+
+	cv::Mat LoadImage;
+	cv::Mat DepthImage;
+	if ( Vid.ReadFrame( LoadImage, DepthImage ) == false )
+	{
+		fprintf( stderr, "Could not read init frame\n" );
+		return -1;
+	}
+	Goban.InitDetection( DepthImage.empty() ? LoadImage : DepthImage );
+
+	int NumFrame = 1;
+	int NbCheckedFrames = 0;
+	int NbFailedFrames = 0;
+	int NbEventFrames = 0;
+	long long int NbEventAllocations = 0;
+	for ( ;; NumFrame++ )
+	{
+		// Whole loop body, from decoding to drawing
+		long long int NbAllocationsBefore = AllocationCounter::GetNbAllocations();
+		size_t NbCommitsBefore = Goban.GameState.GetNbCommits();
+
+		if ( Vid.ReadFrame( LoadImage, DepthImage ) == false )
+		{
+			break;
+		}
+		double CurTime = Vid.GetTimestamp();
+
+		Goban.ProcessCurrentFrame( LoadImage, DepthImage, CurTime, Config.BlackThreshold, Config.WhiteThreshold, true );
+		bool CheckpointWritten = Goban.CheckpointIfNeeded( CurTime );
+
+		cv::Mat FeedbackImage = Goban.GetFeedbackImage( LoadImage );
+		if ( FeedbackImage.size() == PlaceImage.size() )
+		{
+			FeedbackImage.copyTo( PlaceImage );
+		}
+		else
+		{
+			cv::resize( FeedbackImage, PlaceImage, PlaceImage.size() );
+		}
+		Goban.GameState.DrawCurrentState( GobanImage, CurTime );
+
+		long long int NbFrameAllocations = AllocationCounter::GetNbAllocations() - NbAllocationsBefore;
+		if ( NumFrame <= AllocationWarmupFrames )
+		{
+			continue;
+		}
+
+		if ( CheckpointWritten == true || Goban.GameState.GetNbCommits() != NbCommitsBefore )
+		{
+			NbEventFrames++;
+			NbEventAllocations += NbFrameAllocations;
+			continue;
+		}
+
+		NbCheckedFrames++;
+		if ( NbFrameAllocations != 0 )
+		{
+			fprintf( stderr, "Frame %d (%.3lf s): %lld heap allocations in steady state\n", NumFrame, CurTime, NbFrameAllocations );
+			NbFailedFrames++;
+		}
+	}
+
+	Omiscid::SimpleString Result = "?";
+	Goban.GameState.SGFWriter.Close( Result );
+	Goban.RemoveCheckpoint();
+
+	fprintf( stderr, "%d steady state frames checked, %d allocating. %d frames with a commit or a checkpoint (%lld allocations, not checked).\n",
+		NbCheckedFrames, NbFailedFrames, NbEventFrames, NbEventAllocations );
+
+	return ( NbFailedFrames == 0 && NbCheckedFrames > 0 ) ? 0 : -1;
+}
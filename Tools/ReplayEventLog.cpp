@@ -0,0 +1,380 @@
+/**
+ * @file ReplayEventLog.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "../EventLogRecord.h"
+#include "../StoneGroups.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+#define RecordsPerBlock 4096		// Number of records read at once
+
+/**
+ * @class EventLogReader
+ * @brief Random access to the records of an event log, records are read by blocks
+ */
+class EventLogReader
+{
+public:
+	EventLogHeader Header;					// Header of the log
+	long long NbRecords = 0;				// Number of complete records
+
+	/**
+    * @brief Destructor
+	*/
+	~EventLogReader()
+	{
+		if ( File != nullptr )
+		{
+			fclose( File );
+		}
+	}
+
+	/**
+    * @brief Open a log and check its header
+    * @param FileName [in] Event log
+    * @return true if the log can be read
+	*/
+	bool Open( const char * FileName )
+	{
+		File = fopen( FileName, "rb" );
+		if ( File == nullptr )
+		{
+			fprintf( stderr, "Could not open '%s'\n", FileName );
+			return false;
+		}
+
+		if ( fread( &Header, sizeof(Header), 1, File ) != 1 || memcmp( Header.Magic, EventLogMagic, sizeof(EventLogMagic) ) != 0 ||
+			Header.Version != EventLogVersion || Header.RecordSize != (int32_t)sizeof(EventLogRecord) || Header.NumColumns <= 1 || Header.NumLines <= 1 )
+		{
+			fprintf( stderr, "'%s' is not a valid event log\n", FileName );
+			return false;
+		}
+
+		// A log of a crashed session may end with a partial record
+		fseek( File, 0, SEEK_END );
+		long long FileSize = (long long)ftell( File );
+		NbRecords = ( FileSize - (long long)sizeof(Header) )/(long long)sizeof(EventLogRecord);
+		return true;
+	}
+
+	/**
+    * @brief Get a record
+    * @param Index [in] Index of the record (0 to NbRecords-1)
+    * @return The record
+	*/
+	const EventLogRecord& Get( long long Index )
+	{
+		long long Block = Index/RecordsPerBlock;
+		if ( Block != CurrentBlock )
+		{
+			long long First = Block*RecordsPerBlock;
+			size_t NbToRead = (size_t)std::min( (long long)RecordsPerBlock, NbRecords-First );
+			Records.resize( NbToRead );
+			fseek( File, (long)(sizeof(Header) + First*sizeof(EventLogRecord)), SEEK_SET );
+			if ( fread( &Records[0], sizeof(EventLogRecord), NbToRead, File ) != NbToRead )
+			{
+				memset( &Records[0], 0, NbToRead*sizeof(EventLogRecord) );
+			}
+			CurrentBlock = Block;
+		}
+		return Records[(size_t)(Index-CurrentBlock*RecordsPerBlock)];
+	}
+
+	/**
+    * @brief Binary search of the first record after a timestamp, records are in timestamp order
+    * @param Timestamp [in] Timestamp
+    * @return Number of records with a timestamp lower or equal to Timestamp
+	*/
+	long long CountUntil( double Timestamp )
+	{
+		long long Low = 0, High = NbRecords;
+		while ( Low < High )
+		{
+			long long Middle = Low + (High-Low)/2;
+			if ( Get( Middle ).Timestamp <= Timestamp )
+			{
+				Low = Middle+1;
+			}
+			else
+			{
+				High = Middle;
+			}
+		}
+		return Low;
+	}
+
+protected:
+	FILE * File = nullptr;					// Log file
+	long long CurrentBlock = -1;			// Block in Records
+	std::vector<EventLogRecord> Records;	// Current block of records
+};
+
+/**
+ * @class ReplayedState
+ * @brief Board and detector state rebuilt from an event log
+ */
+class ReplayedState : public StoneState
+{
+public:
+	class Event
+	{
+	public:
+		bool IsMove;	// Move or removal by hand
+		int Color;		// Color of the stone
+		int Cell;		// Cell (a*NumLines+b)
+		int NumMove;	// Move number (number of moves before a removal)
+	};
+
+	int NumColumns;
+	int NumLines;
+	std::vector<int> Detected;				// Detected state of each cell
+	std::vector<unsigned char> Motion;		// Extended motion flag of each cell
+	std::vector<int> Provisional;			// Color of the provisional move of each cell, Empty if none
+	std::vector<Event> Events;				// Committed events, oldest first
+	int NbGaps = 0;							// Gap records replayed: the state may miss dropped records
+	long long NbLostRecords = 0;			// Number of records dropped in these gaps
+
+	/**
+    * @brief Constructor, empty goban
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+	*/
+	ReplayedState( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines), Detected(_NumColumns*_NumLines, Empty),
+		Motion(_NumColumns*_NumLines, 0), Provisional(_NumColumns*_NumLines, Empty)
+	{
+	}
+
+	/**
+    * @brief Load a snapshot
+    * @param Reader [in] Log
+    * @param Index [in] Index of the Snapshot record
+    * @return Index of the first record after the snapshot
+	*/
+	long long LoadSnapshot( EventLogReader& Reader, long long Index )
+	{
+		const EventLogRecord SnapshotRecord = Reader.Get( Index++ );
+		for ( int n = 0; n < SnapshotRecord.Value && Index < Reader.NbRecords; n++, Index++ )
+		{
+			const EventLogRecord& Record = Reader.Get( Index );
+			if ( Record.Type == EventLogRecord::SnapshotCell && IsValidCell( Record.Cell ) )
+			{
+				Detected[Record.Cell] = Record.Value;
+				Motion[Record.Cell] = (unsigned char)Record.NumMove;
+			}
+		}
+
+		// Provisional moves are not part of a snapshot, they are seen again on the next settled frames
+		std::fill( Provisional.begin(), Provisional.end(), (int)Empty );
+
+		// Events are listed newest first
+		Events.clear();
+		for ( int n = 0; n < SnapshotRecord.NumMove && Index < Reader.NbRecords; n++, Index++ )
+		{
+			const EventLogRecord& Record = Reader.Get( Index );
+			if ( IsValidCell( Record.Cell ) == false )
+			{
+				continue;
+			}
+			Event NewEvent;
+			NewEvent.IsMove = ( Record.Type == EventLogRecord::SnapshotMove );
+			NewEvent.Color = Record.Value;
+			NewEvent.Cell = Record.Cell;
+			NewEvent.NumMove = Record.NumMove;
+			Events.push_back( NewEvent );
+		}
+		std::reverse( Events.begin(), Events.end() );
+
+		return Index;
+	}
+
+	/**
+    * @brief Apply a record
+    * @param Record [in] Record to apply
+	*/
+	void Apply( const EventLogRecord& Record )
+	{
+		if ( Record.Type == EventLogRecord::Gap )
+		{
+			NbGaps++;
+			NbLostRecords += Record.Value;
+			return;
+		}
+
+		if ( IsValidCell( Record.Cell ) == false )
+		{
+			return;
+		}
+
+		switch( Record.Type )
+		{
+			case EventLogRecord::DetectorState:
+				Detected[Record.Cell] = Record.Value;
+				break;
+
+			case EventLogRecord::MotionStart:
+			case EventLogRecord::MotionStop:
+				Motion[Record.Cell] = ( Record.Type == EventLogRecord::MotionStart ) ? 1 : 0;
+				break;
+
+			case EventLogRecord::ProvisionalMove:
+				Provisional[Record.Cell] = Record.Value;
+				break;
+
+			case EventLogRecord::ConfirmedMove:
+			case EventLogRecord::RemovedStone:
+			{
+				Provisional[Record.Cell] = Empty;
+				Event NewEvent;
+				NewEvent.IsMove = ( Record.Type == EventLogRecord::ConfirmedMove );
+				NewEvent.Color = Record.Value;
+				NewEvent.Cell = Record.Cell;
+				NewEvent.NumMove = Record.NumMove;
+				Events.push_back( NewEvent );
+				break;
+			}
+
+			case EventLogRecord::RetractedMove:
+				if ( Record.NumMove == 0 )
+				{
+					Provisional[Record.Cell] = Empty;
+					break;
+				}
+				// Rollback, all events from this move are undone
+				while ( Events.empty() == false && Events.back().NumMove >= Record.NumMove )
+				{
+					Events.pop_back();
+				}
+				break;
+		}
+	}
+
+	/**
+    * @brief Print committed and detected boards, provisional moves are lower case and cells in motion are marked with '*'
+    * @param fout [in] Output file
+	*/
+	void Print( FILE * fout )
+	{
+		// Committed board
+		StoneGroups Groups( NumColumns, NumLines );
+		std::vector<int> Captured;
+		int NbMoves = 0;
+		for ( size_t Pos = 0; Pos < Events.size(); Pos++ )
+		{
+			int a = Events[Pos].Cell/NumLines;
+			int b = Events[Pos].Cell%NumLines;
+			if ( Events[Pos].IsMove == true )
+			{
+				if ( Groups.GetColor( a, b ) == Empty )
+				{
+					Groups.Play( a, b, Events[Pos].Color, Captured );
+				}
+				NbMoves = Events[Pos].NumMove;
+			}
+			else if ( Groups.GetColor( a, b ) != Empty )
+			{
+				Groups.Remove( a, b );
+			}
+		}
+
+		const char StateChars[] = "OX.";	// White, Black, Empty
+		const char ProvisionalChars[] = "ox";
+		fprintf( fout, "%d moves, %d events committed\n", NbMoves, (int)Events.size() );
+		fprintf( fout, "%-*s   Detected\n", NumColumns*2, "Committed" );
+		for ( int b = 0; b < NumLines; b++ )
+		{
+			for ( int a = 0; a < NumColumns; a++ )
+			{
+				int Cell = a*NumLines+b;
+				int Color = Groups.GetColor( a, b );
+				char c = StateChars[( Color >= White && Color <= Empty ) ? Color : Empty];
+				if ( Color == Empty && (Provisional[Cell] == White || Provisional[Cell] == Black) )
+				{
+					c = ProvisionalChars[Provisional[Cell]];
+				}
+				fprintf( fout, "%c ", c );
+			}
+			fprintf( fout, "   " );
+			for ( int a = 0; a < NumColumns; a++ )
+			{
+				int Cell = a*NumLines+b;
+				int Color = Detected[Cell];
+				fprintf( fout, "%c%c", StateChars[( Color >= White && Color <= Empty ) ? Color : Empty], Motion[Cell] ? '*' : ' ' );
+			}
+			fprintf( fout, "\n" );
+		}
+	}
+
+protected:
+	inline bool IsValidCell( int Cell ) const
+	{
+		return ( Cell >= 0 && Cell < NumColumns*NumLines );
+	}
+};
+
+/**
+* @brief Rebuild board and detector states at a timestamp from an event log
+*/
+int main( int argc, char *argv[] )
+{
+	if ( argc != 3 || strcasecmp("-h", argv[1]) == 0 || strcasecmp("-help", argv[1]) == 0 || strcasecmp("--help", argv[1]) == 0 )
+	{
+		fprintf( stderr, "Usage: %s <event log> <timestamp>\n", argv[0] );
+		fprintf( stderr, "Print committed game and detector states at timestamp (s) from an .evlog file written with '-eventlog'.\n" );
+		return ( argc == 3 ) ? 0 : -1;
+	}
+
+	double Start = (double)cv::getTickCount();
+
+	EventLogReader Reader;
+	if ( Reader.Open( argv[1] ) == false )
+	{
+		return -1;
+	}
+	double Timestamp = atof( argv[2] );
+
+	// Records up to Timestamp, then nearest snapshot before them
+	long long End = Reader.CountUntil( Timestamp );
+	long long SnapshotIndex = End-1;
+	while ( SnapshotIndex >= 0 && Reader.Get( SnapshotIndex ).Type != EventLogRecord::Snapshot )
+	{
+		SnapshotIndex--;
+	}
+
+	ReplayedState State( Reader.Header.NumColumns, Reader.Header.NumLines );
+	long long Index = 0;
+	if ( SnapshotIndex >= 0 )
+	{
+		Index = State.LoadSnapshot( Reader, SnapshotIndex );
+	}
+	long long NbReplayed = std::max( End-Index, 0LL );
+	for ( ; Index < End; Index++ )
+	{
+		State.Apply( Reader.Get( Index ) );
+	}
+
+	double ElapsedTime = ((double)cv::getTickCount()-Start)/cv::getTickFrequency();
+
+	fprintf( stdout, "State at %.3lf s (%lld records in log", Timestamp, Reader.NbRecords );
+	if ( SnapshotIndex >= 0 )
+	{
+		fprintf( stdout, ", snapshot at %.3lf s", Reader.Get( SnapshotIndex ).Timestamp );
+	}
+	fprintf( stdout, ", %lld records replayed in %.3lf ms)\n", NbReplayed, ElapsedTime*1000.0 );
+	if ( State.NbGaps > 0 )
+	{
+		fprintf( stdout, "Warning: %lld records were dropped in %d gaps after the snapshot, states may be wrong until the next snapshot\n", State.NbLostRecords, State.NbGaps );
+	}
+	State.Print( stdout );
+
+	return 0;
+}
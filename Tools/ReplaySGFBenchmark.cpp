@@ -0,0 +1,601 @@
+/**
+ * @file ReplaySGFBenchmark.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "../StoneGroups.h"
+#include "Bitboard.h"
+#include "../GobanState.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+
+/**
+ * @class SGFGame
+ * @brief Moves of the main line of an SGF file (setup stones are moves without alternation)
+ */
+class SGFGame
+{
+public:
+	class Move
+	{
+	public:
+		int Color;		// StoneState::Black or StoneState::White
+		int a;			// Column
+		int b;			// Line
+	};
+
+	int NumColumns = 19;			// SZ property (SZ[n] or SZ[columns:lines])
+	int NumLines = 19;
+	std::vector<Move> Moves;		// Setup stones and moves, passes removed
+
+	/**
+    * @brief Load main line of an SGF file
+    * @param FileName [in] SGF file
+    * @return true if the file was read
+	*/
+	bool Load( const char * FileName )
+	{
+		FILE * fin = fopen( FileName, "rb" );
+		if ( fin == nullptr )
+		{
+			fprintf( stderr, "Could not open '%s'\n", FileName );
+			return false;
+		}
+
+		std::string Content;
+		char Buffer[4096];
+		size_t NbRead;
+		while ( (NbRead = fread( Buffer, 1, sizeof(Buffer), fin )) > 0 )
+		{
+			Content.append( Buffer, NbRead );
+		}
+		fclose( fin );
+
+		Moves.clear();
+		NumColumns = NumLines = 19;
+
+		// Main line is the first variation at each fork: it ends on the first closing parenthesis
+		std::string Property;
+		for ( size_t Pos = 0; Pos < Content.size(); Pos++ )
+		{
+			char c = Content[Pos];
+			if ( c == ')' )
+			{
+				break;
+			}
+			if ( c >= 'A' && c <= 'Z' )
+			{
+				Property += c;
+				continue;
+			}
+			if ( c == ';' )
+			{
+				Property.clear();
+				continue;
+			}
+			if ( c != '[' )
+			{
+				// lower case letters of old SGF property names or spaces
+				continue;
+			}
+
+			// Read value
+			std::string Value;
+			for ( Pos++; Pos < Content.size() && Content[Pos] != ']'; Pos++ )
+			{
+				if ( Content[Pos] == '\\' && Pos+1 < Content.size() )
+				{
+					Pos++;
+				}
+				Value += Content[Pos];
+			}
+
+			if ( Property == "SZ" )
+			{
+				if ( sscanf( Value.c_str(), "%d:%d", &NumColumns, &NumLines ) < 2 )
+				{
+					NumLines = NumColumns;
+				}
+			}
+			else if ( Property == "B" || Property == "W" || Property == "AB" || Property == "AW" )
+			{
+				// Passes are empty values or 'tt'
+				if ( Value.size() >= 2 && Value[0] >= 'a' && Value[1] >= 'a' && Value[0]-'a' < NumColumns && Value[1]-'a' < NumLines )
+				{
+					Move NewMove;
+					NewMove.Color = ( Property[Property.size()-1] == 'B' ) ? StoneState::Black : StoneState::White;
+					NewMove.a = Value[0]-'a';
+					NewMove.b = Value[1]-'a';
+					Moves.push_back( NewMove );
+				}
+			}
+
+			// Next values of the same property (AB[aa][bb]...) keep the name until a new one starts
+			size_t NextPos = Pos+1;
+			while ( NextPos < Content.size() && (Content[NextPos] == ' ' || Content[NextPos] == '\n' || Content[NextPos] == '\r' || Content[NextPos] == '\t') )
+			{
+				NextPos++;
+			}
+			if ( NextPos >= Content.size() || Content[NextPos] != '[' )
+			{
+				Property.clear();
+			}
+		}
+
+		return ( NumColumns > 1 && NumLines > 1 && NumColumns*NumLines <= MaxBitboardCells );
+	}
+};
+
+/**
+ * @class LegacyCaptures
+ * @brief Former capture search of GobanState: recursive flood fill leaving by an exception when a liberty
+ *		  is found, chains are stored in a list. Used as reference and baseline.
+ */
+class LegacyCaptures : public StoneState
+{
+public:
+	int NumColumns;
+	int NumLines;
+	std::vector<int> Color;
+	std::vector<bool> CaptureChecked;
+
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+	*/
+	LegacyCaptures( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines), Color(_NumColumns*_NumLines, Empty),
+		CaptureChecked(_NumColumns*_NumLines, false)
+	{
+	}
+
+	void CheckLibertiesRecursive( int a, int b, int StoneColor, std::list<int>& CurrentChain )
+	{
+		int Cell = a*NumLines+b;
+		if ( CaptureChecked[Cell] == true )
+		{
+			return;
+		}
+		if ( Color[Cell] == Empty )
+		{
+			throw 1;
+		}
+		if ( Color[Cell] != StoneColor )
+		{
+			return;
+		}
+
+		CaptureChecked[Cell] = true;
+		CurrentChain.push_back( Cell );
+
+		if ( a > 0 )			{ CheckLibertiesRecursive( a-1, b, StoneColor, CurrentChain ); }
+		if ( a < NumColumns-1 )	{ CheckLibertiesRecursive( a+1, b, StoneColor, CurrentChain ); }
+		if ( b > 0 )			{ CheckLibertiesRecursive( a, b-1, StoneColor, CurrentChain ); }
+		if ( b < NumLines-1 )	{ CheckLibertiesRecursive( a, b+1, StoneColor, CurrentChain ); }
+	}
+
+	int CheckLiberties( int a, int b, int StoneColor )
+	{
+		if ( Color[a*NumLines+b] != StoneColor )
+		{
+			return 0;
+		}
+
+		std::list<int> CurrentChain;
+		int NbCaptured = 0;
+		try
+		{
+			CheckLibertiesRecursive( a, b, StoneColor, CurrentChain );
+			for ( std::list<int>::iterator it = CurrentChain.begin(); it != CurrentChain.end(); it++ )
+			{
+				Color[*it] = Empty;
+				NbCaptured++;
+			}
+		}
+		catch ( int )
+		{
+		}
+
+		for ( std::list<int>::iterator it = CurrentChain.begin(); it != CurrentChain.end(); it++ )
+		{
+			CaptureChecked[*it] = false;
+		}
+		return NbCaptured;
+	}
+
+	int Play( int a, int b, int StoneColor )
+	{
+		Color[a*NumLines+b] = StoneColor;
+
+		int Opponent = (StoneColor+1)%StateModulo;
+		int NbCaptured = 0;
+		if ( a > 0 )			{ NbCaptured += CheckLiberties( a-1, b, Opponent ); }
+		if ( a < NumColumns-1 )	{ NbCaptured += CheckLiberties( a+1, b, Opponent ); }
+		if ( b > 0 )			{ NbCaptured += CheckLiberties( a, b-1, Opponent ); }
+		if ( b < NumLines-1 )	{ NbCaptured += CheckLiberties( a, b+1, Opponent ); }
+		return NbCaptured;
+	}
+};
+
+/**
+ * @class BitboardCaptures
+ * @brief Capture search of GobanState on bitboards: flood fill of adjacent opponent groups and liberty count
+ *		  with word-wide shifts and popcount.
+ */
+class BitboardCaptures : public StoneState
+{
+public:
+	BitboardGeometry Geometry;
+	Bitboard Stones[StateModulo];
+
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the goban
+    * @param _NumLines [in] Number of lines of the goban
+	*/
+	BitboardCaptures( int _NumColumns, int _NumLines ) : Geometry(_NumColumns, _NumLines)
+	{
+	}
+
+	int GetColor( int Cell ) const
+	{
+		if ( Stones[Black].Test( Cell ) )
+		{
+			return Black;
+		}
+		return Stones[White].Test( Cell ) ? White : Empty;
+	}
+
+	int Play( int a, int b, int StoneColor )
+	{
+		int Cell = a*Geometry.NumLines+b;
+		int Opponent = (StoneColor+1)%StateModulo;
+
+		Stones[Opponent].Reset( Cell );
+		Stones[StoneColor].Set( Cell );
+
+		int NumLines = Geometry.NumLines;
+		int Neighbours[4];
+		int NbNeighbours = 0;
+		if ( a > 0 )						{ Neighbours[NbNeighbours++] = Cell-NumLines; }
+		if ( a < Geometry.NumColumns-1 )	{ Neighbours[NbNeighbours++] = Cell+NumLines; }
+		if ( b > 0 )						{ Neighbours[NbNeighbours++] = Cell-1; }
+		if ( b < NumLines-1 )				{ Neighbours[NbNeighbours++] = Cell+1; }
+
+		Bitboard EmptyCells = Geometry.OnBoard.AndNot( Stones[Black] | Stones[White] );
+
+		// Each adjacent opponent stone not yet in a checked group starts a flood fill
+		Bitboard Checked;
+		Bitboard Captured;
+		for ( int n = 0; n < NbNeighbours; n++ )
+		{
+			int Neighbour = Neighbours[n];
+			if ( Stones[Opponent].Test( Neighbour ) == false || Checked.Test( Neighbour ) == true )
+			{
+				continue;
+			}
+
+			Bitboard Seed;
+			Seed.Set( Neighbour );
+			Bitboard Group = Geometry.FloodFill( Seed, Stones[Opponent] );
+			Checked |= Group;
+			if ( Geometry.CountLiberties( Group, EmptyCells ) == 0 )
+			{
+				Captured |= Group;
+			}
+		}
+
+		Stones[Opponent].Remove( Captured );
+		return Captured.PopCount();
+	}
+};
+
+/**
+* @brief Read the moves of an SGF file written by SGFGenerator, i.e. everything after the header
+* @param FileName [in] SGF file
+* @param Moves [out] Content of the file from the first move
+* @return true if the file was read
+*/
+static bool ReadSGFMoves( const char * FileName, std::string& Moves )
+{
+	FILE * fin = fopen( FileName, "rb" );
+	if ( fin == nullptr )
+	{
+		return false;
+	}
+
+	std::string Content;
+	char Buffer[4096];
+	size_t NbRead;
+	while ( (NbRead = fread( Buffer, 1, sizeof(Buffer), fin )) > 0 )
+	{
+		Content.append( Buffer, NbRead );
+	}
+	fclose( fin );
+
+	// The header holds the file name, moves start on the first line beginning with a node
+	size_t FirstMove = Content.find( "\n;" );
+	Moves = ( FirstMove == std::string::npos ) ? std::string() : Content.substr( FirstMove+1 );
+	return true;
+}
+
+/**
+* @brief Record a game with GobanState where one move is on a wrong cell, correct it with GobanState::CorrectMove and
+*		 check that the rewritten SGF tail and the position match a recording of the right game
+* @param Game [in] Game to record
+* @param Folder [in] Folder of the temporary SGF files
+* @param Checked [out] false if the game can not be checked (no free cell, or moves illegal for GobanState)
+* @return true if the corrected recording matches
+*/
+static bool CheckMoveCorrection( const SGFGame& Game, const char * Folder, bool& Checked )
+{
+	Checked = false;
+	if ( Game.Moves.empty() == true )
+	{
+		return true;
+	}
+
+	// Wrong cell: never played in the game, thus empty whenever the wrong move is played
+	std::vector<bool> Played( Game.NumColumns*Game.NumLines, false );
+	for ( size_t NumMove = 0; NumMove < Game.Moves.size(); NumMove++ )
+	{
+		Played[Game.Moves[NumMove].a*Game.NumLines+Game.Moves[NumMove].b] = true;
+	}
+	int WrongCell = (int)(std::find( Played.begin(), Played.end(), false ) - Played.begin());
+	if ( WrongCell >= Game.NumColumns*Game.NumLines )
+	{
+		return true;
+	}
+
+	int CorrectedMove = (int)Game.Moves.size()/2 + 1;
+	Omiscid::SimpleString Event = "ReplaySGFBenchmark", Round, Rule, Komi = "0", Date = "Check", Time = "Correction", BlackPlayer = "Black", WhitePlayer = "White";
+	std::string Moves[2];
+	uint64_t Hashes[2];
+	int NbMoves[2];
+
+	// 0: right game, 1: game with a wrong move then corrected
+	for ( int Recording = 0; Recording < 2; Recording++ )
+	{
+		GobanState State( Game.NumColumns, Game.NumLines );
+		StoneDetectorStorage AllDetectors( Game.NumColumns, Game.NumLines );
+		if ( State.SGFWriter.Open( Folder, Event, Round, Rule, Komi, Date, Time, BlackPlayer, WhitePlayer ) == false )
+		{
+			fprintf( stderr, "Could not open SGF file in '%s'\n", Folder );
+			return false;
+		}
+
+		for ( size_t NumMove = 0; NumMove < Game.Moves.size(); NumMove++ )
+		{
+			const SGFGame::Move& CurMove = Game.Moves[NumMove];
+			bool WrongMove = ( Recording == 1 && (int)NumMove+1 == CorrectedMove );
+
+			// Replayed moves must be legal, as detected ones, or the correction leaves them to the detectors
+			if ( Recording == 0 && (State.Goban[CurMove.a][CurMove.b].State != StoneState::Empty || State.IsLegalMove( CurMove.a, CurMove.b, CurMove.Color ) == false) )
+			{
+				Omiscid::SimpleString Result = "?";
+				State.SGFWriter.Close( Result );
+				remove( State.SGFWriter.GetFileName().GetStr() );
+				return true;
+			}
+
+			State.SearchFor = CurMove.Color;
+			State.CommitMove( WrongMove ? WrongCell/Game.NumLines : CurMove.a, WrongMove ? WrongCell%Game.NumLines : CurMove.b, "", AllDetectors, 0.0 );
+		}
+
+		if ( Recording == 1 )
+		{
+			const SGFGame::Move& RightMove = Game.Moves[CorrectedMove-1];
+			if ( State.CorrectMove( CorrectedMove, RightMove.a, RightMove.b, AllDetectors, 0.0 ) == false )
+			{
+				fprintf( stderr, "Correction of move %d refused\n", CorrectedMove );
+				return false;
+			}
+		}
+
+		Hashes[Recording] = State.Groups.GetHash();
+		NbMoves[Recording] = State.GetNbMoves();
+		bool Read = ReadSGFMoves( State.SGFWriter.GetFileName().GetStr(), Moves[Recording] );
+
+		Omiscid::SimpleString Result = "?";
+		State.SGFWriter.Close( Result );
+		remove( State.SGFWriter.GetFileName().GetStr() );
+		if ( Read == false )
+		{
+			fprintf( stderr, "Could not read back '%s'\n", State.SGFWriter.GetFileName().GetStr() );
+			return false;
+		}
+	}
+
+	if ( Moves[0] != Moves[1] || Hashes[0] != Hashes[1] || NbMoves[0] != NbMoves[1] )
+	{
+		fprintf( stderr, "Corrected move %d: SGF tail or position differ from the right game (%d/%d moves)\n", CorrectedMove, NbMoves[1], NbMoves[0] );
+		return false;
+	}
+
+	Checked = true;
+	return true;
+}
+
+/**
+* @brief Replay SGF files with StoneGroups, bitboards and the former capture search, check that all agree and compare times.
+*		 With -correct, check move correction of GobanState on each game.
+*/
+int main( int argc, char *argv[] )
+{
+	int NbRepeats = 1;
+	std::vector<std::string> SGFFiles;
+	const char * CorrectionFolder = nullptr;
+
+	for ( int PosArg = 1; PosArg < argc; PosArg++ )
+	{
+		if ( strcasecmp("-h", argv[PosArg]) == 0 || strcasecmp("-help", argv[PosArg]) == 0 || strcasecmp("--help", argv[PosArg]) == 0 )
+		{
+			fprintf( stderr, "Usage: %s [-repeat <n>] [-list <file>] [-correct <folder>] <sgf file> [<sgf file> ...]\n", argv[0] );
+			fprintf( stderr, "-repeat: Number of replays of each game for timing (Default=1).\n-list: File with one SGF file name per line.\n" );
+			fprintf( stderr, "-correct: Also record each game with a wrong move, correct it and compare the SGF tail (temporary files in folder).\n" );
+			return 0;
+		}
+
+		if ( PosArg+1 < argc )
+		{
+			if ( strcasecmp("-repeat", argv[PosArg]) == 0 )
+			{
+				NbRepeats = std::max( atoi(argv[++PosArg]), 1 );
+				continue;
+			}
+			if ( strcasecmp("-correct", argv[PosArg]) == 0 )
+			{
+				CorrectionFolder = argv[++PosArg];
+				continue;
+			}
+			if ( strcasecmp("-list", argv[PosArg]) == 0 )
+			{
+				FILE * fin = fopen( argv[++PosArg], "rb" );
+				if ( fin == nullptr )
+				{
+					fprintf( stderr, "Could not open list '%s'\n", argv[PosArg] );
+					return -1;
+				}
+
+				char Line[1024];
+				while ( fgets( Line, sizeof(Line), fin ) != nullptr )
+				{
+					Line[strcspn( Line, "\r\n" )] = '\0';
+					if ( Line[0] != '\0' )
+					{
+						SGFFiles.push_back( Line );
+					}
+				}
+				fclose( fin );
+				continue;
+			}
+		}
+
+		SGFFiles.push_back( argv[PosArg] );
+	}
+
+	if ( SGFFiles.empty() == true )
+	{
+		fprintf( stderr, "No SGF file to replay\n" );
+		return -1;
+	}
+
+	int NbGames = 0;
+	int NbMismatchGames = 0;
+	int NbCorrectionErrors = 0;
+	int NbCorrectionChecks = 0;
+	long long int NbMoves = 0;
+	long long int NbCaptured = 0;
+	double GroupsTime = 0.0;
+	double BitboardTime = 0.0;
+	double LegacyTime = 0.0;
+	std::vector<int> Captured;
+	SGFGame Game;
+
+	for ( size_t NumFile = 0; NumFile < SGFFiles.size(); NumFile++ )
+	{
+		if ( Game.Load( SGFFiles[NumFile].c_str() ) == false )
+		{
+			continue;
+		}
+
+		NbGames++;
+		Captured.reserve( Game.NumColumns*Game.NumLines );
+
+		// Check StoneGroups and bitboards against the former search
+		StoneGroups Groups( Game.NumColumns, Game.NumLines );
+		BitboardCaptures Bitboards( Game.NumColumns, Game.NumLines );
+		LegacyCaptures Legacy( Game.NumColumns, Game.NumLines );
+		for ( size_t NumMove = 0; NumMove < Game.Moves.size(); NumMove++ )
+		{
+			const SGFGame::Move& CurMove = Game.Moves[NumMove];
+			NbCaptured += Groups.Play( CurMove.a, CurMove.b, CurMove.Color, Captured );
+			Bitboards.Play( CurMove.a, CurMove.b, CurMove.Color );
+			Legacy.Play( CurMove.a, CurMove.b, CurMove.Color );
+		}
+		NbMoves += (long long int)Game.Moves.size();
+
+		for ( int a = 0; a < Game.NumColumns; a++ )
+		{
+			for ( int b = 0; b < Game.NumLines; b++ )
+			{
+				int LegacyColor = Legacy.Color[a*Game.NumLines+b];
+				if ( Groups.GetColor( a, b ) != LegacyColor || Bitboards.GetColor( a*Game.NumLines+b ) != LegacyColor )
+				{
+					fprintf( stderr, "Final position mismatch in '%s' at (%d,%d)\n", SGFFiles[NumFile].c_str(), a, b );
+					NbMismatchGames++;
+					a = Game.NumColumns;
+					b = Game.NumLines;
+				}
+			}
+		}
+
+		bool CorrectionChecked = false;
+		if ( CorrectionFolder != nullptr && CheckMoveCorrection( Game, CorrectionFolder, CorrectionChecked ) == false )
+		{
+			fprintf( stderr, "Move correction failed in '%s'\n", SGFFiles[NumFile].c_str() );
+			NbCorrectionErrors++;
+		}
+		NbCorrectionChecks += ( CorrectionChecked == true ) ? 1 : 0;
+
+		// Timings
+		double Start = (double)cv::getTickCount();
+		for ( int Repeat = 0; Repeat < NbRepeats; Repeat++ )
+		{
+			Groups.Clear();
+			for ( size_t NumMove = 0; NumMove < Game.Moves.size(); NumMove++ )
+			{
+				const SGFGame::Move& CurMove = Game.Moves[NumMove];
+				Groups.Play( CurMove.a, CurMove.b, CurMove.Color, Captured );
+			}
+		}
+		GroupsTime += ((double)cv::getTickCount()-Start)/cv::getTickFrequency();
+
+		Start = (double)cv::getTickCount();
+		for ( int Repeat = 0; Repeat < NbRepeats; Repeat++ )
+		{
+			BitboardCaptures TimedBitboards( Game.NumColumns, Game.NumLines );
+			for ( size_t NumMove = 0; NumMove < Game.Moves.size(); NumMove++ )
+			{
+				const SGFGame::Move& CurMove = Game.Moves[NumMove];
+				TimedBitboards.Play( CurMove.a, CurMove.b, CurMove.Color );
+			}
+		}
+		BitboardTime += ((double)cv::getTickCount()-Start)/cv::getTickFrequency();
+
+		Start = (double)cv::getTickCount();
+		for ( int Repeat = 0; Repeat < NbRepeats; Repeat++ )
+		{
+			LegacyCaptures TimedLegacy( Game.NumColumns, Game.NumLines );
+			for ( size_t NumMove = 0; NumMove < Game.Moves.size(); NumMove++ )
+			{
+				const SGFGame::Move& CurMove = Game.Moves[NumMove];
+				TimedLegacy.Play( CurMove.a, CurMove.b, CurMove.Color );
+			}
+		}
+		LegacyTime += ((double)cv::getTickCount()-Start)/cv::getTickFrequency();
+	}
+
+	double NbTimedMoves = (double)NbMoves*(double)NbRepeats;
+	fprintf( stderr, "%d games, %lld moves, %lld captured stones, %d games with mismatching final position\n", NbGames, NbMoves, NbCaptured, NbMismatchGames );
+	if ( CorrectionFolder != nullptr )
+	{
+		fprintf( stderr, "%d games with a checked move correction, %d failed (games with a move illegal for the recorder are not checked)\n", NbCorrectionChecks, NbCorrectionErrors );
+	}
+	if ( NbTimedMoves > 0.0 )
+	{
+		fprintf( stderr, "Union-find groups: %.1lf ns/move\nBitboard search:   %.1lf ns/move\nRecursive search:  %.1lf ns/move\n", 1e9*GroupsTime/NbTimedMoves, 1e9*BitboardTime/NbTimedMoves, 1e9*LegacyTime/NbTimedMoves );
+	}
+
+	return ( NbMismatchGames == 0 && NbCorrectionErrors == 0 ) ? 0 : -1;
+}
@@ -0,0 +1,342 @@
+/**
+ * @file TrainPatchClassifier.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "../PatchClassifier.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @class PatchClassifierTrainer
+ * @brief Train a linear or MLP (one hidden layer) model on labelled patches using SGD with a softmax loss.
+ *		  Classes are weighted to compensate the large number of empty cells.
+ */
+class PatchClassifierTrainer
+{
+public:
+	int NbHidden;				// Size of hidden layer, 0 for a linear model
+	cv::Mat W1, b1, W2, b2;		// Float model
+
+	/**
+    * @brief Constructor
+    * @param _NbHidden [in] Size of hidden layer, 0 for a linear model
+	*/
+	PatchClassifierTrainer( int _NbHidden ) : NbHidden(_NbHidden)
+	{
+		cv::RNG Init( 0x476F );
+		int NbOutputs = ( NbHidden > 0 ) ? NbHidden : PatchClassifier::NbClasses;
+
+		W1 = cv::Mat( NbOutputs, PatchFeatures, CV_32FC1 );
+		Init.fill( W1, cv::RNG::NORMAL, 0.0, sqrt( 2.0/(double)PatchFeatures ) );
+		b1 = cv::Mat::zeros( 1, NbOutputs, CV_32FC1 );
+
+		if ( NbHidden > 0 )
+		{
+			W2 = cv::Mat( PatchClassifier::NbClasses, NbHidden, CV_32FC1 );
+			Init.fill( W2, cv::RNG::NORMAL, 0.0, sqrt( 2.0/(double)NbHidden ) );
+			b2 = cv::Mat::zeros( 1, PatchClassifier::NbClasses, CV_32FC1 );
+		}
+	}
+
+	/**
+    * @brief Compute class scores of a patch with the float model
+    * @param x [in] Normalised patch
+    * @param h [out] First layer output
+    * @param z [out] Class scores
+	*/
+	void Forward( const float * x, std::vector<float>& h, float * z )
+	{
+		h.resize( W1.rows );
+		for ( int Output = 0; Output < W1.rows; Output++ )
+		{
+			const float * w = W1.ptr<float>( Output );
+			float Sum = b1.at<float>( Output );
+			for ( int Feature = 0; Feature < PatchFeatures; Feature++ )
+			{
+				Sum += w[Feature]*x[Feature];
+			}
+			h[Output] = Sum;
+		}
+
+		if ( NbHidden == 0 )
+		{
+			for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+			{
+				z[Class] = h[Class];
+			}
+			return;
+		}
+
+		for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+		{
+			const float * w = W2.ptr<float>( Class );
+			float Sum = b2.at<float>( Class );
+			for ( int Output = 0; Output < NbHidden; Output++ )
+			{
+				Sum += w[Output]*std::max( h[Output], 0.0f );
+			}
+			z[Class] = Sum;
+		}
+	}
+
+	/**
+    * @brief One SGD step on a patch
+    * @param x [in] Normalised patch
+    * @param Label [in] Class of the patch
+    * @param Rate [in] Learning rate (including class weight)
+    * @return loss for this patch
+	*/
+	double Step( const float * x, int Label, float Rate )
+	{
+		std::vector<float> h;
+		float z[PatchClassifier::NbClasses];
+		Forward( x, h, z );
+
+		// Softmax
+		float MaxZ = *std::max_element( z, z+PatchClassifier::NbClasses );
+		float p[PatchClassifier::NbClasses];
+		float SumP = 0.0f;
+		for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+		{
+			p[Class] = exp( z[Class]-MaxZ );
+			SumP += p[Class];
+		}
+
+		float dz[PatchClassifier::NbClasses];
+		for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+		{
+			p[Class] /= SumP;
+			dz[Class] = p[Class] - ( Class == Label ? 1.0f : 0.0f );
+		}
+
+		// Gradient on first layer outputs
+		std::vector<float> dh( W1.rows );
+		if ( NbHidden == 0 )
+		{
+			for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+			{
+				dh[Class] = dz[Class];
+			}
+		}
+		else
+		{
+			for ( int Output = 0; Output < NbHidden; Output++ )
+			{
+				float Sum = 0.0f;
+				for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+				{
+					Sum += W2.at<float>( Class, Output )*dz[Class];
+				}
+				dh[Output] = ( h[Output] > 0.0f ) ? Sum : 0.0f;
+			}
+
+			// Update second layer
+			for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+			{
+				float * w = W2.ptr<float>( Class );
+				for ( int Output = 0; Output < NbHidden; Output++ )
+				{
+					w[Output] -= Rate*dz[Class]*std::max( h[Output], 0.0f );
+				}
+				b2.at<float>( Class ) -= Rate*dz[Class];
+			}
+		}
+
+		// Update first layer
+		for ( int Output = 0; Output < W1.rows; Output++ )
+		{
+			if ( dh[Output] == 0.0f )
+			{
+				continue;
+			}
+
+			float * w = W1.ptr<float>( Output );
+			for ( int Feature = 0; Feature < PatchFeatures; Feature++ )
+			{
+				w[Feature] -= Rate*dh[Output]*x[Feature];
+			}
+			b1.at<float>( Output ) -= Rate*dh[Output];
+		}
+
+		return -log( std::max( p[Label], 1e-7f ) );
+	}
+};
+
+/**
+* @brief Print accuracy and confusion matrix of the quantised classifier
+* @param Classifier [in] Quantised classifier
+* @param Batch [in] Patches
+* @param Labels [in] Labels
+* @param Indexes [in] Patches to evaluate
+* @param Title [in] Title of the report
+*/
+void ReportAccuracy( PatchClassifier& Classifier, cv::Mat& Batch, std::vector<int>& Labels, std::vector<int>& Indexes, const char * Title )
+{
+	if ( Indexes.empty() == true )
+	{
+		return;
+	}
+
+	cv::Mat SubBatch( (int)Indexes.size(), PatchFeatures, CV_8UC1 );
+	for ( size_t i = 0; i < Indexes.size(); i++ )
+	{
+		Batch.row( Indexes[i] ).copyTo( SubBatch.row( (int)i ) );
+	}
+
+	std::vector<int> Classes;
+	Classifier.Classify( SubBatch, Classes );
+
+	int Confusion[PatchClassifier::NbClasses][PatchClassifier::NbClasses];
+	memset( Confusion, 0, sizeof(Confusion) );
+	int NbGood = 0;
+	for ( size_t i = 0; i < Indexes.size(); i++ )
+	{
+		Confusion[Labels[Indexes[i]]][Classes[i]]++;
+		NbGood += ( Labels[Indexes[i]] == Classes[i] );
+	}
+
+	fprintf( stderr, "%s: accuracy=%.3lf%% on %d patches\n", Title, 100.0*(double)NbGood/(double)Indexes.size(), (int)Indexes.size() );
+	const char * ClassNames[PatchClassifier::NbClasses] = { "White", "Black", "Empty" };
+	for ( int Label = 0; Label < PatchClassifier::NbClasses; Label++ )
+	{
+		fprintf( stderr, "  %-6s -> White=%d Black=%d Empty=%d\n", ClassNames[Label], Confusion[Label][PatchClassifier::White],
+			Confusion[Label][PatchClassifier::Black], Confusion[Label][PatchClassifier::Empty] );
+	}
+}
+
+/**
+* @brief Train a patch classifier from patch files dumped by Go-CamRecorder (-dump-patches option).
+*/
+int main( int argc, char *argv[] )
+{
+	int NbHidden = 0;
+	int NbEpochs = 20;
+	float LearningRate = 0.01f;
+	const char * OutputModel = "PatchClassifier.yml";
+	std::vector<const char*> DumpFiles;
+
+	for ( int PosArg = 1; PosArg < argc; PosArg++ )
+	{
+		if ( strcasecmp("-h", argv[PosArg]) == 0 || strcasecmp("-help", argv[PosArg]) == 0 || strcasecmp("--help", argv[PosArg]) == 0 )
+		{
+			fprintf( stderr, "Usage: %s [-hidden <n>] [-epochs <n>] [-rate <r>] [-o <model file>] <patch file> [<patch file> ...]\n", argv[0] );
+			fprintf( stderr, "-hidden: Size of hidden layer (Default=0, linear model).\n-epochs: Number of training epochs (Default=20).\n" );
+			fprintf( stderr, "-rate: Learning rate (Default=0.01).\n-o: Output model (Default=PatchClassifier.yml).\n" );
+			return 0;
+		}
+
+		if ( PosArg+1 < argc )
+		{
+			if ( strcasecmp("-hidden", argv[PosArg]) == 0 )
+			{
+				NbHidden = std::max( atoi(argv[++PosArg]), 0 );
+				continue;
+			}
+			if ( strcasecmp("-epochs", argv[PosArg]) == 0 )
+			{
+				NbEpochs = std::max( atoi(argv[++PosArg]), 1 );
+				continue;
+			}
+			if ( strcasecmp("-rate", argv[PosArg]) == 0 )
+			{
+				LearningRate = (float)atof(argv[++PosArg]);
+				continue;
+			}
+			if ( strcasecmp("-o", argv[PosArg]) == 0 )
+			{
+				OutputModel = argv[++PosArg];
+				continue;
+			}
+		}
+
+		DumpFiles.push_back( argv[PosArg] );
+	}
+
+	// Load all patches
+	cv::Mat Batch;
+	std::vector<int> Labels;
+	for ( size_t i = 0; i < DumpFiles.size(); i++ )
+	{
+		if ( PatchClassifier::ReadDump( DumpFiles[i], Batch, Labels ) == false )
+		{
+			return -1;
+		}
+	}
+
+	if ( Labels.empty() == true )
+	{
+		fprintf( stderr, "No patch to learn from\n" );
+		return -1;
+	}
+
+	// Normalised features, same scaling as the quantised version
+	cv::Mat Features;
+	Batch.convertTo( Features, CV_32F, 1.0/128.0, -1.0 );
+
+	// Split: 1 patch over 10 for validation
+	std::vector<int> TrainIndexes, ValidationIndexes;
+	int NbPerClass[PatchClassifier::NbClasses] = { 0, 0, 0 };
+	for ( int i = 0; i < (int)Labels.size(); i++ )
+	{
+		if ( i % 10 == 9 )
+		{
+			ValidationIndexes.push_back( i );
+		}
+		else
+		{
+			TrainIndexes.push_back( i );
+			NbPerClass[Labels[i]]++;
+		}
+	}
+
+	// Class weights to compensate empty cells
+	float ClassWeight[PatchClassifier::NbClasses];
+	for ( int Class = 0; Class < PatchClassifier::NbClasses; Class++ )
+	{
+		ClassWeight[Class] = ( NbPerClass[Class] > 0 ) ? (float)TrainIndexes.size()/(float)(PatchClassifier::NbClasses*NbPerClass[Class]) : 0.0f;
+	}
+
+	fprintf( stderr, "%d patches (White=%d Black=%d Empty=%d for training), %s model\n", (int)Labels.size(),
+		NbPerClass[PatchClassifier::White], NbPerClass[PatchClassifier::Black], NbPerClass[PatchClassifier::Empty], NbHidden > 0 ? "MLP" : "linear" );
+
+	PatchClassifierTrainer Trainer( NbHidden );
+	cv::RNG Shuffle( 0x476F );
+	for ( int Epoch = 0; Epoch < NbEpochs; Epoch++ )
+	{
+		// Shuffle training patches
+		for ( int i = (int)TrainIndexes.size()-1; i > 0; i-- )
+		{
+			std::swap( TrainIndexes[i], TrainIndexes[Shuffle.uniform( 0, i+1 )] );
+		}
+
+		double Loss = 0.0;
+		float Rate = LearningRate/(1.0f + (float)Epoch*0.1f);
+		for ( size_t i = 0; i < TrainIndexes.size(); i++ )
+		{
+			int Index = TrainIndexes[i];
+			Loss += Trainer.Step( Features.ptr<float>( Index ), Labels[Index], Rate*ClassWeight[Labels[Index]] );
+		}
+
+		fprintf( stderr, "Epoch %d: loss=%.5lf\n", Epoch+1, Loss/(double)TrainIndexes.size() );
+	}
+
+	// Evaluate the quantised model, as used in Go-CamRecorder
+	PatchClassifier Classifier;
+	Classifier.SetModel( Trainer.W1, Trainer.b1, Trainer.W2, Trainer.b2 );
+	ReportAccuracy( Classifier, Batch, Labels, TrainIndexes, "Training" );
+	ReportAccuracy( Classifier, Batch, Labels, ValidationIndexes, "Validation" );
+
+	if ( Classifier.Save( OutputModel ) == false )
+	{
+		return -1;
+	}
+
+	fprintf( stderr, "Model saved to '%s'\n", OutputModel );
+	return 0;
+}
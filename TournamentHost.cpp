@@ -0,0 +1,352 @@
+/**
+ * @file TournamentHost.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "TournamentHost.h"
+
+#include <algorithm>
+
+/**
+* @brief Read and process one frame of the board, called from a worker of the pool
+*/
+void HostedBoard::Execute()
+{
+	double Wait = WaitTime.GetInSeconds();
+
+	if ( Vid.ReadFrame( LoadImage, DepthImage ) == false )
+	{
+		// End of source, leave the pool
+		Finished = true;
+		Pending = false;
+		return;
+	}
+
+	double CurTime = Vid.GetTimestamp();
+	Goban.ProcessCurrentFrame( LoadImage, DepthImage, CurTime, SingleConfig.BlackThreshold, SingleConfig.WhiteThreshold );
+
+	// Boards with motion get CPU first on next frame
+	bool Urgent = Goban.IsChanging();
+	double Lag = WaitTime.GetInSeconds();
+
+	{
+		Omiscid::SmartLocker SL_Protect( Protect );
+		Goban.GameState.DrawCurrentState( StateImage, CurTime );
+
+		NbFrames++;
+		TotalFrames++;
+		SumWait += Wait;
+		SumLag += Lag;
+		MaxLag = std::max( MaxLag, Lag );
+	}
+
+	if ( Host.Stopping == true )
+	{
+		Pending = false;
+		return;
+	}
+
+	// Next frame, must be the last use of this board in this call
+	Host.Pool->Submit( this, Urgent );
+}
+
+/**
+* @brief Print statistics since the last report and reset them
+* @param Board [in] Number of the board
+* @param fout [in] Output file (default=stderr)
+*/
+void HostedBoard::ReportStats( int Board, FILE * fout /* = stderr */ )
+{
+	Omiscid::SmartLocker SL_Protect( Protect );
+
+	double ElapsedTime = StatsTime.GetInSeconds();
+	fprintf( fout, "Board %d (%s): fps=%.2lf, mean wait=%.1lf ms, mean lag=%.1lf ms, max lag=%.1lf ms%s\n", Board, SourceName.GetStr(),
+		ElapsedTime > 0.0 ? (double)NbFrames/ElapsedTime : 0.0, NbFrames > 0 ? 1000.0*SumWait/(double)NbFrames : 0.0,
+		NbFrames > 0 ? 1000.0*SumLag/(double)NbFrames : 0.0, 1000.0*MaxLag, Finished == true ? " (finished)" : "" );
+
+	NbFrames = 0;
+	SumWait = 0.0;
+	SumLag = 0.0;
+	MaxLag = 0.0;
+	StatsTime.Reset();
+}
+
+/**
+* @brief Virtual destructor
+*/
+/* virtual */ TournamentHost::~TournamentHost()
+{
+	for ( size_t Board = 0; Board < Boards.size(); Board++ )
+	{
+		delete Boards[Board];
+	}
+}
+
+/**
+* @brief Load boards from a host file. Each line is 'source[;black player name[;white player name]]',
+*		 empty lines and lines starting with '#' are ignored.
+* @param HostFileName [in] Name of the host file
+* @return true if at least one board was loaded
+*/
+bool TournamentHost::LoadBoards( const char * HostFileName )
+{
+	FILE * fin = fopen( HostFileName, "rb" );
+	if ( fin == nullptr )
+	{
+		fprintf( stderr, "Could not open host file '%s'\n", HostFileName );
+		return false;
+	}
+
+	char Line[1024];
+	while ( fgets( Line, sizeof(Line), fin ) != nullptr )
+	{
+		// Remove line return
+		for ( int i = 0; Line[i] != '\0'; i++ )
+		{
+			if ( Line[i] == '\n' || Line[i] == '\r' )
+			{
+				Line[i] = '\0';
+				break;
+			}
+		}
+
+		if ( Line[0] == '\0' || Line[0] == '#' )
+		{
+			continue;
+		}
+
+		// Split fields
+		char * Fields[3] = { Line, nullptr, nullptr };
+		for ( int NumField = 1; NumField < 3; NumField++ )
+		{
+			char * Separator = strchr( Fields[NumField-1], ';' );
+			if ( Separator == nullptr )
+			{
+				break;
+			}
+			*Separator = '\0';
+			Fields[NumField] = Separator+1;
+		}
+
+		HostedBoard * NewBoard = new HostedBoard( *this, Fields[0], NumColumns, NumLines );
+		if ( Fields[1] != nullptr )
+		{
+			NewBoard->BlackPlayerName = Fields[1];
+		}
+		if ( Fields[2] != nullptr )
+		{
+			NewBoard->WhitePlayerName = Fields[2];
+		}
+		Boards.push_back( NewBoard );
+	}
+
+	fclose( fin );
+
+	if ( Boards.empty() == true )
+	{
+		fprintf( stderr, "No board in host file '%s'\n", HostFileName );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+* @brief Open video sources and retrieve or compute calibration of all boards
+* @return true if all sources are opened and calibrated
+*/
+bool TournamentHost::Calibrate()
+{
+	for ( size_t Board = 0; Board < Boards.size(); Board++ )
+	{
+		HostedBoard& CurBoard = *Boards[Board];
+
+		CurBoard.Vid.Open( CurBoard.SourceName.GetStr() );
+		if ( CurBoard.Vid.IsOpen() == false )
+		{
+			fprintf( stderr, "Could not open device or file '%s'\n", CurBoard.SourceName.GetStr() );
+			return false;
+		}
+
+		// Remove trailing ":" or '/' here from source name => store calibration file
+		Omiscid::SimpleString CalibrationName = CurBoard.SourceName;
+		char TrailingChar = CalibrationName[CalibrationName.GetLength()-1];
+		if ( TrailingChar == ':' || TrailingChar == '/' )
+		{
+			CalibrationName.pop_back();
+		}
+
+		fprintf( stderr, "Calibration of board %d/%d (%s)\n", (int)Board+1, (int)Boards.size(), CurBoard.SourceName.GetStr() );
+		if ( CurBoard.Goban.GetCalibration( CalibrationName, CurBoard.Vid ) == false )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* @brief Init detection and open SGF files of all boards
+* @param Folder [in] Output folder of SGF files
+* @param Event [in] Event name
+* @param Round [in] Round
+* @param Rule [in] Rules
+* @param Komi [in] Komi
+* @param Date [in] Date of the games
+* @param Time [in] Time of the games
+* @return true if all boards are ready
+*/
+bool TournamentHost::Start( Omiscid::SimpleString Folder, Omiscid::SimpleString& Event, Omiscid::SimpleString& Round, Omiscid::SimpleString& Rule, Omiscid::SimpleString& Komi,
+							Omiscid::SimpleString& Date, Omiscid::SimpleString& Time )
+{
+	for ( size_t Board = 0; Board < Boards.size(); Board++ )
+	{
+		HostedBoard& CurBoard = *Boards[Board];
+
+		// Goban *must* be empty
+		if ( CurBoard.Vid.ReadFrame( CurBoard.LoadImage, CurBoard.DepthImage ) == false )
+		{
+			fprintf( stderr, "Could not read init frame of '%s', abording...\n", CurBoard.SourceName.GetStr() );
+			return false;
+		}
+
+		if ( CurBoard.DepthImage.empty() == false )
+		{
+			// Depth is present, use it as motion detector
+			CurBoard.Goban.InitDetection( CurBoard.DepthImage );
+		}
+		else
+		{
+			CurBoard.Goban.InitDetection( CurBoard.LoadImage );
+		}
+
+		CurBoard.StateImage = cv::Mat( HostStateImageSize, HostStateImageSize, CV_8UC3 );
+		CurBoard.Goban.GameState.DrawGoban( CurBoard.StateImage );
+
+		if ( CurBoard.Goban.GameState.SGFWriter.Open( Folder, Event, Round, Rule, Komi, Date, Time, CurBoard.BlackPlayerName, CurBoard.WhitePlayerName ) == false )
+		{
+			fprintf( stderr, "Could not open output SGF file of '%s', abording...\n", CurBoard.SourceName.GetStr() );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+* @brief Process all boards until ESC or the end of all sources
+* @param NbWorkers [in] Number of worker threads of the pool
+*/
+void TournamentHost::Run( int NbWorkers )
+{
+	// Cell loops of each board run sequentially, the pool owns the cores
+	cv::setNumThreads( 0 );
+
+	Pool = new WorkStealingPool( NbWorkers );
+	fprintf( stderr, "Start hosting %d boards with %d workers!\n", (int)Boards.size(), Pool->GetNbWorkers() );
+
+	Stopping = false;
+	for ( size_t Board = 0; Board < Boards.size(); Board++ )
+	{
+		Boards[Board]->Pending = true;
+		Pool->Submit( Boards[Board] );
+	}
+
+	// One window for all boards, show game state of the selected one
+	Omiscid::PerfElapsedTime ReportTime;
+	int Selected = 0;
+	cv::Mat ShowImage;
+	for(;;)
+	{
+		int NbRunning = 0;
+		for ( size_t Board = 0; Board < Boards.size(); Board++ )
+		{
+			if ( Boards[Board]->Finished == false )
+			{
+				NbRunning++;
+			}
+		}
+
+		if ( NbRunning == 0 )
+		{
+			break;
+		}
+
+		// See MainGo.cpp about closing window
+		if ( cv::getTrackbarPos( "Black Threshold", HostWindowName ) == -1 )
+		{
+			cv::namedWindow( HostWindowName );
+			cv::createTrackbar( "Black Threshold", HostWindowName, &SingleConfig.BlackThreshold, MaxThresholdForColorDetection );
+			cv::createTrackbar( "White Threshold", HostWindowName, &SingleConfig.WhiteThreshold, MaxThresholdForColorDetection );
+		}
+
+		{
+			Omiscid::SmartLocker SL_Protect( Boards[Selected]->Protect );
+			Boards[Selected]->StateImage.copyTo( ShowImage );
+		}
+
+		char BoardTitle[256];
+		snprintf( BoardTitle, sizeof(BoardTitle), "Board %d/%d: %s", Selected+1, (int)Boards.size(), Boards[Selected]->SourceName.GetStr() );
+		cv::putText( ShowImage, BoardTitle, cv::Point( 5, 15 ), cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar( 0, 0, 255 ) );
+		cv::imshow( HostWindowName, ShowImage );
+
+		// 'n'/'p' select next/previous board
+		char KeyPressed = cv::waitKey( 40 );
+		if ( KeyPressed == 27 )
+		{
+			break;
+		}
+		if ( KeyPressed == 'n' || KeyPressed == 'N' )
+		{
+			Selected = (Selected+1)%(int)Boards.size();
+		}
+		if ( KeyPressed == 'p' || KeyPressed == 'P' )
+		{
+			Selected = (Selected+(int)Boards.size()-1)%(int)Boards.size();
+		}
+
+		if ( ReportTime.GetInSeconds() >= HostStatsReportTime )
+		{
+			for ( size_t Board = 0; Board < Boards.size(); Board++ )
+			{
+				Boards[Board]->ReportStats( (int)Board+1, stderr );
+			}
+			fprintf( stderr, "Stolen tasks: %lld\n", Pool->GetNbSteals() );
+			ReportTime.Reset();
+		}
+	}
+
+	// Let the frames in progress end before stopping workers
+	Stopping = true;
+	for ( size_t Board = 0; Board < Boards.size(); Board++ )
+	{
+		while ( Boards[Board]->Pending == true )
+		{
+			Omiscid::Thread::Sleep( HostStopPollTime );
+		}
+	}
+
+	delete Pool;
+	Pool = nullptr;
+
+	cv::destroyAllWindows();
+}
+
+/**
+* @brief Print final statistics of all boards
+* @param fout [in] Output file (default=stderr)
+*/
+void TournamentHost::Report( FILE * fout /* = stderr */ )
+{
+	for ( size_t Board = 0; Board < Boards.size(); Board++ )
+	{
+		HostedBoard& CurBoard = *Boards[Board];
+
+		fprintf( fout, "\nBoard %d/%d (%s): %lld frames\n", (int)Board+1, (int)Boards.size(), CurBoard.SourceName.GetStr(), CurBoard.TotalFrames );
+		CurBoard.Goban.GameState.ReportCommitLatencies( fout );
+		CurBoard.Goban.ReportBudget( fout );
+	}
+}
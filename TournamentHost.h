@@ -0,0 +1,158 @@
+/**
+ * @file TournamentHost.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __TOURNAMENT_HOST_H__
+#define __TOURNAMENT_HOST_H__
+
+#include "Go-CamRecorder.h"
+#include "GobanDetector.h"
+#include "MultiSourceVideo.h"
+#include "WorkStealingPool.h"
+
+#include <atomic>
+#include <vector>
+
+#define HostStatsReportTime 10.0			// Time (s) between 2 reports of per board statistics
+#define HostStateImageSize 400				// Size of the game state image of each board
+#define HostStopPollTime 1					// Sleep time (ms) while waiting for the frames in progress at stop
+#define HostWindowName "Tournament host... ESC to terminate game recordings."
+
+class TournamentHost;
+
+/**
+ * @class HostedBoard
+ * @brief One board of a tournament host: a video source, its goban detector and its SGF. Each task execution
+ *		  reads and processes one frame, then the board submits itself again (urgent if the goban is changing).
+ */
+class HostedBoard : public PoolTask
+{
+public:
+	/**
+    * @brief Constructor
+    * @param _Host [in] Tournament host of the board
+    * @param _SourceName [in] Device number or video file of the board
+    * @param NumColumns [in] Number of columns of the goban
+    * @param NumLines [in] Number of lines of the goban
+	*/
+	HostedBoard( TournamentHost& _Host, const Omiscid::SimpleString& _SourceName, int NumColumns, int NumLines ) :
+		Host(_Host), SourceName(_SourceName), Goban(NumColumns, NumLines), Pending(false), Finished(false)
+	{
+	}
+
+	/**
+    * @brief Virtual destructor
+	*/
+	virtual ~HostedBoard() {}
+
+	/**
+    * @brief Read and process one frame of the board, called from a worker of the pool
+	*/
+	virtual void Execute();
+
+	/**
+    * @brief Print statistics since the last report and reset them
+    * @param Board [in] Number of the board
+    * @param fout [in] Output file (default=stderr)
+	*/
+	void ReportStats( int Board, FILE * fout = stderr );
+
+	TournamentHost& Host;						// Tournament host of the board
+	Omiscid::SimpleString SourceName;			// Device number or video file
+	Omiscid::SimpleString BlackPlayerName;		// Black player name
+	Omiscid::SimpleString WhitePlayerName;		// White player name
+
+	MultiVideoSource Vid;						// Video source of the board
+	GobanDetector Goban;						// Goban detector of the board
+	cv::Mat LoadImage;							// Current color frame
+	cv::Mat DepthImage;							// Current depth frame, if any
+
+	std::atomic<bool> Pending;					// Is the board in the pool (queued or in progress)?
+	std::atomic<bool> Finished;					// End of the video source
+
+	Omiscid::Mutex Protect;						// Mutex for multithreading access to the state image and statistics
+	cv::Mat StateImage;							// Current game state of the board
+
+	// Statistics since the last report
+	Omiscid::PerfElapsedTime StatsTime;			// Time since the last report
+	long long int NbFrames = 0;					// Number of processed frames
+	double SumWait = 0.0;						// Sum of waiting times in the pool
+	double SumLag = 0.0;						// Sum of times between submission and end of processing
+	double MaxLag = 0.0;						// Max time between submission and end of processing
+	long long int TotalFrames = 0;				// Number of processed frames since the beginning
+};
+
+/**
+ * @class TournamentHost
+ * @brief Host many boards, each one with its own video source, in a single process. All boards share one
+ *		  work-stealing pool of workers, boards with motion on their goban get CPU first.
+ */
+class TournamentHost
+{
+public:
+	/**
+    * @brief Constructor
+    * @param _NumColumns [in] Number of columns of the gobans
+    * @param _NumLines [in] Number of lines of the gobans
+	*/
+	TournamentHost( int _NumColumns, int _NumLines ) : NumColumns(_NumColumns), NumLines(_NumLines), Stopping(false)
+	{
+	}
+
+	/**
+    * @brief Virtual destructor
+	*/
+	virtual ~TournamentHost();
+
+	/**
+    * @brief Load boards from a host file. Each line is 'source[;black player name[;white player name]]',
+	*		 empty lines and lines starting with '#' are ignored.
+    * @param HostFileName [in] Name of the host file
+    * @return true if at least one board was loaded
+	*/
+	bool LoadBoards( const char * HostFileName );
+
+	/**
+    * @brief Open video sources and retrieve or compute calibration of all boards
+    * @return true if all sources are opened and calibrated
+	*/
+	bool Calibrate();
+
+	/**
+    * @brief Init detection and open SGF files of all boards
+    * @param Folder [in] Output folder of SGF files
+    * @param Event [in] Event name
+    * @param Round [in] Round
+    * @param Rule [in] Rules
+    * @param Komi [in] Komi
+    * @param Date [in] Date of the games
+    * @param Time [in] Time of the games
+    * @return true if all boards are ready
+	*/
+	bool Start( Omiscid::SimpleString Folder, Omiscid::SimpleString& Event, Omiscid::SimpleString& Round, Omiscid::SimpleString& Rule, Omiscid::SimpleString& Komi,
+				Omiscid::SimpleString& Date, Omiscid::SimpleString& Time );
+
+	/**
+    * @brief Process all boards until ESC or the end of all sources
+    * @param NbWorkers [in] Number of worker threads of the pool
+	*/
+	void Run( int NbWorkers );
+
+	/**
+    * @brief Print final statistics of all boards
+    * @param fout [in] Output file (default=stderr)
+	*/
+	void Report( FILE * fout = stderr );
+
+	std::vector<HostedBoard*> Boards;			// Hosted boards
+	int NumColumns;								// Number of columns of the gobans
+	int NumLines;								// Number of lines of the gobans
+	WorkStealingPool * Pool = nullptr;			// Pool of workers while running
+	std::atomic<bool> Stopping;					// Boards must not submit new frames
+};
+
+#endif // __TOURNAMENT_HOST_H__
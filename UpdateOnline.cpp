@@ -22,6 +22,11 @@ bool UploadOnline::UploadOnServeur( bool EndGame /* = false */ )
 
 		if ( EndGame == false )
 		{
+			// Provisional moves after committed ones
+			for ( size_t Pos = 0; Pos < ProvisionalNodes.size(); Pos++ )
+			{
+				JsonMsg += ProvisionalNodes[Pos];
+			}
 			JsonMsg += ")\",\"End\":\"0\"}";
 		}
 		else
@@ -113,11 +118,26 @@ void FUNCTION_CALL_TYPE UploadOnline::Run()
 
 /**
 * @brief Init SGF file for upload.
-* @param GobanSize [in] Size of goban
+* @param NumColumns [in] Number of columns of the goban
+* @param NumLines [in] Number of lines of the goban
 * @param FileName [in] SGF file name
 * @param FileName [in] SGF Header (event, player names, komi, rules ...)
 */
-void UploadOnline::InitDistantSGF( int GobanSize, const Omiscid::SimpleString& FileName, const Omiscid::SimpleString& SGFHeader )
+void UploadOnline::InitDistantSGF( int NumColumns, int NumLines, const Omiscid::SimpleString& FileName, const Omiscid::SimpleString& SGFHeader )
+{
+	ResumeDistantSGF( NumColumns, NumLines, FileName, SGFHeader, std::vector<Omiscid::SimpleString>(), -1 );
+}
+
+/**
+* @brief Init SGF file for upload with moves already played, after restart of a recording session.
+* @param NumColumns [in] Number of columns of the goban
+* @param NumLines [in] Number of lines of the goban
+* @param FileName [in] SGF file name
+* @param SGFHeader [in] SGF Header (event, player names, komi, rules ...)
+* @param Moves [in] Moves already played
+* @param Version [in] Version of the SGF file when it was saved
+*/
+void UploadOnline::ResumeDistantSGF( int NumColumns, int NumLines, const Omiscid::SimpleString& FileName, const Omiscid::SimpleString& SGFHeader, const std::vector<Omiscid::SimpleString>& Moves, int Version )
 {
 	if ( IsConfigured() == false )
 	{
@@ -140,12 +160,21 @@ void UploadOnline::InitDistantSGF( int GobanSize, const Omiscid::SimpleString& F
 
 	// Init begining of file
 	CurrentFileContent = SGFHeader + "\\n";
+	MoveOffsets.clear();
+	this->NumLines = NumLines;
+	ProvisionalCells.clear();
+	ProvisionalNodes.clear();
+	for ( size_t Pos = 0; Pos < Moves.size(); Pos++ )
+	{
+		MoveOffsets.push_back( CurrentFileContent.GetLength() );
+		CurrentFileContent += Moves[Pos] + "\\n";
+	}
 
 	// Generate Precomputed header, could use JSon serialization facility
 	PrecomputedJson = "{\"APIKey\":\"" + Omiscid::SimpleString( APIKey ) + "\",\"FileName\":\"" + FileName + "\",\"FileContent\":\"";
 
-	// Sure to restart sending in thread
-	ValueUpdate = -1;
+	// Sure to restart sending in thread (the thread starts with version 0)
+	ValueUpdate = ( Version == 0 ) ? -1 : Version;
 
 	// Start my thread part
 	StartThread();
@@ -166,11 +195,37 @@ void UploadOnline::AddMove( const Omiscid::SimpleString NewMove )
 	Omiscid::SmartLocker SL_ProtectCurrentFileContent( ProtectCurrentFileContent );
 
 	// Add move followed by line return, no check here about content!
+	MoveOffsets.push_back( CurrentFileContent.GetLength() );
 	CurrentFileContent += NewMove + "\\n";
 
 	ValueUpdate++;
 }
 
+/**
+* @brief Remove moves at the end of the SGF, after a correction.
+* @param NbMoves [in] Number of moves to keep.
+*/
+void UploadOnline::TruncateMoves( int NbMoves )
+{
+	if ( IsConfigured() == false || IsRunning() == false )
+	{
+		return;
+	}
+
+	// Lock file content
+	Omiscid::SmartLocker SL_ProtectCurrentFileContent( ProtectCurrentFileContent );
+
+	if ( NbMoves < 0 || NbMoves >= (int)MoveOffsets.size() )
+	{
+		return;
+	}
+
+	CurrentFileContent = CurrentFileContent.SubString( 0, MoveOffsets[NbMoves] );
+	MoveOffsets.resize( NbMoves );
+
+	ValueUpdate++;
+}
+
 /**
 * @brief End the SGF file, add result if provided by the user and make a last upload.
 * @param Result [in] Game result computed by a human.
@@ -196,4 +251,86 @@ void UploadOnline::EndDistantSGF( Omiscid::SimpleString Result )
 
 	// End my thread part, wait for sending last data for 5s max
 	StopThread( 5000 );
+}
+
+/**
+* @brief Remove the provisional move of a cell, if any. Lock must be done at upper level.
+* @param Cell [in] Cell of the move (a*NumLines+b)
+* @return true if a provisional move was removed.
+*/
+bool UploadOnline::RemoveProvisionalMove( int Cell )
+{
+	for ( size_t Pos = 0; Pos < ProvisionalCells.size(); Pos++ )
+	{
+		if ( ProvisionalCells[Pos] == Cell )
+		{
+			ProvisionalCells.erase( ProvisionalCells.begin()+Pos );
+			ProvisionalNodes.erase( ProvisionalNodes.begin()+Pos );
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+* @brief A stone is seen on a settled detector, upload it without waiting for the commit
+*/
+void UploadOnline::ProvisionalMove( int Color, int a, int b, double Timestamp )
+{
+	if ( IsConfigured() == false || IsRunning() == false )
+	{
+		return;
+	}
+
+	// Lock file content
+	Omiscid::SmartLocker SL_ProtectCurrentFileContent( ProtectCurrentFileContent );
+
+	Omiscid::SimpleString NewNode = ";";
+	NewNode += (Color == StoneState::Black ? 'B' : 'W');
+	NewNode += '[';
+	NewNode += (char)('a'+a);
+	NewNode += (char)('a'+b);
+	NewNode += "]C[Provisional move]\\n";
+
+	RemoveProvisionalMove( a*NumLines+b );
+	ProvisionalCells.push_back( a*NumLines+b );
+	ProvisionalNodes.push_back( NewNode );
+
+	ValueUpdate++;
+}
+
+/**
+* @brief A move is committed, it was added by the SGF file: remove its provisional version
+*/
+void UploadOnline::ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp )
+{
+	if ( IsConfigured() == false || IsRunning() == false )
+	{
+		return;
+	}
+
+	// Lock file content
+	Omiscid::SmartLocker SL_ProtectCurrentFileContent( ProtectCurrentFileContent );
+	if ( RemoveProvisionalMove( a*NumLines+b ) == true )
+	{
+		ValueUpdate++;
+	}
+}
+
+/**
+* @brief A provisional move disappeared (NumMove is 0). Undone committed moves are truncated by the SGF file.
+*/
+void UploadOnline::RetractedMove( int NumMove, int Color, int a, int b, double Timestamp )
+{
+	if ( NumMove != 0 || IsConfigured() == false || IsRunning() == false )
+	{
+		return;
+	}
+
+	// Lock file content
+	Omiscid::SmartLocker SL_ProtectCurrentFileContent( ProtectCurrentFileContent );
+	if ( RemoveProvisionalMove( a*NumLines+b ) == true )
+	{
+		ValueUpdate++;
+	}
 }
\ No newline at end of file
@@ -12,14 +12,21 @@
 #include <System/Mutex.h>
 #include <System/Thread.h>
 
+#include "StoneState.h"
+#include "GameEventListener.h"
+
+#include <vector>
+
 // API Key to prevent upload from unknown clients
 #define APIKey "TO_BE_DEFINED"					// This key must be defined at compile time to permits upload on the server
 
 /**
  * @class UploadOnline 
  * @brief Thread to upload when mandatory (if a modification appears) on the Web site using UploadSGF.php file.
+ *		  Committed moves come from the SGF file. As a GameEventListener, provisional moves are uploaded
+ *		  at the end of the game with a comment, as soon as they are seen, until they are confirmed or retracted.
  */
-class UploadOnline : public Omiscid::Thread
+class UploadOnline : public Omiscid::Thread, public GameEventListener
 {
 protected:
 	Omiscid::SimpleString Host;					// HTTP host
@@ -28,6 +35,10 @@ protected:
 
 	Omiscid::Mutex ProtectCurrentFileContent;	// Mutex for multithreading access
 	Omiscid::SimpleString CurrentFileContent;	// Current file content
+	std::vector<unsigned int> MoveOffsets;		// Length of the file content before each move
+	int NumLines;								// Number of lines of the goban
+	std::vector<int> ProvisionalCells;			// Cells of provisional moves (a*NumLines+b), in order of appearance
+	std::vector<Omiscid::SimpleString> ProvisionalNodes;	// SGF nodes of provisional moves
 	int ValueUpdate;							// ValueUpate, aka version number of the SGF file.
 	Omiscid::SimpleString PrecomputedJson;		// Precomputed Json Header
 	Omiscid::SimpleString PrecomputedHeader;	// Precomputed HTTP header
@@ -45,6 +56,13 @@ protected:
 	*/
 	void SendIt(int& LastUpdateValue);
 
+	/**
+	* @brief Remove the provisional move of a cell, if any. Lock must be done at upper level.
+	* @param Cell [in] Cell of the move (a*NumLines+b)
+	* @return true if a provisional move was removed.
+	*/
+	bool RemoveProvisionalMove( int Cell );
+
 public:
 	/**
 	* @brief Constructor
@@ -58,6 +76,7 @@ public:
 		URL = RemoteURL;
 		HTTPPort = RemoteHTTPPort;
 		ValueUpdate = 0;
+		NumLines = 0;
 	}
 
 	/**
@@ -79,11 +98,33 @@ public:
 
 	/**
 	* @brief Init SGF file for upload.
-	* @param GobanSize [in] Size of goban
+	* @param NumColumns [in] Number of columns of the goban
+	* @param NumLines [in] Number of lines of the goban
 	* @param FileName [in] SGF file name
 	* @param FileName [in] SGF Header (event, player names, komi, rules ...)
 	*/
-	void InitDistantSGF( int GobanSize, const Omiscid::SimpleString& FileName, const Omiscid::SimpleString& SGFHeader );
+	void InitDistantSGF( int NumColumns, int NumLines, const Omiscid::SimpleString& FileName, const Omiscid::SimpleString& SGFHeader );
+
+	/**
+	* @brief Init SGF file for upload with moves already played, after restart of a recording session.
+	* @param NumColumns [in] Number of columns of the goban
+	* @param NumLines [in] Number of lines of the goban
+	* @param FileName [in] SGF file name
+	* @param SGFHeader [in] SGF Header (event, player names, komi, rules ...)
+	* @param Moves [in] Moves already played
+	* @param Version [in] Version of the SGF file when it was saved
+	*/
+	void ResumeDistantSGF( int NumColumns, int NumLines, const Omiscid::SimpleString& FileName, const Omiscid::SimpleString& SGFHeader, const std::vector<Omiscid::SimpleString>& Moves, int Version );
+
+	/**
+	* @brief Get version of the SGF file
+	* @return Version, changed each time the SGF file changes
+	*/
+	inline int GetVersion()
+	{
+		Omiscid::SmartLocker SL_ProtectCurrentFileContent( ProtectCurrentFileContent );
+		return ValueUpdate;
+	}
 
 	/**
 	* @brief Add a new move at the end of the SGF. 
@@ -91,11 +132,22 @@ public:
 	*/
 	void AddMove(const Omiscid::SimpleString NewMove);
 
+	/**
+	* @brief Remove moves at the end of the SGF, after a correction.
+	* @param NbMoves [in] Number of moves to keep.
+	*/
+	void TruncateMoves( int NbMoves );
+
 	/**
 	* @brief End the SGF file, add result if provided by the user and make a last upload.
 	* @param Result [in] Game result computed by a human.
 	*/
 	void EndDistantSGF(Omiscid::SimpleString Result);
+
+	// Game events
+	virtual void ProvisionalMove( int Color, int a, int b, double Timestamp );
+	virtual void ConfirmedMove( int NumMove, int Color, int a, int b, const char * Comment, double Timestamp );
+	virtual void RetractedMove( int NumMove, int Color, int a, int b, double Timestamp );
 };
 
 #endif
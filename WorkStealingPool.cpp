@@ -0,0 +1,170 @@
+/**
+ * @file WorkStealingPool.cpp
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+#include "WorkStealingPool.h"
+
+/**
+* @brief Constructor, start workers
+* @param NbWorkers [in] Number of worker threads (min 1)
+* @param _StarvationDelay [in] Time (s) after which a waiting task runs before urgent ones
+*/
+WorkStealingPool::WorkStealingPool( int NbWorkers, double _StarvationDelay /* = DefaultStarvationDelay */ ) :
+	StarvationDelay(_StarvationDelay), NextWorker(0), NbSteals(0), NbQueuedTasks(0), NbUrgentTasks(0)
+{
+	if ( NbWorkers < 1 )
+	{
+		NbWorkers = 1;
+	}
+
+	for ( int Id = 0; Id < NbWorkers; Id++ )
+	{
+		Workers.push_back( new Worker( *this, Id ) );
+	}
+
+	// Start workers once all queues exist, they may steal from each other
+	for ( size_t Id = 0; Id < Workers.size(); Id++ )
+	{
+		Workers[Id]->StartThread();
+	}
+}
+
+/**
+* @brief Virtual destructor, stop workers (tasks still in queues are not executed)
+*/
+/* virtual */ WorkStealingPool::~WorkStealingPool()
+{
+	for ( size_t Id = 0; Id < Workers.size(); Id++ )
+	{
+		Workers[Id]->StopThread( 10000 );
+	}
+
+	for ( size_t Id = 0; Id < Workers.size(); Id++ )
+	{
+		delete Workers[Id];
+	}
+}
+
+/**
+* @brief Submit a task to the pool
+* @param Task [in] Task to execute, must live until its execution ends
+* @param Urgent [in] Shall the task run before other ones?
+*/
+void WorkStealingPool::Submit( PoolTask * Task, bool Urgent /* = false */ )
+{
+	Task->Urgent = Urgent;
+	Task->WaitTime.Reset();
+
+	// Spread tasks over queues, idle workers will balance the load
+	Worker& Target = *Workers[NextWorker++ % (unsigned int)Workers.size()];
+
+	Omiscid::SmartLocker SL_ProtectTasks( Target.ProtectTasks );
+	Target.Tasks.push_back( Task );
+	NbQueuedTasks++;
+	if ( Urgent == true )
+	{
+		NbUrgentTasks++;
+	}
+	SL_ProtectTasks.Unlock();
+
+	TaskAvailable.Signal();
+}
+
+/**
+* @brief Get next task for a worker, from its own queue or stolen from another queue
+* @param Id [in] Position of the worker in the pool
+* @return Task or nullptr if all queues are empty
+*/
+PoolTask * WorkStealingPool::GetTask( int Id )
+{
+	// Urgent tasks of all queues first (own queue first), then other tasks
+	for ( int UrgentOnly = (NbUrgentTasks > 0 ? 1 : 0); UrgentOnly >= 0; UrgentOnly-- )
+	{
+		for ( size_t Offset = 0; Offset < Workers.size(); Offset++ )
+		{
+			PoolTask * Task = Workers[(Id+Offset) % Workers.size()]->TakeTask( StarvationDelay, UrgentOnly == 1 );
+			if ( Task != nullptr )
+			{
+				if ( Offset != 0 )
+				{
+					NbSteals++;
+				}
+				return Task;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+/**
+* @brief Take the next task of the queue according to starvation and urgency
+* @param StarvationDelay [in] Time (s) after which a waiting task runs before urgent ones
+* @param UrgentOnly [in] Shall we take only a starving or an urgent task?
+* @return Task or nullptr if the queue has no such task
+*/
+PoolTask * WorkStealingPool::Worker::TakeTask( double StarvationDelay, bool UrgentOnly )
+{
+	Omiscid::SmartLocker SL_ProtectTasks( ProtectTasks );
+
+	if ( Tasks.empty() == true )
+	{
+		return nullptr;
+	}
+
+	// Oldest task first if it waits for too long, else first urgent task, else oldest task
+	std::deque<PoolTask*>::iterator Selected = Tasks.begin();
+	if ( (*Selected)->WaitTime.GetInSeconds() < StarvationDelay )
+	{
+		std::deque<PoolTask*>::iterator it;
+		for ( it = Tasks.begin(); it != Tasks.end(); it++ )
+		{
+			if ( (*it)->Urgent == true )
+			{
+				Selected = it;
+				break;
+			}
+		}
+
+		if ( it == Tasks.end() && UrgentOnly == true )
+		{
+			return nullptr;
+		}
+	}
+
+	PoolTask * Task = *Selected;
+	Tasks.erase( Selected );
+	Pool.NbQueuedTasks--;
+	if ( Task->Urgent == true )
+	{
+		Pool.NbUrgentTasks--;
+	}
+	return Task;
+}
+
+/** @brief Execute own tasks or stolen ones until the pool stops
+*/
+void FUNCTION_CALL_TYPE WorkStealingPool::Worker::Run()
+{
+	while ( StopPending() == false )
+	{
+		PoolTask * Task = Pool.GetTask( Id );
+		if ( Task == nullptr )
+		{
+			// Wake up on submission, or regularly to check if we must stop
+			Pool.TaskAvailable.Wait( IdleWorkerWaitTime );
+			continue;
+		}
+
+		// Several tasks may have been submitted for a single wake up, wake up another worker
+		if ( Pool.NbQueuedTasks > 0 )
+		{
+			Pool.TaskAvailable.Signal();
+		}
+
+		Task->Execute();
+	}
+}
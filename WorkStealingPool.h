@@ -0,0 +1,148 @@
+/**
+ * @file WorkStealingPool.h
+ * @ingroup Go-CamRecorder
+ * @author Dominique Vaufreydaz, personnal project
+ * @copyright All right reserved.
+ */
+
+
+#ifndef __WORK_STEALING_POOL_H__
+#define __WORK_STEALING_POOL_H__
+
+#include <System/Event.h>
+#include <System/Mutex.h>
+#include <System/Thread.h>
+#include <System/ElapsedTime.h>
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#define DefaultStarvationDelay 0.5		// Time (s) after which a waiting task runs before urgent ones
+#define IdleWorkerWaitTime 100			// Max wait time (ms) of a worker without task before checking if it must stop
+
+/**
+ * @class PoolTask
+ * @brief Task to run in a WorkStealingPool. A task must not be submitted again before its Execute call ends.
+ */
+class PoolTask
+{
+public:
+	/**
+	* @brief Virtual destructor
+	*/
+	virtual ~PoolTask() {}
+
+	/**
+	* @brief Work of the task, called from a worker thread
+	*/
+	virtual void Execute() = 0;
+
+	bool Urgent = false;						// Urgent tasks run first (if no task is starving)
+	Omiscid::PerfElapsedTime WaitTime;			// Time since submission
+};
+
+/**
+ * @class WorkStealingPool
+ * @brief Pool of worker threads, each one with its own task queue. Idle workers steal tasks from other queues.
+ *		  Within a queue, a task waiting for more than StarvationDelay comes first, then urgent tasks, then
+ *		  other tasks in submission order. Urgent tasks of all queues are taken before non-urgent local ones.
+ *		  Thus urgent tasks get CPU first but no task is starved. Idle workers wait for submissions.
+ */
+class WorkStealingPool
+{
+public:
+	/**
+    * @brief Constructor, start workers
+    * @param NbWorkers [in] Number of worker threads (min 1)
+    * @param _StarvationDelay [in] Time (s) after which a waiting task runs before urgent ones
+	*/
+	WorkStealingPool( int NbWorkers, double _StarvationDelay = DefaultStarvationDelay );
+
+	/**
+    * @brief Virtual destructor, stop workers (tasks still in queues are not executed)
+	*/
+	virtual ~WorkStealingPool();
+
+	/**
+    * @brief Submit a task to the pool
+    * @param Task [in] Task to execute, must live until its execution ends
+    * @param Urgent [in] Shall the task run before other ones?
+	*/
+	void Submit( PoolTask * Task, bool Urgent = false );
+
+	/**
+    * @brief Get number of worker threads
+    * @return Number of workers
+	*/
+	inline int GetNbWorkers()
+	{
+		return (int)Workers.size();
+	}
+
+	/**
+    * @brief Get number of tasks executed by another worker than the one they were submitted to
+    * @return Number of stolen tasks
+	*/
+	inline long long int GetNbSteals()
+	{
+		return NbSteals.load();
+	}
+
+protected:
+	/**
+	 * @class Worker
+	 * @brief Worker thread with its own task queue
+	 */
+	class Worker : public Omiscid::Thread
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param _Pool [in] Pool of the worker
+		* @param _Id [in] Position of the worker in the pool
+		*/
+		Worker( WorkStealingPool& _Pool, int _Id ) : Pool(_Pool), Id(_Id)
+		{
+		}
+
+		/**
+		* @brief Virtual destructor
+		*/
+		virtual ~Worker() {}
+
+		/** @brief Execute own tasks or stolen ones until the pool stops
+		 */
+		virtual void FUNCTION_CALL_TYPE Run();
+
+		/**
+		* @brief Take the next task of the queue according to starvation and urgency
+		* @param StarvationDelay [in] Time (s) after which a waiting task runs before urgent ones
+		* @param UrgentOnly [in] Shall we take only a starving or an urgent task?
+		* @return Task or nullptr if the queue has no such task
+		*/
+		PoolTask * TakeTask( double StarvationDelay, bool UrgentOnly );
+
+		WorkStealingPool& Pool;					// Pool of the worker
+		int Id;									// Position of the worker in the pool
+		Omiscid::Mutex ProtectTasks;			// Mutex for multithreading access to Tasks
+		std::deque<PoolTask*> Tasks;			// Tasks in submission order
+	};
+
+	/**
+	* @brief Get next task for a worker, from its own queue or stolen from another queue
+	* @param Id [in] Position of the worker in the pool
+	* @return Task or nullptr if all queues are empty
+	*/
+	PoolTask * GetTask( int Id );
+
+	std::vector<Worker*> Workers;				// Worker threads
+	double StarvationDelay;						// Time (s) after which a waiting task runs before urgent ones
+	std::atomic<unsigned int> NextWorker;		// Worker receiving the next submitted task
+	std::atomic<long long int> NbSteals;		// Number of stolen tasks
+	std::atomic<int> NbQueuedTasks;				// Number of tasks in all queues
+	std::atomic<int> NbUrgentTasks;				// Number of urgent tasks in all queues
+	Omiscid::Event TaskAvailable;				// Signaled when a task is submitted
+};
+
+#endif // __WORK_STEALING_POOL_H__